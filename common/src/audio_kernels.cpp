@@ -0,0 +1,639 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <string.h>
+
+#include "audio_kernels.h"
+#include "cpu_features.h"
+
+#if defined(STEAMAUDIO_SIMD_X86)
+#include <immintrin.h>
+#elif defined(STEAMAUDIO_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// Scalar Kernels
+// --------------------------------------------------------------------------------------------------------------------
+
+// Each kernel processes samples [start, numSamples), so the SIMD kernels can hand their remainders to these. The gain
+// for sample i is always computed as startGain + i * step, rather than accumulated, so all implementations produce the
+// same ramp.
+
+static float rampStep(float startGain,
+                      float endGain,
+                      int numSamples)
+{
+    return (numSamples > 0) ? (endGain - startGain) / static_cast<float>(numSamples) : 0.0f;
+}
+
+static void applyRampScalar(const float* in,
+                            float startGain,
+                            float step,
+                            int start,
+                            int numSamples,
+                            float* out)
+{
+    for (auto i = start; i < numSamples; ++i)
+    {
+        out[i] = in[i] * (startGain + static_cast<float>(i) * step);
+    }
+}
+
+static void mixIntoScalar(const float* in,
+                          int start,
+                          int numSamples,
+                          float* out)
+{
+    for (auto i = start; i < numSamples; ++i)
+    {
+        out[i] += in[i];
+    }
+}
+
+static void rampMixInterleaveStereoScalar(const float* in0,
+                                          const float* in1,
+                                          const float* mix0,
+                                          const float* mix1,
+                                          float startGain,
+                                          float step,
+                                          int start,
+                                          int numSamples,
+                                          float* out)
+{
+    for (auto i = start; i < numSamples; ++i)
+    {
+        auto gain = startGain + static_cast<float>(i) * step;
+        out[2 * i + 0] = in0[i] * gain + (mix0 ? mix0[i] : 0.0f);
+        out[2 * i + 1] = in1[i] * gain + (mix1 ? mix1[i] : 0.0f);
+    }
+}
+
+static void deinterleaveDownmixStereoScalar(const float* in,
+                                            int start,
+                                            int numSamples,
+                                            float* out0,
+                                            float* out1,
+                                            float* mono)
+{
+    for (auto i = start; i < numSamples; ++i)
+    {
+        auto left = in[2 * i + 0];
+        auto right = in[2 * i + 1];
+
+        if (out0)
+        {
+            out0[i] = left;
+            out1[i] = right;
+        }
+
+        if (mono)
+        {
+            mono[i] = 0.5f * (left + right);
+        }
+    }
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// SSE2 Kernels
+// --------------------------------------------------------------------------------------------------------------------
+
+#if defined(STEAMAUDIO_SIMD_X86)
+
+STEAMAUDIO_TARGET_SSE2
+static void applyRampSSE2(const float* in,
+                          float startGain,
+                          float step,
+                          int numSamples,
+                          float* out)
+{
+    const auto offsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const auto startGains = _mm_set1_ps(startGain);
+    const auto steps = _mm_set1_ps(step);
+
+    auto i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        auto indices = _mm_add_ps(_mm_set1_ps(static_cast<float>(i)), offsets);
+        auto gains = _mm_add_ps(startGains, _mm_mul_ps(indices, steps));
+        _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_loadu_ps(&in[i]), gains));
+    }
+
+    applyRampScalar(in, startGain, step, i, numSamples, out);
+}
+
+STEAMAUDIO_TARGET_SSE2
+static void mixIntoSSE2(const float* in,
+                        int numSamples,
+                        float* out)
+{
+    auto i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        _mm_storeu_ps(&out[i], _mm_add_ps(_mm_loadu_ps(&out[i]), _mm_loadu_ps(&in[i])));
+    }
+
+    mixIntoScalar(in, i, numSamples, out);
+}
+
+STEAMAUDIO_TARGET_SSE2
+static void rampMixInterleaveStereoSSE2(const float* in0,
+                                        const float* in1,
+                                        const float* mix0,
+                                        const float* mix1,
+                                        float startGain,
+                                        float step,
+                                        int numSamples,
+                                        float* out)
+{
+    const auto offsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const auto startGains = _mm_set1_ps(startGain);
+    const auto steps = _mm_set1_ps(step);
+
+    auto i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        auto indices = _mm_add_ps(_mm_set1_ps(static_cast<float>(i)), offsets);
+        auto gains = _mm_add_ps(startGains, _mm_mul_ps(indices, steps));
+
+        auto left = _mm_mul_ps(_mm_loadu_ps(&in0[i]), gains);
+        auto right = _mm_mul_ps(_mm_loadu_ps(&in1[i]), gains);
+
+        if (mix0)
+        {
+            left = _mm_add_ps(left, _mm_loadu_ps(&mix0[i]));
+            right = _mm_add_ps(right, _mm_loadu_ps(&mix1[i]));
+        }
+
+        _mm_storeu_ps(&out[2 * i + 0], _mm_unpacklo_ps(left, right));
+        _mm_storeu_ps(&out[2 * i + 4], _mm_unpackhi_ps(left, right));
+    }
+
+    rampMixInterleaveStereoScalar(in0, in1, mix0, mix1, startGain, step, i, numSamples, out);
+}
+
+STEAMAUDIO_TARGET_SSE2
+static void deinterleaveDownmixStereoSSE2(const float* in,
+                                          int numSamples,
+                                          float* out0,
+                                          float* out1,
+                                          float* mono)
+{
+    const auto half = _mm_set1_ps(0.5f);
+
+    auto i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        auto a = _mm_loadu_ps(&in[2 * i + 0]);
+        auto b = _mm_loadu_ps(&in[2 * i + 4]);
+
+        auto left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        auto right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+        if (out0)
+        {
+            _mm_storeu_ps(&out0[i], left);
+            _mm_storeu_ps(&out1[i], right);
+        }
+
+        if (mono)
+        {
+            _mm_storeu_ps(&mono[i], _mm_mul_ps(_mm_add_ps(left, right), half));
+        }
+    }
+
+    deinterleaveDownmixStereoScalar(in, i, numSamples, out0, out1, mono);
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// AVX2 Kernels
+// --------------------------------------------------------------------------------------------------------------------
+
+STEAMAUDIO_TARGET_AVX2
+static void applyRampAVX2(const float* in,
+                          float startGain,
+                          float step,
+                          int numSamples,
+                          float* out)
+{
+    const auto offsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const auto startGains = _mm256_set1_ps(startGain);
+    const auto steps = _mm256_set1_ps(step);
+
+    auto i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        auto indices = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), offsets);
+        auto gains = _mm256_add_ps(startGains, _mm256_mul_ps(indices, steps));
+        _mm256_storeu_ps(&out[i], _mm256_mul_ps(_mm256_loadu_ps(&in[i]), gains));
+    }
+
+    applyRampScalar(in, startGain, step, i, numSamples, out);
+}
+
+STEAMAUDIO_TARGET_AVX2
+static void mixIntoAVX2(const float* in,
+                        int numSamples,
+                        float* out)
+{
+    auto i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        _mm256_storeu_ps(&out[i], _mm256_add_ps(_mm256_loadu_ps(&out[i]), _mm256_loadu_ps(&in[i])));
+    }
+
+    mixIntoScalar(in, i, numSamples, out);
+}
+
+STEAMAUDIO_TARGET_AVX2
+static void rampMixInterleaveStereoAVX2(const float* in0,
+                                        const float* in1,
+                                        const float* mix0,
+                                        const float* mix1,
+                                        float startGain,
+                                        float step,
+                                        int numSamples,
+                                        float* out)
+{
+    const auto offsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const auto startGains = _mm256_set1_ps(startGain);
+    const auto steps = _mm256_set1_ps(step);
+
+    auto i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        auto indices = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), offsets);
+        auto gains = _mm256_add_ps(startGains, _mm256_mul_ps(indices, steps));
+
+        auto left = _mm256_mul_ps(_mm256_loadu_ps(&in0[i]), gains);
+        auto right = _mm256_mul_ps(_mm256_loadu_ps(&in1[i]), gains);
+
+        if (mix0)
+        {
+            left = _mm256_add_ps(left, _mm256_loadu_ps(&mix0[i]));
+            right = _mm256_add_ps(right, _mm256_loadu_ps(&mix1[i]));
+        }
+
+        // Unpacking works within each 128-bit lane, so the lanes need to be swapped back into order afterwards.
+        auto low = _mm256_unpacklo_ps(left, right);
+        auto high = _mm256_unpackhi_ps(left, right);
+
+        _mm256_storeu_ps(&out[2 * i + 0], _mm256_permute2f128_ps(low, high, 0x20));
+        _mm256_storeu_ps(&out[2 * i + 8], _mm256_permute2f128_ps(low, high, 0x31));
+    }
+
+    rampMixInterleaveStereoScalar(in0, in1, mix0, mix1, startGain, step, i, numSamples, out);
+}
+
+STEAMAUDIO_TARGET_AVX2
+static void deinterleaveDownmixStereoAVX2(const float* in,
+                                          int numSamples,
+                                          float* out0,
+                                          float* out1,
+                                          float* mono)
+{
+    const auto half = _mm256_set1_ps(0.5f);
+
+    auto i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        auto a = _mm256_loadu_ps(&in[2 * i + 0]);
+        auto b = _mm256_loadu_ps(&in[2 * i + 8]);
+
+        // Arrange the input so that each 128-bit lane can be deinterleaved the same way as with SSE2.
+        auto first = _mm256_permute2f128_ps(a, b, 0x20);
+        auto second = _mm256_permute2f128_ps(a, b, 0x31);
+
+        auto left = _mm256_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0));
+        auto right = _mm256_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1));
+
+        if (out0)
+        {
+            _mm256_storeu_ps(&out0[i], left);
+            _mm256_storeu_ps(&out1[i], right);
+        }
+
+        if (mono)
+        {
+            _mm256_storeu_ps(&mono[i], _mm256_mul_ps(_mm256_add_ps(left, right), half));
+        }
+    }
+
+    deinterleaveDownmixStereoScalar(in, i, numSamples, out0, out1, mono);
+}
+
+#endif
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// NEON Kernels
+// --------------------------------------------------------------------------------------------------------------------
+
+#if defined(STEAMAUDIO_SIMD_NEON)
+
+static void applyRampNEON(const float* in,
+                          float startGain,
+                          float step,
+                          int numSamples,
+                          float* out)
+{
+    const float offsetValues[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const auto offsets = vld1q_f32(offsetValues);
+    const auto startGains = vdupq_n_f32(startGain);
+    const auto steps = vdupq_n_f32(step);
+
+    auto i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        auto indices = vaddq_f32(vdupq_n_f32(static_cast<float>(i)), offsets);
+        auto gains = vaddq_f32(startGains, vmulq_f32(indices, steps));
+        vst1q_f32(&out[i], vmulq_f32(vld1q_f32(&in[i]), gains));
+    }
+
+    applyRampScalar(in, startGain, step, i, numSamples, out);
+}
+
+static void mixIntoNEON(const float* in,
+                        int numSamples,
+                        float* out)
+{
+    auto i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        vst1q_f32(&out[i], vaddq_f32(vld1q_f32(&out[i]), vld1q_f32(&in[i])));
+    }
+
+    mixIntoScalar(in, i, numSamples, out);
+}
+
+static void rampMixInterleaveStereoNEON(const float* in0,
+                                        const float* in1,
+                                        const float* mix0,
+                                        const float* mix1,
+                                        float startGain,
+                                        float step,
+                                        int numSamples,
+                                        float* out)
+{
+    const float offsetValues[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const auto offsets = vld1q_f32(offsetValues);
+    const auto startGains = vdupq_n_f32(startGain);
+    const auto steps = vdupq_n_f32(step);
+
+    auto i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        auto indices = vaddq_f32(vdupq_n_f32(static_cast<float>(i)), offsets);
+        auto gains = vaddq_f32(startGains, vmulq_f32(indices, steps));
+
+        float32x4x2_t frames;
+        frames.val[0] = vmulq_f32(vld1q_f32(&in0[i]), gains);
+        frames.val[1] = vmulq_f32(vld1q_f32(&in1[i]), gains);
+
+        if (mix0)
+        {
+            frames.val[0] = vaddq_f32(frames.val[0], vld1q_f32(&mix0[i]));
+            frames.val[1] = vaddq_f32(frames.val[1], vld1q_f32(&mix1[i]));
+        }
+
+        vst2q_f32(&out[2 * i], frames);
+    }
+
+    rampMixInterleaveStereoScalar(in0, in1, mix0, mix1, startGain, step, i, numSamples, out);
+}
+
+static void deinterleaveDownmixStereoNEON(const float* in,
+                                          int numSamples,
+                                          float* out0,
+                                          float* out1,
+                                          float* mono)
+{
+    const auto half = vdupq_n_f32(0.5f);
+
+    auto i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        auto frames = vld2q_f32(&in[2 * i]);
+
+        if (out0)
+        {
+            vst1q_f32(&out0[i], frames.val[0]);
+            vst1q_f32(&out1[i], frames.val[1]);
+        }
+
+        if (mono)
+        {
+            vst1q_f32(&mono[i], vmulq_f32(vaddq_f32(frames.val[0], frames.val[1]), half));
+        }
+    }
+
+    deinterleaveDownmixStereoScalar(in, i, numSamples, out0, out1, mono);
+}
+
+#endif
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// Dispatch
+// --------------------------------------------------------------------------------------------------------------------
+
+static void applyRampFallback(const float* in,
+                              float startGain,
+                              float step,
+                              int numSamples,
+                              float* out)
+{
+    applyRampScalar(in, startGain, step, 0, numSamples, out);
+}
+
+static void mixIntoFallback(const float* in,
+                            int numSamples,
+                            float* out)
+{
+    mixIntoScalar(in, 0, numSamples, out);
+}
+
+static void rampMixInterleaveStereoFallback(const float* in0,
+                                            const float* in1,
+                                            const float* mix0,
+                                            const float* mix1,
+                                            float startGain,
+                                            float step,
+                                            int numSamples,
+                                            float* out)
+{
+    rampMixInterleaveStereoScalar(in0, in1, mix0, mix1, startGain, step, 0, numSamples, out);
+}
+
+static void deinterleaveDownmixStereoFallback(const float* in,
+                                              int numSamples,
+                                              float* out0,
+                                              float* out1,
+                                              float* mono)
+{
+    deinterleaveDownmixStereoScalar(in, 0, numSamples, out0, out1, mono);
+}
+
+struct Kernels
+{
+    void (*applyRamp)(const float*, float, float, int, float*);
+    void (*mixInto)(const float*, int, float*);
+    void (*rampMixInterleaveStereo)(const float*, const float*, const float*, const float*, float, float, int, float*);
+    void (*deinterleaveDownmixStereo)(const float*, int, float*, float*, float*);
+};
+
+static Kernels selectKernels()
+{
+    Kernels kernels{ applyRampFallback, mixIntoFallback, rampMixInterleaveStereoFallback, deinterleaveDownmixStereoFallback };
+
+    const auto& features = cpuFeatures();
+
+#if defined(STEAMAUDIO_SIMD_X86)
+    if (features.avx2)
+    {
+        kernels = Kernels{ applyRampAVX2, mixIntoAVX2, rampMixInterleaveStereoAVX2, deinterleaveDownmixStereoAVX2 };
+    }
+    else if (features.sse2)
+    {
+        kernels = Kernels{ applyRampSSE2, mixIntoSSE2, rampMixInterleaveStereoSSE2, deinterleaveDownmixStereoSSE2 };
+    }
+#elif defined(STEAMAUDIO_SIMD_NEON)
+    if (features.neon)
+    {
+        kernels = Kernels{ applyRampNEON, mixIntoNEON, rampMixInterleaveStereoNEON, deinterleaveDownmixStereoNEON };
+    }
+#endif
+
+    return kernels;
+}
+
+static const Kernels& kernels()
+{
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// Audio Kernels
+// --------------------------------------------------------------------------------------------------------------------
+
+void applyRamp(const float* in,
+               float startGain,
+               float endGain,
+               int numSamples,
+               float* out)
+{
+    kernels().applyRamp(in, startGain, rampStep(startGain, endGain, numSamples), numSamples, out);
+}
+
+void mixInto(const float* in,
+             int numSamples,
+             float* out)
+{
+    kernels().mixInto(in, numSamples, out);
+}
+
+void rampMixInterleave(const IPLAudioBuffer& in,
+                       float startGain,
+                       float endGain,
+                       const IPLAudioBuffer* mix,
+                       float* out)
+{
+    auto numChannels = in.numChannels;
+    auto numSamples = in.numSamples;
+    auto step = rampStep(startGain, endGain, numSamples);
+
+    if (numChannels == 2)
+    {
+        kernels().rampMixInterleaveStereo(in.data[0], in.data[1], mix ? mix->data[0] : nullptr,
+                                          mix ? mix->data[1] : nullptr, startGain, step, numSamples, out);
+        return;
+    }
+
+    for (auto i = 0; i < numSamples; ++i)
+    {
+        auto gain = startGain + static_cast<float>(i) * step;
+        for (auto j = 0; j < numChannels; ++j)
+        {
+            out[i * numChannels + j] = in.data[j][i] * gain + (mix ? mix->data[j][i] : 0.0f);
+        }
+    }
+}
+
+void deinterleaveDownmix(const float* in,
+                         int numChannels,
+                         int numSamples,
+                         float* const* out,
+                         float* mono)
+{
+    if (numChannels == 2)
+    {
+        kernels().deinterleaveDownmixStereo(in, numSamples, out ? out[0] : nullptr, out ? out[1] : nullptr, mono);
+        return;
+    }
+
+    if (numChannels == 1)
+    {
+        if (out)
+        {
+            memcpy(out[0], in, numSamples * sizeof(float));
+        }
+        if (mono)
+        {
+            memcpy(mono, in, numSamples * sizeof(float));
+        }
+        return;
+    }
+
+    auto scale = 1.0f / static_cast<float>(numChannels);
+
+    for (auto i = 0; i < numSamples; ++i)
+    {
+        auto sum = 0.0f;
+        for (auto j = 0; j < numChannels; ++j)
+        {
+            auto sample = in[i * numChannels + j];
+            if (out)
+            {
+                out[j][i] = sample;
+            }
+            sum += sample;
+        }
+
+        if (mono)
+        {
+            mono[i] = sum * scale;
+        }
+    }
+}
+
+void interleaveScaled(const IPLAudioBuffer& in,
+                      int numChannels,
+                      int outStride,
+                      float scale,
+                      float* out)
+{
+    for (auto i = 0; i < in.numSamples; ++i)
+    {
+        auto frame = &out[i * outStride];
+
+        for (auto j = 0; j < numChannels; ++j)
+        {
+            frame[j] = in.data[j][i] * scale;
+        }
+
+        for (auto j = numChannels; j < outStride; ++j)
+        {
+            frame[j] = 0.0f;
+        }
+    }
+}
+
+}
@@ -0,0 +1,59 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <phonon.h>
+
+#include "plugin_namespace.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// Audio Kernels
+// --------------------------------------------------------------------------------------------------------------------
+
+// Buffer operations used by the DSP effects at the start and end of every process() call. Several of these fuse
+// operations that would otherwise each make a separate pass over the audio data. SSE2, AVX2, or NEON implementations
+// are selected at runtime based on the CPU, with scalar fallbacks for other CPUs and for uncommon channel counts.
+
+// Multiplies a buffer by a gain that ramps linearly from startGain (for the first sample) towards endGain (reached just
+// after the last sample). in and out may point to the same buffer.
+void applyRamp(const float* in,
+               float startGain,
+               float endGain,
+               int numSamples,
+               float* out);
+
+// Adds in to out.
+void mixInto(const float* in,
+             int numSamples,
+             float* out);
+
+// Writes in to an interleaved buffer, multiplied by a gain that ramps from startGain to endGain as in applyRamp, and
+// adds mix (which may be nullptr). mix must have the same number of channels and samples as in.
+void rampMixInterleave(const IPLAudioBuffer& in,
+                       float startGain,
+                       float endGain,
+                       const IPLAudioBuffer* mix,
+                       float* out);
+
+// Splits an interleaved buffer into separate channels, and averages all channels into a mono buffer, in a single pass.
+// Either out or mono may be nullptr. If given, out must have numChannels channels.
+void deinterleaveDownmix(const float* in,
+                         int numChannels,
+                         int numSamples,
+                         float* const* out,
+                         float* mono);
+
+// Writes the first numChannels channels of in to an interleaved buffer with outStride channels, multiplied by scale.
+// The remaining channels of each output frame are set to zero.
+void interleaveScaled(const IPLAudioBuffer& in,
+                      int numChannels,
+                      int outStride,
+                      float scale,
+                      float* out);
+
+}
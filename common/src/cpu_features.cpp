@@ -0,0 +1,121 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include "cpu_features.h"
+
+#if defined(STEAMAUDIO_SIMD_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#include <string.h>
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// CPUFeatures
+// --------------------------------------------------------------------------------------------------------------------
+
+#if defined(STEAMAUDIO_SIMD_X86)
+
+static void cpuid(unsigned int leaf,
+                  unsigned int subleaf,
+                  unsigned int registers[4])
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int values[4] = {};
+    __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (auto i = 0; i < 4; ++i)
+    {
+        registers[i] = static_cast<unsigned int>(values[i]);
+    }
+#else
+    registers[0] = registers[1] = registers[2] = registers[3] = 0;
+    __get_cpuid_count(leaf, subleaf, &registers[0], &registers[1], &registers[2], &registers[3]);
+#endif
+}
+
+// Returns the OS-enabled register state mask (XCR0). Only valid if the CPU supports OSXSAVE.
+static unsigned long long xgetbv()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(0);
+#else
+    unsigned int eax = 0;
+    unsigned int edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+static CPUFeatures detectCPUFeatures()
+{
+    CPUFeatures features{};
+
+    unsigned int registers[4] = {};
+    cpuid(0, 0, registers);
+    auto maxLeaf = registers[0];
+
+    cpuid(1, 0, registers);
+    features.sse2 = (registers[3] & (1u << 26)) != 0;
+    features.sse4 = (registers[2] & (1u << 19)) != 0 && (registers[2] & (1u << 20)) != 0;
+
+    auto osxsave = (registers[2] & (1u << 27)) != 0;
+    auto avx = (registers[2] & (1u << 28)) != 0;
+
+    // AVX registers are only usable if the OS saves and restores them on context switches. The same goes for the
+    // AVX-512 opmask and upper ZMM registers.
+    auto xcr0 = osxsave ? xgetbv() : 0ull;
+    auto osSavesAVXState = osxsave && avx && ((xcr0 & 0x6) == 0x6);
+    auto osSavesAVX512State = osSavesAVXState && ((xcr0 & 0xe0) == 0xe0);
+
+    features.avx = osSavesAVXState;
+
+    if (maxLeaf >= 7 && osSavesAVXState)
+    {
+        cpuid(7, 0, registers);
+        features.avx2 = (registers[1] & (1u << 5)) != 0;
+        features.avx512 = osSavesAVX512State && (registers[1] & (1u << 16)) != 0;
+    }
+
+    cpuid(0x80000000u, 0, registers);
+    if (registers[0] >= 0x80000004u)
+    {
+        for (auto i = 0u; i < 3; ++i)
+        {
+            cpuid(0x80000002u + i, 0, registers);
+            memcpy(features.name + 16 * i, registers, 16);
+        }
+        features.name[48] = '\0';
+    }
+
+    return features;
+}
+
+#else
+
+static CPUFeatures detectCPUFeatures()
+{
+    CPUFeatures features{};
+
+#if defined(STEAMAUDIO_SIMD_NEON)
+    features.neon = true;
+#endif
+
+    return features;
+}
+
+#endif
+
+const CPUFeatures& cpuFeatures()
+{
+    static const CPUFeatures features = detectCPUFeatures();
+    return features;
+}
+
+}
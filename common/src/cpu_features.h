@@ -0,0 +1,51 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+// Compile-time detection of the instruction sets for which we have hand-written kernels. This uses the compiler's own
+// macros rather than IPL_CPU_*, since macOS builds compile every file for both x86_64 and arm64.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define STEAMAUDIO_SIMD_X86
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define STEAMAUDIO_SIMD_NEON
+#endif
+
+// Marks a function as using AVX2 instructions, so it can be compiled without enabling AVX2 for the whole file. MSVC
+// allows AVX2 intrinsics anywhere, so nothing is needed there.
+#if defined(STEAMAUDIO_SIMD_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+#define STEAMAUDIO_TARGET_SSE2
+#define STEAMAUDIO_TARGET_AVX2
+#else
+#define STEAMAUDIO_TARGET_SSE2 __attribute__((target("sse2")))
+#define STEAMAUDIO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#include "plugin_namespace.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// CPUFeatures
+// --------------------------------------------------------------------------------------------------------------------
+
+// Instruction sets that are available on the CPU we're running on, and enabled by the OS.
+struct CPUFeatures
+{
+    bool sse2;
+    bool sse4;      // SSE 4.1 and 4.2.
+    bool avx;
+    bool avx2;
+    bool avx512;    // AVX-512 Foundation.
+    bool neon;
+    char name[49];  // The CPU's brand string, or an empty string if it is not available.
+};
+
+// Detects CPU features the first time it is called. Thread-safe.
+const CPUFeatures& cpuFeatures();
+
+}
@@ -0,0 +1,225 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <chrono>
+
+#include "effect_builder.h"
+#include "rt_audit.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// EffectBuildJob
+// --------------------------------------------------------------------------------------------------------------------
+
+EffectBuildJob::EffectBuildJob()
+    : mState(STATE_IDLE)
+{}
+
+bool EffectBuildJob::isIdle() const
+{
+    return (mState.load(std::memory_order_acquire) == STATE_IDLE);
+}
+
+bool EffectBuildJob::isReady() const
+{
+    return (mState.load(std::memory_order_acquire) == STATE_READY);
+}
+
+void EffectBuildJob::complete()
+{
+    auto expected = static_cast<int>(STATE_READY);
+    mState.compare_exchange_strong(expected, STATE_IDLE, std::memory_order_acq_rel);
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// EffectBuilder
+// --------------------------------------------------------------------------------------------------------------------
+
+EffectBuilder gEffectBuilder;
+
+EffectBuilder::EffectBuilder()
+    : mEnqueuePosition(0)
+    , mDequeuePosition(0)
+    , mRunning(false)
+    , mStopRequested(false)
+{
+    for (auto i = 0u; i < kQueueSize; ++i)
+    {
+        mQueue[i].sequence.store(i, std::memory_order_relaxed);
+        mQueue[i].job = nullptr;
+    }
+}
+
+EffectBuilder::~EffectBuilder()
+{
+    stop();
+}
+
+void EffectBuilder::start()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mRunning)
+        return;
+
+    mStopRequested = false;
+    mThread = std::thread(&EffectBuilder::threadProc, this);
+    mRunning = true;
+}
+
+void EffectBuilder::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (!mRunning)
+            return;
+
+        mRunning = false;
+        mStopRequested = true;
+    }
+
+    mCondition.notify_one();
+    mThread.join();
+
+    // A job may have been submitted after the worker's last check of the queue.
+    while (auto job = dequeue())
+    {
+        run(job);
+    }
+}
+
+bool EffectBuilder::submit(EffectBuildJob* job)
+{
+    if (!mRunning.load(std::memory_order_acquire))
+        return false;
+
+    auto expected = static_cast<int>(EffectBuildJob::STATE_IDLE);
+    if (!job->mState.compare_exchange_strong(expected, EffectBuildJob::STATE_QUEUED, std::memory_order_acq_rel))
+        return false;
+
+    if (!enqueue(job))
+    {
+        job->mState.store(EffectBuildJob::STATE_IDLE, std::memory_order_release);
+        return false;
+    }
+
+    // Notifying without holding the mutex may occasionally miss a worker that is about to wait, but it never blocks
+    // the audio thread. The worker wakes up periodically to pick up such jobs. It may still enter the kernel to wake
+    // the worker, however.
+    recordRTAuditEvent(RTAUDITEVENT_SYSCALL, "condition_variable::notify_one");
+    mCondition.notify_one();
+    return true;
+}
+
+void EffectBuilder::abandon(EffectBuildJob* job)
+{
+    if (!job)
+        return;
+
+    // If the job is queued, the worker thread deletes it once it is dequeued.
+    auto previous = job->mState.exchange(EffectBuildJob::STATE_ABANDONED, std::memory_order_acq_rel);
+    if (previous != EffectBuildJob::STATE_QUEUED)
+    {
+        delete job;
+    }
+}
+
+bool EffectBuilder::enqueue(EffectBuildJob* job)
+{
+    auto position = mEnqueuePosition.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        auto& cell = mQueue[position % kQueueSize];
+        auto sequence = cell.sequence.load(std::memory_order_acquire);
+        auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+        if (difference == 0)
+        {
+            if (mEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                cell.job = job;
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            return false;
+        }
+        else
+        {
+            position = mEnqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+EffectBuildJob* EffectBuilder::dequeue()
+{
+    auto position = mDequeuePosition.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        auto& cell = mQueue[position % kQueueSize];
+        auto sequence = cell.sequence.load(std::memory_order_acquire);
+        auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+        if (difference == 0)
+        {
+            if (mDequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                auto job = cell.job;
+                cell.sequence.store(position + kQueueSize, std::memory_order_release);
+                return job;
+            }
+        }
+        else if (difference < 0)
+        {
+            return nullptr;
+        }
+        else
+        {
+            position = mDequeuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void EffectBuilder::run(EffectBuildJob* job)
+{
+    if (job->mState.load(std::memory_order_acquire) != EffectBuildJob::STATE_ABANDONED)
+    {
+        job->build();
+    }
+
+    auto expected = static_cast<int>(EffectBuildJob::STATE_QUEUED);
+    if (!job->mState.compare_exchange_strong(expected, EffectBuildJob::STATE_READY, std::memory_order_acq_rel))
+    {
+        // The DSP was released while the job was queued.
+        delete job;
+    }
+}
+
+void EffectBuilder::threadProc()
+{
+    while (true)
+    {
+        while (auto job = dequeue())
+        {
+            run(job);
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        if (mStopRequested)
+            break;
+
+        mCondition.wait_for(lock, std::chrono::milliseconds(5));
+    }
+}
+
+}
@@ -0,0 +1,120 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "plugin_namespace.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// EffectBuildJob
+// --------------------------------------------------------------------------------------------------------------------
+
+// A request, made by a DSP from the audio thread, to create Steam Audio effect objects on the builder's worker thread.
+//
+// A DSP owns one job for its lifetime. From process(), it fills in the job's inputs and submits it. Once isReady()
+// returns true, it moves the job's outputs into its own state, and calls complete() so the job can be submitted again.
+// When the DSP is released, it calls EffectBuilder::abandon() instead of deleting the job, since the worker thread may
+// still be using it.
+class EffectBuildJob
+{
+public:
+    EffectBuildJob();
+    virtual ~EffectBuildJob() = default;
+
+    // Returns true if the job is not queued, and can be (re)submitted. Audio thread only.
+    bool isIdle() const;
+
+    // Returns true if the worker thread has finished building, and the outputs can be read. Audio thread only.
+    bool isReady() const;
+
+    // Marks the outputs as consumed, so the job can be submitted again. Audio thread only.
+    void complete();
+
+protected:
+    // Creates the requested objects. Called on the worker thread. Any objects left in the job when it is destroyed
+    // must be released by the destructor.
+    virtual void build() = 0;
+
+private:
+    friend class EffectBuilder;
+
+    enum State
+    {
+        STATE_IDLE,
+        STATE_QUEUED,
+        STATE_READY,
+        STATE_ABANDONED,
+    };
+
+    std::atomic<int> mState;
+};
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// EffectBuilder
+// --------------------------------------------------------------------------------------------------------------------
+
+// Runs EffectBuildJobs on a worker thread, so that creating effects (which allocates memory and may precompute
+// filters) never happens inside the mixer callback.
+//
+// Jobs are submitted through a fixed-size, lock-free queue, so submitting never blocks or allocates. If the queue is
+// full, or the worker is not running, submit() fails, and the DSP should try again in a later block.
+class EffectBuilder
+{
+public:
+    static const size_t kQueueSize = 1024;
+
+    EffectBuilder();
+    ~EffectBuilder();
+
+    // Starts the worker thread, if it is not already running.
+    void start();
+
+    // Builds any jobs still in the queue, and stops the worker thread.
+    void stop();
+
+    // Queues an idle job. Returns false if it could not be queued. Lock-free, may be called on the audio thread.
+    bool submit(EffectBuildJob* job);
+
+    // Gives up ownership of a job. The job is deleted immediately, or by the worker thread once it has finished with
+    // it. Must not be called on the audio thread.
+    void abandon(EffectBuildJob* job);
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        EffectBuildJob* job;
+    };
+
+    Cell mQueue[kQueueSize];
+    std::atomic<size_t> mEnqueuePosition;
+    std::atomic<size_t> mDequeuePosition;
+
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::atomic<bool> mRunning;
+    bool mStopRequested;
+
+    bool enqueue(EffectBuildJob* job);
+    EffectBuildJob* dequeue();
+    void run(EffectBuildJob* job);
+    void threadProc();
+};
+
+extern EffectBuilder gEffectBuilder;
+
+}
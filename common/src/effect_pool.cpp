@@ -0,0 +1,417 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <algorithm>
+
+#include "effect_pool.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+#if !defined(IPL_OS_UNSUPPORTED)
+
+// Defined by each plugin, along with its other helper functions.
+IPLSpeakerLayout speakerLayoutForNumChannels(int numChannels);
+
+// --------------------------------------------------------------------------------------------------------------------
+// Effect Traits
+// --------------------------------------------------------------------------------------------------------------------
+
+// Wraps the Steam Audio API functions for each effect type, so the pool can treat all of them the same way.
+template <typename T>
+struct EffectTraits
+{};
+
+template <>
+struct EffectTraits<IPLPanningEffect>
+{
+    typedef IPLPanningEffectSettings Settings;
+    static const int kType = 0;
+
+    static EffectPool::Key key(const IPLAudioSettings& audioSettings, const Settings& effectSettings)
+    {
+        return EffectPool::Key{ kType, audioSettings.samplingRate, audioSettings.frameSize, effectSettings.speakerLayout.numSpeakers, 0, 0, 0, nullptr };
+    }
+
+    static IPLerror create(IPLContext context, IPLAudioSettings* audioSettings, Settings* effectSettings, IPLPanningEffect* effect) { return iplPanningEffectCreate(context, audioSettings, effectSettings, effect); }
+    static void reset(IPLPanningEffect effect) { iplPanningEffectReset(effect); }
+    static void release(IPLPanningEffect* effect) { iplPanningEffectRelease(effect); }
+};
+
+template <>
+struct EffectTraits<IPLBinauralEffect>
+{
+    typedef IPLBinauralEffectSettings Settings;
+    static const int kType = 1;
+
+    static EffectPool::Key key(const IPLAudioSettings& audioSettings, const Settings& effectSettings)
+    {
+        return EffectPool::Key{ kType, audioSettings.samplingRate, audioSettings.frameSize, 0, 0, 0, 0, effectSettings.hrtf };
+    }
+
+    static IPLerror create(IPLContext context, IPLAudioSettings* audioSettings, Settings* effectSettings, IPLBinauralEffect* effect) { return iplBinauralEffectCreate(context, audioSettings, effectSettings, effect); }
+    static void reset(IPLBinauralEffect effect) { iplBinauralEffectReset(effect); }
+    static void release(IPLBinauralEffect* effect) { iplBinauralEffectRelease(effect); }
+};
+
+template <>
+struct EffectTraits<IPLDirectEffect>
+{
+    typedef IPLDirectEffectSettings Settings;
+    static const int kType = 2;
+
+    static EffectPool::Key key(const IPLAudioSettings& audioSettings, const Settings& effectSettings)
+    {
+        return EffectPool::Key{ kType, audioSettings.samplingRate, audioSettings.frameSize, effectSettings.numChannels, 0, 0, 0, nullptr };
+    }
+
+    static IPLerror create(IPLContext context, IPLAudioSettings* audioSettings, Settings* effectSettings, IPLDirectEffect* effect) { return iplDirectEffectCreate(context, audioSettings, effectSettings, effect); }
+    static void reset(IPLDirectEffect effect) { iplDirectEffectReset(effect); }
+    static void release(IPLDirectEffect* effect) { iplDirectEffectRelease(effect); }
+};
+
+template <>
+struct EffectTraits<IPLReflectionEffect>
+{
+    typedef IPLReflectionEffectSettings Settings;
+    static const int kType = 3;
+
+    static EffectPool::Key key(const IPLAudioSettings& audioSettings, const Settings& effectSettings)
+    {
+        return EffectPool::Key{ kType, audioSettings.samplingRate, audioSettings.frameSize, effectSettings.numChannels, 0, effectSettings.irSize, effectSettings.type, nullptr };
+    }
+
+    static IPLerror create(IPLContext context, IPLAudioSettings* audioSettings, Settings* effectSettings, IPLReflectionEffect* effect) { return iplReflectionEffectCreate(context, audioSettings, effectSettings, effect); }
+    static void reset(IPLReflectionEffect effect) { iplReflectionEffectReset(effect); }
+    static void release(IPLReflectionEffect* effect) { iplReflectionEffectRelease(effect); }
+};
+
+template <>
+struct EffectTraits<IPLPathEffect>
+{
+    typedef IPLPathEffectSettings Settings;
+    static const int kType = 4;
+
+    static EffectPool::Key key(const IPLAudioSettings& audioSettings, const Settings& effectSettings)
+    {
+        return EffectPool::Key{ kType, audioSettings.samplingRate, audioSettings.frameSize, effectSettings.speakerLayout.numSpeakers, effectSettings.maxOrder, 0, 0, effectSettings.hrtf };
+    }
+
+    static IPLerror create(IPLContext context, IPLAudioSettings* audioSettings, Settings* effectSettings, IPLPathEffect* effect) { return iplPathEffectCreate(context, audioSettings, effectSettings, effect); }
+    static void reset(IPLPathEffect effect) { iplPathEffectReset(effect); }
+    static void release(IPLPathEffect* effect) { iplPathEffectRelease(effect); }
+};
+
+template <>
+struct EffectTraits<IPLAmbisonicsDecodeEffect>
+{
+    typedef IPLAmbisonicsDecodeEffectSettings Settings;
+    static const int kType = 5;
+
+    static EffectPool::Key key(const IPLAudioSettings& audioSettings, const Settings& effectSettings)
+    {
+        return EffectPool::Key{ kType, audioSettings.samplingRate, audioSettings.frameSize, effectSettings.speakerLayout.numSpeakers, effectSettings.maxOrder, 0, 0, effectSettings.hrtf };
+    }
+
+    static IPLerror create(IPLContext context, IPLAudioSettings* audioSettings, Settings* effectSettings, IPLAmbisonicsDecodeEffect* effect) { return iplAmbisonicsDecodeEffectCreate(context, audioSettings, effectSettings, effect); }
+    static void reset(IPLAmbisonicsDecodeEffect effect) { iplAmbisonicsDecodeEffectReset(effect); }
+    static void release(IPLAmbisonicsDecodeEffect* effect) { iplAmbisonicsDecodeEffectRelease(effect); }
+};
+
+// Releases an idle effect given only its key.
+static void releaseIdleEffect(const EffectPool::Key& key,
+                              void* effect)
+{
+    switch (key.type)
+    {
+    case EffectTraits<IPLPanningEffect>::kType:
+        { auto typed = static_cast<IPLPanningEffect>(effect); iplPanningEffectRelease(&typed); }
+        break;
+    case EffectTraits<IPLBinauralEffect>::kType:
+        { auto typed = static_cast<IPLBinauralEffect>(effect); iplBinauralEffectRelease(&typed); }
+        break;
+    case EffectTraits<IPLDirectEffect>::kType:
+        { auto typed = static_cast<IPLDirectEffect>(effect); iplDirectEffectRelease(&typed); }
+        break;
+    case EffectTraits<IPLReflectionEffect>::kType:
+        { auto typed = static_cast<IPLReflectionEffect>(effect); iplReflectionEffectRelease(&typed); }
+        break;
+    case EffectTraits<IPLPathEffect>::kType:
+        { auto typed = static_cast<IPLPathEffect>(effect); iplPathEffectRelease(&typed); }
+        break;
+    case EffectTraits<IPLAmbisonicsDecodeEffect>::kType:
+        { auto typed = static_cast<IPLAmbisonicsDecodeEffect>(effect); iplAmbisonicsDecodeEffectRelease(&typed); }
+        break;
+    }
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// EffectPool
+// --------------------------------------------------------------------------------------------------------------------
+
+EffectPool gEffectPool;
+
+bool EffectPool::Key::operator==(const Key& other) const
+{
+    return (type == other.type && samplingRate == other.samplingRate && frameSize == other.frameSize &&
+            numChannels == other.numChannels && order == other.order && irSize == other.irSize &&
+            reflectionType == other.reflectionType && hrtf == other.hrtf);
+}
+
+EffectPool::EffectPool()
+    : mMutex("effect pool")
+    , mMaxIdleEffects(kDefaultMaxIdleEffects)
+    , mAudioSettings{}
+    , mNumChannelsIn(0)
+    , mNumChannelsOut(0)
+{}
+
+void EffectPool::setSettings(int maxIdleEffects,
+                             const IPLAudioSettings& audioSettings,
+                             int numChannelsIn,
+                             int numChannelsOut)
+{
+    std::lock_guard<AuditedMutex> lock(mMutex);
+
+    mMaxIdleEffects = std::max(0, maxIdleEffects);
+    mAudioSettings = audioSettings;
+    mNumChannelsIn = numChannelsIn;
+    mNumChannelsOut = numChannelsOut;
+}
+
+int EffectPool::maxIdleEffects() const
+{
+    std::lock_guard<AuditedMutex> lock(mMutex);
+    return mMaxIdleEffects;
+}
+
+void EffectPool::prewarm(IPLContext context,
+                         IPLHRTF hrtf,
+                         const IPLSimulationSettings* simulationSettings)
+{
+    if (!context || !hrtf)
+        return;
+
+    IPLAudioSettings audioSettings;
+    auto numChannelsIn = 0;
+    auto numChannelsOut = 0;
+
+    {
+        std::lock_guard<AuditedMutex> lock(mMutex);
+
+        audioSettings = mAudioSettings;
+        numChannelsIn = mNumChannelsIn;
+        numChannelsOut = mNumChannelsOut;
+
+        // Effects that depend on an HRTF that is no longer in use would never be reused.
+        auto it = std::remove_if(mIdle.begin(), mIdle.end(), [&](const Entry& entry)
+        {
+            if (!entry.key.hrtf || entry.key.hrtf == hrtf)
+                return false;
+
+            mKeys.erase(entry.effect);
+            releaseIdleEffect(entry.key, entry.effect);
+            return true;
+        });
+
+        mIdle.erase(it, mIdle.end());
+    }
+
+    if (audioSettings.samplingRate <= 0 || audioSettings.frameSize <= 0 || numChannelsIn <= 0 || numChannelsOut <= 0)
+        return;
+
+    auto speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
+
+    IPLPanningEffectSettings panningSettings{};
+    panningSettings.speakerLayout = speakerLayout;
+    prewarmEffect<IPLPanningEffect>(context, &audioSettings, &panningSettings);
+
+    IPLBinauralEffectSettings binauralSettings{};
+    binauralSettings.hrtf = hrtf;
+    prewarmEffect<IPLBinauralEffect>(context, &audioSettings, &binauralSettings);
+
+    IPLDirectEffectSettings directSettings{};
+    directSettings.numChannels = numChannelsIn;
+    prewarmEffect<IPLDirectEffect>(context, &audioSettings, &directSettings);
+
+    if (simulationSettings)
+    {
+        IPLAmbisonicsDecodeEffectSettings ambisonicsSettings{};
+        ambisonicsSettings.speakerLayout = speakerLayout;
+        ambisonicsSettings.hrtf = hrtf;
+        ambisonicsSettings.maxOrder = simulationSettings->maxOrder;
+        prewarmEffect<IPLAmbisonicsDecodeEffect>(context, &audioSettings, &ambisonicsSettings);
+    }
+}
+
+void EffectPool::clear()
+{
+    std::lock_guard<AuditedMutex> lock(mMutex);
+
+    for (const auto& entry : mIdle)
+    {
+        mKeys.erase(entry.effect);
+        releaseIdleEffect(entry.key, entry.effect);
+    }
+
+    mIdle.clear();
+}
+
+IPLerror EffectPool::acquire(IPLContext context, IPLAudioSettings* audioSettings, IPLPanningEffectSettings* effectSettings, IPLPanningEffect* effect)
+{
+    return acquireEffect(context, audioSettings, effectSettings, effect);
+}
+
+IPLerror EffectPool::acquire(IPLContext context, IPLAudioSettings* audioSettings, IPLBinauralEffectSettings* effectSettings, IPLBinauralEffect* effect)
+{
+    return acquireEffect(context, audioSettings, effectSettings, effect);
+}
+
+IPLerror EffectPool::acquire(IPLContext context, IPLAudioSettings* audioSettings, IPLDirectEffectSettings* effectSettings, IPLDirectEffect* effect)
+{
+    return acquireEffect(context, audioSettings, effectSettings, effect);
+}
+
+IPLerror EffectPool::acquire(IPLContext context, IPLAudioSettings* audioSettings, IPLReflectionEffectSettings* effectSettings, IPLReflectionEffect* effect)
+{
+    return acquireEffect(context, audioSettings, effectSettings, effect);
+}
+
+IPLerror EffectPool::acquire(IPLContext context, IPLAudioSettings* audioSettings, IPLPathEffectSettings* effectSettings, IPLPathEffect* effect)
+{
+    return acquireEffect(context, audioSettings, effectSettings, effect);
+}
+
+IPLerror EffectPool::acquire(IPLContext context, IPLAudioSettings* audioSettings, IPLAmbisonicsDecodeEffectSettings* effectSettings, IPLAmbisonicsDecodeEffect* effect)
+{
+    return acquireEffect(context, audioSettings, effectSettings, effect);
+}
+
+void EffectPool::release(IPLPanningEffect* effect)
+{
+    releaseEffect(effect);
+}
+
+void EffectPool::release(IPLBinauralEffect* effect)
+{
+    releaseEffect(effect);
+}
+
+void EffectPool::release(IPLDirectEffect* effect)
+{
+    releaseEffect(effect);
+}
+
+void EffectPool::release(IPLReflectionEffect* effect)
+{
+    releaseEffect(effect);
+}
+
+void EffectPool::release(IPLPathEffect* effect)
+{
+    releaseEffect(effect);
+}
+
+void EffectPool::release(IPLAmbisonicsDecodeEffect* effect)
+{
+    releaseEffect(effect);
+}
+
+template <typename T, typename S>
+IPLerror EffectPool::acquireEffect(IPLContext context,
+                                   IPLAudioSettings* audioSettings,
+                                   S* effectSettings,
+                                   T* effect)
+{
+    auto key = EffectTraits<T>::key(*audioSettings, *effectSettings);
+
+    {
+        std::lock_guard<AuditedMutex> lock(mMutex);
+
+        for (auto it = mIdle.rbegin(); it != mIdle.rend(); ++it)
+        {
+            if (it->key == key)
+            {
+                *effect = static_cast<T>(it->effect);
+                mIdle.erase(std::next(it).base());
+                return IPL_STATUS_SUCCESS;
+            }
+        }
+    }
+
+    auto status = EffectTraits<T>::create(context, audioSettings, effectSettings, effect);
+    if (status != IPL_STATUS_SUCCESS)
+        return status;
+
+    std::lock_guard<AuditedMutex> lock(mMutex);
+    mKeys[*effect] = key;
+
+    return IPL_STATUS_SUCCESS;
+}
+
+template <typename T>
+void EffectPool::releaseEffect(T* effect)
+{
+    if (!effect || !*effect)
+        return;
+
+    EffectTraits<T>::reset(*effect);
+
+    {
+        std::lock_guard<AuditedMutex> lock(mMutex);
+
+        auto it = mKeys.find(*effect);
+        if (it != mKeys.end())
+        {
+            if (countIdle(it->second) < mMaxIdleEffects)
+            {
+                mIdle.push_back(Entry{ it->second, *effect });
+                *effect = nullptr;
+                return;
+            }
+
+            mKeys.erase(it);
+        }
+    }
+
+    EffectTraits<T>::release(effect);
+}
+
+template <typename T, typename S>
+void EffectPool::prewarmEffect(IPLContext context,
+                               IPLAudioSettings* audioSettings,
+                               S* effectSettings)
+{
+    auto key = EffectTraits<T>::key(*audioSettings, *effectSettings);
+
+    while (true)
+    {
+        {
+            std::lock_guard<AuditedMutex> lock(mMutex);
+            if (countIdle(key) >= mMaxIdleEffects)
+                return;
+        }
+
+        T effect = nullptr;
+        if (EffectTraits<T>::create(context, audioSettings, effectSettings, &effect) != IPL_STATUS_SUCCESS)
+            return;
+
+        std::lock_guard<AuditedMutex> lock(mMutex);
+        mKeys[effect] = key;
+        mIdle.push_back(Entry{ key, effect });
+    }
+}
+
+int EffectPool::countIdle(const Key& key) const
+{
+    return static_cast<int>(std::count_if(mIdle.begin(), mIdle.end(), [&](const Entry& entry)
+    {
+        return (entry.key == key);
+    }));
+}
+
+#endif
+
+}
@@ -0,0 +1,123 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <phonon.h>
+
+#include "plugin_namespace.h"
+#include "rt_audit.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// EffectPool
+// --------------------------------------------------------------------------------------------------------------------
+
+// Keeps Steam Audio effect objects alive after the DSP that used them is released, so they can be reused by the next DSP
+// that needs an effect with the same settings.
+//
+// acquire() and release() have the same signatures as the corresponding iplXxxEffectCreate and iplXxxEffectRelease
+// functions, and can be used in their place. Released effects are reset, and kept for reuse if fewer than
+// maxIdleEffects() effects with the same settings are already idle. Otherwise they are released.
+//
+// The pool can also be pre-warmed with the effects needed by a typical spatializer instance, so that the first events
+// played after initialization don't pay for creating them. Only effects whose memory use doesn't depend on the
+// simulation settings (panning, binaural, direct, and Ambisonics decode) are pre-warmed.
+//
+// All functions are thread-safe, but none are real-time safe.
+class EffectPool
+{
+public:
+    static const int kDefaultMaxIdleEffects = 16;
+
+    EffectPool();
+
+    // Sets the number of idle effects of each type and configuration to keep, and the configuration used to pre-warm
+    // the pool. If audioSettings.samplingRate is 0, the pool is not pre-warmed.
+    void setSettings(int maxIdleEffects,
+                     const IPLAudioSettings& audioSettings,
+                     int numChannelsIn,
+                     int numChannelsOut);
+
+    int maxIdleEffects() const;
+
+    // Creates idle effects for the pre-warm configuration until maxIdleEffects() of each are available. Idle effects
+    // that were created for a different HRTF are released, since they can no longer be used. simulationSettings may be
+    // nullptr if simulation settings have not been specified yet.
+    void prewarm(IPLContext context,
+                 IPLHRTF hrtf,
+                 const IPLSimulationSettings* simulationSettings);
+
+    // Releases all idle effects.
+    void clear();
+
+    IPLerror acquire(IPLContext context, IPLAudioSettings* audioSettings, IPLPanningEffectSettings* effectSettings, IPLPanningEffect* effect);
+    IPLerror acquire(IPLContext context, IPLAudioSettings* audioSettings, IPLBinauralEffectSettings* effectSettings, IPLBinauralEffect* effect);
+    IPLerror acquire(IPLContext context, IPLAudioSettings* audioSettings, IPLDirectEffectSettings* effectSettings, IPLDirectEffect* effect);
+    IPLerror acquire(IPLContext context, IPLAudioSettings* audioSettings, IPLReflectionEffectSettings* effectSettings, IPLReflectionEffect* effect);
+    IPLerror acquire(IPLContext context, IPLAudioSettings* audioSettings, IPLPathEffectSettings* effectSettings, IPLPathEffect* effect);
+    IPLerror acquire(IPLContext context, IPLAudioSettings* audioSettings, IPLAmbisonicsDecodeEffectSettings* effectSettings, IPLAmbisonicsDecodeEffect* effect);
+
+    void release(IPLPanningEffect* effect);
+    void release(IPLBinauralEffect* effect);
+    void release(IPLDirectEffect* effect);
+    void release(IPLReflectionEffect* effect);
+    void release(IPLPathEffect* effect);
+    void release(IPLAmbisonicsDecodeEffect* effect);
+
+    // Identifies the settings an effect was created with. Effects can only be reused when all fields match.
+    struct Key
+    {
+        int type;
+        int samplingRate;
+        int frameSize;
+        int numChannels;
+        int order;
+        int irSize;
+        int reflectionType;
+        IPLHRTF hrtf;
+
+        bool operator==(const Key& other) const;
+    };
+
+private:
+    struct Entry
+    {
+        Key key;
+        void* effect;
+    };
+
+    mutable AuditedMutex mMutex;
+    int mMaxIdleEffects;
+    IPLAudioSettings mAudioSettings;
+    int mNumChannelsIn;
+    int mNumChannelsOut;
+
+    // Effects that are not in use by any DSP.
+    std::vector<Entry> mIdle;
+
+    // The settings of every effect created by the pool, whether idle or in use.
+    std::unordered_map<void*, Key> mKeys;
+
+    template <typename T, typename S>
+    IPLerror acquireEffect(IPLContext context, IPLAudioSettings* audioSettings, S* effectSettings, T* effect);
+
+    template <typename T>
+    void releaseEffect(T* effect);
+
+    template <typename T, typename S>
+    void prewarmEffect(IPLContext context, IPLAudioSettings* audioSettings, S* effectSettings);
+
+    int countIdle(const Key& key) const;
+};
+
+extern EffectPool gEffectPool;
+
+}
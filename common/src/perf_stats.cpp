@@ -0,0 +1,224 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include "perf_stats.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// Counters only have one writer, so they can be incremented without a read-modify-write operation.
+static void increment(std::atomic<uint64_t>& counter,
+                      uint64_t amount)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static void accumulate(PerfStats& total,
+                       const PerfStats& stats)
+{
+    total.numProcessCalls += stats.numProcessCalls;
+    total.numBypassedBlocks += stats.numBypassedBlocks;
+    total.numInitFailures += stats.numInitFailures;
+    total.numHRTFChanges += stats.numHRTFChanges;
+    total.numHRTFCrossfades += stats.numHRTFCrossfades;
+    total.numLateBlocks += stats.numLateBlocks;
+
+    for (auto i = 0; i < NUM_PERFSTAGES; ++i)
+    {
+        total.stageNanoseconds[i] += stats.stageNanoseconds[i];
+    }
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// PerfCounters
+// --------------------------------------------------------------------------------------------------------------------
+
+PerfCounters::PerfCounters()
+    : mNumProcessCalls(0)
+    , mNumBypassedBlocks(0)
+    , mNumInitFailures(0)
+    , mNumHRTFChanges(0)
+    , mNumHRTFCrossfades(0)
+    , mNumLateBlocks(0)
+    , mSourceHandle(-1)
+    , mLastHRTF(nullptr)
+{
+    for (auto i = 0; i < NUM_PERFSTAGES; ++i)
+    {
+        mStageNanoseconds[i] = 0;
+    }
+}
+
+void PerfCounters::countProcessCall()
+{
+    increment(mNumProcessCalls, 1);
+}
+
+void PerfCounters::countBypassedBlock()
+{
+    increment(mNumBypassedBlocks, 1);
+}
+
+void PerfCounters::countInitFailure()
+{
+    increment(mNumInitFailures, 1);
+}
+
+void PerfCounters::countHRTFChange(const void* hrtf)
+{
+    if (hrtf == mLastHRTF)
+        return;
+
+    // The first HRTF an effect sees is not a change.
+    if (mLastHRTF)
+    {
+        increment(mNumHRTFChanges, 1);
+    }
+
+    mLastHRTF = hrtf;
+}
+
+void PerfCounters::countHRTFCrossfade()
+{
+    increment(mNumHRTFCrossfades, 1);
+}
+
+void PerfCounters::countLateBlock()
+{
+    increment(mNumLateBlocks, 1);
+}
+
+void PerfCounters::addStageTime(PerfStage stage,
+                                uint64_t nanoseconds)
+{
+    increment(mStageNanoseconds[stage], nanoseconds);
+}
+
+void PerfCounters::setSourceHandle(int32_t handle)
+{
+    mSourceHandle.store(handle, std::memory_order_relaxed);
+}
+
+int32_t PerfCounters::sourceHandle() const
+{
+    return mSourceHandle.load(std::memory_order_relaxed);
+}
+
+void PerfCounters::read(PerfStats& stats) const
+{
+    stats.numProcessCalls = mNumProcessCalls.load(std::memory_order_relaxed);
+    stats.numBypassedBlocks = mNumBypassedBlocks.load(std::memory_order_relaxed);
+    stats.numInitFailures = mNumInitFailures.load(std::memory_order_relaxed);
+    stats.numHRTFChanges = mNumHRTFChanges.load(std::memory_order_relaxed);
+    stats.numHRTFCrossfades = mNumHRTFCrossfades.load(std::memory_order_relaxed);
+    stats.numLateBlocks = mNumLateBlocks.load(std::memory_order_relaxed);
+
+    for (auto i = 0; i < NUM_PERFSTAGES; ++i)
+    {
+        stats.stageNanoseconds[i] = mStageNanoseconds[i].load(std::memory_order_relaxed);
+    }
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// PerfTimer
+// --------------------------------------------------------------------------------------------------------------------
+
+PerfTimer::PerfTimer(PerfCounters& counters,
+                     PerfStage stage)
+    : mCounters(counters)
+    , mStage(stage)
+    , mStart(std::chrono::steady_clock::now())
+{}
+
+PerfTimer::~PerfTimer()
+{
+    auto elapsed = std::chrono::steady_clock::now() - mStart;
+    mCounters.addStageTime(mStage, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// PerfStatsRegistry
+// --------------------------------------------------------------------------------------------------------------------
+
+PerfStatsRegistry gPerfStatsRegistry;
+
+PerfStatsRegistry::PerfStatsRegistry()
+    : mMutex("performance counter registry")
+    , mRetired{}
+{}
+
+void PerfStatsRegistry::add(const void* instance,
+                            const PerfCounters* counters)
+{
+    std::lock_guard<AuditedMutex> lock(mMutex);
+
+    mCounters[instance] = counters;
+}
+
+void PerfStatsRegistry::remove(const void* instance)
+{
+    std::lock_guard<AuditedMutex> lock(mMutex);
+
+    auto it = mCounters.find(instance);
+    if (it == mCounters.end())
+        return;
+
+    PerfStats stats;
+    it->second->read(stats);
+    accumulate(mRetired, stats);
+
+    mCounters.erase(it);
+}
+
+bool PerfStatsRegistry::read(const void* instance,
+                             PerfStats& stats) const
+{
+    std::lock_guard<AuditedMutex> lock(mMutex);
+
+    auto it = mCounters.find(instance);
+    if (it == mCounters.end())
+        return false;
+
+    it->second->read(stats);
+    return true;
+}
+
+bool PerfStatsRegistry::readForSource(int32_t handle,
+                                      PerfStats& stats) const
+{
+    if (handle < 0)
+        return false;
+
+    std::lock_guard<AuditedMutex> lock(mMutex);
+
+    for (const auto& entry : mCounters)
+    {
+        if (entry.second->sourceHandle() == handle)
+        {
+            entry.second->read(stats);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void PerfStatsRegistry::readTotal(PerfStats& stats) const
+{
+    std::lock_guard<AuditedMutex> lock(mMutex);
+
+    stats = mRetired;
+
+    for (const auto& entry : mCounters)
+    {
+        PerfStats instanceStats;
+        entry.second->read(instanceStats);
+        accumulate(stats, instanceStats);
+    }
+}
+
+}
@@ -0,0 +1,161 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+#include "plugin_namespace.h"
+#include "rt_audit.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// PerfCounters
+// --------------------------------------------------------------------------------------------------------------------
+
+// Stages of process() that are timed separately.
+enum PerfStage
+{
+    PERFSTAGE_DIRECT,       // Direct effect, including deinterleaving the input.
+    PERFSTAGE_BINAURAL,     // Binaural or panning effect applied to the direct path.
+    PERFSTAGE_REFLECTIONS,  // Reflection effect or reflection mixer.
+    PERFSTAGE_PATHING,      // Path effect.
+    PERFSTAGE_DECODE,       // Ambisonics decode effect.
+    NUM_PERFSTAGES
+};
+
+// A copy of an effect's counters, taken at some point in time.
+struct PerfStats
+{
+    uint64_t numProcessCalls;
+    uint64_t numBypassedBlocks;
+    uint64_t numInitFailures;
+    uint64_t numHRTFChanges;
+    uint64_t numHRTFCrossfades;
+    uint64_t numLateBlocks;
+    uint64_t stageNanoseconds[NUM_PERFSTAGES];
+};
+
+// Counters describing how much work an effect instance has done. The counters are only ever incremented by one thread
+// at a time: the thread that calls the effect's process() function, or, when the Unity plugin renders in pipelined
+// mode, the thread rendering the effect's current block. They can be read on any thread. Nothing here locks or
+// allocates memory.
+class PerfCounters
+{
+public:
+    PerfCounters();
+
+    // Counts one call to process() that rendered (or tried to render) audio.
+    void countProcessCall();
+
+    // Counts one block that was skipped because the effect's inputs were idle.
+    void countBypassedBlock();
+
+    // Counts one block that could not be rendered normally because effect objects or audio buffers could not be
+    // initialized (or have not finished initializing).
+    void countInitFailure();
+
+    // Counts an HRTF change, if hrtf differs from the HRTF passed to the previous call.
+    void countHRTFChange(const void* hrtf);
+
+    // Counts an HRTF change that was crossfaded.
+    void countHRTFCrossfade();
+
+    // Counts one block that was played using the fallback, because a render pool worker did not finish in time.
+    void countLateBlock();
+
+    // Adds time spent in a stage.
+    void addStageTime(PerfStage stage,
+                      uint64_t nanoseconds);
+
+    // The handle of the source rendered by this effect, if any, as obtained from the source manager. Used to look up
+    // an effect's counters from the game engine, which knows its sources by handle.
+    void setSourceHandle(int32_t handle);
+    int32_t sourceHandle() const;
+
+    // Takes a snapshot of the counters. May be called on any thread.
+    void read(PerfStats& stats) const;
+
+private:
+    std::atomic<uint64_t> mNumProcessCalls;
+    std::atomic<uint64_t> mNumBypassedBlocks;
+    std::atomic<uint64_t> mNumInitFailures;
+    std::atomic<uint64_t> mNumHRTFChanges;
+    std::atomic<uint64_t> mNumHRTFCrossfades;
+    std::atomic<uint64_t> mNumLateBlocks;
+    std::atomic<uint64_t> mStageNanoseconds[NUM_PERFSTAGES];
+    std::atomic<int32_t> mSourceHandle;
+    const void* mLastHRTF;
+};
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// PerfTimer
+// --------------------------------------------------------------------------------------------------------------------
+
+// Adds the time between construction and destruction to one of an effect's stages.
+class PerfTimer
+{
+public:
+    PerfTimer(PerfCounters& counters,
+              PerfStage stage);
+
+    ~PerfTimer();
+
+private:
+    PerfCounters& mCounters;
+    PerfStage mStage;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// PerfStatsRegistry
+// --------------------------------------------------------------------------------------------------------------------
+
+// Tracks the counters of every live effect instance, so they can be looked up by the game engine. When an instance is
+// removed, its counters are folded into a running total, so totals include instances that have since been released.
+//
+// All functions are thread-safe, but none are real-time safe. Effects only add and remove themselves when they are
+// created and released; process() only touches its own PerfCounters.
+class PerfStatsRegistry
+{
+public:
+    PerfStatsRegistry();
+
+    // Registers an instance's counters. The counters must remain valid until the instance is removed.
+    void add(const void* instance,
+             const PerfCounters* counters);
+
+    // Unregisters an instance, adding its counters to the totals.
+    void remove(const void* instance);
+
+    // Reads the counters of an instance. Returns false if the instance is not registered.
+    bool read(const void* instance,
+              PerfStats& stats) const;
+
+    // Reads the counters of the instance rendering the source with the given handle. Returns false if there is no
+    // such instance.
+    bool readForSource(int32_t handle,
+                       PerfStats& stats) const;
+
+    // Reads the sum of the counters of all instances, past and present.
+    void readTotal(PerfStats& stats) const;
+
+private:
+    mutable AuditedMutex mMutex;
+    std::unordered_map<const void*, const PerfCounters*> mCounters;
+    PerfStats mRetired;
+};
+
+extern PerfStatsRegistry gPerfStatsRegistry;
+
+}
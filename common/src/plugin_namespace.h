@@ -0,0 +1,13 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+// The sources in this directory are shared by the FMOD Studio and Unity plugins, and compiled into each of them. Each
+// plugin's build defines STEAMAUDIO_PLUGIN_NAMESPACE as its own namespace (SteamAudioFMOD or SteamAudioUnity), so
+// that both plugins can be loaded into the same process without sharing globals such as the pool allocator.
+#if !defined(STEAMAUDIO_PLUGIN_NAMESPACE)
+#error "STEAMAUDIO_PLUGIN_NAMESPACE must be defined as the namespace of the plugin being built."
+#endif
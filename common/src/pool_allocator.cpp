@@ -0,0 +1,499 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+#if defined(IPL_OS_WINDOWS)
+#include <malloc.h>
+#endif
+
+#include "pool_allocator.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// PoolAllocator
+// --------------------------------------------------------------------------------------------------------------------
+
+const int PoolAllocator::kNumSizeClasses;
+const size_t PoolAllocator::kMinBlockSize;
+const size_t PoolAllocator::kMaxBlockSize;
+const size_t PoolAllocator::kBlockAlignment;
+const size_t PoolAllocator::kMaxEmptyChunkBytes;
+const int PoolAllocator::kLargeSizeClass;
+
+PoolAllocator gPoolAllocator;
+
+// Every block is preceded by a header, which records where the block came from. The header is padded to
+// kBlockAlignment bytes, so that blocks stay aligned. Headers of pooled blocks are written once, when their chunk is
+// created, and a free block's link to the next free block is stored in the block itself.
+struct PoolAllocator::BlockHeader
+{
+    int32_t sizeClass;
+    Chunk* chunk;           // Pooled blocks only: the chunk that contains the block.
+    void* base;             // Large allocations only: the pointer to pass to alignedFree.
+    uint64_t size;          // Large allocations only: the size that was requested.
+    uint64_t reservedSize;  // Large allocations only: the size that was obtained from the system.
+};
+
+// A chunk starts with this header, padded to kBlockAlignment bytes, followed by its blocks.
+struct PoolAllocator::Chunk
+{
+    Chunk* prev;            // Previous chunk in the size class's list of partially used chunks.
+    Chunk* next;            // Next chunk in the size class's list of partially used chunks.
+    FreeBlock* freeList;
+    int32_t numFree;
+    int32_t numBlocks;
+    uint64_t reservedSize;  // Size of the chunk, including its header.
+};
+
+static const size_t kHeaderSize = PoolAllocator::kBlockAlignment;
+
+// Blocks of a size class are obtained from the system in chunks of roughly this size. Larger blocks get a chunk each.
+static const size_t kChunkSize = 64 * 1024;
+
+// Bytes of free blocks of each size class that each thread keeps for itself. Larger blocks are not cached.
+static const size_t kMaxCachedBytes = 16 * 1024;
+static const int kMaxCachedBlocksPerSizeClass = 16;
+
+static void* alignedAlloc(size_t size,
+                          size_t alignment)
+{
+#if defined(IPL_OS_WINDOWS)
+    return _aligned_malloc(size, alignment);
+#else
+    void* memory = nullptr;
+    if (posix_memalign(&memory, std::max(alignment, sizeof(void*)), size) != 0)
+        return nullptr;
+
+    return memory;
+#endif
+}
+
+static void alignedFree(void* memory)
+{
+#if defined(IPL_OS_WINDOWS)
+    _aligned_free(memory);
+#else
+    ::free(memory);
+#endif
+}
+
+// Free blocks cached by one thread. Freed blocks go back to whichever thread frees them, not the one that allocated
+// them. When the thread exits, its cached blocks go back to their chunks.
+struct PoolAllocator::ThreadCache
+{
+    FreeBlock* lists[kNumSizeClasses];
+    int counts[kNumSizeClasses];
+
+    ThreadCache()
+        : lists{}
+        , counts{}
+    {}
+
+    ~ThreadCache();
+};
+
+// Set once the calling thread's cache has been destroyed, after which the thread must not use it. This is a plain
+// bool, so it remains valid while other thread-local objects are being destroyed.
+static thread_local bool tIsThreadCacheDestroyed = false;
+
+PoolAllocator::ThreadCache::~ThreadCache()
+{
+    for (auto i = 0; i < kNumSizeClasses; ++i)
+    {
+        gPoolAllocator.release(i, lists[i], counts[i]);
+        counts[i] = 0;
+    }
+
+    tIsThreadCacheDestroyed = true;
+}
+
+PoolAllocator::SizeClass::SizeClass()
+    : mutex("pool allocator")
+    , partialChunks(nullptr)
+    , numAllocations(0)
+    , numActiveAllocations(0)
+    , bytesInUse(0)
+    , peakBytesInUse(0)
+    , bytesReserved(0)
+{}
+
+PoolAllocator::PoolAllocator()
+    : mEmptyChunkBytes(0)
+{
+    static_assert(sizeof(BlockHeader) <= kHeaderSize, "BlockHeader must fit in kHeaderSize bytes.");
+    static_assert(sizeof(Chunk) <= kHeaderSize, "Chunk must fit in kHeaderSize bytes.");
+}
+
+void* PoolAllocator::allocate(size_t size,
+                              size_t alignment)
+{
+    if (size > kMaxBlockSize || alignment > kBlockAlignment)
+    {
+        auto offset = std::max(kHeaderSize, alignment);
+        auto reservedSize = offset + size;
+        auto base = alignedAlloc(reservedSize, std::max(kBlockAlignment, alignment));
+        if (!base)
+            return nullptr;
+
+        auto memory = reinterpret_cast<uint8_t*>(base) + offset;
+        auto header = headerForBlock(memory);
+        header->sizeClass = kLargeSizeClass;
+        header->chunk = nullptr;
+        header->base = base;
+        header->size = size;
+        header->reservedSize = reservedSize;
+
+        mSizeClasses[kLargeSizeClass].bytesReserved.fetch_add(reservedSize, std::memory_order_relaxed);
+        countAllocation(kLargeSizeClass, size);
+        return memory;
+    }
+
+    auto sizeClass = sizeClassForSize(size);
+    auto maxCount = maxCachedBlocks(sizeClass);
+
+    FreeBlock* block = nullptr;
+    if (this == &gPoolAllocator && maxCount > 0 && !tIsThreadCacheDestroyed)
+    {
+        auto& cache = threadCache();
+        auto& list = cache.lists[sizeClass];
+        auto& count = cache.counts[sizeClass];
+
+        if (!list)
+        {
+            count += refill(sizeClass, list, std::max(1, maxCount / 2));
+        }
+
+        if (list)
+        {
+            block = list;
+            list = block->next;
+            --count;
+        }
+    }
+    else
+    {
+        refill(sizeClass, block, 1);
+    }
+
+    if (!block)
+        return nullptr;
+
+    countAllocation(sizeClass, blockSizeForSizeClass(sizeClass));
+    return block;
+}
+
+void PoolAllocator::free(void* memory)
+{
+    if (!memory)
+        return;
+
+    auto header = headerForBlock(memory);
+    auto sizeClass = header->sizeClass;
+
+    if (sizeClass == kLargeSizeClass)
+    {
+        countFree(kLargeSizeClass, header->size);
+        mSizeClasses[kLargeSizeClass].bytesReserved.fetch_sub(header->reservedSize, std::memory_order_relaxed);
+        alignedFree(header->base);
+        return;
+    }
+
+    countFree(sizeClass, blockSizeForSizeClass(sizeClass));
+
+    auto block = reinterpret_cast<FreeBlock*>(memory);
+    auto maxCount = maxCachedBlocks(sizeClass);
+
+    if (this == &gPoolAllocator && maxCount > 0 && !tIsThreadCacheDestroyed)
+    {
+        auto& cache = threadCache();
+        auto& list = cache.lists[sizeClass];
+        auto& count = cache.counts[sizeClass];
+
+        block->next = list;
+        list = block;
+        ++count;
+
+        // Keep half of the cache, so that alternating frees and allocations don't bounce blocks back and forth.
+        if (count > maxCount)
+        {
+            auto numReleased = count - maxCount / 2;
+            release(sizeClass, list, numReleased);
+            count -= numReleased;
+        }
+    }
+    else
+    {
+        block->next = nullptr;
+        release(sizeClass, block, 1);
+    }
+}
+
+void PoolAllocator::getStats(PoolAllocatorStats* stats) const
+{
+    for (auto i = 0; i <= kLargeSizeClass; ++i)
+    {
+        const auto& sizeClass = mSizeClasses[i];
+
+        stats[i].blockSize = (i < kLargeSizeClass) ? blockSizeForSizeClass(i) : 0;
+        stats[i].numAllocations = sizeClass.numAllocations.load(std::memory_order_relaxed);
+        stats[i].numActiveAllocations = sizeClass.numActiveAllocations.load(std::memory_order_relaxed);
+        stats[i].bytesInUse = sizeClass.bytesInUse.load(std::memory_order_relaxed);
+        stats[i].peakBytesInUse = sizeClass.peakBytesInUse.load(std::memory_order_relaxed);
+        stats[i].bytesReserved = sizeClass.bytesReserved.load(std::memory_order_relaxed);
+    }
+}
+
+void* IPLCALL PoolAllocator::allocateCallback(IPLsize size,
+                                              IPLsize alignment)
+{
+    return gPoolAllocator.allocate(size, alignment);
+}
+
+void IPLCALL PoolAllocator::freeCallback(void* memory)
+{
+    gPoolAllocator.free(memory);
+}
+
+// The first four size classes are 64, 128, 192, and 256 bytes. Above that, each octave is split into four size
+// classes: 320, 384, 448, 512, 640, and so on, up to kMaxBlockSize.
+int PoolAllocator::sizeClassForSize(size_t size)
+{
+    if (size <= 4 * kMinBlockSize)
+        return static_cast<int>(std::max<size_t>((size + kMinBlockSize - 1) / kMinBlockSize, 1)) - 1;
+
+    auto octave = 0;
+    auto octaveSize = 4 * kMinBlockSize;
+    while (size > 2 * octaveSize)
+    {
+        octaveSize *= 2;
+        ++octave;
+    }
+
+    auto step = octaveSize / 4;
+    auto subClass = static_cast<int>((size - octaveSize + step - 1) / step) - 1;
+    return 4 + 4 * octave + subClass;
+}
+
+size_t PoolAllocator::blockSizeForSizeClass(int sizeClass)
+{
+    if (sizeClass < 4)
+        return kMinBlockSize * (sizeClass + 1);
+
+    auto octaveSize = (4 * kMinBlockSize) << ((sizeClass - 4) / 4);
+    return octaveSize + (octaveSize / 4) * ((sizeClass - 4) % 4 + 1);
+}
+
+int PoolAllocator::maxCachedBlocks(int sizeClass)
+{
+    auto blockSize = blockSizeForSizeClass(sizeClass);
+    if (blockSize > kMaxCachedBytes)
+        return 0;
+
+    auto numBlocks = static_cast<int>(kMaxCachedBytes / blockSize);
+    return std::min(std::max(numBlocks, 1), kMaxCachedBlocksPerSizeClass);
+}
+
+PoolAllocator::BlockHeader* PoolAllocator::headerForBlock(void* memory)
+{
+    return reinterpret_cast<BlockHeader*>(reinterpret_cast<uint8_t*>(memory) - kHeaderSize);
+}
+
+int PoolAllocator::refill(int sizeClass,
+                          FreeBlock*& list,
+                          int count)
+{
+    auto& shared = mSizeClasses[sizeClass];
+    std::lock_guard<AuditedMutex> lock(shared.mutex);
+
+    auto numMoved = 0;
+    while (numMoved < count)
+    {
+        auto chunk = shared.partialChunks;
+        if (!chunk)
+        {
+            chunk = createChunk(sizeClass);
+            if (!chunk)
+                break;
+
+            linkChunk(sizeClass, chunk);
+        }
+
+        if (chunk->numFree == chunk->numBlocks)
+        {
+            mEmptyChunkBytes.fetch_sub(chunk->reservedSize, std::memory_order_relaxed);
+        }
+
+        while (numMoved < count && chunk->freeList)
+        {
+            auto block = chunk->freeList;
+            chunk->freeList = block->next;
+            --chunk->numFree;
+
+            block->next = list;
+            list = block;
+            ++numMoved;
+        }
+
+        if (!chunk->freeList)
+        {
+            unlinkChunk(sizeClass, chunk);
+        }
+    }
+
+    return numMoved;
+}
+
+void PoolAllocator::release(int sizeClass,
+                            FreeBlock*& list,
+                            int count)
+{
+    if (count <= 0 || !list)
+        return;
+
+    auto& shared = mSizeClasses[sizeClass];
+    std::lock_guard<AuditedMutex> lock(shared.mutex);
+
+    for (auto i = 0; i < count && list; ++i)
+    {
+        auto block = list;
+        list = block->next;
+
+        auto chunk = headerForBlock(block)->chunk;
+        block->next = chunk->freeList;
+        chunk->freeList = block;
+
+        if (chunk->numFree++ == 0)
+        {
+            linkChunk(sizeClass, chunk);
+        }
+
+        if (chunk->numFree == chunk->numBlocks)
+        {
+            auto emptyChunkBytes = mEmptyChunkBytes.fetch_add(chunk->reservedSize, std::memory_order_relaxed);
+            if (emptyChunkBytes + chunk->reservedSize > kMaxEmptyChunkBytes)
+            {
+                mEmptyChunkBytes.fetch_sub(chunk->reservedSize, std::memory_order_relaxed);
+                unlinkChunk(sizeClass, chunk);
+                destroyChunk(sizeClass, chunk);
+            }
+        }
+    }
+}
+
+// New chunks are empty, so they are counted in mEmptyChunkBytes until the caller takes blocks from them.
+PoolAllocator::Chunk* PoolAllocator::createChunk(int sizeClass)
+{
+    auto slotSize = kHeaderSize + blockSizeForSizeClass(sizeClass);
+    auto numBlocks = std::max<size_t>(kChunkSize / slotSize, 1);
+    auto reservedSize = kHeaderSize + numBlocks * slotSize;
+
+    auto memory = reinterpret_cast<uint8_t*>(alignedAlloc(reservedSize, kBlockAlignment));
+    if (!memory)
+        return nullptr;
+
+    auto chunk = reinterpret_cast<Chunk*>(memory);
+    chunk->prev = nullptr;
+    chunk->next = nullptr;
+    chunk->freeList = nullptr;
+    chunk->numFree = static_cast<int32_t>(numBlocks);
+    chunk->numBlocks = static_cast<int32_t>(numBlocks);
+    chunk->reservedSize = reservedSize;
+
+    for (auto i = numBlocks; i > 0; --i)
+    {
+        auto slot = memory + kHeaderSize + (i - 1) * slotSize;
+
+        auto header = reinterpret_cast<BlockHeader*>(slot);
+        header->sizeClass = sizeClass;
+        header->chunk = chunk;
+
+        auto block = reinterpret_cast<FreeBlock*>(slot + kHeaderSize);
+        block->next = chunk->freeList;
+        chunk->freeList = block;
+    }
+
+    mSizeClasses[sizeClass].bytesReserved.fetch_add(reservedSize, std::memory_order_relaxed);
+    mEmptyChunkBytes.fetch_add(reservedSize, std::memory_order_relaxed);
+    return chunk;
+}
+
+void PoolAllocator::destroyChunk(int sizeClass,
+                                 Chunk* chunk)
+{
+    mSizeClasses[sizeClass].bytesReserved.fetch_sub(chunk->reservedSize, std::memory_order_relaxed);
+    alignedFree(chunk);
+}
+
+void PoolAllocator::linkChunk(int sizeClass,
+                              Chunk* chunk)
+{
+    auto& shared = mSizeClasses[sizeClass];
+
+    chunk->prev = nullptr;
+    chunk->next = shared.partialChunks;
+    if (shared.partialChunks)
+    {
+        shared.partialChunks->prev = chunk;
+    }
+
+    shared.partialChunks = chunk;
+}
+
+void PoolAllocator::unlinkChunk(int sizeClass,
+                                Chunk* chunk)
+{
+    auto& shared = mSizeClasses[sizeClass];
+
+    if (chunk->prev)
+    {
+        chunk->prev->next = chunk->next;
+    }
+    else
+    {
+        shared.partialChunks = chunk->next;
+    }
+
+    if (chunk->next)
+    {
+        chunk->next->prev = chunk->prev;
+    }
+
+    chunk->prev = nullptr;
+    chunk->next = nullptr;
+}
+
+void PoolAllocator::countAllocation(int sizeClass,
+                                    uint64_t bytes)
+{
+    auto& counters = mSizeClasses[sizeClass];
+    counters.numAllocations.fetch_add(1, std::memory_order_relaxed);
+    counters.numActiveAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    auto bytesInUse = counters.bytesInUse.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    auto peakBytesInUse = counters.peakBytesInUse.load(std::memory_order_relaxed);
+    while (bytesInUse > peakBytesInUse &&
+           !counters.peakBytesInUse.compare_exchange_weak(peakBytesInUse, bytesInUse, std::memory_order_relaxed))
+    {}
+}
+
+void PoolAllocator::countFree(int sizeClass,
+                              uint64_t bytes)
+{
+    auto& counters = mSizeClasses[sizeClass];
+    counters.numActiveAllocations.fetch_sub(1, std::memory_order_relaxed);
+    counters.bytesInUse.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+PoolAllocator::ThreadCache& PoolAllocator::threadCache()
+{
+    static thread_local ThreadCache tCache;
+    return tCache;
+}
+
+}
@@ -0,0 +1,142 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include <phonon.h>
+
+#include "plugin_namespace.h"
+#include "rt_audit.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// PoolAllocator
+// --------------------------------------------------------------------------------------------------------------------
+
+// Usage counters for one size class of the pool allocator.
+struct PoolAllocatorStats
+{
+    size_t blockSize;               // Largest allocation served by this size class, or 0 for large allocations.
+    uint64_t numAllocations;        // Total number of allocations made, including those since freed.
+    uint64_t numActiveAllocations;  // Number of allocations not yet freed.
+    uint64_t bytesInUse;            // Bytes in blocks that have not been freed.
+    uint64_t peakBytesInUse;        // Largest value of bytesInUse so far.
+    uint64_t bytesReserved;         // Bytes obtained from the system, whether in use or not.
+};
+
+// A size-class allocator for Steam Audio's own allocations, installed via IPLContextSettings::allocateCallback and
+// IPLContextSettings::freeCallback.
+//
+// Requests of up to kMaxBlockSize bytes are rounded up to the nearest size class, and served from blocks carved out of
+// chunks, one set of chunks per size class. Size classes are multiples of 64 bytes up to 256 bytes, and four per
+// octave above that, so no more than 25% of a block is wasted by rounding. Freed blocks are reused by the same size
+// class, so long sessions that repeatedly create and destroy effects, IRs, and so on reuse the same memory instead of
+// fragmenting the heap. Once every block in a chunk has been freed, the chunk is returned to the system, except for up
+// to kMaxEmptyChunkBytes of empty chunks kept for reuse. Larger requests, and requests with an alignment greater than
+// kBlockAlignment, go straight to the system.
+//
+// Each thread caches a few free blocks of each size class up to 16 KB, so that most allocations and frees don't lock
+// anything. Only gPoolAllocator uses these caches; other instances always use the shared free lists.
+class PoolAllocator
+{
+public:
+    static const int kNumSizeClasses = 52;
+    static const size_t kMinBlockSize = 64;
+    static const size_t kMaxBlockSize = 1024 * 1024;
+    static const size_t kBlockAlignment = 64;
+    static const size_t kMaxEmptyChunkBytes = 1024 * 1024;
+
+    // Index of the size class used for large allocations, in the array filled in by getStats.
+    static const int kLargeSizeClass = kNumSizeClasses;
+
+    PoolAllocator();
+
+    void* allocate(size_t size,
+                   size_t alignment);
+
+    void free(void* memory);
+
+    // Fills in stats[0] to stats[kLargeSizeClass]. May be called on any thread.
+    void getStats(PoolAllocatorStats* stats) const;
+
+    // Callbacks for IPLContextSettings that use gPoolAllocator.
+    static void* IPLCALL allocateCallback(IPLsize size,
+                                          IPLsize alignment);
+
+    static void IPLCALL freeCallback(void* memory);
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct BlockHeader;
+    struct Chunk;
+
+    struct SizeClass
+    {
+        AuditedMutex mutex;
+        Chunk* partialChunks;   // Chunks with at least one free block.
+        std::atomic<uint64_t> numAllocations;
+        std::atomic<uint64_t> numActiveAllocations;
+        std::atomic<uint64_t> bytesInUse;
+        std::atomic<uint64_t> peakBytesInUse;
+        std::atomic<uint64_t> bytesReserved;
+
+        SizeClass();
+    };
+
+    struct ThreadCache;
+
+    SizeClass mSizeClasses[kNumSizeClasses + 1];
+    std::atomic<size_t> mEmptyChunkBytes;
+
+    static int sizeClassForSize(size_t size);
+    static size_t blockSizeForSizeClass(int sizeClass);
+    static int maxCachedBlocks(int sizeClass);
+    static BlockHeader* headerForBlock(void* memory);
+
+    // Moves up to count free blocks of the given size class from its chunks (allocating new chunks if needed) to the
+    // given list. Returns the number of blocks moved.
+    int refill(int sizeClass,
+               FreeBlock*& list,
+               int count);
+
+    // Moves count blocks from the given list back to the chunks of the given size class, returning any chunks that
+    // become empty to the system, beyond those kept for reuse.
+    void release(int sizeClass,
+                 FreeBlock*& list,
+                 int count);
+
+    Chunk* createChunk(int sizeClass);
+
+    void destroyChunk(int sizeClass,
+                      Chunk* chunk);
+
+    void linkChunk(int sizeClass,
+                   Chunk* chunk);
+
+    void unlinkChunk(int sizeClass,
+                     Chunk* chunk);
+
+    void countAllocation(int sizeClass,
+                         uint64_t bytes);
+
+    void countFree(int sizeClass,
+                   uint64_t bytes);
+
+    static ThreadCache& threadCache();
+};
+
+extern PoolAllocator gPoolAllocator;
+
+}
@@ -0,0 +1,207 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <algorithm>
+
+#include "effect_builder.h"
+#include "reflection_budget.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// RankJob
+// --------------------------------------------------------------------------------------------------------------------
+
+class ReflectionBudget::RankJob : public EffectBuildJob
+{
+public:
+    ReflectionBudget* budget;
+    uint64_t clock;
+    int maxOrder;
+    float maxDuration;
+
+protected:
+    virtual void build() override
+    {
+        budget->rank(clock, maxOrder, maxDuration);
+    }
+};
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// ReflectionBudget
+// --------------------------------------------------------------------------------------------------------------------
+
+const int ReflectionBudget::kMaxSources;
+const float ReflectionBudget::kHysteresis = 1.5f;
+
+ReflectionBudget gReflectionBudget;
+
+ReflectionBudget::ReflectionBudget()
+    : mBudget(0.0f)
+    , mClock(0)
+    , mNumSlotsUsed(0)
+    , mSlots(new Slot[kMaxSources])
+    , mRanked(new RankedSource[kMaxSources])
+    , mRankJob(new RankJob())
+{
+    mRankJob->budget = this;
+
+    for (auto i = 0; i < kMaxSources; ++i)
+    {
+        mSlots[i].inUse = false;
+        mSlots[i].priority = 0.0f;
+        mSlots[i].clock = 0;
+        mSlots[i].order = -1;
+        mSlots[i].duration = 0.0f;
+    }
+}
+
+ReflectionBudget::~ReflectionBudget()
+{
+    gEffectBuilder.abandon(mRankJob);
+}
+
+void ReflectionBudget::setBudget(float channelSeconds)
+{
+    mBudget = std::max(channelSeconds, 0.0f);
+}
+
+bool ReflectionBudget::isEnabled() const
+{
+    return mBudget.load(std::memory_order_relaxed) > 0.0f;
+}
+
+int ReflectionBudget::addSource()
+{
+    for (auto i = 0; i < kMaxSources; ++i)
+    {
+        auto inUse = false;
+        if (mSlots[i].inUse.compare_exchange_strong(inUse, true))
+        {
+            mSlots[i].clock = 0;
+            mSlots[i].order = -1;
+
+            auto numSlotsUsed = mNumSlotsUsed.load();
+            while (numSlotsUsed < i + 1 && !mNumSlotsUsed.compare_exchange_weak(numSlotsUsed, i + 1))
+            {}
+
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void ReflectionBudget::removeSource(int source)
+{
+    if (source < 0 || kMaxSources <= source)
+        return;
+
+    mSlots[source].order = -1;
+    mSlots[source].inUse = false;
+}
+
+void ReflectionBudget::update(int source,
+                              uint64_t clock,
+                              float priority,
+                              int maxOrder,
+                              float maxDuration)
+{
+    if (source < 0 || kMaxSources <= source)
+        return;
+
+    auto lastClock = mClock.load();
+    if (clock > lastClock && mClock.compare_exchange_strong(lastClock, clock))
+    {
+        // If the worker is still ranking a previous block, skip this block's ranking. The previous levels of detail
+        // remain in effect.
+        if (mRankJob->isReady())
+        {
+            mRankJob->complete();
+        }
+
+        if (mRankJob->isIdle())
+        {
+            mRankJob->clock = lastClock;
+            mRankJob->maxOrder = maxOrder;
+            mRankJob->maxDuration = maxDuration;
+            gEffectBuilder.submit(mRankJob);
+        }
+    }
+
+    mSlots[source].priority = priority;
+    mSlots[source].clock = clock;
+}
+
+ReflectionLOD ReflectionBudget::lod(int source) const
+{
+    if (source < 0 || kMaxSources <= source)
+        return ReflectionLOD{-1, 0.0f};
+
+    return ReflectionLOD{mSlots[source].order.load(), mSlots[source].duration.load()};
+}
+
+void ReflectionBudget::rank(uint64_t clock,
+                            int maxOrder,
+                            float maxDuration)
+{
+    // Only sources that published a priority during the previous block are ranked. All others are not rendering
+    // reflections, and don't need any budget.
+    auto numRanked = 0;
+    auto numSlotsUsed = mNumSlotsUsed.load();
+    for (auto i = 0; i < numSlotsUsed; ++i)
+    {
+        if (mSlots[i].inUse && mSlots[i].clock >= clock)
+        {
+            auto priority = mSlots[i].priority.load();
+            if (mSlots[i].order >= 0)
+            {
+                priority *= kHysteresis;
+            }
+
+            mRanked[numRanked++] = RankedSource{priority, i};
+        }
+        else
+        {
+            mSlots[i].order = -1;
+        }
+    }
+
+    std::sort(mRanked.get(), mRanked.get() + numRanked, [](const RankedSource& a, const RankedSource& b)
+    {
+        return a.priority > b.priority;
+    });
+
+    auto remainingBudget = mBudget.load();
+
+    for (auto i = 0; i < numRanked; ++i)
+    {
+        auto order = -1;
+        auto duration = 0.0f;
+
+        for (auto fraction = 1.0f; fraction >= 0.25f && order < 0; fraction *= 0.5f)
+        {
+            for (auto candidateOrder = maxOrder; candidateOrder >= 0; --candidateOrder)
+            {
+                auto numChannels = (candidateOrder + 1) * (candidateOrder + 1);
+                auto cost = numChannels * maxDuration * fraction;
+                if (cost <= remainingBudget)
+                {
+                    order = candidateOrder;
+                    duration = maxDuration * fraction;
+                    remainingBudget -= cost;
+                    break;
+                }
+            }
+        }
+
+        auto& slot = mSlots[mRanked[i].source];
+        slot.duration = duration;
+        slot.order = order;
+    }
+}
+
+}
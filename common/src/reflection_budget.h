@@ -0,0 +1,123 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include "plugin_namespace.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// ReflectionBudget
+// --------------------------------------------------------------------------------------------------------------------
+
+// Level of detail at which a source's reflections should be rendered.
+struct ReflectionLOD
+{
+    // Ambisonic order of the IR to convolve with. -1 if reflections should not be rendered at all.
+    int order;
+
+    // Duration of the IR to convolve with, in seconds.
+    float duration;
+};
+
+// Limits the total cost of convolution reverb across all spatializers.
+//
+// The cost of convolving with a reflection IR is roughly proportional to the number of Ambisonic channels times the IR
+// duration, so the budget is expressed in channel-seconds: with a budget of 8, for example, at most 8 first order
+// (4 channel) sources with 2 s IRs are convolved at full detail. Each block, every source that renders reflections
+// publishes a priority. Once per mix block, the sources are ranked by priority, and, in order, each is assigned the
+// most detailed order and IR duration that fit in the remaining budget. The Ambisonic order is lowered first, then the
+// IR duration is halved, down to a quarter of its full length. Sources for which even the cheapest level of detail
+// doesn't fit don't render reflections until they rise in the ranking.
+//
+// Sources that are already rendering reflections are ranked as if their priority were kHysteresis times higher, so
+// that sources with similar priorities don't repeatedly trade places, and switch between levels of detail, from one
+// block to the next.
+//
+// Ranking sorts every source, so it runs on the effect builder's worker thread rather than on the mixer thread. The
+// first source to publish a priority in a new block requests it, using the priorities published during the previous
+// block. A source's level of detail therefore lags its priority by at least one block. Sources that have not been
+// ranked yet don't render reflections.
+//
+// Sources are added and removed on any thread. Priorities are published, and levels of detail read, on the mixer
+// thread. Nothing on the mixer thread locks or allocates memory.
+class ReflectionBudget
+{
+public:
+    static const int kMaxSources = 4096;
+    static const float kHysteresis;
+
+    ReflectionBudget();
+    ~ReflectionBudget();
+
+    // Sets the budget, in channel-seconds. A budget of 0 (the default) disables the budget, so every source renders
+    // reflections at full detail.
+    void setBudget(float channelSeconds);
+
+    // Returns true if a budget has been set.
+    bool isEnabled() const;
+
+    // Reserves a slot for a source. Returns -1 if all slots are in use.
+    int addSource();
+
+    // Frees a slot.
+    void removeSource(int source);
+
+    // Publishes a source's priority for the current block. Higher priority sources are given more detail. clock
+    // identifies the mix block, and must increase from one block to the next. If this is the first call for a new
+    // block, and the previous ranking has finished, ranking is requested for the previous block. Lock-free.
+    void update(int source,
+                uint64_t clock,
+                float priority,
+                int maxOrder,
+                float maxDuration);
+
+    // Returns the level of detail assigned to a source.
+    ReflectionLOD lod(int source) const;
+
+private:
+    class RankJob;
+
+    struct Slot
+    {
+        std::atomic<bool> inUse;
+        std::atomic<float> priority;
+        std::atomic<uint64_t> clock;
+        std::atomic<int> order;
+        std::atomic<float> duration;
+    };
+
+    struct RankedSource
+    {
+        float priority;
+        int source;
+    };
+
+    std::atomic<float> mBudget;
+    std::atomic<uint64_t> mClock;
+    std::atomic<int> mNumSlotsUsed;
+    std::unique_ptr<Slot[]> mSlots;
+    std::unique_ptr<RankedSource[]> mRanked;
+
+    // The job that runs rank() on the worker thread. Only submitted or completed by the caller of update() that
+    // starts a new block.
+    RankJob* mRankJob;
+
+    // Ranks the sources that published a priority for the given block, or later, and assigns their levels of detail.
+    // Called on the effect builder's worker thread.
+    void rank(uint64_t clock,
+              int maxOrder,
+              float maxDuration);
+};
+
+extern ReflectionBudget gReflectionBudget;
+
+}
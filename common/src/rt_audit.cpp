@@ -0,0 +1,429 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#if defined(IPL_OS_WINDOWS)
+#include <Windows.h>
+#elif defined(IPL_OS_LINUX) || defined(IPL_OS_MACOSX)
+#include <dlfcn.h>
+#include <execinfo.h>
+#endif
+
+#include "pool_allocator.h"
+#include "rt_audit.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+#if defined(STEAMAUDIO_ENABLE_RT_AUDIT)
+
+// --------------------------------------------------------------------------------------------------------------------
+// Recording
+// --------------------------------------------------------------------------------------------------------------------
+
+// Events are grouped by call site: the event type, the description, and the innermost stack frames. Each distinct call
+// site gets one slot in a fixed-size, open-addressed table, so recording never allocates or locks.
+static const int kMaxSites = 256;
+static const int kMaxFrames = 8;
+
+// Frames for captureFrames, record, and recordRTAuditEvent, none of which are inlined, so that the innermost frame
+// reported is the function that made the event (operator new, AuditedMutex::lock, etc.).
+static const int kSkippedFrames = 3;
+
+#if defined(IPL_OS_WINDOWS)
+#define RTAUDIT_NOINLINE __declspec(noinline)
+#else
+#define RTAUDIT_NOINLINE __attribute__((noinline))
+#endif
+
+struct Site
+{
+    std::atomic<uint64_t> key;
+    std::atomic<bool> ready;
+    RTAuditEvent event;
+    const char* what;
+    int numFrames;
+    void* frames[kMaxFrames];
+    std::atomic<uint64_t> count;
+};
+
+static Site gSites[kMaxSites];
+static std::atomic<uint64_t> gEventCounts[NUM_RTAUDITEVENTS];
+static std::atomic<uint64_t> gNumUntrackedEvents;
+
+static thread_local int tScopeDepth = 0;
+static thread_local bool tIsRecording = false;
+
+static const char* gEventNames[NUM_RTAUDITEVENTS] = {"allocation", "lock", "system call"};
+
+static RTAUDIT_NOINLINE int captureFrames(void** frames)
+{
+#if defined(IPL_OS_LINUX) || defined(IPL_OS_MACOSX)
+    void* buffer[kMaxFrames + kSkippedFrames];
+    auto numFrames = backtrace(buffer, kMaxFrames + kSkippedFrames) - kSkippedFrames;
+    for (auto i = 0; i < numFrames; ++i)
+    {
+        frames[i] = buffer[i + kSkippedFrames];
+    }
+    return std::max(numFrames, 0);
+#elif defined(IPL_OS_WINDOWS)
+    return CaptureStackBackTrace(kSkippedFrames, kMaxFrames, frames, nullptr);
+#else
+    return 0;
+#endif
+}
+
+static uint64_t hashSite(RTAuditEvent event,
+                         const char* what,
+                         void* const* frames,
+                         int numFrames)
+{
+    auto hash = 14695981039346656037ull;
+    auto combine = [&](uint64_t value)
+    {
+        hash = (hash ^ value) * 1099511628211ull;
+    };
+
+    combine(static_cast<uint64_t>(event));
+    combine(reinterpret_cast<uintptr_t>(what));
+    for (auto i = 0; i < numFrames; ++i)
+    {
+        combine(reinterpret_cast<uintptr_t>(frames[i]));
+    }
+
+    // 0 marks an empty slot.
+    return (hash != 0) ? hash : 1;
+}
+
+static RTAUDIT_NOINLINE void record(RTAuditEvent event,
+                                    const char* what)
+{
+    gEventCounts[event].fetch_add(1, std::memory_order_relaxed);
+
+    void* frames[kMaxFrames];
+    auto numFrames = captureFrames(frames);
+    auto key = hashSite(event, what, frames, numFrames);
+
+    for (auto i = 0; i < kMaxSites; ++i)
+    {
+        auto& site = gSites[(key + i) % kMaxSites];
+
+        auto existingKey = site.key.load(std::memory_order_acquire);
+        if (existingKey == 0 && site.key.compare_exchange_strong(existingKey, key, std::memory_order_acq_rel))
+        {
+            site.event = event;
+            site.what = what;
+            site.numFrames = numFrames;
+            std::copy(frames, frames + numFrames, site.frames);
+            site.count.store(1, std::memory_order_relaxed);
+            site.ready.store(true, std::memory_order_release);
+            return;
+        }
+
+        if (existingKey == key)
+        {
+            site.count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    gNumUntrackedEvents.fetch_add(1, std::memory_order_relaxed);
+}
+
+RTAUDIT_NOINLINE void recordRTAuditEvent(RTAuditEvent event,
+                                         const char* what)
+{
+    // Capturing the stack may itself allocate (for example, the first time on a new thread), so don't record events
+    // made while recording.
+    if (tScopeDepth <= 0 || tIsRecording)
+        return;
+
+    tIsRecording = true;
+    record(event, what);
+    tIsRecording = false;
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// RTAuditScope
+// --------------------------------------------------------------------------------------------------------------------
+
+RTAuditScope::RTAuditScope()
+{
+    ++tScopeDepth;
+}
+
+RTAuditScope::~RTAuditScope()
+{
+    --tScopeDepth;
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// Reporting
+// --------------------------------------------------------------------------------------------------------------------
+
+// Appends formatted text to a fixed-size buffer, silently truncating once it is full.
+class ReportWriter
+{
+public:
+    ReportWriter(char* buffer,
+                 int size)
+        : mBuffer(buffer)
+        , mSize(size)
+        , mLength(0)
+    {
+        if (mBuffer && mSize > 0)
+        {
+            mBuffer[0] = '\0';
+        }
+    }
+
+    template <typename... Args>
+    void write(const char* format,
+               Args... args)
+    {
+        if (!mBuffer || mLength >= mSize - 1)
+            return;
+
+        auto written = snprintf(mBuffer + mLength, mSize - mLength, format, args...);
+        if (written > 0)
+        {
+            mLength = std::min(mLength + written, mSize - 1);
+        }
+    }
+
+private:
+    char* mBuffer;
+    int mSize;
+    int mLength;
+};
+
+static void writeFrame(ReportWriter& writer,
+                       void* frame)
+{
+#if defined(IPL_OS_LINUX) || defined(IPL_OS_MACOSX)
+    Dl_info info{};
+    if (dladdr(frame, &info) && info.dli_sname)
+    {
+        auto offset = reinterpret_cast<uintptr_t>(frame) - reinterpret_cast<uintptr_t>(info.dli_saddr);
+        writer.write("        %s+0x%llx\n", info.dli_sname, static_cast<unsigned long long>(offset));
+        return;
+    }
+
+    if (dladdr(frame, &info) && info.dli_fname)
+    {
+        auto offset = reinterpret_cast<uintptr_t>(frame) - reinterpret_cast<uintptr_t>(info.dli_fbase);
+        writer.write("        %s+0x%llx\n", info.dli_fname, static_cast<unsigned long long>(offset));
+        return;
+    }
+#endif
+
+    writer.write("        %p\n", frame);
+}
+
+int64_t writeRTAuditReport(char* report,
+                           int size)
+{
+    uint64_t counts[NUM_RTAUDITEVENTS];
+    uint64_t total = 0;
+    for (auto i = 0; i < NUM_RTAUDITEVENTS; ++i)
+    {
+        counts[i] = gEventCounts[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    ReportWriter writer(report, size);
+    writer.write("Real-time audit: %llu allocations, %llu locks, %llu system calls.\n",
+                 static_cast<unsigned long long>(counts[RTAUDITEVENT_ALLOCATION]),
+                 static_cast<unsigned long long>(counts[RTAUDITEVENT_LOCK]),
+                 static_cast<unsigned long long>(counts[RTAUDITEVENT_SYSCALL]));
+
+    // Most frequent call sites first.
+    int order[kMaxSites];
+    auto numSites = 0;
+    for (auto i = 0; i < kMaxSites; ++i)
+    {
+        if (gSites[i].ready.load(std::memory_order_acquire))
+        {
+            order[numSites++] = i;
+        }
+    }
+
+    std::sort(order, order + numSites, [](int a, int b)
+    {
+        return gSites[a].count.load(std::memory_order_relaxed) > gSites[b].count.load(std::memory_order_relaxed);
+    });
+
+    for (auto i = 0; i < numSites; ++i)
+    {
+        const auto& site = gSites[order[i]];
+
+        writer.write("%s: %s (%llu times)\n", gEventNames[site.event], site.what,
+                     static_cast<unsigned long long>(site.count.load(std::memory_order_relaxed)));
+
+        for (auto j = 0; j < site.numFrames; ++j)
+        {
+            writeFrame(writer, site.frames[j]);
+        }
+    }
+
+    auto numUntrackedEvents = gNumUntrackedEvents.load(std::memory_order_relaxed);
+    if (numUntrackedEvents > 0)
+    {
+        writer.write("%llu events from other call sites.\n", static_cast<unsigned long long>(numUntrackedEvents));
+    }
+
+    return static_cast<int64_t>(total);
+}
+
+void resetRTAudit()
+{
+    for (auto& site : gSites)
+    {
+        site.ready.store(false, std::memory_order_relaxed);
+        site.count.store(0, std::memory_order_relaxed);
+        site.key.store(0, std::memory_order_release);
+    }
+
+    for (auto& count : gEventCounts)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+
+    gNumUntrackedEvents.store(0, std::memory_order_relaxed);
+}
+
+#if defined(IPL_OS_LINUX) || defined(IPL_OS_MACOSX)
+// The first call to backtrace() loads the unwinder, which allocates. Do that when the plugin is loaded.
+static const int gBacktracePrimed = []()
+{
+    void* frame = nullptr;
+    return backtrace(&frame, 1);
+}();
+#endif
+
+#else
+
+int64_t writeRTAuditReport(char* report,
+                           int size)
+{
+    if (report && size > 0)
+    {
+        report[0] = '\0';
+    }
+
+    return -1;
+}
+
+void resetRTAudit()
+{}
+
+#endif
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// Allocation Callbacks
+// --------------------------------------------------------------------------------------------------------------------
+
+void* IPLCALL auditedAllocate(IPLsize size,
+                              IPLsize alignment)
+{
+    recordRTAuditEvent(RTAUDITEVENT_ALLOCATION, "Steam Audio allocation");
+    return gPoolAllocator.allocate(size, alignment);
+}
+
+void IPLCALL auditedFree(void* memory)
+{
+    recordRTAuditEvent(RTAUDITEVENT_ALLOCATION, "Steam Audio free");
+    gPoolAllocator.free(memory);
+}
+
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// Operator New and Delete
+// --------------------------------------------------------------------------------------------------------------------
+
+#if defined(STEAMAUDIO_ENABLE_RT_AUDIT)
+
+// These must only be used for allocations made by the plugin itself, not those made by the host application. DLLs and
+// two-level namespaces keep them local on Windows and macOS; on Linux and Android, rt_audit.map keeps them out of the
+// dynamic symbol table.
+
+void* operator new(size_t size)
+{
+    STEAMAUDIO_PLUGIN_NAMESPACE::recordRTAuditEvent(STEAMAUDIO_PLUGIN_NAMESPACE::RTAUDITEVENT_ALLOCATION, "operator new");
+
+    auto memory = malloc(std::max<size_t>(size, 1));
+    if (!memory)
+        throw std::bad_alloc();
+
+    return memory;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size,
+                   const std::nothrow_t&) noexcept
+{
+    STEAMAUDIO_PLUGIN_NAMESPACE::recordRTAuditEvent(STEAMAUDIO_PLUGIN_NAMESPACE::RTAUDITEVENT_ALLOCATION, "operator new");
+    return malloc(std::max<size_t>(size, 1));
+}
+
+void* operator new[](size_t size,
+                     const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* memory) noexcept
+{
+    if (!memory)
+        return;
+
+    STEAMAUDIO_PLUGIN_NAMESPACE::recordRTAuditEvent(STEAMAUDIO_PLUGIN_NAMESPACE::RTAUDITEVENT_ALLOCATION, "operator delete");
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    operator delete(memory);
+}
+
+void operator delete(void* memory,
+                     size_t) noexcept
+{
+    operator delete(memory);
+}
+
+void operator delete[](void* memory,
+                       size_t) noexcept
+{
+    operator delete(memory);
+}
+
+void operator delete(void* memory,
+                     const std::nothrow_t&) noexcept
+{
+    operator delete(memory);
+}
+
+void operator delete[](void* memory,
+                       const std::nothrow_t&) noexcept
+{
+    operator delete(memory);
+}
+
+#endif
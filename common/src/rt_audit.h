@@ -0,0 +1,124 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <mutex>
+
+#include <phonon.h>
+
+#include "plugin_namespace.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// Real-Time Audit
+// --------------------------------------------------------------------------------------------------------------------
+
+// When the plugin is built with STEAMAUDIO_ENABLE_RT_AUDIT defined, every heap allocation, mutex lock, and system call
+// that may block, made on a thread that is inside a real-time callback (such as a DSP's process() function), is
+// recorded along with a summary of the call stack. Nothing is done to prevent such calls, so the plugin behaves as it
+// normally would, only more slowly.
+//
+// The plugin's own allocations are seen by replacing operator new and delete within the plugin. Allocations made by
+// Steam Audio are only seen if the context was created with auditedAllocate and auditedFree as its allocation
+// callbacks.
+//
+// Without STEAMAUDIO_ENABLE_RT_AUDIT, none of this has any effect, and AuditedMutex is a plain mutex.
+
+enum RTAuditEvent
+{
+    RTAUDITEVENT_ALLOCATION,
+    RTAUDITEVENT_LOCK,
+    RTAUDITEVENT_SYSCALL,
+    NUM_RTAUDITEVENTS
+};
+
+#if defined(STEAMAUDIO_ENABLE_RT_AUDIT)
+
+// Marks the calling thread as running real-time code until the scope ends. Scopes may be nested.
+class RTAuditScope
+{
+public:
+    RTAuditScope();
+    ~RTAuditScope();
+
+    RTAuditScope(const RTAuditScope&) = delete;
+    RTAuditScope& operator=(const RTAuditScope&) = delete;
+};
+
+// Records an event if the calling thread is inside an RTAuditScope. what describes the call, and must be a string
+// literal.
+void recordRTAuditEvent(RTAuditEvent event,
+                        const char* what);
+
+#else
+
+// The constructor is user-provided, so that scopes aren't reported as unused variables.
+class RTAuditScope
+{
+public:
+    RTAuditScope()
+    {}
+
+    RTAuditScope(const RTAuditScope&) = delete;
+    RTAuditScope& operator=(const RTAuditScope&) = delete;
+};
+
+inline void recordRTAuditEvent(RTAuditEvent,
+                               const char*)
+{}
+
+#endif
+
+// Allocation callbacks for IPLContextSettings, which record allocations made by Steam Audio from real-time code, and
+// then pass them on to gPoolAllocator.
+void* IPLCALL auditedAllocate(IPLsize size,
+                              IPLsize alignment);
+
+void IPLCALL auditedFree(void* memory);
+
+// Writes a human-readable summary of all recorded events to report, truncating it to fit in size bytes (including the
+// terminating null character). Returns the total number of events recorded, or -1 if the plugin was built without the
+// audit.
+int64_t writeRTAuditReport(char* report,
+                           int size);
+
+// Discards all recorded events.
+void resetRTAudit();
+
+// A mutex whose lock() function records an event when called from real-time code. try_lock() never blocks, so it is
+// not recorded.
+class AuditedMutex
+{
+public:
+    explicit AuditedMutex(const char* name)
+        : mName(name)
+    {}
+
+    void lock()
+    {
+        recordRTAuditEvent(RTAUDITEVENT_LOCK, mName);
+        mMutex.lock();
+    }
+
+    bool try_lock()
+    {
+        return mMutex.try_lock();
+    }
+
+    void unlock()
+    {
+        mMutex.unlock();
+    }
+
+private:
+    std::mutex mMutex;
+    const char* mName;
+};
+
+}
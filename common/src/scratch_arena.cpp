@@ -0,0 +1,138 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <algorithm>
+
+#include "scratch_arena.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// ScratchArena
+// --------------------------------------------------------------------------------------------------------------------
+
+const size_t ScratchArena::kAlignment;
+const size_t ScratchArena::kMinBlockSize;
+
+static size_t alignSize(size_t size)
+{
+    return (size + ScratchArena::kAlignment - 1) & ~(ScratchArena::kAlignment - 1);
+}
+
+ScratchArena::ScratchArena()
+    : mCurrentBlock(0)
+    , mOffset(0)
+{}
+
+ScratchArena& ScratchArena::forCurrentThread()
+{
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+ScratchArena::Mark ScratchArena::mark() const
+{
+    return Mark{ mCurrentBlock, mOffset };
+}
+
+void ScratchArena::rewind(const Mark& mark)
+{
+    mCurrentBlock = mark.block;
+    mOffset = mark.offset;
+
+    if (mCurrentBlock == 0 && mOffset == 0 && mBlocks.size() > 1)
+    {
+        coalesce();
+    }
+}
+
+void* ScratchArena::allocate(size_t size)
+{
+    size = alignSize(std::max<size_t>(size, 1));
+
+    while (mCurrentBlock < mBlocks.size() && mOffset + size > mBlocks[mCurrentBlock].size)
+    {
+        ++mCurrentBlock;
+        mOffset = 0;
+    }
+
+    if (mCurrentBlock >= mBlocks.size())
+    {
+        addBlock(size);
+        mCurrentBlock = mBlocks.size() - 1;
+        mOffset = 0;
+    }
+
+    auto data = mBlocks[mCurrentBlock].data + mOffset;
+    mOffset += size;
+    return data;
+}
+
+IPLAudioBuffer ScratchArena::allocateAudioBuffer(int numChannels,
+                                                 int numSamples)
+{
+    IPLAudioBuffer buffer{};
+    buffer.numChannels = numChannels;
+    buffer.numSamples = numSamples;
+    buffer.data = reinterpret_cast<float**>(allocate(numChannels * sizeof(float*)));
+
+    for (auto i = 0; i < numChannels; ++i)
+    {
+        buffer.data[i] = reinterpret_cast<float*>(allocate(numSamples * sizeof(float)));
+    }
+
+    return buffer;
+}
+
+void ScratchArena::addBlock(size_t minSize)
+{
+    auto size = std::max(minSize, kMinBlockSize);
+    if (!mBlocks.empty())
+    {
+        size = std::max(size, mBlocks.back().size * 2);
+    }
+
+    Block block;
+    block.memory.reset(new uint8_t[size + kAlignment - 1]);
+    block.data = reinterpret_cast<uint8_t*>(alignSize(reinterpret_cast<uintptr_t>(block.memory.get())));
+    block.size = size;
+
+    mBlocks.push_back(std::move(block));
+}
+
+void ScratchArena::coalesce()
+{
+    auto totalSize = size_t{ 0 };
+    for (const auto& block : mBlocks)
+    {
+        totalSize += block.size;
+    }
+
+    mBlocks.clear();
+    addBlock(totalSize);
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// ScratchScope
+// --------------------------------------------------------------------------------------------------------------------
+
+ScratchScope::ScratchScope()
+    : mArena(ScratchArena::forCurrentThread())
+    , mMark(mArena.mark())
+{}
+
+ScratchScope::~ScratchScope()
+{
+    mArena.rewind(mMark);
+}
+
+IPLAudioBuffer ScratchScope::audioBuffer(int numChannels,
+                                         int numSamples)
+{
+    return mArena.allocateAudioBuffer(numChannels, numSamples);
+}
+
+}
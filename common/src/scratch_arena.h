@@ -0,0 +1,104 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <phonon.h>
+
+#include "plugin_namespace.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// ScratchArena
+// --------------------------------------------------------------------------------------------------------------------
+
+// A bump allocator for temporary audio buffers, with one instance per thread.
+//
+// Buffers that are only needed for the duration of a single process() call are borrowed from the arena of the thread
+// that is calling process(), instead of being allocated for each DSP instance. Since a mixer thread processes one DSP
+// at a time, all the DSPs it runs share the same memory, which stays hot in cache from one DSP to the next.
+//
+// The arena grows when it runs out of space, which allocates memory. This only happens the first few times the largest
+// DSP chain runs on a given thread. Once the arena is rewound to empty, any extra blocks are merged into a single block
+// large enough for the peak usage seen so far, after which allocation never touches the heap.
+class ScratchArena
+{
+public:
+    static const size_t kAlignment = 64;
+    static const size_t kMinBlockSize = 256 * 1024;
+
+    // A position in the arena, to which it can be rewound.
+    struct Mark
+    {
+        size_t block;
+        size_t offset;
+    };
+
+    ScratchArena();
+
+    // Returns the arena for the calling thread.
+    static ScratchArena& forCurrentThread();
+
+    // Returns the current position in the arena.
+    Mark mark() const;
+
+    // Frees everything allocated since the given mark was taken.
+    void rewind(const Mark& mark);
+
+    // Allocates size bytes, aligned to kAlignment. Contents are uninitialized.
+    void* allocate(size_t size);
+
+    // Allocates a deinterleaved audio buffer. The channel pointer array is also allocated from the arena. Samples are
+    // uninitialized.
+    IPLAudioBuffer allocateAudioBuffer(int numChannels,
+                                       int numSamples);
+
+private:
+    struct Block
+    {
+        std::unique_ptr<uint8_t[]> memory;
+        uint8_t* data;
+        size_t size;
+    };
+
+    std::vector<Block> mBlocks;
+    size_t mCurrentBlock;
+    size_t mOffset;
+
+    void addBlock(size_t minSize);
+    void coalesce();
+};
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// ScratchScope
+// --------------------------------------------------------------------------------------------------------------------
+
+// Borrows memory from the calling thread's scratch arena, and returns it when it goes out of scope.
+class ScratchScope
+{
+public:
+    ScratchScope();
+    ~ScratchScope();
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    IPLAudioBuffer audioBuffer(int numChannels,
+                               int numSamples);
+
+private:
+    ScratchArena& mArena;
+    ScratchArena::Mark mMark;
+};
+
+}
@@ -0,0 +1,386 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(IPL_OS_WINDOWS)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "cpu_features.h"
+#include "simd_level.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// SIMD Level Selection
+// --------------------------------------------------------------------------------------------------------------------
+
+// The audio settings and Ambisonic order used when timing kernels. These are typical of a game, not of any particular
+// project; what matters is how the levels compare to each other.
+static const int kSamplingRate = 48000;
+static const int kFrameSize = 512;
+static const int kAmbisonicOrder = 2;
+
+// Each level is timed kNumRounds times, interleaved with the other levels, and the fastest time is used. This keeps
+// background activity and clock speed changes from favoring one level over another.
+static const int kNumWarmupBlocks = 8;
+static const int kNumTimedBlocks = 32;
+static const int kNumRounds = 3;
+
+// A lower level is only chosen over a higher one if it is at least this much faster.
+static const double kMinSpeedup = 1.05;
+
+IPLSIMDLevel detectSIMDLevel()
+{
+    const auto& features = cpuFeatures();
+
+    if (features.avx512)
+        return IPL_SIMDLEVEL_AVX512;
+    else if (features.avx2)
+        return IPL_SIMDLEVEL_AVX2;
+    else if (features.avx)
+        return IPL_SIMDLEVEL_AVX;
+    else if (features.sse4)
+        return IPL_SIMDLEVEL_SSE4;
+    else if (features.neon)
+        return IPL_SIMDLEVEL_NEON;
+    else
+        return IPL_SIMDLEVEL_SSE2;
+}
+
+// Identifies the machine and Steam Audio version that a cached result is valid for.
+static std::string cacheKey()
+{
+    char version[32] = {};
+    snprintf(version, sizeof(version), "%u", static_cast<unsigned int>(STEAMAUDIO_VERSION));
+
+    std::string key = cpuFeatures().name;
+    key.erase(0, key.find_first_not_of(' '));
+    key += "|";
+    key += version;
+
+    // Keep the key on one line.
+    std::replace(key.begin(), key.end(), '\n', ' ');
+    std::replace(key.begin(), key.end(), '\r', ' ');
+    return key;
+}
+
+static void makeDirectory(const std::string& path)
+{
+#if defined(IPL_OS_WINDOWS)
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+// Returns the default cache file, creating the directory that contains it if needed, or an empty string if there is
+// nowhere to put it.
+static std::string defaultCacheFileName()
+{
+#if defined(IPL_OS_WINDOWS)
+    auto localAppData = getenv("LOCALAPPDATA");
+    if (!localAppData || !*localAppData)
+        return "";
+
+    std::string directory = std::string(localAppData) + "\\SteamAudio";
+    makeDirectory(directory);
+    return directory + "\\simd_level.txt";
+#elif defined(IPL_OS_MACOSX)
+    auto home = getenv("HOME");
+    if (!home || !*home)
+        return "";
+
+    std::string directory = std::string(home) + "/Library/Caches/SteamAudio";
+    makeDirectory(directory);
+    return directory + "/simd_level.txt";
+#elif defined(IPL_OS_LINUX)
+    std::string directory;
+
+    auto cacheHome = getenv("XDG_CACHE_HOME");
+    auto home = getenv("HOME");
+    if (cacheHome && *cacheHome)
+    {
+        directory = cacheHome;
+    }
+    else if (home && *home)
+    {
+        directory = std::string(home) + "/.cache";
+        makeDirectory(directory);
+    }
+    else
+    {
+        return "";
+    }
+
+    directory += "/steamaudio";
+    makeDirectory(directory);
+    return directory + "/simd_level.txt";
+#else
+    return "";
+#endif
+}
+
+static bool readCachedSIMDLevel(const std::string& fileName,
+                                IPLSIMDLevel& simdLevel)
+{
+    if (fileName.empty())
+        return false;
+
+    auto file = fopen(fileName.c_str(), "r");
+    if (!file)
+        return false;
+
+    char key[256] = {};
+    auto level = -1;
+    auto isValid = fgets(key, sizeof(key), file) && fscanf(file, "%d", &level) == 1;
+    fclose(file);
+
+    if (!isValid)
+        return false;
+
+    key[strcspn(key, "\r\n")] = '\0';
+    if (cacheKey() != key || level < IPL_SIMDLEVEL_SSE2 || level > detectSIMDLevel())
+        return false;
+
+    simdLevel = static_cast<IPLSIMDLevel>(level);
+    return true;
+}
+
+static void writeCachedSIMDLevel(const std::string& fileName,
+                                 IPLSIMDLevel simdLevel)
+{
+    if (fileName.empty())
+        return;
+
+    auto file = fopen(fileName.c_str(), "w");
+    if (!file)
+        return;
+
+    fprintf(file, "%s\n%d\n", cacheKey().c_str(), static_cast<int>(simdLevel));
+    fclose(file);
+}
+
+// A context created with a given SIMD level, along with the effects and buffers used to time it.
+class KernelTimer
+{
+public:
+    explicit KernelTimer(IPLSIMDLevel simdLevel)
+        : mSIMDLevel(simdLevel)
+        , mContext(nullptr)
+        , mHRTF(nullptr)
+        , mBinauralEffect(nullptr)
+        , mAmbisonicsEffect(nullptr)
+        , mMonoBuffer{}
+        , mAmbisonicsBuffer{}
+        , mOutBuffer{}
+        , mBestTime(HUGE_VAL)
+        , mNumBlocks(0)
+    {}
+
+    ~KernelTimer()
+    {
+        iplAudioBufferFree(mContext, &mOutBuffer);
+        iplAudioBufferFree(mContext, &mAmbisonicsBuffer);
+        iplAudioBufferFree(mContext, &mMonoBuffer);
+        iplAmbisonicsBinauralEffectRelease(&mAmbisonicsEffect);
+        iplBinauralEffectRelease(&mBinauralEffect);
+        iplHRTFRelease(&mHRTF);
+        iplContextRelease(&mContext);
+    }
+
+    KernelTimer(const KernelTimer&) = delete;
+    KernelTimer& operator=(const KernelTimer&) = delete;
+
+    IPLSIMDLevel simdLevel() const
+    {
+        return mSIMDLevel;
+    }
+
+    double bestTime() const
+    {
+        return mBestTime;
+    }
+
+    bool init(SIMDLevelContextCreateFunction createContext)
+    {
+        if (createContext(mSIMDLevel, &mContext) != IPL_STATUS_SUCCESS)
+            return false;
+
+        IPLAudioSettings audioSettings{};
+        audioSettings.samplingRate = kSamplingRate;
+        audioSettings.frameSize = kFrameSize;
+
+        IPLHRTFSettings hrtfSettings{};
+        hrtfSettings.type = IPL_HRTFTYPE_DEFAULT;
+        hrtfSettings.volume = 1.0f;
+
+        if (iplHRTFCreate(mContext, &audioSettings, &hrtfSettings, &mHRTF) != IPL_STATUS_SUCCESS)
+            return false;
+
+        IPLBinauralEffectSettings binauralSettings{};
+        binauralSettings.hrtf = mHRTF;
+
+        if (iplBinauralEffectCreate(mContext, &audioSettings, &binauralSettings, &mBinauralEffect) != IPL_STATUS_SUCCESS)
+            return false;
+
+        IPLAmbisonicsBinauralEffectSettings ambisonicsSettings{};
+        ambisonicsSettings.hrtf = mHRTF;
+        ambisonicsSettings.maxOrder = kAmbisonicOrder;
+
+        if (iplAmbisonicsBinauralEffectCreate(mContext, &audioSettings, &ambisonicsSettings, &mAmbisonicsEffect) != IPL_STATUS_SUCCESS)
+            return false;
+
+        auto numAmbisonicsChannels = (kAmbisonicOrder + 1) * (kAmbisonicOrder + 1);
+
+        if (iplAudioBufferAllocate(mContext, 1, kFrameSize, &mMonoBuffer) != IPL_STATUS_SUCCESS ||
+            iplAudioBufferAllocate(mContext, numAmbisonicsChannels, kFrameSize, &mAmbisonicsBuffer) != IPL_STATUS_SUCCESS ||
+            iplAudioBufferAllocate(mContext, 2, kFrameSize, &mOutBuffer) != IPL_STATUS_SUCCESS)
+            return false;
+
+        // Fill the inputs with deterministic noise, so denormals and silence don't skew the timings.
+        auto seed = 1u;
+        auto fill = [&](IPLAudioBuffer& buffer)
+        {
+            for (auto i = 0; i < buffer.numChannels; ++i)
+            {
+                for (auto j = 0; j < buffer.numSamples; ++j)
+                {
+                    seed = seed * 1664525u + 1013904223u;
+                    buffer.data[i][j] = (static_cast<float>(seed >> 8) / static_cast<float>(1u << 24)) * 2.0f - 1.0f;
+                }
+            }
+        };
+
+        fill(mMonoBuffer);
+        fill(mAmbisonicsBuffer);
+
+        for (auto i = 0; i < kNumWarmupBlocks; ++i)
+        {
+            processBlock();
+        }
+
+        return true;
+    }
+
+    void time()
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto i = 0; i < kNumTimedBlocks; ++i)
+        {
+            processBlock();
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        mBestTime = std::min(mBestTime, std::chrono::duration<double>(end - start).count());
+    }
+
+private:
+    IPLSIMDLevel mSIMDLevel;
+    IPLContext mContext;
+    IPLHRTF mHRTF;
+    IPLBinauralEffect mBinauralEffect;
+    IPLAmbisonicsBinauralEffect mAmbisonicsEffect;
+    IPLAudioBuffer mMonoBuffer;
+    IPLAudioBuffer mAmbisonicsBuffer;
+    IPLAudioBuffer mOutBuffer;
+    double mBestTime;
+    int mNumBlocks;
+
+    void processBlock()
+    {
+        // Move the source around the listener, so that HRTF interpolation does real work.
+        auto angle = 0.1f * static_cast<float>(mNumBlocks++);
+
+        IPLBinauralEffectParams binauralParams{};
+        binauralParams.direction = IPLVector3{sinf(angle), 0.0f, -cosf(angle)};
+        binauralParams.interpolation = IPL_HRTFINTERPOLATION_BILINEAR;
+        binauralParams.spatialBlend = 1.0f;
+        binauralParams.hrtf = mHRTF;
+        iplBinauralEffectApply(mBinauralEffect, &binauralParams, &mMonoBuffer, &mOutBuffer);
+
+        IPLAmbisonicsBinauralEffectParams ambisonicsParams{};
+        ambisonicsParams.hrtf = mHRTF;
+        ambisonicsParams.order = kAmbisonicOrder;
+        iplAmbisonicsBinauralEffectApply(mAmbisonicsEffect, &ambisonicsParams, &mAmbisonicsBuffer, &mOutBuffer);
+    }
+};
+
+// Returns false if fewer than two levels could be timed, in which case there is nothing to choose between.
+static bool autotuneSIMDLevel(SIMDLevelContextCreateFunction createContext,
+                              IPLSIMDLevel& simdLevel)
+{
+    auto detectedLevel = detectSIMDLevel();
+
+    std::vector<std::unique_ptr<KernelTimer>> timers;
+    for (auto level = static_cast<int>(IPL_SIMDLEVEL_SSE2); level <= static_cast<int>(detectedLevel); ++level)
+    {
+        std::unique_ptr<KernelTimer> timer(new KernelTimer(static_cast<IPLSIMDLevel>(level)));
+        if (timer->init(createContext))
+        {
+            timers.push_back(std::move(timer));
+        }
+    }
+
+    if (timers.size() < 2)
+        return false;
+
+    for (auto i = 0; i < kNumRounds; ++i)
+    {
+        for (auto& timer : timers)
+        {
+            timer->time();
+        }
+    }
+
+    // Start from the highest level, and only step down to a lower level if it is clearly faster.
+    auto best = timers.back().get();
+    for (auto it = timers.rbegin() + 1; it != timers.rend(); ++it)
+    {
+        if ((*it)->bestTime() * kMinSpeedup < best->bestTime())
+        {
+            best = it->get();
+        }
+    }
+
+    simdLevel = best->simdLevel();
+    return true;
+}
+
+IPLSIMDLevel selectSIMDLevel(bool autotune,
+                             SIMDLevelContextCreateFunction createContext,
+                             const char* cacheFileName)
+{
+    auto fileName = (cacheFileName) ? std::string(cacheFileName) : defaultCacheFileName();
+
+    IPLSIMDLevel simdLevel;
+    if (readCachedSIMDLevel(fileName, simdLevel))
+        return simdLevel;
+
+    // There is nothing to choose between if the CPU only supports one level.
+    if (!autotune || !createContext || detectSIMDLevel() == IPL_SIMDLEVEL_SSE2)
+        return detectSIMDLevel();
+
+    if (!autotuneSIMDLevel(createContext, simdLevel))
+        return detectSIMDLevel();
+
+    writeCachedSIMDLevel(fileName, simdLevel);
+    return simdLevel;
+}
+
+}
@@ -0,0 +1,41 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <phonon.h>
+
+#include "plugin_namespace.h"
+
+namespace STEAMAUDIO_PLUGIN_NAMESPACE {
+
+// --------------------------------------------------------------------------------------------------------------------
+// SIMD Level Selection
+// --------------------------------------------------------------------------------------------------------------------
+
+// Creates a context whose SIMD level is at most simdLevel.
+typedef IPLerror (IPLCALL* SIMDLevelContextCreateFunction)(IPLSIMDLevel simdLevel,
+                                                           IPLContext* context);
+
+// Returns the highest SIMD level that both the CPU and the OS support.
+IPLSIMDLevel detectSIMDLevel();
+
+// Returns the SIMD level that contexts should be created with on this machine.
+//
+// If an earlier call autotuned on this machine, with the same version of Steam Audio, the result it saved in
+// cacheFileName is returned. Otherwise, if autotune is true, Steam Audio's binaural and Ambisonics convolution kernels
+// are timed using a context created by createContext at each level the CPU supports, and the fastest level is saved to
+// cacheFileName and returned. This takes a fraction of a second. Lower levels are only chosen if they are clearly
+// faster, which can happen when wide vector instructions cause the CPU to lower its clock speed. Otherwise, the result
+// of detectSIMDLevel is returned.
+//
+// If cacheFileName is nullptr, a file in the user's cache directory is used, if there is one.
+IPLSIMDLevel selectSIMDLevel(bool autotune,
+                             SIMDLevelContextCreateFunction createContext,
+                             const char* cacheFileName);
+
+}
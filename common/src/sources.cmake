@@ -0,0 +1,35 @@
+# Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+# https://valvesoftware.github.io/steam-audio/license.html
+
+#
+# SHARED PLUGIN SOURCES
+#
+
+# Sources shared by the FMOD Studio and Unity plugins. Each plugin includes this file, adds SRC_COMMON to its own
+# sources and COMMON_SRC_DIR to its include directories, and defines STEAMAUDIO_PLUGIN_NAMESPACE as its namespace.
+
+set(COMMON_SRC_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+set(SRC_COMMON
+    ${COMMON_SRC_DIR}/plugin_namespace.h
+    ${COMMON_SRC_DIR}/audio_kernels.h
+    ${COMMON_SRC_DIR}/audio_kernels.cpp
+    ${COMMON_SRC_DIR}/cpu_features.h
+    ${COMMON_SRC_DIR}/cpu_features.cpp
+    ${COMMON_SRC_DIR}/effect_builder.h
+    ${COMMON_SRC_DIR}/effect_builder.cpp
+    ${COMMON_SRC_DIR}/effect_pool.h
+    ${COMMON_SRC_DIR}/effect_pool.cpp
+    ${COMMON_SRC_DIR}/perf_stats.h
+    ${COMMON_SRC_DIR}/perf_stats.cpp
+    ${COMMON_SRC_DIR}/pool_allocator.h
+    ${COMMON_SRC_DIR}/pool_allocator.cpp
+    ${COMMON_SRC_DIR}/reflection_budget.h
+    ${COMMON_SRC_DIR}/reflection_budget.cpp
+    ${COMMON_SRC_DIR}/rt_audit.h
+    ${COMMON_SRC_DIR}/rt_audit.cpp
+    ${COMMON_SRC_DIR}/scratch_arena.h
+    ${COMMON_SRC_DIR}/scratch_arena.cpp
+    ${COMMON_SRC_DIR}/simd_level.h
+    ${COMMON_SRC_DIR}/simd_level.cpp
+)
@@ -0,0 +1,838 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+// Headless benchmark for the Steam Audio FMOD plugin.
+//
+// Stands in for the FMOD mixer: creates a number of Steam Audio Spatializer instances, plus a Mixer Return and a
+// Reverb, and calls their process() callbacks once per block, with sources and the listener moving along scripted
+// paths and DSP parameters changing over time. As FMOD does, the sys_mix callback of every plugin description is
+// called at the start and end of each block. Optionally, some voices are released and recreated every block, as when
+// events start and stop. Reports the distribution of per-block processing time, and how many voices a single core
+// could render in real time. Requires the Steam Audio library, but neither the FMOD runtime nor a GPU.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(IPL_OS_WINDOWS)
+#include <Windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include "steamaudio_fmod.h"
+
+using namespace SteamAudioFMOD;
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// Options
+// --------------------------------------------------------------------------------------------------------------------
+
+struct Options
+{
+    const char* phononLibrary;
+    int numVoices;
+    int numBlocks;
+    int numWarmupBlocks;
+    int samplingRate;
+    int frameSize;
+    int spatializerFrameSize;
+    int numListeners;
+    int numChurnVoices;
+    int hrtfSwitchInterval;
+    bool directBinaural;
+    float minVoicesPerCore;
+};
+
+void printUsage(const char* program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --phonon <path>               Path to the Steam Audio library.\n");
+    printf("  --voices <n>                  Number of Steam Audio Spatializer instances. Default: 64.\n");
+    printf("  --blocks <n>                  Number of blocks to measure. Default: 2000.\n");
+    printf("  --warmup <n>                  Maximum number of blocks to run before measuring. Default: 500.\n");
+    printf("  --sampling-rate <n>           Sampling rate, in Hz. Default: 48000.\n");
+    printf("  --frame-size <n>              Block size, in samples. Default: 1024.\n");
+    printf("  --spatializer-frame-size <n>  Frame size used by the spatializers, or 0 for the block size. Default: 0.\n");
+    printf("  --listeners <n>               Number of listeners. If more than 1, voices are mixed for all of them. Default: 1.\n");
+    printf("  --churn <n>                   Number of voices to release and recreate every block. Default: 0.\n");
+    printf("  --hrtf-switch <n>             Switch between two HRTFs every n blocks, or never if 0. Default: 0.\n");
+    printf("  --panning                     Pan the direct path instead of rendering it binaurally.\n");
+    printf("  --min-voices-per-core <x>     Exit with an error if fewer voices per core are measured.\n");
+}
+
+bool parseOptions(int argc,
+                  char** argv,
+                  Options& options)
+{
+#if defined(IPL_OS_WINDOWS)
+    options.phononLibrary = "phonon.dll";
+#elif defined(IPL_OS_MACOSX)
+    options.phononLibrary = "libphonon.dylib";
+#else
+    options.phononLibrary = "libphonon.so";
+#endif
+    options.numVoices = 64;
+    options.numBlocks = 2000;
+    options.numWarmupBlocks = 500;
+    options.samplingRate = 48000;
+    options.frameSize = 1024;
+    options.spatializerFrameSize = 0;
+    options.numListeners = 1;
+    options.numChurnVoices = 0;
+    options.hrtfSwitchInterval = 0;
+    options.directBinaural = true;
+    options.minVoicesPerCore = 0.0f;
+
+    for (auto i = 1; i < argc; ++i)
+    {
+        auto hasValue = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--phonon") && hasValue)
+            options.phononLibrary = argv[++i];
+        else if (!strcmp(argv[i], "--voices") && hasValue)
+            options.numVoices = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--blocks") && hasValue)
+            options.numBlocks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--warmup") && hasValue)
+            options.numWarmupBlocks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--sampling-rate") && hasValue)
+            options.samplingRate = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--frame-size") && hasValue)
+            options.frameSize = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--spatializer-frame-size") && hasValue)
+            options.spatializerFrameSize = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--listeners") && hasValue)
+            options.numListeners = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--churn") && hasValue)
+            options.numChurnVoices = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hrtf-switch") && hasValue)
+            options.hrtfSwitchInterval = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--panning"))
+            options.directBinaural = false;
+        else if (!strcmp(argv[i], "--min-voices-per-core") && hasValue)
+            options.minVoicesPerCore = static_cast<float>(atof(argv[++i]));
+        else
+            return false;
+    }
+
+    return (options.numVoices > 0 && options.numBlocks > 0 && options.numWarmupBlocks >= 0 &&
+            options.samplingRate > 0 && options.frameSize > 0 && options.spatializerFrameSize >= 0 &&
+            options.numListeners > 0 && options.numListeners <= FMOD_MAX_LISTENERS && options.numChurnVoices >= 0 &&
+            options.hrtfSwitchInterval >= 0);
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// PhononAPI
+// --------------------------------------------------------------------------------------------------------------------
+
+// The Steam Audio functions used by the benchmark. These are loaded at run time, in the same way that the plugin loads
+// iplContextCreate when running in FMOD Studio, since the plugin exports stubs with the same names.
+struct PhononAPI
+{
+#if defined(IPL_OS_WINDOWS)
+    HMODULE library;
+#else
+    void* library;
+#endif
+
+    decltype(iplContextCreate)* contextCreate;
+    decltype(iplContextRelease)* contextRelease;
+    decltype(iplHRTFCreate)* hrtfCreate;
+    decltype(iplHRTFRelease)* hrtfRelease;
+
+    bool load(const char* path)
+    {
+#if defined(IPL_OS_WINDOWS)
+        library = LoadLibraryA(path);
+#else
+        library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+#endif
+        if (!library)
+            return false;
+
+        contextCreate = reinterpret_cast<decltype(iplContextCreate)*>(getFunction("iplContextCreate"));
+        contextRelease = reinterpret_cast<decltype(iplContextRelease)*>(getFunction("iplContextRelease"));
+        hrtfCreate = reinterpret_cast<decltype(iplHRTFCreate)*>(getFunction("iplHRTFCreate"));
+        hrtfRelease = reinterpret_cast<decltype(iplHRTFRelease)*>(getFunction("iplHRTFRelease"));
+
+        return (contextCreate && contextRelease && hrtfCreate && hrtfRelease);
+    }
+
+    void* getFunction(const char* name)
+    {
+#if defined(IPL_OS_WINDOWS)
+        return reinterpret_cast<void*>(GetProcAddress(library, name));
+#else
+        return dlsym(library, name);
+#endif
+    }
+};
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// MockHost
+// --------------------------------------------------------------------------------------------------------------------
+
+// The parts of the FMOD mixer that DSP plugins can query through FMOD_DSP_STATE_FUNCTIONS.
+struct MockHost
+{
+    int samplingRate;
+    unsigned int frameSize;
+    unsigned long long clock;
+    int numListeners;
+    FMOD_3D_ATTRIBUTES listeners[FMOD_MAX_LISTENERS];
+};
+
+MockHost gHost;
+
+void* F_CALL mockAlloc(unsigned int size,
+                       FMOD_MEMORY_TYPE,
+                       const char*)
+{
+    return malloc(size);
+}
+
+void* F_CALL mockRealloc(void* ptr,
+                         unsigned int size,
+                         FMOD_MEMORY_TYPE,
+                         const char*)
+{
+    return realloc(ptr, size);
+}
+
+void F_CALL mockFree(void* ptr,
+                     FMOD_MEMORY_TYPE,
+                     const char*)
+{
+    free(ptr);
+}
+
+FMOD_RESULT F_CALL mockGetSampleRate(FMOD_DSP_STATE*,
+                                     int* rate)
+{
+    *rate = gHost.samplingRate;
+    return FMOD_OK;
+}
+
+FMOD_RESULT F_CALL mockGetBlockSize(FMOD_DSP_STATE*,
+                                    unsigned int* blockSize)
+{
+    *blockSize = gHost.frameSize;
+    return FMOD_OK;
+}
+
+// Inverse-distance rolloff, used by the spatializer when distance attenuation follows FMOD's curve.
+FMOD_RESULT F_CALL mockGetRolloffGain(FMOD_DSP_STATE*,
+                                      FMOD_DSP_PAN_3D_ROLLOFF_TYPE,
+                                      float distance,
+                                      float minDistance,
+                                      float maxDistance,
+                                      float* gain)
+{
+    auto clampedDistance = std::min(std::max(distance, minDistance), maxDistance);
+    *gain = (clampedDistance > 0.0f) ? minDistance / clampedDistance : 1.0f;
+    return FMOD_OK;
+}
+
+FMOD_DSP_STATE_PAN_FUNCTIONS gPanFunctions =
+{
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    mockGetRolloffGain
+};
+
+FMOD_RESULT F_CALL mockGetSpeakerMode(FMOD_DSP_STATE*,
+                                      FMOD_SPEAKERMODE* speakerModeMixer,
+                                      FMOD_SPEAKERMODE* speakerModeOutput)
+{
+    if (speakerModeMixer)
+        *speakerModeMixer = FMOD_SPEAKERMODE_STEREO;
+    if (speakerModeOutput)
+        *speakerModeOutput = FMOD_SPEAKERMODE_STEREO;
+
+    return FMOD_OK;
+}
+
+FMOD_RESULT F_CALL mockGetClock(FMOD_DSP_STATE*,
+                                unsigned long long* clock,
+                                unsigned int* offset,
+                                unsigned int* length)
+{
+    *clock = gHost.clock;
+    *offset = 0;
+    *length = gHost.frameSize;
+    return FMOD_OK;
+}
+
+FMOD_RESULT F_CALL mockGetListenerAttributes(FMOD_DSP_STATE*,
+                                             int* numListeners,
+                                             FMOD_3D_ATTRIBUTES* attributes)
+{
+    *numListeners = gHost.numListeners;
+    for (auto i = 0; i < gHost.numListeners; ++i)
+    {
+        attributes[i] = gHost.listeners[i];
+    }
+    return FMOD_OK;
+}
+
+void F_CALL mockLog(FMOD_DEBUG_FLAGS,
+                    const char*,
+                    int,
+                    const char*,
+                    const char*,
+                    ...)
+{}
+
+FMOD_RESULT F_CALL mockGetUserData(FMOD_DSP_STATE*,
+                                   void** userData)
+{
+    *userData = nullptr;
+    return FMOD_OK;
+}
+
+FMOD_DSP_STATE_FUNCTIONS gStateFunctions =
+{
+    mockAlloc,
+    mockRealloc,
+    mockFree,
+    mockGetSampleRate,
+    mockGetBlockSize,
+    nullptr,
+    &gPanFunctions,
+    mockGetSpeakerMode,
+    mockGetClock,
+    mockGetListenerAttributes,
+    mockLog,
+    mockGetUserData
+};
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// MockDSP
+// --------------------------------------------------------------------------------------------------------------------
+
+// One DSP instance, along with the buffers FMOD would pass to it. The address of the MockDSP stands in for the
+// FMOD::DSP handle.
+class MockDSP
+{
+public:
+    MockDSP(FMOD_DSP_DESCRIPTION* description,
+            int numChannelsIn,
+            int numChannelsOut)
+        : mDescription(description)
+        , mState{}
+        , mNumChannelsIn(numChannelsIn)
+        , mNumChannelsOut(numChannelsOut)
+        , mChannelMask(0)
+        , mIn(numChannelsIn * gHost.frameSize, 0.0f)
+        , mOut(numChannelsOut * gHost.frameSize, 0.0f)
+    {
+        mState.instance = this;
+        mState.functions = &gStateFunctions;
+        mState.source_speakermode = FMOD_SPEAKERMODE_STEREO;
+
+        mDescription->create(&mState);
+    }
+
+    ~MockDSP()
+    {
+        mDescription->release(&mState);
+    }
+
+    void* handle()
+    {
+        return this;
+    }
+
+    float* input()
+    {
+        return mIn.data();
+    }
+
+    int findParam(const char* name) const
+    {
+        for (auto i = 0; i < mDescription->numparameters; ++i)
+        {
+            if (!strcmp(mDescription->paramdesc[i]->name, name))
+                return i;
+        }
+
+        fprintf(stderr, "Unknown parameter: %s\n", name);
+        exit(EXIT_FAILURE);
+    }
+
+    void setBool(const char* name,
+                 bool value)
+    {
+        mDescription->setparameterbool(&mState, findParam(name), value ? 1 : 0);
+    }
+
+    void setInt(const char* name,
+                int value)
+    {
+        mDescription->setparameterint(&mState, findParam(name), value);
+    }
+
+    void setFloat(const char* name,
+                  float value)
+    {
+        mDescription->setparameterfloat(&mState, findParam(name), value);
+    }
+
+    void setData(const char* name,
+                 void* value,
+                 unsigned int length)
+    {
+        mDescription->setparameterdata(&mState, findParam(name), value, length);
+    }
+
+    // Queries the DSP, then processes one block if it doesn't ask to be skipped, like FMOD's mixer does.
+    void process()
+    {
+        auto in = mIn.data();
+        auto out = mOut.data();
+
+        FMOD_DSP_BUFFER_ARRAY inBuffers{};
+        inBuffers.numbuffers = 1;
+        inBuffers.buffernumchannels = &mNumChannelsIn;
+        inBuffers.bufferchannelmask = &mChannelMask;
+        inBuffers.buffers = &in;
+        inBuffers.speakermode = (mNumChannelsIn == 1) ? FMOD_SPEAKERMODE_MONO : FMOD_SPEAKERMODE_STEREO;
+
+        auto numChannelsOut = mNumChannelsOut;
+        FMOD_DSP_BUFFER_ARRAY outBuffers{};
+        outBuffers.numbuffers = 1;
+        outBuffers.buffernumchannels = &numChannelsOut;
+        outBuffers.bufferchannelmask = &mChannelMask;
+        outBuffers.buffers = &out;
+        outBuffers.speakermode = FMOD_SPEAKERMODE_STEREO;
+
+        auto result = mDescription->process(&mState, gHost.frameSize, &inBuffers, &outBuffers, false, FMOD_DSP_PROCESS_QUERY);
+        if (result != FMOD_OK)
+            return;
+
+        mDescription->process(&mState, gHost.frameSize, &inBuffers, &outBuffers, false, FMOD_DSP_PROCESS_PERFORM);
+    }
+
+private:
+    FMOD_DSP_DESCRIPTION* mDescription;
+    FMOD_DSP_STATE mState;
+    int mNumChannelsIn;
+    int mNumChannelsOut;
+    FMOD_CHANNELMASK mChannelMask;
+    std::vector<float> mIn;
+    std::vector<float> mOut;
+};
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// System Mix
+// --------------------------------------------------------------------------------------------------------------------
+
+// FMOD calls the sys_mix callback of every registered plugin description once per stage of every mix, whether or not
+// any instances of it exist, with a state that doesn't belong to any instance.
+void systemMix(int stage)
+{
+    static FMOD_DSP_DESCRIPTION* const kDescriptions[] =
+    {
+        FMOD_SteamAudio_Spatialize_GetDSPDescription(),
+        FMOD_SteamAudio_MixerReturn_GetDSPDescription(),
+        FMOD_SteamAudio_Reverb_GetDSPDescription(),
+        FMOD_SteamAudio_SpatializerGroup_GetDSPDescription()
+    };
+
+    for (auto description : kDescriptions)
+    {
+        if (!description->sys_mix)
+            continue;
+
+        FMOD_DSP_STATE state{};
+        state.functions = &gStateFunctions;
+        description->sys_mix(&state, stage);
+    }
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// Scene Script
+// --------------------------------------------------------------------------------------------------------------------
+
+FMOD_VECTOR makeVector(float x,
+                       float y,
+                       float z)
+{
+    FMOD_VECTOR vector;
+    vector.x = x;
+    vector.y = y;
+    vector.z = z;
+    return vector;
+}
+
+// The first listener stands at the origin, and any others stand in a row beside it, all turning slowly.
+void updateListeners(float time)
+{
+    for (auto i = 0; i < gHost.numListeners; ++i)
+    {
+        auto angle = 0.2f * time + static_cast<float>(i);
+
+        gHost.listeners[i].position = makeVector(4.0f * static_cast<float>(i), 0.0f, 0.0f);
+        gHost.listeners[i].velocity = makeVector(0.0f, 0.0f, 0.0f);
+        gHost.listeners[i].forward = makeVector(sinf(angle), 0.0f, cosf(angle));
+        gHost.listeners[i].up = makeVector(0.0f, 1.0f, 0.0f);
+    }
+}
+
+// Each source orbits the listener at its own radius, speed, and height, and its occlusion changes every few seconds,
+// so cached parameters are invalidated regularly.
+void updateSource(MockDSP& dsp,
+                  int index,
+                  float time)
+{
+    auto radius = 2.0f + static_cast<float>(index % 16) * 3.0f;
+    auto speed = 0.1f + 0.05f * static_cast<float>(index % 7);
+    auto angle = speed * time + static_cast<float>(index);
+    auto height = static_cast<float>(index % 3) - 1.0f;
+
+    FMOD_DSP_PARAMETER_3DATTRIBUTES attributes{};
+    attributes.absolute.position = makeVector(radius * sinf(angle), height, radius * cosf(angle));
+    attributes.absolute.velocity = makeVector(0.0f, 0.0f, 0.0f);
+    attributes.absolute.forward = makeVector(0.0f, 0.0f, 1.0f);
+    attributes.absolute.up = makeVector(0.0f, 1.0f, 0.0f);
+    attributes.relative = attributes.absolute;
+
+    dsp.setData("SourcePos", &attributes, sizeof(attributes));
+
+    auto period = static_cast<int>(time / 3.0f) + index;
+    dsp.setFloat("Occlusion", (period % 4 == 0) ? 0.3f : 1.0f);
+}
+
+// A different tone for each source, so no two inputs are identical.
+void fillInput(MockDSP& dsp,
+               int index)
+{
+    auto frequency = 110.0f * (1.0f + static_cast<float>(index % 24) / 12.0f);
+    auto omega = 2.0f * 3.14159265f * frequency / static_cast<float>(gHost.samplingRate);
+
+    auto in = dsp.input();
+    for (auto i = 0u; i < gHost.frameSize; ++i)
+    {
+        in[i] = 0.25f * sinf(omega * static_cast<float>(i));
+    }
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// Main
+// --------------------------------------------------------------------------------------------------------------------
+
+struct Mix
+{
+    std::vector<std::unique_ptr<MockDSP>> voices;
+    std::unique_ptr<MockDSP> mixerReturn;
+    std::unique_ptr<MockDSP> reverb;
+
+    // The next voice to release and recreate, and the total time spent doing so, in microseconds.
+    int nextChurnVoice;
+    double churnTime;
+
+    // HRTFs to switch between, if HRTF switching is enabled.
+    IPLHRTF hrtfs[2];
+};
+
+MockDSP* createVoice(const Options& options,
+                     int index)
+{
+    auto voice = new MockDSP(FMOD_SteamAudio_Spatialize_GetDSPDescription(), 1, 2);
+
+    voice->setInt("ApplyDA", PARAMETER_SIMULATIONDEFINED);
+    voice->setInt("ApplyAA", PARAMETER_SIMULATIONDEFINED);
+    voice->setInt("ApplyOccl", PARAMETER_USERDEFINED);
+    voice->setBool("DirectBinaural", options.directBinaural);
+    voice->setInt("Interpolation", (index % 2) ? IPL_HRTFINTERPOLATION_BILINEAR : IPL_HRTFINTERPOLATION_NEAREST);
+    voice->setInt("FrameSize", options.spatializerFrameSize);
+    voice->setInt("Listener", (options.numListeners > 1) ? -1 : 0);
+
+    fillInput(*voice, index);
+
+    return voice;
+}
+
+// Releases and recreates voices, as FMOD does when events stop and start. This happens outside the mixer, so it is
+// timed separately. The first voice is never churned, so that its stats cover the whole run.
+void churnVoices(const Options& options,
+                 Mix& mix)
+{
+    auto numVoices = static_cast<int>(mix.voices.size());
+    auto numChurnVoices = std::min(options.numChurnVoices, numVoices - 1);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto i = 0; i < numChurnVoices; ++i)
+    {
+        auto index = 1 + mix.nextChurnVoice;
+        mix.nextChurnVoice = (mix.nextChurnVoice + 1) % (numVoices - 1);
+
+        mix.voices[index].reset();
+        mix.voices[index].reset(createVoice(options, index));
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    mix.churnTime += std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// Runs one mix block, and returns how long it took, in microseconds.
+double runBlock(const Options& options,
+                Mix& mix,
+                int block)
+{
+    auto time = static_cast<float>(block) * static_cast<float>(gHost.frameSize) / static_cast<float>(gHost.samplingRate);
+
+    gHost.clock = static_cast<unsigned long long>(block) * gHost.frameSize;
+
+    churnVoices(options, mix);
+
+    // Spatializers should crossfade every time the HRTF changes, which relies on the render state being switched only
+    // once per mix, even though sys_mix is called for every description.
+    if (options.hrtfSwitchInterval > 0 && block > 0 && block % options.hrtfSwitchInterval == 0)
+    {
+        iplFMODSetHRTF(mix.hrtfs[(block / options.hrtfSwitchInterval) % 2]);
+    }
+
+    updateListeners(time);
+    for (auto i = 0u; i < mix.voices.size(); ++i)
+    {
+        updateSource(*mix.voices[i], static_cast<int>(i), time);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    systemMix(0);
+
+    for (auto& voice : mix.voices)
+    {
+        voice->process();
+    }
+
+    mix.reverb->process();
+    mix.mixerReturn->process();
+
+    systemMix(1);
+
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+double percentile(const std::vector<double>& sortedValues,
+                  double fraction)
+{
+    auto index = static_cast<size_t>(fraction * static_cast<double>(sortedValues.size() - 1) + 0.5);
+    return sortedValues[std::min(index, sortedValues.size() - 1)];
+}
+
+void printStageTimes(const IPLFMODPerfStats& stats)
+{
+    if (stats.numProcessCalls == 0)
+        return;
+
+    auto perCall = [&](IPLuint64 nanoseconds)
+    {
+        return static_cast<double>(nanoseconds) / static_cast<double>(stats.numProcessCalls) / 1000.0;
+    };
+
+    printf("Per process() call (us):   direct %.2f, binaural %.2f, reflections %.2f, pathing %.2f, decode %.2f\n",
+           perCall(stats.directTime), perCall(stats.binauralTime), perCall(stats.reflectionsTime),
+           perCall(stats.pathingTime), perCall(stats.decodeTime));
+}
+
+int main(int argc,
+         char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PhononAPI phonon{};
+    if (!phonon.load(options.phononLibrary))
+    {
+        fprintf(stderr, "Unable to load Steam Audio library: %s\n", options.phononLibrary);
+        return EXIT_FAILURE;
+    }
+
+    gHost.samplingRate = options.samplingRate;
+    gHost.frameSize = static_cast<unsigned int>(options.frameSize);
+    gHost.clock = 0;
+    gHost.numListeners = options.numListeners;
+    updateListeners(0.0f);
+
+    IPLContextSettings contextSettings{};
+    contextSettings.version = STEAMAUDIO_VERSION;
+    contextSettings.simdLevel = IPL_SIMDLEVEL_AVX2;
+
+    IPLContext context = nullptr;
+    if (phonon.contextCreate(&contextSettings, &context) != IPL_STATUS_SUCCESS)
+    {
+        fprintf(stderr, "Unable to create Steam Audio context.\n");
+        return EXIT_FAILURE;
+    }
+
+    IPLAudioSettings audioSettings{};
+    audioSettings.samplingRate = options.samplingRate;
+    audioSettings.frameSize = options.frameSize;
+
+    IPLHRTFSettings hrtfSettings{};
+    hrtfSettings.type = IPL_HRTFTYPE_DEFAULT;
+    hrtfSettings.volume = 1.0f;
+
+    IPLHRTF hrtf = nullptr;
+    IPLHRTF alternateHRTF = nullptr;
+    if (phonon.hrtfCreate(context, &audioSettings, &hrtfSettings, &hrtf) != IPL_STATUS_SUCCESS ||
+        phonon.hrtfCreate(context, &audioSettings, &hrtfSettings, &alternateHRTF) != IPL_STATUS_SUCCESS)
+    {
+        fprintf(stderr, "Unable to create HRTF.\n");
+        return EXIT_FAILURE;
+    }
+
+    IPLSimulationSettings simulationSettings{};
+    simulationSettings.flags = static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT | IPL_SIMULATIONFLAGS_REFLECTIONS);
+    simulationSettings.sceneType = IPL_SCENETYPE_DEFAULT;
+    simulationSettings.reflectionType = IPL_REFLECTIONEFFECTTYPE_CONVOLUTION;
+    simulationSettings.maxOrder = 1;
+    simulationSettings.maxDuration = 1.0f;
+    simulationSettings.samplingRate = options.samplingRate;
+    simulationSettings.frameSize = options.frameSize;
+
+    iplFMODInitialize(context);
+    iplFMODSetHRTF(hrtf);
+    iplFMODSetSimulationSettings(simulationSettings);
+
+    Mix mix;
+    mix.nextChurnVoice = 0;
+    mix.churnTime = 0.0;
+    mix.hrtfs[0] = hrtf;
+    mix.hrtfs[1] = alternateHRTF;
+
+    for (auto i = 0; i < options.numVoices; ++i)
+    {
+        mix.voices.emplace_back(createVoice(options, i));
+    }
+
+    mix.reverb.reset(new MockDSP(FMOD_SteamAudio_Reverb_GetDSPDescription(), 2, 2));
+    mix.mixerReturn.reset(new MockDSP(FMOD_SteamAudio_MixerReturn_GetDSPDescription(), 2, 2));
+
+    // Effect objects are built on a worker thread, so keep mixing until every instance has its effects, giving the
+    // worker a chance to run in between. If voices are being churned, new instances keep arriving, so this runs for
+    // all of the warmup blocks.
+    auto block = 0;
+    IPLFMODPerfStats stats{};
+    for (auto i = 0; i < options.numWarmupBlocks; ++i)
+    {
+        auto numInitFailures = stats.numInitFailures;
+
+        runBlock(options, mix, block++);
+
+        iplFMODGetPerfStats(nullptr, &stats);
+        if (i > 0 && stats.numInitFailures == numInitFailures)
+            break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    IPLFMODPerfStats warmupStats{};
+    iplFMODGetPerfStats(mix.voices[0]->handle(), &warmupStats);
+
+    mix.churnTime = 0.0;
+
+    std::vector<double> blockTimes;
+    blockTimes.reserve(options.numBlocks);
+    for (auto i = 0; i < options.numBlocks; ++i)
+    {
+        blockTimes.push_back(runBlock(options, mix, block++));
+    }
+
+    IPLFMODPerfStats voiceStats{};
+    iplFMODGetPerfStats(mix.voices[0]->handle(), &voiceStats);
+
+    IPLFMODPerfStats totalStats{};
+    iplFMODGetPerfStats(nullptr, &totalStats);
+
+    mix.voices.clear();
+    mix.reverb.reset();
+    mix.mixerReturn.reset();
+
+    iplFMODTerminate();
+    phonon.hrtfRelease(&hrtf);
+    phonon.hrtfRelease(&alternateHRTF);
+    phonon.contextRelease(&context);
+
+    auto mean = 0.0;
+    for (auto blockTime : blockTimes)
+    {
+        mean += blockTime;
+    }
+    mean /= static_cast<double>(blockTimes.size());
+
+    std::sort(blockTimes.begin(), blockTimes.end());
+
+    auto blockDuration = 1e6 * static_cast<double>(options.frameSize) / static_cast<double>(options.samplingRate);
+    auto voicesPerCore = static_cast<double>(options.numVoices) * blockDuration / mean;
+    auto voicesPerCoreP99 = static_cast<double>(options.numVoices) * blockDuration / percentile(blockTimes, 0.99);
+
+    printf("Voices:                    %d (%s)\n", options.numVoices, options.directBinaural ? "binaural" : "panning");
+    printf("Block:                     %d samples at %d Hz (%.1f us)\n", options.frameSize, options.samplingRate, blockDuration);
+    if (options.spatializerFrameSize > 0)
+    {
+        printf("Spatializer frame:         %d samples\n", options.spatializerFrameSize);
+    }
+    if (options.numListeners > 1)
+    {
+        printf("Listeners:                 %d\n", options.numListeners);
+    }
+    auto numChurnVoices = std::min(options.numChurnVoices, options.numVoices - 1);
+    if (numChurnVoices > 0)
+    {
+        printf("Churn:                     %d voices per block, %.1f us per voice (not included in block time)\n",
+               numChurnVoices, mix.churnTime / (static_cast<double>(numChurnVoices) * options.numBlocks));
+    }
+    printf("Blocks measured:           %d\n", options.numBlocks);
+    printf("Block time (us):           mean %.1f, p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n",
+           mean, percentile(blockTimes, 0.5), percentile(blockTimes, 0.9), percentile(blockTimes, 0.99), blockTimes.back());
+    printf("Voices per core:           %.1f (mean), %.1f (p99)\n", voicesPerCore, voicesPerCoreP99);
+    printf("Init failures:             %llu (of which %llu after warmup)\n",
+           static_cast<unsigned long long>(totalStats.numInitFailures),
+           static_cast<unsigned long long>(voiceStats.numInitFailures - warmupStats.numInitFailures));
+    if (options.hrtfSwitchInterval > 0)
+    {
+        printf("HRTF changes:              %llu (of which %llu crossfaded)\n",
+               static_cast<unsigned long long>(voiceStats.numHRTFChanges - warmupStats.numHRTFChanges),
+               static_cast<unsigned long long>(voiceStats.numHRTFCrossfades - warmupStats.numHRTFCrossfades));
+    }
+    printStageTimes(voiceStats);
+
+    if (voicesPerCore < options.minVoicesPerCore)
+    {
+        fprintf(stderr, "Voices per core (%.1f) is below the minimum (%.1f).\n", voicesPerCore, options.minVoicesPerCore);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include "dsp_registry.h"
+
+namespace SteamAudioFMOD {
+
+// --------------------------------------------------------------------------------------------------------------------
+// DSPRegistry
+// --------------------------------------------------------------------------------------------------------------------
+
+DSPRegistry gDSPRegistry;
+
+DSPRegistry::DSPRegistry()
+    : mMutex("DSP registry")
+    , mNextID(1)
+    , mReleasedCallback(nullptr)
+    , mReleasedCallbackUserData(nullptr)
+{}
+
+uint32_t DSPRegistry::add(void* dsp)
+{
+    std::lock_guard<AuditedMutex> lock(mMutex);
+
+    auto id = mNextID++;
+    if (mNextID == 0)
+    {
+        mNextID = 1;
+    }
+
+    mIDs[dsp] = id;
+    return id;
+}
+
+void DSPRegistry::remove(void* dsp)
+{
+    ReleasedCallback callback = nullptr;
+    void* userData = nullptr;
+    uint32_t id = 0;
+
+    {
+        std::lock_guard<AuditedMutex> lock(mMutex);
+
+        auto it = mIDs.find(dsp);
+        if (it == mIDs.end())
+            return;
+
+        id = it->second;
+        mIDs.erase(it);
+
+        callback = mReleasedCallback;
+        userData = mReleasedCallbackUserData;
+    }
+
+    // Called without holding the lock, so the callback can query the registry.
+    if (callback)
+    {
+        callback(dsp, id, userData);
+    }
+}
+
+uint32_t DSPRegistry::find(void* dsp) const
+{
+    std::lock_guard<AuditedMutex> lock(mMutex);
+
+    auto it = mIDs.find(dsp);
+    return (it != mIDs.end()) ? it->second : 0;
+}
+
+void DSPRegistry::setReleasedCallback(ReleasedCallback callback,
+                                      void* userData)
+{
+    std::lock_guard<AuditedMutex> lock(mMutex);
+
+    mReleasedCallback = callback;
+    mReleasedCallbackUserData = userData;
+}
+
+}
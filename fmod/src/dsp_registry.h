@@ -0,0 +1,62 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <mutex>
+#include <unordered_map>
+
+#include <fmod/fmod_common.h>
+
+#include "rt_audit.h"
+
+namespace SteamAudioFMOD {
+
+// --------------------------------------------------------------------------------------------------------------------
+// DSPRegistry
+// --------------------------------------------------------------------------------------------------------------------
+
+// Tracks every live Steam Audio Spatializer DSP, so the game engine can tell whether a given FMOD::DSP is one, without
+// querying FMOD for its name, and can tell when it has been released.
+//
+// Each DSP is assigned a nonzero ID when it is added. IDs are never reused, so a caller that remembers both the
+// FMOD::DSP pointer and its ID can detect that the DSP was released, even if FMOD later creates another spatializer
+// at the same address.
+//
+// All functions are thread-safe, but none are real-time safe.
+class DSPRegistry
+{
+public:
+    typedef void (F_CALL* ReleasedCallback)(void* dsp, uint32_t id, void* userData);
+
+    DSPRegistry();
+
+    // Registers a DSP, and returns its ID.
+    uint32_t add(void* dsp);
+
+    // Unregisters a DSP, and calls the released callback, if any.
+    void remove(void* dsp);
+
+    // Returns the ID of a DSP, or 0 if it is not registered.
+    uint32_t find(void* dsp) const;
+
+    // Specifies a function to call whenever a DSP is removed. The callback is called on whichever thread FMOD uses to
+    // release the DSP, without holding any locks. Pass nullptr to remove the callback.
+    void setReleasedCallback(ReleasedCallback callback,
+                             void* userData);
+
+private:
+    mutable AuditedMutex mMutex;
+    std::unordered_map<void*, uint32_t> mIDs;
+    uint32_t mNextID;
+    ReleasedCallback mReleasedCallback;
+    void* mReleasedCallbackUserData;
+};
+
+extern DSPRegistry gDSPRegistry;
+
+}
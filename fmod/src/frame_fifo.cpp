@@ -0,0 +1,96 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include "frame_fifo.h"
+
+namespace SteamAudioFMOD {
+
+// --------------------------------------------------------------------------------------------------------------------
+// FrameFIFO
+// --------------------------------------------------------------------------------------------------------------------
+
+const int FrameFIFO::kMaxFrameSize;
+
+static int greatestCommonDivisor(int a,
+                                 int b)
+{
+    while (b != 0)
+    {
+        auto r = a % b;
+        a = b;
+        b = r;
+    }
+
+    return a;
+}
+
+FrameFIFO::FrameFIFO(int numChannelsIn,
+                     int numChannelsOut,
+                     int frameSize,
+                     int blockSize)
+    : mNumChannelsIn(numChannelsIn)
+    , mNumChannelsOut(numChannelsOut)
+    , mFrameSize(std::max(frameSize, 1))
+    , mBlockSize(std::max(blockSize, 1))
+    , mInitialLatency(0)
+    , mNumInputSamples(0)
+    , mOutputCapacity(0)
+    , mOutputReadIndex(0)
+    , mNumOutputSamples(0)
+{
+    // Blocks of B samples are read at times B, 2B, ..., and frames of N samples are rendered at times N, 2N, .... The
+    // output must stay ahead of the reads, which takes N - gcd(N, B) samples of silence.
+    mInitialLatency = mFrameSize - greatestCommonDivisor(mFrameSize, mBlockSize);
+
+    // Between calls to process(), less than one frame is buffered in total. During a call, up to one more block is.
+    mOutputCapacity = mFrameSize + mBlockSize;
+
+    mInput.resize(static_cast<size_t>(mFrameSize) * mNumChannelsIn);
+    mFrame.resize(static_cast<size_t>(mFrameSize) * mNumChannelsOut);
+    mOutput.resize(static_cast<size_t>(mOutputCapacity) * mNumChannelsOut);
+
+    reset();
+}
+
+void FrameFIFO::reset()
+{
+    std::fill(mOutput.begin(), mOutput.begin() + static_cast<size_t>(mInitialLatency) * mNumChannelsOut, 0.0f);
+
+    mNumInputSamples = 0;
+    mOutputReadIndex = 0;
+    mNumOutputSamples = mInitialLatency;
+}
+
+void FrameFIFO::writeOutput(const float* frame,
+                            int numSamples)
+{
+    numSamples = std::min(numSamples, mOutputCapacity - mNumOutputSamples);
+
+    auto writeIndex = (mOutputReadIndex + mNumOutputSamples) % mOutputCapacity;
+    auto numBeforeWrap = std::min(numSamples, mOutputCapacity - writeIndex);
+
+    memcpy(&mOutput[writeIndex * mNumChannelsOut], frame, numBeforeWrap * mNumChannelsOut * sizeof(float));
+    memcpy(&mOutput[0], frame + numBeforeWrap * mNumChannelsOut, (numSamples - numBeforeWrap) * mNumChannelsOut * sizeof(float));
+
+    mNumOutputSamples += numSamples;
+}
+
+void FrameFIFO::readOutput(float* out,
+                           int numSamples)
+{
+    auto numRead = std::min(numSamples, mNumOutputSamples);
+    auto numBeforeWrap = std::min(numRead, mOutputCapacity - mOutputReadIndex);
+
+    memcpy(out, &mOutput[mOutputReadIndex * mNumChannelsOut], numBeforeWrap * mNumChannelsOut * sizeof(float));
+    memcpy(out + numBeforeWrap * mNumChannelsOut, &mOutput[0], (numRead - numBeforeWrap) * mNumChannelsOut * sizeof(float));
+
+    // If there isn't enough output, the silence written here delays everything that follows.
+    memset(out + numRead * mNumChannelsOut, 0, (numSamples - numRead) * mNumChannelsOut * sizeof(float));
+
+    mOutputReadIndex = (mOutputReadIndex + numRead) % mOutputCapacity;
+    mNumOutputSamples -= numRead;
+}
+
+}
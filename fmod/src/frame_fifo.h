@@ -0,0 +1,130 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace SteamAudioFMOD {
+
+// --------------------------------------------------------------------------------------------------------------------
+// FrameFIFO
+// --------------------------------------------------------------------------------------------------------------------
+
+// Lets an effect render Steam Audio frames of a fixed size, independently of the size of the blocks the mixer delivers.
+//
+// Interleaved input is collected until a complete frame is available, which is then rendered into a ring buffer of
+// interleaved output. Each block of output is read from the ring buffer, which is primed with just enough silence that
+// there is always a full block to read, as long as the mixer delivers blocks of the expected size. This silence is the
+// latency added by the FIFO. If the frame size divides the block size, the latency is 0, and blocks are rendered in
+// place without any copying.
+//
+// If the mixer delivers a block that is larger than the expected block size, it is processed in several pieces. If a
+// block can't be filled, for example after a partial block, the missing samples are filled with silence, and the
+// latency increases by that many samples. The latency never exceeds one sample less than the frame size.
+//
+// The constructor allocates memory, so it must not be called on the audio thread. Everything else is real-time safe.
+class FrameFIFO
+{
+public:
+    static const int kMaxFrameSize = 4096;
+
+    FrameFIFO(int numChannelsIn,
+              int numChannelsOut,
+              int frameSize,
+              int blockSize);
+
+    int numChannelsIn() const { return mNumChannelsIn; }
+    int numChannelsOut() const { return mNumChannelsOut; }
+    int frameSize() const { return mFrameSize; }
+
+    // The number of samples by which the output currently lags the input.
+    int latency() const { return mNumInputSamples + mNumOutputSamples; }
+
+    // Discards all buffered audio, and restores the initial latency.
+    void reset();
+
+    // Processes numSamples samples of interleaved audio. renderFrame(in, out) is called once for every complete frame,
+    // and must write frameSize() samples of interleaved output to out.
+    template <typename RenderFrame>
+    void process(const float* in,
+                 float* out,
+                 int numSamples,
+                 RenderFrame&& renderFrame);
+
+private:
+    int mNumChannelsIn;
+    int mNumChannelsOut;
+    int mFrameSize;
+    int mBlockSize;
+    int mInitialLatency;
+
+    // Input that has not yet been rendered. Always fewer than mFrameSize samples between calls to process().
+    std::vector<float> mInput;
+    int mNumInputSamples;
+
+    // The frame currently being rendered, before it is copied to the output ring buffer.
+    std::vector<float> mFrame;
+
+    // Rendered output that has not yet been read.
+    std::vector<float> mOutput;
+    int mOutputCapacity;
+    int mOutputReadIndex;
+    int mNumOutputSamples;
+
+    void writeOutput(const float* frame,
+                     int numSamples);
+
+    // Reads up to numSamples samples, and fills the rest with silence.
+    void readOutput(float* out,
+                    int numSamples);
+};
+
+template <typename RenderFrame>
+void FrameFIFO::process(const float* in,
+                        float* out,
+                        int numSamples,
+                        RenderFrame&& renderFrame)
+{
+    // Nothing is buffered, so render whole frames straight from the input to the output.
+    if (mNumInputSamples == 0 && mNumOutputSamples == 0 && numSamples % mFrameSize == 0)
+    {
+        for (auto i = 0; i < numSamples; i += mFrameSize)
+        {
+            renderFrame(in + i * mNumChannelsIn, out + i * mNumChannelsOut);
+        }
+
+        return;
+    }
+
+    // Limit the amount of output buffered at any time by processing oversized blocks in pieces.
+    for (auto pieceStart = 0; pieceStart < numSamples; pieceStart += mBlockSize)
+    {
+        auto pieceSize = std::min(mBlockSize, numSamples - pieceStart);
+        auto pieceIn = in + pieceStart * mNumChannelsIn;
+
+        for (auto i = 0; i < pieceSize; )
+        {
+            auto numCopied = std::min(pieceSize - i, mFrameSize - mNumInputSamples);
+            memcpy(&mInput[mNumInputSamples * mNumChannelsIn], pieceIn + i * mNumChannelsIn, numCopied * mNumChannelsIn * sizeof(float));
+            mNumInputSamples += numCopied;
+            i += numCopied;
+
+            if (mNumInputSamples == mFrameSize)
+            {
+                renderFrame(mInput.data(), mFrame.data());
+                writeOutput(mFrame.data(), mFrameSize);
+                mNumInputSamples = 0;
+            }
+        }
+
+        readOutput(out + pieceStart * mNumChannelsOut, pieceSize);
+    }
+}
+
+}
@@ -0,0 +1,155 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include "hrtf_loader.h"
+
+namespace SteamAudioFMOD {
+
+// --------------------------------------------------------------------------------------------------------------------
+// HRTFLoader
+// --------------------------------------------------------------------------------------------------------------------
+
+HRTFLoader gHRTFLoader;
+
+HRTFLoader::HRTFLoader()
+    : mRunning(false)
+    , mStopRequested(false)
+    , mNextID(1)
+{}
+
+HRTFLoader::~HRTFLoader()
+{
+    stop();
+}
+
+void HRTFLoader::start()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mRunning)
+        return;
+
+    mStopRequested = false;
+    mThread = std::thread(&HRTFLoader::threadProc, this);
+    mRunning = true;
+}
+
+void HRTFLoader::stop()
+{
+    std::deque<Request> cancelled;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (!mRunning)
+            return;
+
+        mRunning = false;
+        mStopRequested = true;
+        cancelled.swap(mQueue);
+    }
+
+    mCondition.notify_one();
+    mThread.join();
+
+    for (auto& request : cancelled)
+    {
+        cancel(request);
+    }
+}
+
+uint32_t HRTFLoader::load(IPLContext context,
+                          const IPLAudioSettings& audioSettings,
+                          const IPLHRTFSettings& hrtfSettings,
+                          Completion completion)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (!mRunning || !context)
+        return 0;
+
+    Request request;
+    request.id = mNextID++;
+    request.context = iplContextRetain(context);
+    request.audioSettings = audioSettings;
+    request.hrtfSettings = hrtfSettings;
+    request.completion = completion;
+
+    // Skip 0, which means the request was not queued.
+    if (mNextID == 0)
+        mNextID = 1;
+
+    if (hrtfSettings.type == IPL_HRTFTYPE_SOFA)
+    {
+        if (hrtfSettings.sofaFileName)
+        {
+            request.sofaFileName = hrtfSettings.sofaFileName;
+        }
+
+        if (hrtfSettings.sofaData && hrtfSettings.sofaDataSize > 0)
+        {
+            request.sofaData.assign(hrtfSettings.sofaData, hrtfSettings.sofaData + hrtfSettings.sofaDataSize);
+        }
+    }
+
+    auto id = request.id;
+    mQueue.push_back(std::move(request));
+
+    mCondition.notify_one();
+    return id;
+}
+
+void HRTFLoader::run(Request& request)
+{
+    // Point the settings at the request's own copies of the SOFA file name and data.
+    auto& hrtfSettings = request.hrtfSettings;
+    hrtfSettings.sofaFileName = (!request.sofaFileName.empty()) ? request.sofaFileName.c_str() : nullptr;
+    hrtfSettings.sofaData = (!request.sofaData.empty()) ? request.sofaData.data() : nullptr;
+    hrtfSettings.sofaDataSize = static_cast<int>(request.sofaData.size());
+
+    IPLHRTF hrtf = nullptr;
+    auto status = iplHRTFCreate(request.context, &request.audioSettings, &hrtfSettings, &hrtf);
+
+    if (request.completion)
+    {
+        request.completion(request.id, status, (status == IPL_STATUS_SUCCESS) ? hrtf : nullptr);
+    }
+
+    iplHRTFRelease(&hrtf);
+    iplContextRelease(&request.context);
+}
+
+void HRTFLoader::cancel(Request& request)
+{
+    if (request.completion)
+    {
+        request.completion(request.id, IPL_STATUS_FAILURE, nullptr);
+    }
+
+    iplContextRelease(&request.context);
+}
+
+void HRTFLoader::threadProc()
+{
+    while (true)
+    {
+        Request request;
+
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [&]() { return mStopRequested || !mQueue.empty(); });
+
+            if (mStopRequested)
+                break;
+
+            request = std::move(mQueue.front());
+            mQueue.pop_front();
+        }
+
+        run(request);
+    }
+}
+
+}
@@ -0,0 +1,83 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <phonon.h>
+
+namespace SteamAudioFMOD {
+
+// --------------------------------------------------------------------------------------------------------------------
+// HRTFLoader
+// --------------------------------------------------------------------------------------------------------------------
+
+// Creates HRTFs on a worker thread, so that loading and resampling a SOFA file never stalls the game thread.
+//
+// Requests are handled one at a time, in the order in which they were made, and every request completes exactly once,
+// even if several are made in quick succession. This way, the HRTF that ends up in use is always the one that was
+// requested last, whichever requests succeed.
+//
+// All functions are thread-safe, but none are real-time safe.
+class HRTFLoader
+{
+public:
+    // Called on the worker thread when a request completes. hrtf is nullptr if the request failed or was cancelled. The
+    // loader releases its reference to hrtf once this returns, so it must be retained if it is needed afterwards.
+    typedef std::function<void(uint32_t id, IPLerror status, IPLHRTF hrtf)> Completion;
+
+    HRTFLoader();
+    ~HRTFLoader();
+
+    // Starts the worker thread, if it is not already running.
+    void start();
+
+    // Waits for the request being handled (if any), cancels all other queued requests, and stops the worker thread.
+    void stop();
+
+    // Queues a request to create an HRTF. SOFA file names and data are copied, so they need not outlive the call.
+    // Returns an ID that identifies the request in its completion callback, or 0 if the worker is not running.
+    uint32_t load(IPLContext context,
+                  const IPLAudioSettings& audioSettings,
+                  const IPLHRTFSettings& hrtfSettings,
+                  Completion completion);
+
+private:
+    struct Request
+    {
+        uint32_t id;
+        IPLContext context;
+        IPLAudioSettings audioSettings;
+        IPLHRTFSettings hrtfSettings;
+        std::string sofaFileName;
+        std::vector<uint8_t> sofaData;
+        Completion completion;
+    };
+
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Request> mQueue;
+    bool mRunning;
+    bool mStopRequested;
+    uint32_t mNextID;
+
+    static void run(Request& request);
+    static void cancel(Request& request);
+    void threadProc();
+};
+
+extern HRTFLoader gHRTFLoader;
+
+}
@@ -4,6 +4,10 @@
 //
 
 #include "steamaudio_fmod.h"
+#include "audio_kernels.h"
+#include "effect_builder.h"
+#include "perf_stats.h"
+#include "rt_audit.h"
 
 namespace SteamAudioFMOD {
 
@@ -42,6 +46,8 @@ void initParamDescs()
     gParams[BINAURAL].booldesc = {false};
 }
 
+class PublishJob;
+
 struct State
 {
     bool binaural;
@@ -52,6 +58,38 @@ struct State
 
     IPLReflectionMixer reflectionMixer;
     IPLAmbisonicsDecodeEffect ambisonicsEffect;
+
+    PerfCounters perf;
+
+    // True if reflectionMixer has been published to the other effects via the RenderStateManager.
+    bool isReflectionMixerPublished;
+
+    // Publishes reflectionMixer on the effect builder's worker thread, if it could not be published from create().
+    PublishJob* publishJob;
+};
+
+// Publishing allocates a new snapshot and may free old ones, so it must not happen on the audio thread.
+class PublishJob : public EffectBuildJob
+{
+public:
+    // Input, retained on the audio thread before the job is submitted, and released once it has been published.
+    IPLReflectionMixer reflectionMixer;
+
+    PublishJob()
+        : reflectionMixer(nullptr)
+    {}
+
+    ~PublishJob() override
+    {
+        iplReflectionMixerRelease(&reflectionMixer);
+    }
+
+protected:
+    void build() override
+    {
+        gRenderStateManager.setReflectionMixer(reflectionMixer);
+        iplReflectionMixerRelease(&reflectionMixer);
+    }
 };
 
 enum InitFlags
@@ -63,6 +101,7 @@ enum InitFlags
 };
 
 InitFlags lazyInit(FMOD_DSP_STATE* state,
+                   const RenderState* renderState,
                    int numChannelsIn,
                    int numChannelsOut)
 {
@@ -72,47 +111,36 @@ InitFlags lazyInit(FMOD_DSP_STATE* state,
     state->functions->getsamplerate(state, &audioSettings.samplingRate);
     state->functions->getblocksize(state, reinterpret_cast<unsigned int*>(&audioSettings.frameSize));
 
-    if (!gContext && isRunningInEditor())
-    {
-        initContextAndDefaultHRTF(audioSettings);
-    }
-
     if (!gContext)
         return initFlags;
 
-    if (!gHRTF[1])
+    if (!renderState || !renderState->hrtf)
         return initFlags;
 
+    const auto& simulationSettings = renderState->simulationSettings;
+
     auto effect = reinterpret_cast<State*>(state->plugindata);
 
     auto status = IPL_STATUS_SUCCESS;
 
-    if (gIsSimulationSettingsValid)
+    if (renderState->isSimulationSettingsValid)
     {
         status = IPL_STATUS_SUCCESS;
 
         if (!effect->reflectionMixer)
         {
             IPLReflectionEffectSettings effectSettings;
-            effectSettings.type = gSimulationSettings.reflectionType;
-            effectSettings.numChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
+            effectSettings.type = simulationSettings.reflectionType;
+            effectSettings.numChannels = numChannelsForOrder(simulationSettings.maxOrder);
 
             status = iplReflectionMixerCreate(gContext, &audioSettings, &effectSettings, &effect->reflectionMixer);
-
-            if (!gNewReflectionMixerWritten)
-            {
-                iplReflectionMixerRelease(&gReflectionMixer[1]);
-                gReflectionMixer[1] = iplReflectionMixerRetain(effect->reflectionMixer);
-
-                gNewReflectionMixerWritten = true;
-            }
         }
 
         if (status == IPL_STATUS_SUCCESS)
             initFlags = static_cast<InitFlags>(initFlags | INIT_REFLECTIONEFFECT);
     }
 
-    if (numChannelsOut > 0 && gIsSimulationSettingsValid)
+    if (numChannelsOut > 0 && renderState->isSimulationSettingsValid)
     {
         status = IPL_STATUS_SUCCESS;
 
@@ -120,8 +148,8 @@ InitFlags lazyInit(FMOD_DSP_STATE* state,
         {
             IPLAmbisonicsDecodeEffectSettings effectSettings;
             effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
-            effectSettings.hrtf = gHRTF[1];
-            effectSettings.maxOrder = gSimulationSettings.maxOrder;
+            effectSettings.hrtf = renderState->hrtf;
+            effectSettings.maxOrder = simulationSettings.maxOrder;
 
             status = iplAmbisonicsDecodeEffectCreate(gContext, &audioSettings, &effectSettings, &effect->ambisonicsEffect);
         }
@@ -132,7 +160,7 @@ InitFlags lazyInit(FMOD_DSP_STATE* state,
 
     if (numChannelsIn > 0 && numChannelsOut > 0)
     {
-        auto numAmbisonicChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
+        auto numAmbisonicChannels = numChannelsForOrder(simulationSettings.maxOrder);
 
         if (!effect->reflectionsBuffer.data)
             iplAudioBufferAllocate(gContext, numAmbisonicChannels, audioSettings.frameSize, &effect->reflectionsBuffer);
@@ -158,11 +186,60 @@ void reset(FMOD_DSP_STATE* state)
     effect->binaural = false;
 }
 
+// Makes the reflection mixer created by this effect available to the Spatializer and Reverb effects. Must not be
+// called from within RenderStateManager::withLatest.
+void publishReflectionMixer(FMOD_DSP_STATE* state)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    if (effect->reflectionMixer && !effect->isReflectionMixerPublished)
+    {
+        gRenderStateManager.setReflectionMixer(effect->reflectionMixer);
+        effect->isReflectionMixerPublished = true;
+    }
+}
+
+// Called from process() when the reflection mixer was created after create(). Hands it to the effect builder to be
+// published, and marks it as published once that has happened. Never blocks.
+void requestReflectionMixerPublish(State* effect)
+{
+    if (!effect->reflectionMixer || effect->isReflectionMixerPublished)
+        return;
+
+    auto job = effect->publishJob;
+
+    if (job->isReady())
+    {
+        job->complete();
+        effect->isReflectionMixerPublished = true;
+    }
+    else if (job->isIdle())
+    {
+        job->reflectionMixer = iplReflectionMixerRetain(effect->reflectionMixer);
+
+        // If the queue is full, try again in the next block. The effect still holds a reference, so this never frees
+        // the mixer.
+        if (!gEffectBuilder.submit(job))
+            iplReflectionMixerRelease(&job->reflectionMixer);
+    }
+}
+
 FMOD_RESULT F_CALL create(FMOD_DSP_STATE* state)
 {
-    state->plugindata = new State();
+    auto effect = new State();
+    effect->publishJob = new PublishJob();
+    state->plugindata = effect;
     reset(state);
-    lazyInit(state, 0, 0);
+
+    gPerfStatsRegistry.add(state->instance, &effect->perf);
+
+    initContextIfRunningInEditor(state);
+    gRenderStateManager.withLatest([&](const RenderState* renderState)
+    {
+        lazyInit(state, renderState, 0, 0);
+    });
+    publishReflectionMixer(state);
+
     return FMOD_OK;
 }
 
@@ -170,6 +247,10 @@ FMOD_RESULT F_CALL release(FMOD_DSP_STATE* state)
 {
     auto effect = reinterpret_cast<State*>(state->plugindata);
 
+    gPerfStatsRegistry.remove(state->instance);
+
+    gEffectBuilder.abandon(effect->publishJob);
+
     iplAudioBufferFree(gContext, &effect->reflectionsBuffer);
     iplAudioBufferFree(gContext, &effect->inBuffer);
     iplAudioBufferFree(gContext, &effect->outBuffer);
@@ -226,14 +307,21 @@ FMOD_RESULT F_CALL process(FMOD_DSP_STATE* state,
                            FMOD_BOOL inputsIdle,
                            FMOD_DSP_PROCESS_OPERATION operation)
 {
+    RTAuditScope auditScope;
+
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
     if (operation == FMOD_DSP_PROCESS_QUERY)
     {
         if (inputsIdle)
+        {
+            effect->perf.countBypassedBlock();
             return FMOD_ERR_DSP_DONTPROCESS;
+        }
     }
     else if (operation == FMOD_DSP_PROCESS_PERFORM)
     {
-        auto effect = reinterpret_cast<State*>(state->plugindata);
+        effect->perf.countProcessCall();
 
         auto samplingRate = 0;
         auto frameSize = 0u;
@@ -248,40 +336,66 @@ FMOD_RESULT F_CALL process(FMOD_DSP_STATE* state,
         // Start by clearing the output buffer.
         memset(out, 0, numChannelsOut * frameSize * sizeof(float));
 
+        initContextIfRunningInEditor(state);
+
         // Make sure that audio processing state has been initialized. If initialization fails, stop and emit silence.
-        auto initFlags = lazyInit(state, numChannelsIn, numChannelsOut);
+        auto renderState = gRenderStateManager.current();
+        auto initFlags = lazyInit(state, renderState, numChannelsIn, numChannelsOut);
         if (!(initFlags & INIT_AUDIOBUFFERS) || !(initFlags & INIT_REFLECTIONEFFECT) || !(initFlags & INIT_AMBISONICSEFFECT))
+        {
+            effect->perf.countInitFailure();
             return FMOD_ERR_DSP_SILENCE;
+        }
 
-        if (gNewHRTFWritten)
-        {
-            iplHRTFRelease(&gHRTF[0]);
-            gHRTF[0] = iplHRTFRetain(gHRTF[1]);
+        effect->perf.countHRTFChange(renderState->hrtf);
 
-            gNewHRTFWritten = false;
-        }
+        requestReflectionMixerPublish(effect);
+
+        const auto& simulationSettings = renderState->simulationSettings;
 
         auto listenerCoordinates = calcListenerCoordinates(state);
 
         IPLReflectionEffectParams reflectionParams;
-        reflectionParams.numChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
-        reflectionParams.tanDevice = gSimulationSettings.tanDevice;
+        reflectionParams.numChannels = numChannelsForOrder(simulationSettings.maxOrder);
+        reflectionParams.tanDevice = simulationSettings.tanDevice;
 
-        iplReflectionMixerApply(effect->reflectionMixer, &reflectionParams, &effect->reflectionsBuffer);
+        {
+            PerfTimer timer(effect->perf, PERFSTAGE_REFLECTIONS);
+            iplReflectionMixerApply(effect->reflectionMixer, &reflectionParams, &effect->reflectionsBuffer);
+        }
 
-        IPLAmbisonicsDecodeEffectParams ambisonicsParams;
-        ambisonicsParams.order = gSimulationSettings.maxOrder;
-        ambisonicsParams.hrtf = gHRTF[0];
-        ambisonicsParams.orientation = listenerCoordinates;
-        ambisonicsParams.binaural = (effect->binaural) ? IPL_TRUE : IPL_FALSE;
+        {
+            PerfTimer timer(effect->perf, PERFSTAGE_DECODE);
 
-        iplAmbisonicsDecodeEffectApply(effect->ambisonicsEffect, &ambisonicsParams, &effect->reflectionsBuffer, &effect->outBuffer);
+            IPLAmbisonicsDecodeEffectParams ambisonicsParams;
+            ambisonicsParams.order = simulationSettings.maxOrder;
+            ambisonicsParams.hrtf = renderState->hrtf;
+            ambisonicsParams.orientation = listenerCoordinates;
+            ambisonicsParams.binaural = (effect->binaural) ? IPL_TRUE : IPL_FALSE;
 
-        iplAudioBufferDeinterleave(gContext, in, &effect->inBuffer);
-        iplAudioBufferMix(gContext, &effect->inBuffer, &effect->outBuffer);
-        
+            iplAmbisonicsDecodeEffectApply(effect->ambisonicsEffect, &ambisonicsParams, &effect->reflectionsBuffer, &effect->outBuffer);
+        }
+
+        // The input is mixed in after interleaving, so it doesn't need to be deinterleaved. Input channels that the output
+        // doesn't have are dropped.
         iplAudioBufferInterleave(gContext, &effect->outBuffer, out);
 
+        if (numChannelsIn == numChannelsOut)
+        {
+            mixInto(in, numChannelsIn * static_cast<int>(frameSize), out);
+        }
+        else
+        {
+            auto numChannels = std::min(numChannelsIn, numChannelsOut);
+            for (auto i = 0u; i < frameSize; ++i)
+            {
+                for (auto j = 0; j < numChannels; ++j)
+                {
+                    out[i * numChannelsOut + j] += in[i * numChannelsIn + j];
+                }
+            }
+        }
+
         return FMOD_OK;
     }
 
@@ -318,7 +432,7 @@ FMOD_DSP_DESCRIPTION gMixerReturnEffect
     nullptr,
     nullptr,
     nullptr,
-    nullptr
+    systemMix
 };
 
 }
@@ -33,6 +33,10 @@ studio.plugins.registerPluginDescription("Steam Audio Spatializer", {
 		"ReflMixLevel": {displayName: "Reflections Mix Level"},
 		"PathBinaural": {displayName: "Apply HRTF To Pathing"},
 		"PathMixLevel": {displayName: "Pathing Mix Level"},
+		"Group": {displayName: "Spatializer Group"},
+		"FrameSize": {displayName: "Frame Size"},
+		"Latency": {displayName: "Latency"},
+		"Listener": {displayName: "Listener"},
 	},
 	deckUi: {
 		deckWidgetType: studio.ui.deckWidgetType.Layout,
@@ -360,4 +364,43 @@ studio.plugins.registerPluginDescription("Steam Audio Reverb", {
 			}
 		]
 	}
-});
\ No newline at end of file
+});
+
+studio.plugins.registerPluginDescription("Steam Audio Spatializer Group", {
+	companyName: "Valve",
+	productName: "Steam Audio Spatializer Group",
+	parameters: {
+		"Group": {displayName: "Group"},
+		"Order": {displayName: "Ambisonic Order"},
+		"Binaural": {displayName: "Apply HRTF"}
+	},
+	deckUi: {
+		deckWidgetType: studio.ui.deckWidgetType.Layout,
+		layout: studio.ui.layoutType.HBoxLayout,
+		minimumWidth: 256,
+		items: [
+			{
+				deckWidgetType: studio.ui.deckWidgetType.Layout,
+				layout: studio.ui.layoutType.VBoxLayout,
+				spacing: 6,
+				contentsMargins: {left: 4, right: 4},
+				items: [
+					{
+						deckWidgetType: studio.ui.deckWidgetType.Dial,
+						binding: "Group"
+					},
+					{
+						deckWidgetType: studio.ui.deckWidgetType.Dial,
+						binding: "Order"
+					},
+					{
+						deckWidgetType: studio.ui.deckWidgetType.Button,
+						binding: "Binaural",
+						text: "On",
+						buttonWidth: 64
+					}
+				]
+			}
+		]
+	}
+});
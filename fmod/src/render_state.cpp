@@ -0,0 +1,223 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <algorithm>
+
+#include "render_state.h"
+
+namespace SteamAudioFMOD {
+
+// --------------------------------------------------------------------------------------------------------------------
+// RenderStateManager
+// --------------------------------------------------------------------------------------------------------------------
+
+RenderStateManager gRenderStateManager;
+
+RenderStateManager::RenderStateManager()
+    : mPublishMutex("render state publishing")
+    , mLatest(nullptr)
+    , mPending(nullptr)
+    , mCurrent(nullptr)
+    , mPrevious(nullptr)
+    , mRetired(nullptr)
+    , mStartedBlocks(0)
+    , mFinishedBlocks(0)
+    , mInMixBlock(false)
+    , mMixBlockClock(0)
+{}
+
+void RenderStateManager::setHRTF(IPLHRTF hrtf)
+{
+    publish([&](RenderState& state)
+    {
+        if (state.hrtf == hrtf)
+            return false;
+
+        iplHRTFRelease(&state.hrtf);
+        state.hrtf = iplHRTFRetain(hrtf);
+        return true;
+    });
+}
+
+void RenderStateManager::setSimulationSettings(const IPLSimulationSettings& simulationSettings)
+{
+    publish([&](RenderState& state)
+    {
+        state.simulationSettings = simulationSettings;
+        state.isSimulationSettingsValid = true;
+        return true;
+    });
+}
+
+void RenderStateManager::setReverbSource(IPLSource reverbSource)
+{
+    publish([&](RenderState& state)
+    {
+        if (state.reverbSource == reverbSource)
+            return false;
+
+        iplSourceRelease(&state.reverbSource);
+        state.reverbSource = iplSourceRetain(reverbSource);
+        return true;
+    });
+}
+
+void RenderStateManager::setReflectionMixer(IPLReflectionMixer reflectionMixer)
+{
+    publish([&](RenderState& state)
+    {
+        if (state.reflectionMixer == reflectionMixer)
+            return false;
+
+        iplReflectionMixerRelease(&state.reflectionMixer);
+        state.reflectionMixer = iplReflectionMixerRetain(reflectionMixer);
+        return true;
+    });
+}
+
+void RenderStateManager::beginMixBlock(uint64_t clock)
+{
+    if (mInMixBlock && clock == mMixBlockClock)
+        return;
+
+    mInMixBlock = true;
+    mMixBlockClock = clock;
+
+    auto block = mStartedBlocks.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+    mPrevious.store(nullptr, std::memory_order_release);
+
+    auto pending = mPending.exchange(nullptr, std::memory_order_acq_rel);
+    if (!pending)
+        return;
+
+    auto previous = mCurrent.exchange(pending, std::memory_order_acq_rel);
+    if (!previous)
+        return;
+
+    mPrevious.store(previous, std::memory_order_release);
+
+    // The previous snapshot may have been read by DSPs in earlier blocks, but not in this one. Hand it to the
+    // publishing thread, which will free it once this block has finished.
+    previous->retiredAtBlock = block;
+    previous->nextRetired = mRetired.load(std::memory_order_relaxed);
+    while (!mRetired.compare_exchange_weak(previous->nextRetired, previous, std::memory_order_release, std::memory_order_relaxed))
+    {}
+}
+
+void RenderStateManager::endMixBlock(uint64_t clock)
+{
+    if (!mInMixBlock || clock != mMixBlockClock)
+        return;
+
+    mInMixBlock = false;
+
+    mFinishedBlocks.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void RenderStateManager::reset()
+{
+    std::lock_guard<AuditedMutex> lock(mPublishMutex);
+
+    auto pending = mPending.exchange(nullptr);
+    auto current = mCurrent.exchange(nullptr);
+    mPrevious.store(nullptr);
+
+    destroy(pending);
+    if (current != pending)
+        destroy(current);
+
+    for (auto retired = mRetired.exchange(nullptr); retired; )
+    {
+        auto next = retired->nextRetired;
+        destroy(retired);
+        retired = next;
+    }
+
+    for (auto deferred : mDeferred)
+    {
+        destroy(deferred);
+    }
+    mDeferred.clear();
+
+    mLatest = nullptr;
+}
+
+template <typename F>
+void RenderStateManager::publish(F modify)
+{
+    std::lock_guard<AuditedMutex> lock(mPublishMutex);
+
+    auto state = copy(mLatest);
+    if (!modify(*state))
+    {
+        destroy(state);
+        return;
+    }
+
+    state->version = (mLatest) ? mLatest->version + 1 : 1;
+    mLatest = state;
+
+    // If the previous pending snapshot was never adopted by the mixer, no DSP has seen it, so it can be freed right
+    // away. The new snapshot already contains all of its changes.
+    auto superseded = mPending.exchange(state, std::memory_order_acq_rel);
+    destroy(superseded);
+
+    collectGarbage();
+}
+
+void RenderStateManager::collectGarbage()
+{
+    for (auto retired = mRetired.exchange(nullptr, std::memory_order_acquire); retired; )
+    {
+        auto next = retired->nextRetired;
+        mDeferred.push_back(retired);
+        retired = next;
+    }
+
+    auto finishedBlocks = mFinishedBlocks.load(std::memory_order_acquire);
+
+    auto it = std::remove_if(mDeferred.begin(), mDeferred.end(), [&](RenderState* state)
+    {
+        if (state->retiredAtBlock > finishedBlocks)
+            return false;
+
+        destroy(state);
+        return true;
+    });
+
+    mDeferred.erase(it, mDeferred.end());
+}
+
+RenderState* RenderStateManager::copy(const RenderState* state)
+{
+    auto newState = new RenderState{};
+
+    if (state)
+    {
+        newState->version = state->version;
+        newState->hrtf = iplHRTFRetain(state->hrtf);
+        newState->simulationSettings = state->simulationSettings;
+        newState->isSimulationSettingsValid = state->isSimulationSettingsValid;
+        newState->reverbSource = iplSourceRetain(state->reverbSource);
+        newState->reflectionMixer = iplReflectionMixerRetain(state->reflectionMixer);
+    }
+
+    return newState;
+}
+
+void RenderStateManager::destroy(RenderState* state)
+{
+    if (!state)
+        return;
+
+    iplHRTFRelease(&state->hrtf);
+    iplSourceRelease(&state->reverbSource);
+    iplReflectionMixerRelease(&state->reflectionMixer);
+
+    delete state;
+}
+
+}
@@ -0,0 +1,159 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <phonon.h>
+
+#include "rt_audit.h"
+
+namespace SteamAudioFMOD {
+
+// --------------------------------------------------------------------------------------------------------------------
+// RenderState
+// --------------------------------------------------------------------------------------------------------------------
+
+// An immutable snapshot of all the global state that the DSP effects need for rendering. Each snapshot holds its own
+// reference to every Steam Audio object it points to, so a DSP can use the objects for the duration of a process()
+// call without retaining or releasing anything.
+struct RenderState
+{
+    // Incremented every time a new snapshot is published.
+    uint64_t version;
+
+    IPLHRTF hrtf;
+    IPLSimulationSettings simulationSettings;
+    bool isSimulationSettingsValid;
+    IPLSource reverbSource;
+    IPLReflectionMixer reflectionMixer;
+
+    // Bookkeeping used for deferred reclamation. Not part of the published state.
+    uint64_t retiredAtBlock;
+    RenderState* nextRetired;
+};
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// RenderStateManager
+// --------------------------------------------------------------------------------------------------------------------
+
+// Publishes RenderState snapshots from the game thread to the audio thread.
+//
+// Publishers (iplFMODSetHRTF and friends) build a complete new snapshot from the most recently published one, so an
+// update is never lost, even if several arrive before the mixer runs. The mixer adopts the newest snapshot once per mix
+// block, from the sys_mix callback, before any DSP runs. DSPs then read the current snapshot with a single atomic load.
+// Snapshots that are no longer current are freed on the publishing thread, once the mixer has finished the blocks in
+// which they could have been read, so the audio thread never frees memory or releases Steam Audio objects.
+//
+// This assumes that a single FMOD system is mixing the Steam Audio effects, which is the case for the runtime.
+class RenderStateManager
+{
+public:
+    RenderStateManager();
+
+    // Publishes a new snapshot in which the HRTF has been replaced. Retains a reference to the HRTF. Does nothing if the
+    // HRTF is already the latest one.
+    void setHRTF(IPLHRTF hrtf);
+
+    // Publishes a new snapshot in which the simulation settings have been replaced.
+    void setSimulationSettings(const IPLSimulationSettings& simulationSettings);
+
+    // Publishes a new snapshot in which the reverb source has been replaced. Retains a reference to the source. Does
+    // nothing if the source is already the latest one.
+    void setReverbSource(IPLSource reverbSource);
+
+    // Publishes a new snapshot in which the reflection mixer has been replaced. Retains a reference to the mixer. Does
+    // nothing if the mixer is already the latest one.
+    void setReflectionMixer(IPLReflectionMixer reflectionMixer);
+
+    // Calls a function with the most recently published snapshot (or nullptr if nothing has been published yet). The
+    // snapshot stays valid for the duration of the call. Must not be called from the audio thread.
+    template <typename F>
+    void withLatest(F function)
+    {
+        std::lock_guard<AuditedMutex> lock(mPublishMutex);
+        function(static_cast<const RenderState*>(mLatest));
+    }
+
+    // Called by the mixer at the start of every mix block, with the mixer's clock. Adopts the newest published
+    // snapshot, if any. FMOD calls sys_mix once for each Steam Audio DSP description, so this may be called several
+    // times per block; only the first call for a given block does anything. Wait-free apart from a single CAS that can
+    // only fail if the publishing thread is reclaiming snapshots at the same time.
+    void beginMixBlock(uint64_t clock);
+
+    // Called by the mixer at the end of every mix block. As with beginMixBlock, only the first call after the block
+    // started does anything.
+    void endMixBlock(uint64_t clock);
+
+    // Returns the snapshot for the current mix block, or nullptr if nothing has been published yet. Wait-free. The
+    // snapshot may only be used until the end of the current mix block.
+    const RenderState* current() const
+    {
+        return mCurrent.load(std::memory_order_acquire);
+    }
+
+    // Returns the snapshot that was current before this mix block, if the current snapshot was adopted at the start of
+    // this block, or nullptr otherwise. Wait-free. Lets DSPs crossfade from the previous state instead of switching
+    // abruptly. The snapshot may only be used until the end of the current mix block.
+    const RenderState* previous() const
+    {
+        return mPrevious.load(std::memory_order_acquire);
+    }
+
+    // Releases all snapshots. Must only be called when no DSP effects exist.
+    void reset();
+
+private:
+    // Guards publishing and reclamation. Never taken on the audio thread.
+    AuditedMutex mPublishMutex;
+
+    // The most recently published snapshot. Accessed only with mPublishMutex held.
+    RenderState* mLatest;
+
+    // The most recently published snapshot that the mixer has not adopted yet.
+    std::atomic<RenderState*> mPending;
+
+    // The snapshot being used by the mixer.
+    std::atomic<RenderState*> mCurrent;
+
+    // The snapshot replaced by mCurrent at the start of the current mix block, if any. It is retired in that block, so
+    // it is not freed before the block has finished.
+    std::atomic<RenderState*> mPrevious;
+
+    // Lock-free stack of snapshots that the mixer has stopped using. Pushed by the mixer, drained by publishers.
+    std::atomic<RenderState*> mRetired;
+
+    // Retired snapshots that may still be in use by DSPs. Accessed only with mPublishMutex held.
+    std::vector<RenderState*> mDeferred;
+
+    // The number of mix blocks that have started and finished, respectively.
+    std::atomic<uint64_t> mStartedBlocks;
+    std::atomic<uint64_t> mFinishedBlocks;
+
+    // True between the start and the end of a mix block, and the clock of the most recently started block. Only
+    // accessed by the mixer.
+    bool mInMixBlock;
+    uint64_t mMixBlockClock;
+
+    // Creates a copy of the latest snapshot, lets the caller modify it, and publishes it.
+    template <typename F>
+    void publish(F modify);
+
+    // Frees retired snapshots that can no longer be in use. Must be called with mPublishMutex held.
+    void collectGarbage();
+
+    static RenderState* copy(const RenderState* state);
+    static void destroy(RenderState* state);
+};
+
+extern RenderStateManager gRenderStateManager;
+
+}
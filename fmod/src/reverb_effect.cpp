@@ -4,6 +4,9 @@
 //
 
 #include "steamaudio_fmod.h"
+#include "audio_kernels.h"
+#include "perf_stats.h"
+#include "rt_audit.h"
 
 namespace SteamAudioFMOD {
 
@@ -53,6 +56,8 @@ struct State
 
     IPLReflectionEffect reflectionEffect;
     IPLAmbisonicsDecodeEffect ambisonicsEffect;
+
+    PerfCounters perf;
 };
 
 enum InitFlags
@@ -64,6 +69,7 @@ enum InitFlags
 };
 
 InitFlags lazyInit(FMOD_DSP_STATE* state,
+                   const RenderState* renderState,
                    int numChannelsIn,
                    int numChannelsOut)
 {
@@ -73,31 +79,28 @@ InitFlags lazyInit(FMOD_DSP_STATE* state,
     state->functions->getsamplerate(state, &audioSettings.samplingRate);
     state->functions->getblocksize(state, reinterpret_cast<unsigned int*>(&audioSettings.frameSize));
 
-    if (!gContext && isRunningInEditor())
-    {
-        initContextAndDefaultHRTF(audioSettings);
-    }
-
     if (!gContext)
         return initFlags;
 
-    if (!gHRTF[1])
+    if (!renderState || !renderState->hrtf)
         return initFlags;
 
+    const auto& simulationSettings = renderState->simulationSettings;
+
     auto effect = reinterpret_cast<State*>(state->plugindata);
 
     auto status = IPL_STATUS_SUCCESS;
 
-    if (gIsSimulationSettingsValid)
+    if (renderState->isSimulationSettingsValid)
     {
         status = IPL_STATUS_SUCCESS;
 
         if (!effect->reflectionEffect)
         {
             IPLReflectionEffectSettings effectSettings;
-            effectSettings.type = gSimulationSettings.reflectionType;
-            effectSettings.irSize = numSamplesForDuration(gSimulationSettings.maxDuration, audioSettings.samplingRate);
-            effectSettings.numChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
+            effectSettings.type = simulationSettings.reflectionType;
+            effectSettings.irSize = numSamplesForDuration(simulationSettings.maxDuration, audioSettings.samplingRate);
+            effectSettings.numChannels = numChannelsForOrder(simulationSettings.maxOrder);
 
             status = iplReflectionEffectCreate(gContext, &audioSettings, &effectSettings, &effect->reflectionEffect);
         }
@@ -106,7 +109,7 @@ InitFlags lazyInit(FMOD_DSP_STATE* state,
             initFlags = static_cast<InitFlags>(initFlags | INIT_REFLECTIONEFFECT);
     }
 
-    if (numChannelsOut > 0 && gIsSimulationSettingsValid)
+    if (numChannelsOut > 0 && renderState->isSimulationSettingsValid)
     {
         status = IPL_STATUS_SUCCESS;
 
@@ -114,8 +117,8 @@ InitFlags lazyInit(FMOD_DSP_STATE* state,
         {
             IPLAmbisonicsDecodeEffectSettings effectSettings;
             effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
-            effectSettings.hrtf = gHRTF[1];
-            effectSettings.maxOrder = gSimulationSettings.maxOrder;
+            effectSettings.hrtf = renderState->hrtf;
+            effectSettings.maxOrder = simulationSettings.maxOrder;
 
             status = iplAmbisonicsDecodeEffectCreate(gContext, &audioSettings, &effectSettings, &effect->ambisonicsEffect);
         }
@@ -126,7 +129,7 @@ InitFlags lazyInit(FMOD_DSP_STATE* state,
 
     if (numChannelsIn > 0 && numChannelsOut > 0)
     {
-        auto numAmbisonicChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
+        auto numAmbisonicChannels = numChannelsForOrder(simulationSettings.maxOrder);
 
         if (!effect->inBuffer.data)
             iplAudioBufferAllocate(gContext, numChannelsIn, audioSettings.frameSize, &effect->inBuffer);
@@ -157,9 +160,18 @@ void reset(FMOD_DSP_STATE* state)
 
 FMOD_RESULT F_CALL create(FMOD_DSP_STATE* state)
 {
-    state->plugindata = new State();
+    auto effect = new State();
+    state->plugindata = effect;
     reset(state);
-    lazyInit(state, 0, 0);
+
+    gPerfStatsRegistry.add(state->instance, &effect->perf);
+
+    initContextIfRunningInEditor(state);
+    gRenderStateManager.withLatest([&](const RenderState* renderState)
+    {
+        lazyInit(state, renderState, 0, 0);
+    });
+
     return FMOD_OK;
 }
 
@@ -167,6 +179,8 @@ FMOD_RESULT F_CALL release(FMOD_DSP_STATE* state)
 {
     auto effect = reinterpret_cast<State*>(state->plugindata);
 
+    gPerfStatsRegistry.remove(state->instance);
+
     iplAudioBufferFree(gContext, &effect->inBuffer);
     iplAudioBufferFree(gContext, &effect->monoBuffer);
     iplAudioBufferFree(gContext, &effect->reflectionsBuffer);
@@ -175,9 +189,7 @@ FMOD_RESULT F_CALL release(FMOD_DSP_STATE* state)
     iplReflectionEffectRelease(&effect->reflectionEffect);
     iplAmbisonicsDecodeEffectRelease(&effect->ambisonicsEffect);
 
-    gNewReverbSourceWritten = false;
-    iplSourceRelease(&gReverbSource[0]);
-    iplSourceRelease(&gReverbSource[1]);
+    gRenderStateManager.setReverbSource(nullptr);
 
     delete state->plugindata;
 
@@ -228,14 +240,21 @@ FMOD_RESULT F_CALL process(FMOD_DSP_STATE* state,
                            FMOD_BOOL inputsIdle,
                            FMOD_DSP_PROCESS_OPERATION operation)
 {
+    RTAuditScope auditScope;
+
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
     if (operation == FMOD_DSP_PROCESS_QUERY)
     {
         if (inputsIdle)
+        {
+            effect->perf.countBypassedBlock();
             return FMOD_ERR_DSP_DONTPROCESS;
+        }
     }
     else if (operation == FMOD_DSP_PROCESS_PERFORM)
     {
-        auto effect = reinterpret_cast<State*>(state->plugindata);
+        effect->perf.countProcessCall();
 
         auto samplingRate = 0;
         auto frameSize = 0u;
@@ -250,59 +269,49 @@ FMOD_RESULT F_CALL process(FMOD_DSP_STATE* state,
         // Start by clearing the output buffer.
         memset(out, 0, numChannelsOut * frameSize * sizeof(float));
 
+        initContextIfRunningInEditor(state);
+
         // Make sure that audio processing state has been initialized. If initialization fails, stop and emit silence.
-        auto initFlags = lazyInit(state, numChannelsIn, numChannelsOut);
+        auto renderState = gRenderStateManager.current();
+        auto initFlags = lazyInit(state, renderState, numChannelsIn, numChannelsOut);
         if (!(initFlags & INIT_AUDIOBUFFERS) || !(initFlags & INIT_REFLECTIONEFFECT) || !(initFlags & INIT_AMBISONICSEFFECT))
-            return FMOD_OK;
-
-        if (gNewHRTFWritten)
         {
-            iplHRTFRelease(&gHRTF[0]);
-            gHRTF[0] = iplHRTFRetain(gHRTF[1]);
-
-            gNewHRTFWritten = false;
+            effect->perf.countInitFailure();
+            return FMOD_OK;
         }
 
-        if (gNewReverbSourceWritten)
-        {
-            iplSourceRelease(&gReverbSource[0]);
-            gReverbSource[0] = iplSourceRetain(gReverbSource[1]);
+        effect->perf.countHRTFChange(renderState->hrtf);
 
-            gNewReverbSourceWritten = false;
-        }
-
-        if (!gReverbSource[0])
+        if (!renderState->reverbSource)
             return FMOD_OK;
 
+        const auto& simulationSettings = renderState->simulationSettings;
+
         auto listenerCoordinates = calcListenerCoordinates(state);
 
-        iplAudioBufferDeinterleave(gContext, in, &effect->inBuffer);
-        iplAudioBufferDownmix(gContext, &effect->inBuffer, &effect->monoBuffer);
+        deinterleaveDownmix(in, numChannelsIn, static_cast<int>(frameSize), nullptr, effect->monoBuffer.data[0]);
 
         IPLSimulationOutputs reverbOutputs{};
-        iplSourceGetOutputs(gReverbSource[0], IPL_SIMULATIONFLAGS_REFLECTIONS, &reverbOutputs);
+        iplSourceGetOutputs(renderState->reverbSource, IPL_SIMULATIONFLAGS_REFLECTIONS, &reverbOutputs);
 
         IPLReflectionEffectParams reflectionParams = reverbOutputs.reflections;
-        reflectionParams.type = gSimulationSettings.reflectionType;
-        reflectionParams.numChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
-        reflectionParams.irSize = numSamplesForDuration(gSimulationSettings.maxDuration, samplingRate);
-        reflectionParams.tanDevice = gSimulationSettings.tanDevice;
+        reflectionParams.type = simulationSettings.reflectionType;
+        reflectionParams.numChannels = numChannelsForOrder(simulationSettings.maxOrder);
+        reflectionParams.irSize = numSamplesForDuration(simulationSettings.maxDuration, samplingRate);
+        reflectionParams.tanDevice = simulationSettings.tanDevice;
 
-        if (gNewReflectionMixerWritten)
         {
-            iplReflectionMixerRelease(&gReflectionMixer[0]);
-            gReflectionMixer[0] = iplReflectionMixerRetain(gReflectionMixer[1]);
-
-            gNewReflectionMixerWritten = false;
+            PerfTimer timer(effect->perf, PERFSTAGE_REFLECTIONS);
+            iplReflectionEffectApply(effect->reflectionEffect, &reflectionParams, &effect->monoBuffer, &effect->reflectionsBuffer, renderState->reflectionMixer);
         }
 
-        iplReflectionEffectApply(effect->reflectionEffect, &reflectionParams, &effect->monoBuffer, &effect->reflectionsBuffer, gReflectionMixer[0]);
-
-        if (gSimulationSettings.reflectionType != IPL_REFLECTIONEFFECTTYPE_TAN && !gReflectionMixer[0])
+        if (simulationSettings.reflectionType != IPL_REFLECTIONEFFECTTYPE_TAN && !renderState->reflectionMixer)
         {
+            PerfTimer timer(effect->perf, PERFSTAGE_DECODE);
+
             IPLAmbisonicsDecodeEffectParams ambisonicsParams;
-            ambisonicsParams.order = gSimulationSettings.maxOrder;
-            ambisonicsParams.hrtf = gHRTF[0];
+            ambisonicsParams.order = simulationSettings.maxOrder;
+            ambisonicsParams.hrtf = renderState->hrtf;
             ambisonicsParams.orientation = listenerCoordinates;
             ambisonicsParams.binaural = (effect->binaural) ? IPL_TRUE : IPL_FALSE;
 
@@ -347,7 +356,7 @@ FMOD_DSP_DESCRIPTION gReverbEffect
     nullptr,
     nullptr,
     nullptr,
-    nullptr
+    systemMix
 };
 
 }
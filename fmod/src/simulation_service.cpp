@@ -0,0 +1,484 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <algorithm>
+#include <chrono>
+
+#include "steamaudio_fmod.h"
+#include "simulation_service.h"
+
+namespace SteamAudioFMOD {
+
+extern std::shared_ptr<SourceManager> gSourceManager;
+
+// --------------------------------------------------------------------------------------------------------------------
+// SimulationService
+// --------------------------------------------------------------------------------------------------------------------
+
+SimulationService gSimulationService;
+
+static uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+SimulationService::SimulationService()
+    : mContext(nullptr)
+    , mSimulator(nullptr)
+    , mScene(nullptr)
+    , mSimulationSettings{}
+    , mSharedInputs{}
+    , mUpdateInterval(0.0f)
+    , mTimeSinceUpdate(0.0f)
+    , mReverbSource(nullptr)
+    , mReverbInputs{}
+    , mSceneCommitRequested(false)
+    , mRunning(false)
+    , mStopRequested(false)
+    , mIndirectRequested(false)
+    , mIndirectInProgress(false)
+    , mNumTicks(0)
+    , mNumIndirectUpdates(0)
+    , mNumSkippedIndirectUpdates(0)
+    , mDirectTime(0)
+    , mReflectionsTime(0)
+    , mPathingTime(0)
+{}
+
+SimulationService::~SimulationService()
+{
+    stop();
+}
+
+bool SimulationService::isRunning() const
+{
+    return mRunning;
+}
+
+IPLerror SimulationService::start(IPLContext context,
+                                  const SimulationServiceSettings& settings)
+{
+    if (mRunning || !context)
+        return IPL_STATUS_FAILURE;
+
+    auto simulationSettings = settings.simulationSettings;
+
+    IPLSimulator simulator = nullptr;
+    auto status = iplSimulatorCreate(context, &simulationSettings, &simulator);
+    if (status != IPL_STATUS_SUCCESS)
+        return status;
+
+    mContext = iplContextRetain(context);
+    mSimulator = simulator;
+    mScene = iplSceneRetain(settings.scene);
+    mSimulationSettings = simulationSettings;
+    mSharedInputs = settings.sharedInputs;
+    mUpdateInterval = std::max(settings.updateInterval, 0.0f);
+
+    // Run reflections and pathing on the first tick.
+    mTimeSinceUpdate = mUpdateInterval;
+
+    if (mScene)
+    {
+        iplSimulatorSetScene(mSimulator, mScene);
+    }
+
+    for (auto i = 0; i < settings.numProbeBatches; ++i)
+    {
+        if (!settings.probeBatches[i])
+            continue;
+
+        mProbeBatches.push_back(iplProbeBatchRetain(settings.probeBatches[i]));
+        iplSimulatorAddProbeBatch(mSimulator, settings.probeBatches[i]);
+    }
+
+    if (settings.simulateReverb && (simulationSettings.flags & IPL_SIMULATIONFLAGS_REFLECTIONS))
+    {
+        IPLSourceSettings sourceSettings{};
+        sourceSettings.flags = IPL_SIMULATIONFLAGS_REFLECTIONS;
+
+        if (iplSourceCreate(mSimulator, &sourceSettings, &mReverbSource) == IPL_STATUS_SUCCESS)
+        {
+            iplSourceAdd(mReverbSource, mSimulator);
+
+            mReverbInputs = IPLSimulationInputs{};
+            mReverbInputs.flags = IPL_SIMULATIONFLAGS_REFLECTIONS;
+            mReverbInputs.reverbScale[0] = 1.0f;
+            mReverbInputs.reverbScale[1] = 1.0f;
+            mReverbInputs.reverbScale[2] = 1.0f;
+            mReverbInputs.hybridReverbTransitionTime = 1.0f;
+            mReverbInputs.hybridReverbOverlapPercent = 0.25f;
+
+            gRenderStateManager.setReverbSource(mReverbSource);
+        }
+    }
+
+    iplSimulatorCommit(mSimulator);
+
+    mNumTicks = 0;
+    mNumIndirectUpdates = 0;
+    mNumSkippedIndirectUpdates = 0;
+    mDirectTime = 0;
+    mReflectionsTime = 0;
+    mPathingTime = 0;
+
+    mSceneCommitRequested = true;
+    mIndirectRequested = false;
+    mIndirectInProgress = false;
+    mStopRequested = false;
+    mThread = std::thread(&SimulationService::threadProc, this);
+    mRunning = true;
+
+    return IPL_STATUS_SUCCESS;
+}
+
+void SimulationService::stop()
+{
+    if (!mRunning)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mStopRequested = true;
+    }
+
+    mCondition.notify_one();
+    mThread.join();
+    mRunning = false;
+
+    if (mReverbSource)
+    {
+        gRenderStateManager.setReverbSource(nullptr);
+
+        iplSourceRemove(mReverbSource, mSimulator);
+        iplSourceRelease(&mReverbSource);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (auto& entry : mSources)
+        {
+            auto& source = *entry.second;
+
+            if (!source.isRemoved && gSourceManager)
+            {
+                gSourceManager->removeSource(entry.first);
+            }
+
+            if (source.isInSimulator)
+            {
+                iplSourceRemove(source.source, mSimulator);
+            }
+
+            iplSourceRelease(&source.source);
+        }
+
+        mSources.clear();
+    }
+
+    mSimulatedSources.clear();
+
+    for (auto& probeBatch : mProbeBatches)
+    {
+        iplSimulatorRemoveProbeBatch(mSimulator, probeBatch);
+        iplProbeBatchRelease(&probeBatch);
+    }
+
+    mProbeBatches.clear();
+
+    iplSimulatorRelease(&mSimulator);
+    iplSceneRelease(&mScene);
+    iplContextRelease(&mContext);
+}
+
+int32_t SimulationService::addSource(IPLSimulationFlags flags)
+{
+    if (!mRunning || !gSourceManager)
+        return -1;
+
+    IPLSourceSettings sourceSettings{};
+    sourceSettings.flags = flags;
+
+    IPLSource iplSource = nullptr;
+    if (iplSourceCreate(mSimulator, &sourceSettings, &iplSource) != IPL_STATUS_SUCCESS)
+        return -1;
+
+    auto handle = gSourceManager->addSource(iplSource);
+    if (handle < 0)
+    {
+        iplSourceRelease(&iplSource);
+        return -1;
+    }
+
+    std::unique_ptr<Source> source(new Source{});
+    source->source = iplSource;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSources[handle] = std::move(source);
+
+    return handle;
+}
+
+void SimulationService::removeSource(int32_t handle)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mSources.find(handle);
+    if (it == mSources.end() || it->second->isRemoved)
+        return;
+
+    // The source stays in the simulator until the next commit, but spatializers stop using it right away.
+    it->second->isRemoved = true;
+
+    if (gSourceManager)
+    {
+        gSourceManager->removeSource(handle);
+    }
+}
+
+void SimulationService::setSourceInputs(int32_t handle,
+                                        const IPLSimulationInputs& inputs)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mSources.find(handle);
+    if (it == mSources.end() || it->second->isRemoved)
+        return;
+
+    it->second->pendingInputs = inputs;
+    it->second->hasPendingInputs = true;
+}
+
+void SimulationService::commitScene()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSceneCommitRequested = true;
+}
+
+void SimulationService::tick(const IPLCoordinateSpace3& listener,
+                             float deltaTime)
+{
+    if (!mRunning)
+        return;
+
+    mNumTicks.fetch_add(1, std::memory_order_relaxed);
+
+    if (!mIndirectInProgress.load(std::memory_order_acquire))
+    {
+        commit();
+    }
+
+    // Adopt the latest inputs, so that setSourceInputs doesn't have to wait for simulation.
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mSimulatedSources.clear();
+
+        for (auto& entry : mSources)
+        {
+            auto& source = *entry.second;
+
+            if (source.hasPendingInputs)
+            {
+                source.inputs = source.pendingInputs;
+                source.hasInputs = true;
+                source.hasPendingInputs = false;
+            }
+
+            if (source.isInSimulator && source.hasInputs && !source.isRemoved)
+            {
+                mSimulatedSources.push_back(&source);
+            }
+        }
+    }
+
+    auto sharedInputs = mSharedInputs;
+    sharedInputs.listener = listener;
+
+    if (mSimulationSettings.flags & IPL_SIMULATIONFLAGS_DIRECT)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        iplSimulatorSetSharedInputs(mSimulator, IPL_SIMULATIONFLAGS_DIRECT, &sharedInputs);
+
+        for (auto source : mSimulatedSources)
+        {
+            if (source->inputs.flags & IPL_SIMULATIONFLAGS_DIRECT)
+            {
+                iplSourceSetInputs(source->source, IPL_SIMULATIONFLAGS_DIRECT, &source->inputs);
+            }
+        }
+
+        iplSimulatorRunDirect(mSimulator);
+
+        mDirectTime.fetch_add(nanosecondsSince(start), std::memory_order_relaxed);
+    }
+
+    auto flags = indirectFlags();
+    if (!flags)
+        return;
+
+    mTimeSinceUpdate += deltaTime;
+    if (mTimeSinceUpdate < mUpdateInterval)
+        return;
+
+    if (mIndirectInProgress.load(std::memory_order_acquire))
+    {
+        mNumSkippedIndirectUpdates.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    mTimeSinceUpdate = 0.0f;
+
+    iplSimulatorSetSharedInputs(mSimulator, flags, &sharedInputs);
+
+    for (auto source : mSimulatedSources)
+    {
+        if (source->inputs.flags & flags)
+        {
+            iplSourceSetInputs(source->source, flags, &source->inputs);
+        }
+    }
+
+    if (mReverbSource)
+    {
+        mReverbInputs.source = listener;
+        iplSourceSetInputs(mReverbSource, IPL_SIMULATIONFLAGS_REFLECTIONS, &mReverbInputs);
+    }
+
+    if (mSimulationSettings.sceneType == IPL_SCENETYPE_CUSTOM)
+    {
+        runIndirect();
+    }
+    else
+    {
+        mIndirectInProgress.store(true, std::memory_order_release);
+
+        {
+            std::lock_guard<std::mutex> lock(mThreadMutex);
+            mIndirectRequested = true;
+        }
+
+        mCondition.notify_one();
+    }
+}
+
+void SimulationService::getStats(SimulationServiceStats& stats) const
+{
+    stats.numTicks = mNumTicks.load(std::memory_order_relaxed);
+    stats.numIndirectUpdates = mNumIndirectUpdates.load(std::memory_order_relaxed);
+    stats.numSkippedIndirectUpdates = mNumSkippedIndirectUpdates.load(std::memory_order_relaxed);
+    stats.directTime = mDirectTime.load(std::memory_order_relaxed);
+    stats.reflectionsTime = mReflectionsTime.load(std::memory_order_relaxed);
+    stats.pathingTime = mPathingTime.load(std::memory_order_relaxed);
+}
+
+IPLSimulationFlags SimulationService::indirectFlags() const
+{
+    return static_cast<IPLSimulationFlags>(mSimulationSettings.flags & (IPL_SIMULATIONFLAGS_REFLECTIONS | IPL_SIMULATIONFLAGS_PATHING));
+}
+
+void SimulationService::commit()
+{
+    std::vector<IPLSource> retiredSources;
+    auto simulatorChanged = false;
+    auto sceneChanged = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (auto it = mSources.begin(); it != mSources.end(); )
+        {
+            auto& source = *it->second;
+
+            if (source.isRemoved)
+            {
+                if (source.isInSimulator)
+                {
+                    iplSourceRemove(source.source, mSimulator);
+                    simulatorChanged = true;
+                }
+
+                retiredSources.push_back(source.source);
+                it = mSources.erase(it);
+            }
+            else
+            {
+                if (!source.isInSimulator)
+                {
+                    iplSourceAdd(source.source, mSimulator);
+                    source.isInSimulator = true;
+                    simulatorChanged = true;
+                }
+
+                ++it;
+            }
+        }
+
+        sceneChanged = mSceneCommitRequested;
+        mSceneCommitRequested = false;
+    }
+
+    if (sceneChanged && mScene)
+    {
+        iplSceneCommit(mScene);
+    }
+
+    if (simulatorChanged || sceneChanged)
+    {
+        iplSimulatorCommit(mSimulator);
+    }
+
+    // Sources are only released once the simulator no longer refers to them.
+    for (auto& source : retiredSources)
+    {
+        iplSourceRelease(&source);
+    }
+}
+
+void SimulationService::runIndirect()
+{
+    auto flags = indirectFlags();
+
+    if (flags & IPL_SIMULATIONFLAGS_REFLECTIONS)
+    {
+        auto start = std::chrono::steady_clock::now();
+        iplSimulatorRunReflections(mSimulator);
+        mReflectionsTime.fetch_add(nanosecondsSince(start), std::memory_order_relaxed);
+    }
+
+    if (flags & IPL_SIMULATIONFLAGS_PATHING)
+    {
+        auto start = std::chrono::steady_clock::now();
+        iplSimulatorRunPathing(mSimulator);
+        mPathingTime.fetch_add(nanosecondsSince(start), std::memory_order_relaxed);
+    }
+
+    mNumIndirectUpdates.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SimulationService::threadProc()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mThreadMutex);
+            mCondition.wait(lock, [&]() { return mStopRequested || mIndirectRequested; });
+
+            if (mStopRequested)
+                break;
+
+            mIndirectRequested = false;
+        }
+
+        runIndirect();
+
+        mIndirectInProgress.store(false, std::memory_order_release);
+    }
+}
+
+}
@@ -0,0 +1,162 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <phonon.h>
+
+namespace SteamAudioFMOD {
+
+// --------------------------------------------------------------------------------------------------------------------
+// SimulationService
+// --------------------------------------------------------------------------------------------------------------------
+
+// Settings for SimulationService::start.
+struct SimulationServiceSettings
+{
+    IPLSimulationSettings simulationSettings;
+    IPLScene scene;
+    IPLProbeBatch* probeBatches;
+    int numProbeBatches;
+    IPLSimulationSharedInputs sharedInputs;     // The listener is ignored, and set on every tick instead.
+    float updateInterval;                       // Minimum time between reflections and pathing simulations, in seconds.
+    bool simulateReverb;
+};
+
+// Cumulative counters for SimulationService. Times are in nanoseconds.
+struct SimulationServiceStats
+{
+    uint64_t numTicks;
+    uint64_t numIndirectUpdates;
+    uint64_t numSkippedIndirectUpdates;
+    uint64_t directTime;
+    uint64_t reflectionsTime;
+    uint64_t pathingTime;
+};
+
+// Runs simulation on behalf of games that use FMOD without a game engine integration.
+//
+// The service owns a simulator and the sources it simulates. Sources are registered with gSourceManager as they are
+// added, so their handles can be passed to the SIMULATION_OUTPUTS_HANDLE parameter of the Steam Audio Spatializer,
+// which reads simulation outputs directly from the source. Inputs for a source may be set at any time, from any
+// thread. They are held until the next call to tick(), which is expected to be made once per game frame.
+//
+// Each tick runs direct simulation on the calling thread, with the latest inputs. Reflections and pathing are run on a
+// worker thread, at most once every updateInterval seconds, and overlap with the game's subsequent frames. While they
+// are running, the next update is skipped rather than waited for, and sources added or removed in the meantime, along
+// with scene changes, are only committed once the worker is idle. If the scene uses custom ray tracing callbacks,
+// reflections and pathing are run on the calling thread instead, since the callbacks are likely not thread-safe.
+//
+// Apart from setSourceInputs and getStats, all functions must be called from the same thread. None are real-time safe.
+class SimulationService
+{
+public:
+    SimulationService();
+    ~SimulationService();
+
+    bool isRunning() const;
+
+    // Creates the simulator and starts the worker thread. Fails if the service is already running.
+    IPLerror start(IPLContext context,
+                   const SimulationServiceSettings& settings);
+
+    // Waits for any simulation in progress, and releases the simulator and all sources.
+    void stop();
+
+    // Creates a source that will be simulated from the next tick on, and returns its handle, or -1 on failure.
+    int32_t addSource(IPLSimulationFlags flags);
+
+    // Stops simulating a source. Its handle becomes invalid immediately.
+    void removeSource(int32_t handle);
+
+    // Sets the inputs used to simulate a source, from the next tick on.
+    void setSourceInputs(int32_t handle,
+                         const IPLSimulationInputs& inputs);
+
+    // Requests that the scene be committed before it is next simulated, after geometry has changed.
+    void commitScene();
+
+    // Runs one step of simulation for the given listener. deltaTime is the time since the previous tick, in seconds.
+    void tick(const IPLCoordinateSpace3& listener,
+              float deltaTime);
+
+    void getStats(SimulationServiceStats& stats) const;
+
+private:
+    struct Source
+    {
+        IPLSource source;
+
+        // Written by setSourceInputs while holding mMutex, and copied to inputs at the start of each tick.
+        IPLSimulationInputs pendingInputs;
+        bool hasPendingInputs;
+
+        // Only accessed by tick().
+        IPLSimulationInputs inputs;
+        bool hasInputs;
+        bool isInSimulator;
+
+        // Set by removeSource, while holding mMutex.
+        bool isRemoved;
+    };
+
+    IPLContext mContext;
+    IPLSimulator mSimulator;
+    IPLScene mScene;
+    std::vector<IPLProbeBatch> mProbeBatches;
+    IPLSimulationSettings mSimulationSettings;
+    IPLSimulationSharedInputs mSharedInputs;
+    float mUpdateInterval;
+    float mTimeSinceUpdate;
+
+    IPLSource mReverbSource;
+    IPLSimulationInputs mReverbInputs;
+
+    // Guards mSources, and the fields of each source that are written outside of tick().
+    mutable std::mutex mMutex;
+    std::unordered_map<int32_t, std::unique_ptr<Source>> mSources;
+    bool mSceneCommitRequested;
+
+    // Sources that are in the simulator, and have inputs. Rebuilt, and only accessed, by tick().
+    std::vector<Source*> mSimulatedSources;
+
+    std::thread mThread;
+    std::mutex mThreadMutex;
+    std::condition_variable mCondition;
+    bool mRunning;
+    bool mStopRequested;
+    bool mIndirectRequested;
+    std::atomic<bool> mIndirectInProgress;
+
+    std::atomic<uint64_t> mNumTicks;
+    std::atomic<uint64_t> mNumIndirectUpdates;
+    std::atomic<uint64_t> mNumSkippedIndirectUpdates;
+    std::atomic<uint64_t> mDirectTime;
+    std::atomic<uint64_t> mReflectionsTime;
+    std::atomic<uint64_t> mPathingTime;
+
+    IPLSimulationFlags indirectFlags() const;
+
+    // Applies source additions and removals, and scene changes, to the simulator. Must only be called while the worker
+    // is idle.
+    void commit();
+
+    void runIndirect();
+    void threadProc();
+};
+
+extern SimulationService gSimulationService;
+
+}
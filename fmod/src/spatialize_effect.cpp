@@ -8,12 +8,24 @@
 
 #include <algorithm>
 #include <atomic>
+#include <limits>
 
 #include "steamaudio_fmod.h"
+#include "audio_kernels.h"
+#include "dsp_registry.h"
+#include "effect_builder.h"
+#include "effect_pool.h"
+#include "frame_fifo.h"
+#include "perf_stats.h"
+#include "reflection_budget.h"
+#include "rt_audit.h"
+#include "scratch_arena.h"
+#include "spatializer_group.h"
 
 namespace SteamAudioFMOD {
 
 extern std::shared_ptr<SourceManager> gSourceManager;
+extern std::atomic<float> gSilenceThreshold;
 
 namespace SpatializeEffect {
 
@@ -360,10 +372,73 @@ enum Params
      *  **Type**: `FMOD_DSP_PARAMETER_TYPE_INT`
      * 
      *  Handle of the `IPLSource` object to use for obtaining simulation results. The handle can
-     *  be obtained by calling `iplFMODAddSource`.
+     *  be obtained by calling `iplFMODAddSource`. Parameters sent for this handle using `iplFMODUpdateSources` override
+     *  the corresponding parameters of this effect.
      */
     SIMULATION_OUTPUTS_HANDLE,
 
+    /**
+     *  **Type**: `FMOD_DSP_PARAMETER_TYPE_INT`
+     *
+     *  Index of the spatializer group that renders this event, or -1 to render it individually. Events in a group are
+     *  downmixed to mono and handed to the Steam Audio Spatializer Group effect with the same group index, which renders
+     *  all of them in a single pass. This significantly reduces the CPU cost of scenes with many simultaneous events.
+     *  Distance attenuation, air absorption, directivity, occlusion, and transmission are applied as usual. The group
+     *  only renders direct sound, so events with APPLY_REFLECTIONS or APPLY_PATHING enabled are rendered individually.
+     *  If no Spatializer Group effect is rendering the group, the event is also rendered individually.
+     */
+    SPATIALIZER_GROUP,
+
+    /**
+     *  **Type**: `FMOD_DSP_PARAMETER_TYPE_INT`
+     *
+     *  **Range**: 0 to 4096.
+     *
+     *  Number of samples that Steam Audio processes at a time, or 0 to use the mixer's block size. Larger frames reduce
+     *  the cost of convolution, but blocks of audio are buffered until a full frame is available, which adds latency.
+     *  Partial or irregularly sized blocks from the mixer are also buffered. Only takes effect if set before the event
+     *  starts playing. When reflections are rendered using the Steam Audio Mixer Return effect, reflections are not
+     *  rendered for events whose frame size differs from the mixer's block size.
+     */
+    FRAME_SIZE,
+
+    /**
+     *  **Type**: `FMOD_DSP_PARAMETER_TYPE_INT`
+     *
+     *  **Range**: 0 to 4096.
+     *
+     *  Read-only. Number of samples by which the output of this effect currently lags its input, due to the buffering
+     *  described under \c FRAME_SIZE. This is 0 if the frame size divides the mixer's block size.
+     */
+    LATENCY,
+
+    /**
+     *  **Type**: `FMOD_DSP_PARAMETER_TYPE_INT`
+     *
+     *  **Range**: -1 to 7.
+     *
+     *  Which of FMOD's listeners to render this event for, when the game uses more than one listener, for example for
+     *  split-screen or spectators.
+     *
+     *  -   `-1`: Render the event once for every listener, and mix the results, weighted by the listener weights that
+     *           FMOD Studio provides along with the source position. Each listener has its own direct path, HRTF, and
+     *           Ambisonics decoding state, while simulation outputs and the convolution of reflections are shared. The
+     *           overall gain is reported for the closest listener. Events that are mixed for more than one listener
+     *           are rendered individually, even if they belong to a spatializer group.
+     *  -   `0` to `7`: Render the event only for the listener with this index. If there are not that many listeners,
+     *           listener 0 is used.
+     */
+    LISTENER,
+
+    /**
+     *  **Type**: `FMOD_DSP_PARAMETER_TYPE_DATA`
+     *
+     *  World-space position of the source, along with its position relative to each listener, and each listener's
+     *  weight. Automatically written by FMOD Studio. Once this has been written, it is used instead of
+     *  \c SOURCE_POSITION. Until then, all listeners are weighted equally when \c LISTENER is `-1`.
+     */
+    SOURCE_POSITION_MULTI,
+
     /** The number of parameters in this effect. */
     NUM_PARAMS
 };
@@ -403,6 +478,11 @@ FMOD_DSP_PARAMETER_DESC gParams[] = {
     { FMOD_DSP_PARAMETER_TYPE_BOOL, "DirectBinaural", "", "Apply HRTF to direct path." },
     { FMOD_DSP_PARAMETER_TYPE_DATA, "DistRange", "", "Distance attenuation range." },
     { FMOD_DSP_PARAMETER_TYPE_INT, "SimOutHandle", "", "Simulation outputs handle." },
+    { FMOD_DSP_PARAMETER_TYPE_INT, "Group", "", "Spatializer group index." },
+    { FMOD_DSP_PARAMETER_TYPE_INT, "FrameSize", "", "Frame size, or 0 for the mixer block size." },
+    { FMOD_DSP_PARAMETER_TYPE_INT, "Latency", "", "Latency due to frame buffering." },
+    { FMOD_DSP_PARAMETER_TYPE_INT, "Listener", "", "Listener to render for, or -1 for all listeners." },
+    { FMOD_DSP_PARAMETER_TYPE_DATA, "SourcePosMulti", "", "Position of the source relative to each listener." },
 };
 
 FMOD_DSP_PARAMETER_DESC* gParamsArray[NUM_PARAMS];
@@ -412,6 +492,7 @@ const char* gDistanceAttenuationTypeValues[] = {"Off", "Physics-Based", "Curve-D
 const char* gHRTFInterpolationValues[] = {"Nearest", "Bilinear"};
 const char* gTransmissionTypeValues[] = {"Frequency Independent", "Frequency Dependent"};
 const char* gRolloffTypeValues[] = {"Linear Squared", "Linear", "Inverse", "Inverse Squared", "Custom"};
+const char* gListenerValues[] = {"All", "0", "1", "2", "3", "4", "5", "6", "7"};
 
 void initParamDescs()
 {
@@ -453,12 +534,95 @@ void initParamDescs()
     gParams[SIMULATION_OUTPUTS].datadesc = {FMOD_DSP_PARAMETER_DATA_TYPE_USER};
     gParams[DIRECT_BINAURAL].booldesc = {true};
     gParams[DISTANCE_ATTENUATION_RANGE].datadesc = {FMOD_DSP_PARAMETER_DATA_TYPE_ATTENUATION_RANGE};
-    gParams[SIMULATION_OUTPUTS_HANDLE].intdesc = {-1, 10000, -1};
+    gParams[SIMULATION_OUTPUTS_HANDLE].intdesc = {-1, SourceManager::kMaxHandle, -1};
+    gParams[SPATIALIZER_GROUP].intdesc = {-1, kMaxSpatializerGroups - 1, -1};
+    gParams[FRAME_SIZE].intdesc = {0, FrameFIFO::kMaxFrameSize, 0};
+    gParams[LATENCY].intdesc = {0, FrameFIFO::kMaxFrameSize, 0};
+    gParams[LISTENER].intdesc = {-1, FMOD_MAX_LISTENERS - 1, 0, false, gListenerValues};
+    gParams[SOURCE_POSITION_MULTI].datadesc = {FMOD_DSP_PARAMETER_DATA_TYPE_3DATTRIBUTES_MULTI};
+}
+
+enum InitFlags
+{
+    INIT_NONE = 0,
+    INIT_DIRECTAUDIOBUFFERS = 1 << 0,
+    INIT_REFLECTIONAUDIOBUFFERS = 1 << 1,
+    INIT_DIRECTEFFECT = 1 << 2,
+    INIT_BINAURALEFFECT = 1 << 3,
+    INIT_REFLECTIONEFFECT = 1 << 4,
+    INIT_PATHEFFECT = 1 << 5,
+    INIT_AMBISONICSEFFECT = 1 << 6,
+    INIT_FRAMEFIFO = 1 << 7
+};
+
+// The effect objects that render an event for one listener. Simulation outputs and the convolution of reflections
+// don't depend on the listener, so they are shared, but everything that depends on the listener's position or
+// orientation is rendered separately for each listener.
+struct ListenerEffects
+{
+    IPLPanningEffect panningEffect;
+    IPLBinauralEffect binauralEffect;
+    IPLDirectEffect directEffect;
+    IPLPathEffect pathEffect;
+    IPLAmbisonicsDecodeEffect ambisonicsEffect;
+
+    // When the HRTF changes, binauralEffect finishes the block with the old HRTF while this effect starts rendering with
+    // the new one, and the two are crossfaded. The effects then swap roles.
+    IPLBinauralEffect crossfadeBinauralEffect;
+};
+
+void releaseListenerEffects(ListenerEffects& effects)
+{
+    gEffectPool.release(&effects.panningEffect);
+    gEffectPool.release(&effects.binauralEffect);
+    gEffectPool.release(&effects.crossfadeBinauralEffect);
+    gEffectPool.release(&effects.directEffect);
+    gEffectPool.release(&effects.pathEffect);
+    gEffectPool.release(&effects.ambisonicsEffect);
 }
 
+// Clears the audio that the effects have buffered, for when they start rendering for a listener again.
+void resetListenerEffects(ListenerEffects& effects)
+{
+    if (effects.panningEffect)
+        iplPanningEffectReset(effects.panningEffect);
+    if (effects.binauralEffect)
+        iplBinauralEffectReset(effects.binauralEffect);
+    if (effects.directEffect)
+        iplDirectEffectReset(effects.directEffect);
+    if (effects.pathEffect)
+        iplPathEffectReset(effects.pathEffect);
+    if (effects.ambisonicsEffect)
+        iplAmbisonicsDecodeEffectReset(effects.ambisonicsEffect);
+}
+
+// Renders an event for one listener. Path 0 renders for the listener selected via LISTENER. When LISTENER is -1, path i
+// renders for FMOD's listener i.
+struct ListenerPath
+{
+    ListenerEffects effects;
+
+    // The HRTF that binauralEffect rendered the previous block with. Only used for comparison, so not retained.
+    IPLHRTF binauralHRTF;
+
+    // True if this path was rendered in the previous block. A path that starts rendering again is reset first, so it
+    // doesn't play the tail of what it rendered the last time it was used. If other paths were already rendering, it
+    // also fades in from silence.
+    bool active;
+
+    // The weight that this path's output was mixed with at the end of the previous frame.
+    float prevWeight;
+
+    // The listener that this path last rendered for, so the path can fade out after its listener has been removed.
+    IPLCoordinateSpace3 listener;
+};
+
+class BuildJob;
+
 struct State
 {
-    FMOD_DSP_PARAMETER_3DATTRIBUTES source;
+    FMOD_DSP_PARAMETER_3DATTRIBUTES_MULTI source;
+    bool sourceMultiWritten;
     FMOD_DSP_PARAMETER_OVERALLGAIN overallGain;
     ParameterApplyType applyDistanceAttenuation;
     ParameterApplyType applyAirAbsorption;
@@ -491,10 +655,62 @@ struct State
     IPLSource simulationSource[2];
     std::atomic<bool> newSimulationSourceWritten;
 
+    // The handle last set via SIMULATION_OUTPUTS_HANDLE, used to look up parameters sent via iplFMODUpdateSources.
+    std::atomic<int32_t> simulationOutputsHandle;
+
+    // Outputs of simulationSource[0], fetched once at the start of each process() call.
+    IPLSimulationOutputs simulationOutputs;
+
+    // Incremented whenever a parameter that affects the direct path parameters is set.
+    std::atomic<uint32_t> paramsVersion;
+
+    // Direct path parameters calculated during the previous process() call, along with everything they were calculated
+    // from. If none of these have changed, the cached parameters are reused.
+    bool directParamsValid;
+    uint32_t directParamsVersion;
+    IPLSource directParamsSource;
+    IPLCoordinateSpace3 directParamsSourceCoordinates;
+    IPLVector3 directParamsListenerPosition;
+    IPLDirectEffectParams directParamsSimulated;
+    IPLDirectEffectParams directParams;
+
+    // Upper bound on the gain due to occlusion and transmission, updated along with the cached direct path parameters.
+    // Used to estimate the overall gain of idle effects without fetching simulation outputs.
+    float occlusionGainBound;
+    int numIdleQueries;
+
+    // This effect's slot in the reflection budget, the level of detail at which reflections were last rendered, and
+    // the gain at which they were last rendered, which is 0 while the budget has left this effect without reflections.
+    int reflectionBudgetSource;
+    ReflectionLOD reflectionsLOD;
+    float prevReflectionsLODGain;
+
+    PerfCounters perf;
+
     float prevDirectMixLevel;
     float prevReflectionsMixLevel;
     float prevPathingMixLevel;
 
+    // The requested spatializer group index, and the group and voice slot this effect is currently registered with.
+    // Only the requested index is written outside of process().
+    std::atomic<int> spatializerGroup;
+    SpatializerGroup* group;
+    int groupVoice;
+
+    // The frame size set via FRAME_SIZE, and the frame size Steam Audio effects are actually created with, which is
+    // fixed the first time process() is called. Until then, frameSize is 0.
+    std::atomic<int> requestedFrameSize;
+    int frameSize;
+
+    // Adapts the mixer's blocks to frames of frameSize samples. The latency it adds is copied to latency after every
+    // process() call, so it can be read via LATENCY.
+    FrameFIFO* frameFIFO;
+    std::atomic<int> latency;
+
+    // The listener set via LISTENER, or -1 to render for all listeners.
+    std::atomic<int> listener;
+
+    // Temporary buffers, borrowed from the mixer thread's scratch arena. Only valid during process().
     IPLAudioBuffer inBuffer;
     IPLAudioBuffer outBuffer;
     IPLAudioBuffer directBuffer;
@@ -502,173 +718,326 @@ struct State
     IPLAudioBuffer reflectionsBuffer;
     IPLAudioBuffer reflectionsSpatializedBuffer;
 
-    IPLPanningEffect panningEffect;
-    IPLBinauralEffect binauralEffect;
-    IPLDirectEffect directEffect;
+    ListenerPath listenerPaths[FMOD_MAX_LISTENERS];
+
+    // Reflections are convolved once, and the result is decoded separately for each listener.
     IPLReflectionEffect reflectionEffect;
-    IPLPathEffect pathEffect;
-    IPLAmbisonicsDecodeEffect ambisonicsEffect;
-};
 
-enum InitFlags
-{
-    INIT_NONE = 0,
-    INIT_DIRECTAUDIOBUFFERS = 1 << 0,
-    INIT_REFLECTIONAUDIOBUFFERS = 1 << 1,
-    INIT_DIRECTEFFECT = 1 << 2,
-    INIT_BINAURALEFFECT = 1 << 3,
-    INIT_REFLECTIONEFFECT = 1 << 4,
-    INIT_PATHEFFECT = 1 << 5,
-    INIT_AMBISONICSEFFECT = 1 << 6
+    // Used to create the effect objects above without blocking the audio thread.
+    BuildJob* buildJob;
 };
 
-InitFlags lazyInit(FMOD_DSP_STATE* state,
-                   int numChannelsIn,
-                   int numChannelsOut)
+// Creates effect objects for a spatializer instance on the effect builder's worker thread.
+class BuildJob : public EffectBuildJob
 {
-    auto initFlags = INIT_NONE;
-
+public:
+    // Inputs, written on the audio thread before the job is submitted.
+    IPLContext context;
     IPLAudioSettings audioSettings;
-    state->functions->getsamplerate(state, &audioSettings.samplingRate);
-    state->functions->getblocksize(state, reinterpret_cast<unsigned int*>(&audioSettings.frameSize));
-
-    if (!gContext && isRunningInEditor())
+    int blockSize;
+    int numChannelsIn;
+    int numChannelsOut;
+    IPLHRTF hrtf;
+    IPLSimulationSettings simulationSettings;
+    InitFlags requested;
+    InitFlags requestedListenerEffects[FMOD_MAX_LISTENERS];
+
+    // Outputs, read on the audio thread once the job is ready.
+    ListenerEffects listenerEffects[FMOD_MAX_LISTENERS];
+    IPLReflectionEffect reflectionEffect;
+    FrameFIFO* frameFIFO;
+
+    BuildJob()
+        : context(nullptr)
+        , audioSettings{}
+        , blockSize(0)
+        , numChannelsIn(0)
+        , numChannelsOut(0)
+        , hrtf(nullptr)
+        , simulationSettings{}
+        , requested(INIT_NONE)
+        , requestedListenerEffects{}
+        , listenerEffects{}
+        , reflectionEffect(nullptr)
+        , frameFIFO(nullptr)
+    {}
+
+    ~BuildJob() override
     {
-        initContextAndDefaultHRTF(audioSettings);
-    }
-
-    if (!gContext)
-        return initFlags;
+        iplHRTFRelease(&hrtf);
 
-    if (!gHRTF[1])
-        return initFlags;
+        delete frameFIFO;
 
-    auto effect = reinterpret_cast<State*>(state->plugindata);
+        for (auto& effects : listenerEffects)
+        {
+            releaseListenerEffects(effects);
+        }
 
-    auto status = IPL_STATUS_SUCCESS;
+        gEffectPool.release(&reflectionEffect);
+    }
 
-    if (numChannelsOut > 0)
+protected:
+    void build() override
     {
-        if (!effect->panningEffect)
+        for (auto i = 0; i < FMOD_MAX_LISTENERS; ++i)
         {
-            IPLPanningEffectSettings effectSettings{};
-            effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
-
-            status = iplPanningEffectCreate(gContext, &audioSettings, &effectSettings, &effect->panningEffect);
+            buildListenerEffects(requestedListenerEffects[i], listenerEffects[i]);
         }
 
-        if (status == IPL_STATUS_SUCCESS)
+        if (requested & INIT_REFLECTIONEFFECT)
         {
-            if (!effect->binauralEffect)
-            {
-                IPLBinauralEffectSettings effectSettings;
-                effectSettings.hrtf = gHRTF[1];
+            IPLReflectionEffectSettings effectSettings;
+            effectSettings.type = simulationSettings.reflectionType;
+            effectSettings.numChannels = numChannelsForOrder(simulationSettings.maxOrder);
+            effectSettings.irSize = numSamplesForDuration(simulationSettings.maxDuration, audioSettings.samplingRate);
 
-                status = iplBinauralEffectCreate(gContext, &audioSettings, &effectSettings, &effect->binauralEffect);
-            }
+            gEffectPool.acquire(context, &audioSettings, &effectSettings, &reflectionEffect);
         }
 
-        if (status == IPL_STATUS_SUCCESS)
-            initFlags = static_cast<InitFlags>(initFlags | INIT_BINAURALEFFECT);
+        if (requested & INIT_FRAMEFIFO)
+        {
+            frameFIFO = new FrameFIFO(numChannelsIn, numChannelsOut, audioSettings.frameSize, blockSize);
+        }
+
+        iplHRTFRelease(&hrtf);
     }
 
-    if (numChannelsIn > 0)
+private:
+    void buildListenerEffects(InitFlags flags,
+                              ListenerEffects& effects)
     {
-        status = IPL_STATUS_SUCCESS;
-        if (!effect->directEffect)
+        if (flags & INIT_BINAURALEFFECT)
+        {
+            IPLPanningEffectSettings panningSettings{};
+            panningSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
+
+            auto status = gEffectPool.acquire(context, &audioSettings, &panningSettings, &effects.panningEffect);
+
+            if (status == IPL_STATUS_SUCCESS)
+            {
+                IPLBinauralEffectSettings binauralSettings;
+                binauralSettings.hrtf = hrtf;
+
+                gEffectPool.acquire(context, &audioSettings, &binauralSettings, &effects.binauralEffect);
+                gEffectPool.acquire(context, &audioSettings, &binauralSettings, &effects.crossfadeBinauralEffect);
+            }
+        }
+
+        if (flags & INIT_DIRECTEFFECT)
         {
             IPLDirectEffectSettings effectSettings;
             effectSettings.numChannels = numChannelsIn;
 
-            status = iplDirectEffectCreate(gContext, &audioSettings, &effectSettings, &effect->directEffect);
+            gEffectPool.acquire(context, &audioSettings, &effectSettings, &effects.directEffect);
         }
 
-        if (status == IPL_STATUS_SUCCESS)
-            initFlags = static_cast<InitFlags>(initFlags | INIT_DIRECTEFFECT);
-    }
+        if (flags & INIT_PATHEFFECT)
+        {
+            IPLPathEffectSettings effectSettings{};
+            effectSettings.maxOrder = simulationSettings.maxOrder;
+            effectSettings.spatialize = IPL_TRUE;
+            effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
+            effectSettings.hrtf = hrtf;
 
-    if (effect->applyReflections && gIsSimulationSettingsValid)
-    {
-        status = IPL_STATUS_SUCCESS;
+            gEffectPool.acquire(context, &audioSettings, &effectSettings, &effects.pathEffect);
+        }
 
-        if (!effect->reflectionEffect)
+        if (flags & INIT_AMBISONICSEFFECT)
         {
-            IPLReflectionEffectSettings effectSettings;
-            effectSettings.type = gSimulationSettings.reflectionType;
-            effectSettings.numChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
-            effectSettings.irSize = numSamplesForDuration(gSimulationSettings.maxDuration, audioSettings.samplingRate);
+            IPLAmbisonicsDecodeEffectSettings effectSettings;
+            effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
+            effectSettings.hrtf = hrtf;
+            effectSettings.maxOrder = simulationSettings.maxOrder;
 
-            status = iplReflectionEffectCreate(gContext, &audioSettings, &effectSettings, &effect->reflectionEffect);
+            gEffectPool.acquire(context, &audioSettings, &effectSettings, &effects.ambisonicsEffect);
         }
-
-        if (status == IPL_STATUS_SUCCESS)
-            initFlags = static_cast<InitFlags>(initFlags | INIT_REFLECTIONEFFECT);
     }
+};
 
-    if (effect->applyPathing && gIsSimulationSettingsValid)
+// Moves an effect object out of a finished build job, unless the instance already has one.
+template <typename T>
+void adoptEffect(T& effect,
+                 T& builtEffect)
+{
+    if (!effect)
     {
-        status = IPL_STATUS_SUCCESS;
+        effect = builtEffect;
+        builtEffect = nullptr;
+    }
+}
 
-        if (!effect->pathEffect)
-        {
-            IPLPathEffectSettings effectSettings{};
-            effectSettings.maxOrder = gSimulationSettings.maxOrder;
-            effectSettings.spatialize = IPL_TRUE;
-            effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
-            effectSettings.hrtf = gHRTF[1];
+void adoptListenerEffects(ListenerEffects& effects,
+                          ListenerEffects& builtEffects)
+{
+    adoptEffect(effects.panningEffect, builtEffects.panningEffect);
+    adoptEffect(effects.binauralEffect, builtEffects.binauralEffect);
+    adoptEffect(effects.crossfadeBinauralEffect, builtEffects.crossfadeBinauralEffect);
+    adoptEffect(effects.directEffect, builtEffects.directEffect);
+    adoptEffect(effects.pathEffect, builtEffects.pathEffect);
+    adoptEffect(effects.ambisonicsEffect, builtEffects.ambisonicsEffect);
+}
 
-            status = iplPathEffectCreate(gContext, &audioSettings, &effectSettings, &effect->pathEffect);
-        }
+// Returns the per-listener effects that are ready for use, and adds those that are needed but missing to requested.
+InitFlags checkListenerEffects(const State* effect,
+                               const ListenerEffects& effects,
+                               const RenderState* renderState,
+                               int numChannelsIn,
+                               int numChannelsOut,
+                               InitFlags& requested)
+{
+    auto initFlags = INIT_NONE;
+
+    if (numChannelsOut > 0)
+    {
+        if (effects.panningEffect && effects.binauralEffect && effects.crossfadeBinauralEffect)
+            initFlags = static_cast<InitFlags>(initFlags | INIT_BINAURALEFFECT);
+        else
+            requested = static_cast<InitFlags>(requested | INIT_BINAURALEFFECT);
+    }
+
+    if (numChannelsIn > 0)
+    {
+        if (effects.directEffect)
+            initFlags = static_cast<InitFlags>(initFlags | INIT_DIRECTEFFECT);
+        else
+            requested = static_cast<InitFlags>(requested | INIT_DIRECTEFFECT);
+    }
 
-        if (status == IPL_STATUS_SUCCESS)
+    if (effect->applyPathing && renderState->isSimulationSettingsValid)
+    {
+        if (effects.pathEffect)
             initFlags = static_cast<InitFlags>(initFlags | INIT_PATHEFFECT);
+        else
+            requested = static_cast<InitFlags>(requested | INIT_PATHEFFECT);
     }
 
-    if (numChannelsOut > 0 && gIsSimulationSettingsValid)
+    if (numChannelsOut > 0 && renderState->isSimulationSettingsValid)
     {
-        status = IPL_STATUS_SUCCESS;
+        if (effects.ambisonicsEffect)
+            initFlags = static_cast<InitFlags>(initFlags | INIT_AMBISONICSEFFECT);
+        else
+            requested = static_cast<InitFlags>(requested | INIT_AMBISONICSEFFECT);
+    }
 
-        if (!effect->ambisonicsEffect)
-        {
-            IPLAmbisonicsDecodeEffectSettings effectSettings;
-            effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
-            effectSettings.hrtf = gHRTF[1];
-            effectSettings.maxOrder = gSimulationSettings.maxOrder;
+    return initFlags;
+}
+
+// Returns the effects and buffers that are ready for use by listener path 0. Any effects that are needed but have not
+// been created yet are requested from the effect builder, and become available in a later block. Never creates effects
+// on the calling thread, so it is safe to call from process().
+//
+// Effects are also requested for the other listener paths whose bits are set in listenerPaths. If listenerFlags is not
+// nullptr, the effects and buffers that are ready for use by each of these paths are written to it.
+InitFlags lazyInit(FMOD_DSP_STATE* state,
+                   const RenderState* renderState,
+                   int numChannelsIn,
+                   int numChannelsOut,
+                   uint32_t listenerPaths,
+                   InitFlags* listenerFlags)
+{
+    auto initFlags = INIT_NONE;
+
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    auto blockSize = 0u;
+    state->functions->getblocksize(state, &blockSize);
+
+    IPLAudioSettings audioSettings;
+    state->functions->getsamplerate(state, &audioSettings.samplingRate);
+    audioSettings.frameSize = (effect->frameSize > 0) ? effect->frameSize : static_cast<int>(blockSize);
+
+    if (!gContext)
+        return initFlags;
+
+    if (!renderState || !renderState->hrtf)
+        return initFlags;
+
+    auto job = effect->buildJob;
 
-            status = iplAmbisonicsDecodeEffectCreate(gContext, &audioSettings, &effectSettings, &effect->ambisonicsEffect);
+    if (job->isReady())
+    {
+        for (auto i = 0; i < FMOD_MAX_LISTENERS; ++i)
+        {
+            adoptListenerEffects(effect->listenerPaths[i].effects, job->listenerEffects[i]);
         }
 
-        if (status == IPL_STATUS_SUCCESS)
-            initFlags = static_cast<InitFlags>(initFlags | INIT_AMBISONICSEFFECT);
+        adoptEffect(effect->reflectionEffect, job->reflectionEffect);
+        adoptEffect(effect->frameFIFO, job->frameFIFO);
+
+        job->complete();
     }
 
-    if (numChannelsIn > 0 && numChannelsOut > 0)
+    auto requested = INIT_NONE;
+    InitFlags requestedListenerEffects[FMOD_MAX_LISTENERS] = {};
+    auto anyRequested = false;
+
+    // Path 0 is always kept ready, since it renders the event whenever a single listener is selected.
+    listenerPaths |= 1;
+
+    InitFlags pathFlags[FMOD_MAX_LISTENERS] = {};
+    for (auto i = 0; i < FMOD_MAX_LISTENERS; ++i)
     {
-        if (!effect->inBuffer.data)
-            iplAudioBufferAllocate(gContext, numChannelsIn, audioSettings.frameSize, &effect->inBuffer);
+        if (!(listenerPaths & (1u << i)))
+            continue;
 
-        if (!effect->outBuffer.data)
-            iplAudioBufferAllocate(gContext, numChannelsOut, audioSettings.frameSize, &effect->outBuffer);
+        pathFlags[i] = checkListenerEffects(effect, effect->listenerPaths[i].effects, renderState, numChannelsIn, numChannelsOut, requestedListenerEffects[i]);
+        anyRequested = anyRequested || (requestedListenerEffects[i] != INIT_NONE);
+    }
 
-        if (!effect->directBuffer.data)
-            iplAudioBufferAllocate(gContext, numChannelsIn, audioSettings.frameSize, &effect->directBuffer);
+    initFlags = pathFlags[0];
 
-        if (!effect->monoBuffer.data)
-            iplAudioBufferAllocate(gContext, 1, audioSettings.frameSize, &effect->monoBuffer);
+    if (effect->applyReflections && renderState->isSimulationSettingsValid)
+    {
+        if (effect->reflectionEffect)
+            initFlags = static_cast<InitFlags>(initFlags | INIT_REFLECTIONEFFECT);
+        else
+            requested = static_cast<InitFlags>(requested | INIT_REFLECTIONEFFECT);
+    }
 
-        initFlags = static_cast<InitFlags>(initFlags | INIT_DIRECTAUDIOBUFFERS);
+    if (numChannelsIn > 0 && numChannelsOut > 0)
+    {
+        if (effect->frameFIFO)
+            initFlags = static_cast<InitFlags>(initFlags | INIT_FRAMEFIFO);
+        else
+            requested = static_cast<InitFlags>(requested | INIT_FRAMEFIFO);
+    }
 
-        if ((effect->applyReflections || effect->applyPathing) && gIsSimulationSettingsValid)
-        {
-            auto numAmbisonicChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
+    anyRequested = anyRequested || (requested != INIT_NONE);
 
-            if (!effect->reflectionsBuffer.data)
-                iplAudioBufferAllocate(gContext, numAmbisonicChannels, audioSettings.frameSize, &effect->reflectionsBuffer);
+    if (anyRequested && job->isIdle())
+    {
+        job->context = gContext;
+        job->audioSettings = audioSettings;
+        job->blockSize = static_cast<int>(blockSize);
+        job->numChannelsIn = numChannelsIn;
+        job->numChannelsOut = numChannelsOut;
+        job->hrtf = iplHRTFRetain(renderState->hrtf);
+        job->simulationSettings = renderState->simulationSettings;
+        job->requested = requested;
+        memcpy(job->requestedListenerEffects, requestedListenerEffects, sizeof(requestedListenerEffects));
+
+        // If the queue is full, try again in the next block.
+        if (!gEffectBuilder.submit(job))
+            iplHRTFRelease(&job->hrtf);
+    }
 
-            if (!effect->reflectionsSpatializedBuffer.data)
-                iplAudioBufferAllocate(gContext, numChannelsOut, audioSettings.frameSize, &effect->reflectionsSpatializedBuffer);
+    // Audio buffers are borrowed from the scratch arena in process(), so there is nothing to allocate here.
+    if (numChannelsIn > 0 && numChannelsOut > 0)
+    {
+        initFlags = static_cast<InitFlags>(initFlags | INIT_DIRECTAUDIOBUFFERS);
 
+        if ((effect->applyReflections || effect->applyPathing) && renderState->isSimulationSettingsValid)
             initFlags = static_cast<InitFlags>(initFlags | INIT_REFLECTIONAUDIOBUFFERS);
+    }
+
+    // The shared objects and buffers are ready for every path if they are ready for path 0.
+    if (listenerFlags)
+    {
+        auto sharedFlags = static_cast<InitFlags>(initFlags & (INIT_DIRECTAUDIOBUFFERS | INIT_REFLECTIONAUDIOBUFFERS | INIT_REFLECTIONEFFECT | INIT_FRAMEFIFO));
+
+        for (auto i = 0; i < FMOD_MAX_LISTENERS; ++i)
+        {
+            listenerFlags[i] = (listenerPaths & (1u << i)) ? static_cast<InitFlags>(pathFlags[i] | sharedFlags) : INIT_NONE;
         }
     }
 
@@ -716,17 +1085,45 @@ void reset(FMOD_DSP_STATE* state)
     effect->simulationSource[0] = nullptr;
     effect->simulationSource[1] = nullptr;
     effect->newSimulationSourceWritten = false;
+    effect->simulationOutputsHandle = -1;
+    effect->simulationOutputs = IPLSimulationOutputs{};
+    effect->directParamsValid = false;
+    effect->occlusionGainBound = 1.0f;
+    effect->numIdleQueries = 0;
 
     effect->prevDirectMixLevel = 1.0f;
     effect->prevReflectionsMixLevel = 0.0f;
+    effect->reflectionsLOD = ReflectionLOD{-1, 0.0f};
+    effect->prevReflectionsLODGain = 0.0f;
     effect->prevPathingMixLevel = 0.0f;
+
+    effect->spatializerGroup = -1;
+    effect->groupVoice = -1;
+
+    effect->requestedFrameSize = 0;
+    effect->latency = 0;
+
+    effect->listener = 0;
 }
 
 FMOD_RESULT F_CALL create(FMOD_DSP_STATE* state)
 {
-    state->plugindata = new State();
+    auto effect = new State();
+    effect->buildJob = new BuildJob();
+    effect->reflectionBudgetSource = gReflectionBudget.addSource();
+
+    state->plugindata = effect;
     reset(state);
-    lazyInit(state, 0, 0);
+
+    gDSPRegistry.add(state->instance);
+    gPerfStatsRegistry.add(state->instance, &effect->perf);
+
+    initContextIfRunningInEditor(state);
+    gRenderStateManager.withLatest([&](const RenderState* renderState)
+    {
+        lazyInit(state, renderState, 0, 0, 1, nullptr);
+    });
+
     return FMOD_OK;
 }
 
@@ -734,24 +1131,30 @@ FMOD_RESULT F_CALL release(FMOD_DSP_STATE* state)
 {
     auto effect = reinterpret_cast<State*>(state->plugindata);
 
-    iplAudioBufferFree(gContext, &effect->inBuffer);
-    iplAudioBufferFree(gContext, &effect->outBuffer);
-    iplAudioBufferFree(gContext, &effect->directBuffer);
-    iplAudioBufferFree(gContext, &effect->monoBuffer);
-    iplAudioBufferFree(gContext, &effect->reflectionsBuffer);
-    iplAudioBufferFree(gContext, &effect->reflectionsSpatializedBuffer);
+    gDSPRegistry.remove(state->instance);
+    gPerfStatsRegistry.remove(state->instance);
+
+    gEffectBuilder.abandon(effect->buildJob);
+    gReflectionBudget.removeSource(effect->reflectionBudgetSource);
+
+    for (auto& path : effect->listenerPaths)
+    {
+        releaseListenerEffects(path.effects);
+    }
+
+    gEffectPool.release(&effect->reflectionEffect);
 
-    iplPanningEffectRelease(&effect->panningEffect);
-    iplBinauralEffectRelease(&effect->binauralEffect);
-    iplDirectEffectRelease(&effect->directEffect);
-    iplReflectionEffectRelease(&effect->reflectionEffect);
-    iplPathEffectRelease(&effect->pathEffect);
-    iplAmbisonicsDecodeEffectRelease(&effect->ambisonicsEffect);
+    delete effect->frameFIFO;
 
     effect->newSimulationSourceWritten = false;
     iplSourceRelease(&effect->simulationSource[0]);
     iplSourceRelease(&effect->simulationSource[1]);
 
+    if (effect->group)
+    {
+        effect->group->removeVoice(effect->groupVoice);
+    }
+
     delete state->plugindata;
 
     return FMOD_OK;
@@ -822,7 +1225,19 @@ FMOD_RESULT F_CALL getInt(FMOD_DSP_STATE* state,
         *value = static_cast<int>(effect->transmissionType);
         break;
     case SIMULATION_OUTPUTS_HANDLE:
-        *value = -1;
+        *value = effect->simulationOutputsHandle;
+        break;
+    case SPATIALIZER_GROUP:
+        *value = effect->spatializerGroup;
+        break;
+    case FRAME_SIZE:
+        *value = effect->requestedFrameSize;
+        break;
+    case LATENCY:
+        *value = effect->latency;
+        break;
+    case LISTENER:
+        *value = effect->listener;
         break;
     default:
         return FMOD_ERR_INVALID_PARAM;
@@ -943,6 +1358,8 @@ FMOD_RESULT F_CALL setBool(FMOD_DSP_STATE* state,
         return FMOD_ERR_INVALID_PARAM;
     }
 
+    effect->paramsVersion++;
+
     return FMOD_OK;
 }
 
@@ -963,21 +1380,64 @@ void setSource(FMOD_DSP_STATE* state,
     }
 }
 
-FMOD_RESULT F_CALL setInt(FMOD_DSP_STATE* state,
-                          int index,
-                          int value)
+// Overrides parameter values with any sent for this effect's source via iplFMODUpdateSources.
+void applySourceParams(FMOD_DSP_STATE* state)
 {
     auto effect = reinterpret_cast<State*>(state->plugindata);
 
-    switch (index)
+    auto handle = effect->simulationOutputsHandle.load();
+    if (handle < 0 || !gSourceManager)
+        return;
+
+    IPLFMODSourceParams params{};
+    if (!gSourceManager->getSourceParams(handle, params))
+        return;
+
+    // Only count a change in occlusion or transmission as a parameter change, since the same values are typically
+    // sent every frame.
+    if ((params.flags & IPL_FMODSOURCEPARAMSFLAGS_OCCLUSION) && effect->occlusion != params.occlusion)
     {
-    case APPLY_DISTANCEATTENUATION:
-        effect->applyDistanceAttenuation = static_cast<ParameterApplyType>(value);
-        break;
-    case APPLY_AIRABSORPTION:
-        effect->applyAirAbsorption = static_cast<ParameterApplyType>(value);
-        break;
-    case APPLY_DIRECTIVITY:
+        effect->occlusion = params.occlusion;
+        effect->paramsVersion++;
+    }
+
+    if ((params.flags & IPL_FMODSOURCEPARAMSFLAGS_TRANSMISSION) && memcmp(effect->transmission, params.transmission, 3 * sizeof(float)) != 0)
+    {
+        memcpy(effect->transmission, params.transmission, 3 * sizeof(float));
+        effect->paramsVersion++;
+    }
+
+    if (params.flags & IPL_FMODSOURCEPARAMSFLAGS_DIRECTMIXLEVEL)
+    {
+        effect->directMixLevel = params.directMixLevel;
+    }
+
+    if (params.flags & IPL_FMODSOURCEPARAMSFLAGS_REFLECTIONSMIXLEVEL)
+    {
+        effect->reflectionsMixLevel = params.reflectionsMixLevel;
+    }
+
+    if (params.flags & IPL_FMODSOURCEPARAMSFLAGS_PATHINGMIXLEVEL)
+    {
+        effect->pathingMixLevel = params.pathingMixLevel;
+    }
+}
+
+FMOD_RESULT F_CALL setInt(FMOD_DSP_STATE* state,
+                          int index,
+                          int value)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    switch (index)
+    {
+    case APPLY_DISTANCEATTENUATION:
+        effect->applyDistanceAttenuation = static_cast<ParameterApplyType>(value);
+        break;
+    case APPLY_AIRABSORPTION:
+        effect->applyAirAbsorption = static_cast<ParameterApplyType>(value);
+        break;
+    case APPLY_DIRECTIVITY:
         effect->applyDirectivity = static_cast<ParameterApplyType>(value);
         break;
     case APPLY_OCCLUSION:
@@ -998,13 +1458,29 @@ FMOD_RESULT F_CALL setInt(FMOD_DSP_STATE* state,
     case SIMULATION_OUTPUTS_HANDLE:
         if (gSourceManager)
         {
-            setSource(state, gSourceManager->getSource(value));
+            auto source = gSourceManager->retainSource(value);
+            setSource(state, source);
+            iplSourceRelease(&source);
         }
+        effect->simulationOutputsHandle = value;
+        break;
+    case SPATIALIZER_GROUP:
+        effect->spatializerGroup = value;
+        break;
+    case FRAME_SIZE:
+        effect->requestedFrameSize = std::max(0, std::min(value, FrameFIFO::kMaxFrameSize));
+        break;
+    case LATENCY:
+        break;
+    case LISTENER:
+        effect->listener = std::max(-1, std::min(value, FMOD_MAX_LISTENERS - 1));
         break;
     default:
         return FMOD_ERR_INVALID_PARAM;
     }
 
+    effect->paramsVersion++;
+
     return FMOD_OK;
 }
 
@@ -1068,9 +1544,25 @@ FMOD_RESULT F_CALL setFloat(FMOD_DSP_STATE* state,
         return FMOD_ERR_INVALID_PARAM;
     }
 
+    effect->paramsVersion++;
+
     return FMOD_OK;
 }
 
+// Stores the single-listener source position, unless the multi-listener position has been written, since FMOD may
+// write both.
+void setSourcePosition(State* effect,
+                       const FMOD_DSP_PARAMETER_3DATTRIBUTES& attributes)
+{
+    if (effect->sourceMultiWritten)
+        return;
+
+    effect->source.numlisteners = 1;
+    effect->source.relative[0] = attributes.relative;
+    effect->source.weight[0] = 1.0f;
+    effect->source.absolute = attributes.absolute;
+}
+
 FMOD_RESULT F_CALL setData(FMOD_DSP_STATE* state,
                            int index,
                            void* value,
@@ -1083,13 +1575,18 @@ FMOD_RESULT F_CALL setData(FMOD_DSP_STATE* state,
     switch (index)
     {
     case SOURCE_POSITION:
+        setSourcePosition(effect, *reinterpret_cast<FMOD_DSP_PARAMETER_3DATTRIBUTES*>(value));
+        break;
+    case SOURCE_POSITION_MULTI:
         memcpy(&effect->source, value, length);
+        effect->sourceMultiWritten = true;
         break;
     case SIMULATION_OUTPUTS:
         break;
     case DISTANCE_ATTENUATION_RANGE:
         memcpy(&effect->attenuationRange, value, length);
         effect->attenuationRangeSet = true;
+        effect->paramsVersion++;
         break;
     default:
         return FMOD_ERR_INVALID_PARAM;
@@ -1098,22 +1595,88 @@ FMOD_RESULT F_CALL setData(FMOD_DSP_STATE* state,
     return FMOD_OK;
 }
 
-IPLDirectEffectParams getDirectParams(FMOD_DSP_STATE* state,
-                                      IPLCoordinateSpace3 source,
-                                      IPLCoordinateSpace3 listener,
-                                      bool updatingOverallGain)
+// Fetches the outputs of the current simulation source, so they can be used for the rest of the process() call.
+void fetchSimulationOutputs(FMOD_DSP_STATE* state,
+                            IPLSimulationFlags flags)
 {
     auto effect = reinterpret_cast<State*>(state->plugindata);
 
-    auto hasSource = false;
-    IPLSimulationOutputs simulationOutputs{};
     if (effect->simulationSource[0])
     {
-        iplSourceGetOutputs(effect->simulationSource[0], IPL_SIMULATIONFLAGS_DIRECT, &simulationOutputs);
-        hasSource = true;
+        iplSourceGetOutputs(effect->simulationSource[0], flags, &effect->simulationOutputs);
     }
+    else
+    {
+        effect->simulationOutputs.direct = IPLDirectEffectParams{};
+    }
+}
 
-    auto params = simulationOutputs.direct;
+float calcDistanceAttenuation(FMOD_DSP_STATE* state,
+                              IPLCoordinateSpace3 source,
+                              IPLCoordinateSpace3 listener)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    auto distanceAttenuation = 1.0f;
+
+    if (effect->applyDistanceAttenuation == PARAMETER_USERDEFINED)
+    {
+        auto minDistance = effect->attenuationRangeSet ? effect->attenuationRange.min : effect->distanceAttenuationMinDistance;
+        auto maxDistance = effect->attenuationRangeSet ? effect->attenuationRange.max : effect->distanceAttenuationMaxDistance;
+
+        state->functions->pan->getrolloffgain(state, effect->distanceAttenuationRolloffType,
+                                              distance(source.origin, listener.origin),
+                                              minDistance, maxDistance, &distanceAttenuation);
+    }
+    else if (effect->applyDistanceAttenuation == PARAMETER_SIMULATIONDEFINED)
+    {
+        IPLDistanceAttenuationModel distanceAttenuationModel{};
+        distanceAttenuationModel.type = IPL_DISTANCEATTENUATIONTYPE_DEFAULT;
+
+        distanceAttenuation = iplDistanceAttenuationCalculate(gContext, source.origin, listener.origin, &distanceAttenuationModel);
+    }
+
+    return distanceAttenuation;
+}
+
+// Until a simulation source has been set, there are no simulated occlusion or transmission values. When estimating
+// the overall gain, assume the source is unoccluded, so FMOD doesn't virtualize it before simulation has had a chance
+// to run.
+void assumeUnoccludedIfNoSource(const State* effect,
+                                IPLDirectEffectParams& directParams)
+{
+    if (effect->simulationSource[0])
+        return;
+
+    if (effect->applyOcclusion == PARAMETER_SIMULATIONDEFINED)
+    {
+        directParams.occlusion = 1.0f;
+    }
+
+    if (effect->applyTransmission == PARAMETER_SIMULATIONDEFINED)
+    {
+        directParams.transmission[0] = 1.0f;
+        directParams.transmission[1] = 1.0f;
+        directParams.transmission[2] = 1.0f;
+    }
+}
+
+float calcOcclusionGain(const IPLDirectEffectParams& directParams)
+{
+    return directParams.occlusion + (1.0f - directParams.occlusion) * *std::max_element(directParams.transmission, directParams.transmission + 3);
+}
+
+// Calculates the direct path parameters for a listener from the fetched simulation outputs and the effect's
+// parameters.
+IPLDirectEffectParams calcDirectParams(FMOD_DSP_STATE* state,
+                                       IPLCoordinateSpace3 source,
+                                       IPLCoordinateSpace3 listener)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    auto hasSource = (effect->simulationSource[0] != nullptr);
+
+    auto params = effect->simulationOutputs.direct;
     params.transmissionType = effect->transmissionType;
 
     params.flags = static_cast<IPLDirectEffectFlags>(0);
@@ -1124,22 +1687,7 @@ IPLDirectEffectParams getDirectParams(FMOD_DSP_STATE* state,
     else
     {
         params.flags = static_cast<IPLDirectEffectFlags>(params.flags | IPL_DIRECTEFFECTFLAGS_APPLYDISTANCEATTENUATION);
-        if (effect->applyDistanceAttenuation == PARAMETER_USERDEFINED)
-        {
-            auto minDistance = effect->attenuationRangeSet ? effect->attenuationRange.min : effect->distanceAttenuationMinDistance;
-            auto maxDistance = effect->attenuationRangeSet ? effect->attenuationRange.max : effect->distanceAttenuationMaxDistance;
-
-            state->functions->pan->getrolloffgain(state, effect->distanceAttenuationRolloffType,
-                                                  distance(source.origin, listener.origin),
-                                                  minDistance, maxDistance, &params.distanceAttenuation);
-        }
-        else
-        {
-            IPLDistanceAttenuationModel distanceAttenuationModel{};
-            distanceAttenuationModel.type = IPL_DISTANCEATTENUATIONTYPE_DEFAULT;
-
-            params.distanceAttenuation = iplDistanceAttenuationCalculate(gContext, source.origin, listener.origin, &distanceAttenuationModel);
-        }
+        params.distanceAttenuation = calcDistanceAttenuation(state, source, listener);
     }
 
     if (effect->applyAirAbsorption == PARAMETER_DISABLE)
@@ -1197,13 +1745,6 @@ IPLDirectEffectParams getDirectParams(FMOD_DSP_STATE* state,
         {
             params.occlusion = effect->occlusion;
         }
-        else
-        {
-            if (updatingOverallGain && !hasSource)
-            {
-                params.occlusion = 1.0f;
-            }
-        }
     }
 
     if (effect->applyTransmission == PARAMETER_DISABLE)
@@ -1221,43 +1762,672 @@ IPLDirectEffectParams getDirectParams(FMOD_DSP_STATE* state,
         {
             memcpy(params.transmission, effect->transmission, 3 * sizeof(float));
         }
-        else
-        {
-            if (updatingOverallGain && !hasSource)
-            {
-                params.transmission[0] = 1.0f;
-                params.transmission[1] = 1.0f;
-                params.transmission[2] = 1.0f;
-            }
-        }
     }
 
     return params;
 }
 
-void updateOverallGain(FMOD_DSP_STATE* state,
-                       IPLCoordinateSpace3 source,
-                       IPLCoordinateSpace3 listener)
+// Calculates the direct path parameters for the listener that the overall gain is reported for. If nothing that they
+// depend on has changed since the last call, returns the previous result.
+IPLDirectEffectParams getDirectParams(FMOD_DSP_STATE* state,
+                                      IPLCoordinateSpace3 source,
+                                      IPLCoordinateSpace3 listener)
 {
     auto effect = reinterpret_cast<State*>(state->plugindata);
-    auto directParams = getDirectParams(state, source, listener, true);
 
+    auto paramsVersion = effect->paramsVersion.load();
+    const auto& simulatedParams = effect->simulationOutputs.direct;
+
+    if (effect->directParamsValid &&
+        effect->directParamsVersion == paramsVersion &&
+        effect->directParamsSource == effect->simulationSource[0] &&
+        memcmp(&effect->directParamsSourceCoordinates, &source, sizeof(source)) == 0 &&
+        memcmp(&effect->directParamsListenerPosition, &listener.origin, sizeof(listener.origin)) == 0 &&
+        memcmp(&effect->directParamsSimulated, &simulatedParams, sizeof(simulatedParams)) == 0)
+    {
+        return effect->directParams;
+    }
+
+    auto params = calcDirectParams(state, source, listener);
+
+    effect->directParamsValid = true;
+    effect->directParamsVersion = paramsVersion;
+    effect->directParamsSource = effect->simulationSource[0];
+    effect->directParamsSourceCoordinates = source;
+    effect->directParamsListenerPosition = listener.origin;
+    effect->directParamsSimulated = simulatedParams;
+    effect->directParams = params;
+
+    auto boundParams = params;
+    assumeUnoccludedIfNoSource(effect, boundParams);
+    effect->occlusionGainBound = calcOcclusionGain(boundParams);
+
+    return params;
+}
+
+// Returns an upper bound on the broadband gain applied to the direct path.
+float calcDirectLevel(const State* effect,
+                      const IPLDirectEffectParams& directParams)
+{
     auto level = effect->directMixLevel;
     level *= directParams.distanceAttenuation;
     level *= *std::max_element(directParams.airAbsorption, directParams.airAbsorption + 3);
     level *= directParams.directivity;
-    level *= (directParams.occlusion + (1.0f - directParams.occlusion) * *std::max_element(directParams.transmission, directParams.transmission + 3));
+    level *= calcOcclusionGain(directParams);
+
+    return level;
+}
 
+// Reports the overall gain to FMOD. Gains below the silence threshold are reported as silence, so FMOD can virtualize
+// the event.
+void setOverallGain(State* effect,
+                    float level)
+{
     if (effect->applyReflections)
         level += effect->reflectionsMixLevel;
 
     if (effect->applyPathing)
         level += effect->pathingMixLevel;
 
+    if (level < gSilenceThreshold.load(std::memory_order_relaxed))
+        level = 0.0f;
+
     effect->overallGain.linear_gain = std::min(1.0f, level);
     effect->overallGain.linear_gain_additive = 0.0f; // this is 0, as this is a volume Fmod sends to "behind the scenes" cooperative plugins, and we don't currently have that
 }
 
+void updateOverallGain(FMOD_DSP_STATE* state,
+                       IPLDirectEffectParams directParams)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    assumeUnoccludedIfNoSource(effect, directParams);
+
+    setOverallGain(effect, calcDirectLevel(effect, directParams));
+}
+
+// Updates the overall gain of an effect whose inputs are idle. Instead of fetching simulation outputs and calculating
+// the direct path parameters, this uses an upper bound on the direct path gain: only distance attenuation is
+// calculated, occlusion and transmission are taken from the last time the direct path parameters were calculated, and
+// position-dependent air absorption and directivity are assumed to be 1. Simulation outputs are only fetched again
+// every few queries, or if a parameter has changed.
+void updateIdleOverallGain(FMOD_DSP_STATE* state,
+                           IPLCoordinateSpace3 source,
+                           IPLCoordinateSpace3 listener)
+{
+    const int kIdleQueriesPerRefresh = 8;
+
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    auto refresh = !effect->directParamsValid ||
+                   effect->directParamsVersion != effect->paramsVersion.load() ||
+                   effect->directParamsSource != effect->simulationSource[0] ||
+                   ++effect->numIdleQueries >= kIdleQueriesPerRefresh;
+
+    if (refresh)
+    {
+        effect->numIdleQueries = 0;
+
+        fetchSimulationOutputs(state, IPL_SIMULATIONFLAGS_DIRECT);
+        updateOverallGain(state, getDirectParams(state, source, listener));
+        return;
+    }
+
+    auto level = effect->directMixLevel;
+    level *= calcDistanceAttenuation(state, source, listener);
+
+    if (effect->applyAirAbsorption == PARAMETER_USERDEFINED)
+        level *= *std::max_element(effect->airAbsorption, effect->airAbsorption + 3);
+
+    if (effect->applyDirectivity == PARAMETER_USERDEFINED)
+        level *= effect->directivity;
+
+    level *= effect->occlusionGainBound;
+
+    setOverallGain(effect, level);
+}
+
+// If this effect belongs to a spatializer group that is being rendered, hands the input over to the group and returns
+// true. Otherwise, returns false, and the effect should be rendered individually. Groups only render direct sound, so
+// effects that apply reflections or pathing are always rendered individually.
+bool submitToGroup(FMOD_DSP_STATE* state,
+                   const IPLDirectEffectParams& directParams,
+                   IPLCoordinateSpace3 source,
+                   IPLCoordinateSpace3 listener,
+                   int numChannelsIn,
+                   int numSamples,
+                   const float* in)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    auto group = (effect->applyReflections || effect->applyPathing) ? nullptr : getSpatializerGroup(effect->spatializerGroup);
+    if (group != effect->group)
+    {
+        if (effect->group)
+        {
+            effect->group->removeVoice(effect->groupVoice);
+        }
+
+        effect->group = group;
+        effect->groupVoice = -1;
+    }
+
+    if (!gContext || !group || !group->isActive() || group->frameSize() != numSamples)
+        return false;
+
+    if (effect->groupVoice < 0)
+    {
+        effect->groupVoice = group->addVoice();
+        if (effect->groupVoice < 0)
+            return false;
+    }
+
+    auto samples = group->voiceSamples(effect->groupVoice);
+    if (numChannelsIn == 1)
+    {
+        memcpy(samples, in, numSamples * sizeof(float));
+    }
+    else
+    {
+        auto scale = 1.0f / numChannelsIn;
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            auto sum = 0.0f;
+            for (auto j = 0; j < numChannelsIn; ++j)
+            {
+                sum += in[i * numChannelsIn + j];
+            }
+
+            samples[i] = sum * scale;
+        }
+    }
+
+    float transmission[3];
+    if (directParams.flags & IPL_DIRECTEFFECTFLAGS_APPLYTRANSMISSION)
+    {
+        if (directParams.transmissionType == IPL_TRANSMISSIONTYPE_FREQINDEPENDENT)
+        {
+            auto averageTransmission = (directParams.transmission[0] + directParams.transmission[1] + directParams.transmission[2]) / 3.0f;
+            transmission[0] = transmission[1] = transmission[2] = averageTransmission;
+        }
+        else
+        {
+            memcpy(transmission, directParams.transmission, 3 * sizeof(float));
+        }
+    }
+    else
+    {
+        transmission[0] = transmission[1] = transmission[2] = 0.0f;
+    }
+
+    SpatializerGroupVoiceParams params{};
+    for (auto i = 0; i < 3; ++i)
+    {
+        auto occlusion = directParams.occlusion + (1.0f - directParams.occlusion) * transmission[i];
+        params.eqGains[i] = effect->directMixLevel * directParams.distanceAttenuation * directParams.airAbsorption[i] * directParams.directivity * occlusion;
+    }
+
+    params.direction = iplCalculateRelativeDirection(gContext, source.origin, listener.origin, listener.ahead, listener.up);
+
+    group->submitVoice(effect->groupVoice, params);
+    return true;
+}
+
+// Renders a cheap approximation of the direct path, for use while effect objects are still being built. The input is
+// downmixed to mono, attenuated by the direct path gain, and panned between the front left and right speakers using an
+// equal-power law.
+void renderFallback(FMOD_DSP_STATE* state,
+                    const IPLDirectEffectParams& directParams,
+                    IPLCoordinateSpace3 source,
+                    IPLCoordinateSpace3 listener,
+                    int numChannelsIn,
+                    int numChannelsOut,
+                    int numSamples,
+                    const float* in,
+                    float* out)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    auto level = calcDirectLevel(effect, directParams) / numChannelsIn;
+
+    float gains[2] = { level, level };
+    if (numChannelsOut > 1)
+    {
+        auto direction = iplCalculateRelativeDirection(gContext, source.origin, listener.origin, listener.ahead, listener.up);
+        auto pan = std::max(-1.0f, std::min(direction.x, 1.0f));
+        auto angle = (pan + 1.0f) * 0.25f * 3.14159265f;
+
+        gains[0] = level * cosf(angle);
+        gains[1] = level * sinf(angle);
+    }
+
+    for (auto i = 0; i < numSamples; ++i)
+    {
+        auto sum = 0.0f;
+        for (auto j = 0; j < numChannelsIn; ++j)
+        {
+            sum += in[i * numChannelsIn + j];
+        }
+
+        out[i * numChannelsOut] = gains[0] * sum;
+        if (numChannelsOut > 1)
+        {
+            out[i * numChannelsOut + 1] = gains[1] * sum;
+        }
+    }
+}
+
+// Renders the direct path with both the previous HRTF and the HRTF in params, and crossfades between them over the
+// block. The binaural effect that has been rendering with the previous HRTF continues with it, so its output has no
+// discontinuity. The other binaural effect starts from silence with the new HRTF, and becomes the main effect for
+// subsequent blocks.
+void crossfadeBinaural(State* effect,
+                       ListenerEffects& effects,
+                       const IPLBinauralEffectParams& params,
+                       IPLHRTF previousHRTF,
+                       IPLAudioBuffer newBuffer)
+{
+    auto previousParams = params;
+    previousParams.hrtf = previousHRTF;
+    iplBinauralEffectApply(effects.binauralEffect, &previousParams, &effect->directBuffer, &effect->outBuffer);
+
+    auto newParams = params;
+    iplBinauralEffectReset(effects.crossfadeBinauralEffect);
+    iplBinauralEffectApply(effects.crossfadeBinauralEffect, &newParams, &effect->directBuffer, &newBuffer);
+
+    for (auto i = 0; i < newBuffer.numChannels; ++i)
+    {
+        applyRamp(effect->outBuffer.data[i], 1.0f, 0.0f, newBuffer.numSamples, effect->outBuffer.data[i]);
+        applyRamp(newBuffer.data[i], 0.0f, 1.0f, newBuffer.numSamples, newBuffer.data[i]);
+        mixInto(newBuffer.data[i], newBuffer.numSamples, effect->outBuffer.data[i]);
+    }
+
+    std::swap(effects.binauralEffect, effects.crossfadeBinauralEffect);
+
+    effect->perf.countHRTFCrossfade();
+}
+
+// Scales a buffer by a gain that ramps from startGain to endGain, and adds it to mix, or overwrites mix if first is
+// true. The contents of in are scaled in place.
+void mixWeighted(const IPLAudioBuffer& in,
+                 float startGain,
+                 float endGain,
+                 bool first,
+                 const IPLAudioBuffer& mix)
+{
+    for (auto i = 0; i < in.numChannels; ++i)
+    {
+        if (first)
+        {
+            applyRamp(in.data[i], startGain, endGain, in.numSamples, mix.data[i]);
+        }
+        else
+        {
+            applyRamp(in.data[i], startGain, endGain, in.numSamples, in.data[i]);
+            mixInto(in.data[i], in.numSamples, mix.data[i]);
+        }
+    }
+}
+
+// Discards audio buffered by the frame FIFO, for when the effect stops rendering frames.
+void resetFrameFIFO(State* effect)
+{
+    if (effect->frameFIFO)
+    {
+        effect->frameFIFO->reset();
+        effect->latency = effect->frameFIFO->latency();
+    }
+}
+
+// Inputs to the render path of one listener that are calculated once per process() call.
+struct ListenerInputs
+{
+    int path;
+    IPLHRTF crossfadeFromHRTF;
+    IPLCoordinateSpace3 listener;
+    IPLVector3 direction;
+    IPLDirectEffectParams directParams;
+    float weight;
+};
+
+// Inputs to a render path that are calculated once per process() call.
+struct RenderInputs
+{
+    const RenderState* renderState;
+    ListenerInputs listeners[FMOD_MAX_LISTENERS];
+    int numListeners;
+
+    // If false, there is a single listener, whose output is mixed at full weight, so weights can be ignored.
+    bool weighted;
+
+    int reflectionsOrder;
+    int reflectionsIRSize;
+
+    // 1 if the reflection budget allows reflections to be rendered, 0 if they should fade out.
+    float reflectionsLODGain;
+
+    int samplingRate;
+    int frameSize;
+    int numChannelsIn;
+    int numChannelsOut;
+    const float* in;
+    float* out;
+};
+
+// Renders the direct path, and optionally reflections and pathing. There is one instantiation for each combination of
+// features, selected once per process() call, so the common case of binaural direct sound only runs straight through
+// without testing for features that are not in use.
+//
+// Reflections are convolved once, and everything that depends on the listener is then rendered for each listener in
+// turn. If there are several listeners, their outputs are weighted and summed.
+template <bool DirectBinaural, bool ApplyReflections, bool ApplyPathing>
+void render(FMOD_DSP_STATE* state,
+            const RenderInputs& inputs)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+    const auto& simulationSettings = inputs.renderState->simulationSettings;
+    auto frameSize = inputs.frameSize;
+    auto numChannelsIn = inputs.numChannelsIn;
+    auto numChannelsOut = inputs.numChannelsOut;
+
+    ScratchScope scratch;
+    effect->inBuffer = scratch.audioBuffer(numChannelsIn, frameSize);
+    effect->outBuffer = scratch.audioBuffer(numChannelsOut, frameSize);
+    effect->directBuffer = scratch.audioBuffer(numChannelsIn, frameSize);
+    effect->monoBuffer = scratch.audioBuffer(1, frameSize);
+
+    if (ApplyReflections || ApplyPathing)
+    {
+        effect->reflectionsBuffer = scratch.audioBuffer(numChannelsForOrder(inputs.reflectionsOrder), frameSize);
+        effect->reflectionsSpatializedBuffer = scratch.audioBuffer(numChannelsOut, frameSize);
+    }
+
+    // Reflections and pathing are applied to a mono downmix of the input, which we calculate in the same pass as
+    // deinterleaving the input.
+    auto inMono = effect->inBuffer.data[0];
+    if ((ApplyReflections || ApplyPathing) && numChannelsIn > 1)
+    {
+        inMono = scratch.audioBuffer(1, frameSize).data[0];
+    }
+
+    {
+        PerfTimer timer(effect->perf, PERFSTAGE_DIRECT);
+
+        deinterleaveDownmix(inputs.in, numChannelsIn, frameSize, effect->inBuffer.data, (inMono != effect->inBuffer.data[0]) ? inMono : nullptr);
+    }
+
+    // The simulated reflections don't depend on the listener, so they are convolved once, into reflectionsBuffer.
+    auto decodeReflections = false;
+
+    if (ApplyReflections)
+    {
+        applyRamp(inMono, effect->prevReflectionsMixLevel, effect->reflectionsMixLevel, frameSize, effect->monoBuffer.data[0]);
+        effect->prevReflectionsMixLevel = effect->reflectionsMixLevel;
+
+        // If reflections are fading back in after the reflection budget left them out, drop the tail of whatever was
+        // convolved before they faded out.
+        if (effect->prevReflectionsLODGain <= 0.0f && inputs.reflectionsLODGain > 0.0f)
+        {
+            iplReflectionEffectReset(effect->reflectionEffect);
+        }
+
+        IPLReflectionEffectParams reflectionParams = effect->simulationOutputs.reflections;
+        reflectionParams.type = simulationSettings.reflectionType;
+        reflectionParams.numChannels = numChannelsForOrder(inputs.reflectionsOrder);
+        reflectionParams.irSize = inputs.reflectionsIRSize;
+        reflectionParams.tanDevice = simulationSettings.tanDevice;
+
+        {
+            PerfTimer timer(effect->perf, PERFSTAGE_REFLECTIONS);
+            iplReflectionEffectApply(effect->reflectionEffect, &reflectionParams, &effect->monoBuffer, &effect->reflectionsBuffer, inputs.renderState->reflectionMixer);
+        }
+
+        if (effect->prevReflectionsLODGain != inputs.reflectionsLODGain)
+        {
+            for (auto i = 0; i < effect->reflectionsBuffer.numChannels; ++i)
+            {
+                applyRamp(effect->reflectionsBuffer.data[i], effect->prevReflectionsLODGain, inputs.reflectionsLODGain, frameSize, effect->reflectionsBuffer.data[i]);
+            }
+
+            effect->prevReflectionsLODGain = inputs.reflectionsLODGain;
+        }
+
+        decodeReflections = (simulationSettings.reflectionType != IPL_REFLECTIONEFFECTTYPE_TAN && !inputs.renderState->reflectionMixer);
+    }
+
+    // The input to the path effect is also shared, since monoBuffer is overwritten by the direct path of each listener.
+    IPLAudioBuffer pathingInBuffer{};
+
+    if (ApplyPathing)
+    {
+        pathingInBuffer = scratch.audioBuffer(1, frameSize);
+
+        applyRamp(inMono, effect->prevPathingMixLevel, effect->pathingMixLevel, frameSize, pathingInBuffer.data[0]);
+        effect->prevPathingMixLevel = effect->pathingMixLevel;
+    }
+
+    // When there are several listeners, their weighted direct and indirect outputs are summed into these buffers.
+    IPLAudioBuffer directMixBuffer{};
+    IPLAudioBuffer indirectMixBuffer{};
+
+    if (inputs.weighted)
+    {
+        directMixBuffer = scratch.audioBuffer(numChannelsOut, frameSize);
+
+        if (decodeReflections || ApplyPathing)
+        {
+            indirectMixBuffer = scratch.audioBuffer(numChannelsOut, frameSize);
+        }
+    }
+
+    // Spatialized reflections and pathing are summed here, and mixed with the direct path when writing the output.
+    const IPLAudioBuffer* indirectBuffer = nullptr;
+
+    for (auto i = 0; i < inputs.numListeners; ++i)
+    {
+        const auto& listenerInputs = inputs.listeners[i];
+        auto& path = effect->listenerPaths[listenerInputs.path];
+        auto& effects = path.effects;
+
+        {
+            PerfTimer timer(effect->perf, PERFSTAGE_DIRECT);
+
+            auto directParams = listenerInputs.directParams;
+            iplDirectEffectApply(effects.directEffect, &directParams, &effect->inBuffer, &effect->directBuffer);
+        }
+
+        if (DirectBinaural)
+        {
+            PerfTimer timer(effect->perf, PERFSTAGE_BINAURAL);
+
+            IPLBinauralEffectParams binauralParams{};
+            binauralParams.direction = listenerInputs.direction;
+            binauralParams.interpolation = effect->hrtfInterpolation;
+            binauralParams.spatialBlend = 1.0f;
+            binauralParams.hrtf = inputs.renderState->hrtf;
+
+            if (listenerInputs.crossfadeFromHRTF)
+            {
+                crossfadeBinaural(effect, effects, binauralParams, listenerInputs.crossfadeFromHRTF, scratch.audioBuffer(numChannelsOut, frameSize));
+            }
+            else
+            {
+                iplBinauralEffectApply(effects.binauralEffect, &binauralParams, &effect->directBuffer, &effect->outBuffer);
+            }
+
+            path.binauralHRTF = binauralParams.hrtf;
+        }
+        else
+        {
+            PerfTimer timer(effect->perf, PERFSTAGE_BINAURAL);
+
+            iplAudioBufferDownmix(gContext, &effect->directBuffer, &effect->monoBuffer);
+
+            IPLPanningEffectParams panningParams{};
+            panningParams.direction = listenerInputs.direction;
+
+            iplPanningEffectApply(effects.panningEffect, &panningParams, &effect->monoBuffer, &effect->outBuffer);
+        }
+
+        indirectBuffer = nullptr;
+
+        if (ApplyReflections && decodeReflections)
+        {
+            PerfTimer timer(effect->perf, PERFSTAGE_DECODE);
+
+            IPLAmbisonicsDecodeEffectParams ambisonicsParams;
+            ambisonicsParams.order = inputs.reflectionsOrder;
+            ambisonicsParams.hrtf = inputs.renderState->hrtf;
+            ambisonicsParams.orientation = listenerInputs.listener;
+            ambisonicsParams.binaural = (effect->reflectionsBinaural) ? IPL_TRUE : IPL_FALSE;
+
+            iplAmbisonicsDecodeEffectApply(effects.ambisonicsEffect, &ambisonicsParams, &effect->reflectionsBuffer, &effect->reflectionsSpatializedBuffer);
+
+            indirectBuffer = &effect->reflectionsSpatializedBuffer;
+        }
+
+        if (ApplyPathing)
+        {
+            IPLPathEffectParams pathParams = effect->simulationOutputs.pathing;
+            pathParams.order = simulationSettings.maxOrder;
+            pathParams.binaural = (effect->pathingBinaural) ? IPL_TRUE : IPL_FALSE;
+            pathParams.hrtf = inputs.renderState->hrtf;
+            pathParams.listener = listenerInputs.listener;
+
+            PerfTimer timer(effect->perf, PERFSTAGE_PATHING);
+
+            if (indirectBuffer)
+            {
+                auto pathingBuffer = scratch.audioBuffer(numChannelsOut, frameSize);
+
+                iplPathEffectApply(effects.pathEffect, &pathParams, &pathingInBuffer, &pathingBuffer);
+
+                for (auto j = 0; j < numChannelsOut; ++j)
+                {
+                    mixInto(pathingBuffer.data[j], frameSize, effect->reflectionsSpatializedBuffer.data[j]);
+                }
+            }
+            else
+            {
+                iplPathEffectApply(effects.pathEffect, &pathParams, &pathingInBuffer, &effect->reflectionsSpatializedBuffer);
+
+                indirectBuffer = &effect->reflectionsSpatializedBuffer;
+            }
+        }
+
+        if (inputs.weighted)
+        {
+            mixWeighted(effect->outBuffer, path.prevWeight, listenerInputs.weight, (i == 0), directMixBuffer);
+
+            if (indirectBuffer)
+            {
+                mixWeighted(*indirectBuffer, path.prevWeight, listenerInputs.weight, (i == 0), indirectMixBuffer);
+            }
+        }
+
+        path.prevWeight = listenerInputs.weight;
+    }
+
+    if (inputs.weighted)
+    {
+        rampMixInterleave(directMixBuffer, effect->prevDirectMixLevel, effect->directMixLevel, indirectBuffer ? &indirectMixBuffer : nullptr, inputs.out);
+    }
+    else
+    {
+        rampMixInterleave(effect->outBuffer, effect->prevDirectMixLevel, effect->directMixLevel, indirectBuffer, inputs.out);
+    }
+
+    effect->prevDirectMixLevel = effect->directMixLevel;
+}
+
+typedef void (*RenderFunction)(FMOD_DSP_STATE* state,
+                               const RenderInputs& inputs);
+
+// Indexed by (directBinaural << 2) | (applyReflections << 1) | applyPathing.
+const RenderFunction gRenderFunctions[] =
+{
+    render<false, false, false>,
+    render<false, false, true>,
+    render<false, true, false>,
+    render<false, true, true>,
+    render<true, false, false>,
+    render<true, false, true>,
+    render<true, true, false>,
+    render<true, true, true>,
+};
+
+// The listeners that an effect renders for during one process() call, indexed by listener path.
+struct ListenerSelection
+{
+    IPLCoordinateSpace3 listeners[FMOD_MAX_LISTENERS];
+
+    // Weights are not normalized. Paths with a weight of 0 are not rendered, other than to fade out.
+    float weights[FMOD_MAX_LISTENERS];
+    int numPaths;
+
+    // The path that the overall gain is reported for, and that spatializer groups and the fallback renderer use.
+    int primary;
+};
+
+// Chooses the listeners to render for, based on the LISTENER parameter. When rendering for all listeners, the closest
+// listener with a nonzero weight is the primary listener, since it is usually the one that hears the event loudest.
+void selectListeners(FMOD_DSP_STATE* state,
+                     IPLCoordinateSpace3 source,
+                     ListenerSelection& selection)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    IPLCoordinateSpace3 listeners[FMOD_MAX_LISTENERS];
+    auto numListeners = calcAllListenerCoordinates(state, listeners);
+
+    auto listener = effect->listener.load();
+    if (listener >= 0)
+    {
+        selection.listeners[0] = listeners[(listener < numListeners) ? listener : 0];
+        selection.weights[0] = 1.0f;
+        selection.numPaths = 1;
+        selection.primary = 0;
+        return;
+    }
+
+    selection.numPaths = numListeners;
+    selection.primary = 0;
+
+    auto closestDistance = std::numeric_limits<float>::max();
+
+    for (auto i = 0; i < numListeners; ++i)
+    {
+        selection.listeners[i] = listeners[i];
+
+        // If the source position was set without listener weights, all listeners are weighted equally.
+        selection.weights[i] = (i < effect->source.numlisteners) ? std::max(effect->source.weight[i], 0.0f) : 1.0f;
+
+        auto listenerDistance = distance(source.origin, listeners[i].origin);
+        if (selection.weights[i] > 0.0f && listenerDistance < closestDistance)
+        {
+            selection.primary = i;
+            closestDistance = listenerDistance;
+        }
+    }
+}
+
+// Returns true if a listener path has the objects it needs to render.
+bool isListenerPathReady(InitFlags flags,
+                         bool applyReflections,
+                         bool applyPathing)
+{
+    if (!(flags & INIT_BINAURALEFFECT) || !(flags & INIT_DIRECTEFFECT))
+        return false;
+
+    if (applyReflections && !(flags & INIT_AMBISONICSEFFECT))
+        return false;
+
+    if (applyPathing && !(flags & INIT_PATHEFFECT))
+        return false;
+
+    return true;
+}
+
 FMOD_RESULT F_CALL process(FMOD_DSP_STATE* state,
                            unsigned int length,
                            const FMOD_DSP_BUFFER_ARRAY* inBuffers,
@@ -1265,10 +2435,16 @@ FMOD_RESULT F_CALL process(FMOD_DSP_STATE* state,
                            FMOD_BOOL inputsIdle,
                            FMOD_DSP_PROCESS_OPERATION operation)
 {
+    RTAuditScope auditScope;
+
     auto effect = reinterpret_cast<State*>(state->plugindata);
 
     auto sourceCoordinates = calcCoordinates(effect->source.absolute);
-    auto listenerCoordinates = calcListenerCoordinates(state);
+
+    ListenerSelection selection;
+    selectListeners(state, sourceCoordinates, selection);
+
+    auto listenerCoordinates = selection.listeners[selection.primary];
 
     if (operation == FMOD_DSP_PROCESS_QUERY)
     {
@@ -1285,40 +2461,37 @@ FMOD_RESULT F_CALL process(FMOD_DSP_STATE* state,
             // channel counts. updateOverallGain won't do any processing - just determine how loud
             // the sound would be (according to attenuation, etc) if it were playing.
             // Note: the SteamAudio Unity plugin now calculates iplGetDirectSoundPath so this is even lighter
-            updateOverallGain(state, sourceCoordinates, listenerCoordinates);
+            updateIdleOverallGain(state, sourceCoordinates, listenerCoordinates);
+            effect->perf.countBypassedBlock();
             return FMOD_ERR_DSP_DONTPROCESS;
         }
     }
     else if (operation == FMOD_DSP_PROCESS_PERFORM)
     {
-        updateOverallGain(state, sourceCoordinates, listenerCoordinates);
+        effect->perf.countProcessCall();
 
         auto samplingRate = 0;
-        auto frameSize = 0u;
+        auto blockSize = 0u;
         state->functions->getsamplerate(state, &samplingRate);
-        state->functions->getblocksize(state, &frameSize);
+        state->functions->getblocksize(state, &blockSize);
+
+        // The frame size can only be chosen before any effects are created, since they are created for a specific
+        // frame size.
+        if (effect->frameSize == 0)
+        {
+            effect->frameSize = (effect->requestedFrameSize > 0) ? effect->requestedFrameSize.load() : static_cast<int>(blockSize);
+        }
 
         auto numChannelsIn = inBuffers->buffernumchannels[0];
         auto numChannelsOut = outBuffers->buffernumchannels[0];
+        auto numSamples = static_cast<int>(length);
         auto in = inBuffers->buffers[0];
         auto out = outBuffers->buffers[0];
 
         // Start by clearing the output buffer.
-        memset(out, 0, numChannelsOut * frameSize * sizeof(float));
-
-        // Make sure that audio processing state has been initialized. If initialization fails, stop and emit silence.
-        // TODO: if nothing is initialized, do some fallback processing (passthrough, panning, or something like that).
-        auto initFlags = lazyInit(state, numChannelsIn, numChannelsOut);
-        if (!(initFlags & INIT_DIRECTAUDIOBUFFERS) || !(initFlags & INIT_BINAURALEFFECT) || !(initFlags & INIT_DIRECTEFFECT))
-            return FMOD_ERR_DSP_SILENCE;
+        memset(out, 0, numChannelsOut * numSamples * sizeof(float));
 
-        if (gNewHRTFWritten)
-        {
-            iplHRTFRelease(&gHRTF[0]);
-            gHRTF[0] = iplHRTFRetain(gHRTF[1]);
-
-            gNewHRTFWritten = false;
-        }
+        initContextIfRunningInEditor(state);
 
         if (effect->newSimulationSourceWritten)
         {
@@ -1328,105 +2501,216 @@ FMOD_RESULT F_CALL process(FMOD_DSP_STATE* state,
             effect->newSimulationSourceWritten = false;
         }
 
-        auto sourcePosition = sourceCoordinates.origin;
-        auto direction = iplCalculateRelativeDirection(gContext, sourcePosition, listenerCoordinates.origin, listenerCoordinates.ahead, listenerCoordinates.up);
+        applySourceParams(state);
 
-        iplAudioBufferDeinterleave(gContext, in, &effect->inBuffer);
+        // Fetch all the simulation outputs we might need in one call.
+        auto simulationFlags = static_cast<int>(IPL_SIMULATIONFLAGS_DIRECT);
+        if (effect->applyReflections)
+            simulationFlags |= IPL_SIMULATIONFLAGS_REFLECTIONS;
+        if (effect->applyPathing)
+            simulationFlags |= IPL_SIMULATIONFLAGS_PATHING;
 
-        IPLDirectEffectParams directParams = getDirectParams(state, sourceCoordinates, listenerCoordinates, false);
+        fetchSimulationOutputs(state, static_cast<IPLSimulationFlags>(simulationFlags));
 
-        iplDirectEffectApply(effect->directEffect, &directParams, &effect->inBuffer, &effect->directBuffer);
+        // The direct path parameters are used for the overall gain as well as for rendering, so only calculate them
+        // once.
+        auto directParams = getDirectParams(state, sourceCoordinates, listenerCoordinates);
+        updateOverallGain(state, directParams);
 
-        if (effect->directBinaural)
+        // Paths that are still fading out keep rendering until they are silent.
+        auto listenerPaths = 0u;
+        auto numWeightedListeners = 0;
+        for (auto i = 0; i < FMOD_MAX_LISTENERS; ++i)
         {
-            IPLBinauralEffectParams binauralParams{};
-            binauralParams.direction = direction;
-            binauralParams.interpolation = effect->hrtfInterpolation;
-            binauralParams.spatialBlend = 1.0f;
-            binauralParams.hrtf = gHRTF[0];
+            auto weighted = (i < selection.numPaths && selection.weights[i] > 0.0f);
+            if (weighted)
+                ++numWeightedListeners;
 
-            iplBinauralEffectApply(effect->binauralEffect, &binauralParams, &effect->directBuffer, &effect->outBuffer);
+            if (weighted || (effect->listenerPaths[i].active && effect->listenerPaths[i].prevWeight > 0.0f))
+                listenerPaths |= (1u << i);
         }
-        else
+
+        // Events in a spatializer group are rendered by the group's Spatializer Group effect, which renders direct sound
+        // for a single listener.
+        if (numWeightedListeners <= 1 && submitToGroup(state, directParams, sourceCoordinates, listenerCoordinates, numChannelsIn, numSamples, in))
         {
-            iplAudioBufferDownmix(gContext, &effect->directBuffer, &effect->monoBuffer);
+            resetFrameFIFO(effect);
+            return FMOD_ERR_DSP_SILENCE;
+        }
 
-            IPLPanningEffectParams panningParams{};
-            panningParams.direction = direction;
+        // Make sure that audio processing state has been initialized. If initialization fails, stop and emit silence.
+        // While the effect objects are being built, render a panned approximation instead.
+        auto renderState = gRenderStateManager.current();
+        InitFlags listenerFlags[FMOD_MAX_LISTENERS] = {};
+        auto initFlags = lazyInit(state, renderState, numChannelsIn, numChannelsOut, listenerPaths, listenerFlags);
+        if (!(initFlags & INIT_DIRECTAUDIOBUFFERS))
+        {
+            effect->perf.countInitFailure();
+            return FMOD_ERR_DSP_SILENCE;
+        }
 
-            iplPanningEffectApply(effect->panningEffect, &panningParams, &effect->monoBuffer, &effect->outBuffer);
+        effect->perf.countHRTFChange(renderState->hrtf);
+
+        if (!(initFlags & INIT_BINAURALEFFECT) || !(initFlags & INIT_DIRECTEFFECT) || !(initFlags & INIT_FRAMEFIFO))
+        {
+            effect->perf.countInitFailure();
+            resetFrameFIFO(effect);
+            renderFallback(state, directParams, sourceCoordinates, listenerCoordinates, numChannelsIn, numChannelsOut, numSamples, in, out);
+            return FMOD_OK;
         }
 
-        for (auto i = 0; i < numChannelsOut; ++i)
+        auto applyReflections = effect->simulationSource[0] && effect->applyReflections &&
+            (initFlags & INIT_REFLECTIONAUDIOBUFFERS) && (initFlags & INIT_REFLECTIONEFFECT) && (initFlags & INIT_AMBISONICSEFFECT);
+        auto applyPathing = effect->simulationSource[0] && effect->applyPathing &&
+            (initFlags & INIT_REFLECTIONAUDIOBUFFERS) && (initFlags & INIT_PATHEFFECT) && (initFlags & INIT_AMBISONICSEFFECT);
+
+        // The reflection mixer is created with the mixer's block size, so it can't accept frames of any other size.
+        if (renderState->reflectionMixer && effect->frameSize != static_cast<int>(blockSize))
         {
-            applyVolumeRamp(effect->prevDirectMixLevel, effect->directMixLevel, frameSize, effect->outBuffer.data[i]);
+            applyReflections = false;
         }
-        effect->prevDirectMixLevel = effect->directMixLevel;
 
-        if (effect->simulationSource[0])
+        const auto& simulationSettings = renderState->simulationSettings;
+
+        auto reflectionsOrder = simulationSettings.maxOrder;
+        auto reflectionsIRSize = numSamplesForDuration(simulationSettings.maxDuration, samplingRate);
+        auto reflectionsLODGain = 1.0f;
+
+        // If a reflection budget is set, convolve with however much of the IR the budget allows, prioritizing sources
+        // by how loud their reflections are likely to be. TAN and the reflection mixer are not budgeted.
+        auto budgetReflections = applyReflections && gReflectionBudget.isEnabled() && !renderState->reflectionMixer &&
+            (simulationSettings.reflectionType == IPL_REFLECTIONEFFECTTYPE_CONVOLUTION || simulationSettings.reflectionType == IPL_REFLECTIONEFFECTTYPE_HYBRID);
+
+        if (budgetReflections)
         {
-            IPLSimulationOutputs simulationOutputs{};
-            iplSourceGetOutputs(effect->simulationSource[0], static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_REFLECTIONS | IPL_SIMULATIONFLAGS_PATHING), &simulationOutputs);
+            unsigned long long clock = 0;
+            unsigned int offset = 0;
+            unsigned int blockLength = 0;
+            state->functions->getclock(state, &clock, &offset, &blockLength);
+
+            auto priority = effect->reflectionsMixLevel * directParams.distanceAttenuation;
+            gReflectionBudget.update(effect->reflectionBudgetSource, clock, priority, simulationSettings.maxOrder, simulationSettings.maxDuration);
+
+            // If the budget no longer has room for this source, fade its reflections out at the level of detail they
+            // were last rendered at, before stopping.
+            auto lod = gReflectionBudget.lod(effect->reflectionBudgetSource);
+            if (lod.order < 0 && effect->prevReflectionsLODGain > 0.0f && effect->reflectionsLOD.order >= 0)
+            {
+                lod = effect->reflectionsLOD;
+                reflectionsLODGain = 0.0f;
+            }
 
-            if (effect->applyReflections &&
-                (initFlags & INIT_REFLECTIONAUDIOBUFFERS) && (initFlags & INIT_REFLECTIONEFFECT) && (initFlags && INIT_AMBISONICSEFFECT))
+            if (lod.order < 0)
+            {
+                applyReflections = false;
+            }
+            else
             {
-                iplAudioBufferDownmix(gContext, &effect->inBuffer, &effect->monoBuffer);
+                reflectionsOrder = lod.order;
+                reflectionsIRSize = numSamplesForDuration(lod.duration, samplingRate);
+                effect->reflectionsLOD = lod;
+            }
+        }
 
-                applyVolumeRamp(effect->prevReflectionsMixLevel, effect->reflectionsMixLevel, frameSize, effect->monoBuffer.data[0]);
-                effect->prevReflectionsMixLevel = effect->reflectionsMixLevel;
+        // Listeners whose paths are still being built are left out, and the weights of the others are normalized.
+        auto totalWeight = 0.0f;
+        for (auto i = 0; i < selection.numPaths; ++i)
+        {
+            if (!isListenerPathReady(listenerFlags[i], applyReflections, applyPathing))
+                selection.weights[i] = 0.0f;
 
-                IPLReflectionEffectParams reflectionParams = simulationOutputs.reflections;
-                reflectionParams.type = gSimulationSettings.reflectionType;
-                reflectionParams.numChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
-                reflectionParams.irSize = numSamplesForDuration(gSimulationSettings.maxDuration, static_cast<int>(samplingRate));
-                reflectionParams.tanDevice = gSimulationSettings.tanDevice;
+            totalWeight += selection.weights[i];
+        }
 
-                if (gNewReflectionMixerWritten)
-                {
-                    iplReflectionMixerRelease(&gReflectionMixer[0]);
-                    gReflectionMixer[0] = iplReflectionMixerRetain(gReflectionMixer[1]);
+        auto previousRenderState = gRenderStateManager.previous();
 
-                    gNewReflectionMixerWritten = false;
-                }
+        RenderInputs inputs;
+        inputs.renderState = renderState;
+        inputs.numListeners = 0;
 
-                iplReflectionEffectApply(effect->reflectionEffect, &reflectionParams, &effect->monoBuffer, &effect->reflectionsBuffer, gReflectionMixer[0]);
+        auto anyPathActive = false;
+        for (const auto& path : effect->listenerPaths)
+        {
+            anyPathActive = anyPathActive || path.active;
+        }
 
-                if (gSimulationSettings.reflectionType != IPL_REFLECTIONEFFECTTYPE_TAN && !gReflectionMixer[0])
-                {
-                    IPLAmbisonicsDecodeEffectParams ambisonicsParams;
-                    ambisonicsParams.order = gSimulationSettings.maxOrder;
-                    ambisonicsParams.hrtf = gHRTF[0];
-                    ambisonicsParams.orientation = listenerCoordinates;
-                    ambisonicsParams.binaural = (effect->reflectionsBinaural) ? IPL_TRUE : IPL_FALSE;
+        for (auto i = 0; i < FMOD_MAX_LISTENERS; ++i)
+        {
+            auto& path = effect->listenerPaths[i];
 
-                    iplAmbisonicsDecodeEffectApply(effect->ambisonicsEffect, &ambisonicsParams, &effect->reflectionsBuffer, &effect->reflectionsSpatializedBuffer);
+            auto weight = (i < selection.numPaths && totalWeight > 0.0f) ? selection.weights[i] / totalWeight : 0.0f;
+            auto fadingOut = (weight <= 0.0f && path.active && path.prevWeight > 0.0f && isListenerPathReady(listenerFlags[i], applyReflections, applyPathing));
 
-                    iplAudioBufferMix(gContext, &effect->reflectionsSpatializedBuffer, &effect->outBuffer);
-                }
+            if (weight <= 0.0f && !fadingOut)
+            {
+                path.active = false;
+                continue;
             }
 
-            if (effect->applyPathing &&
-                (initFlags & INIT_REFLECTIONAUDIOBUFFERS) && (initFlags & INIT_PATHEFFECT) && (initFlags && INIT_AMBISONICSEFFECT))
+            // A path only fades in when it joins paths that were already rendering. Otherwise, such as when a single
+            // listener is selected, it starts at its full weight, so it isn't mixed with a ramp.
+            if (!path.active)
             {
-                iplAudioBufferDownmix(gContext, &effect->inBuffer, &effect->monoBuffer);
+                resetListenerEffects(path.effects);
+                path.binauralHRTF = nullptr;
+                path.prevWeight = (anyPathActive) ? 0.0f : weight;
+                path.active = true;
+            }
 
-                applyVolumeRamp(effect->prevPathingMixLevel, effect->pathingMixLevel, frameSize, effect->monoBuffer.data[0]);
-                effect->prevPathingMixLevel = effect->pathingMixLevel;
+            if (i < selection.numPaths)
+            {
+                path.listener = selection.listeners[i];
+            }
+
+            // Crossfade from the previous HRTF if it changed at the start of this block, and this path was rendering
+            // with it until now. If the path was idle when the HRTF changed, there is nothing to fade from.
+            auto hrtfChanged = (path.binauralHRTF && path.binauralHRTF != renderState->hrtf);
+            auto crossfadeHRTF = (hrtfChanged && previousRenderState && previousRenderState->hrtf == path.binauralHRTF);
+
+            auto& listenerInputs = inputs.listeners[inputs.numListeners++];
+            listenerInputs.path = i;
+            listenerInputs.crossfadeFromHRTF = (crossfadeHRTF) ? path.binauralHRTF : nullptr;
+            listenerInputs.listener = path.listener;
+            listenerInputs.direction = iplCalculateRelativeDirection(gContext, sourceCoordinates.origin, path.listener.origin, path.listener.ahead, path.listener.up);
+            listenerInputs.directParams = (i == selection.primary) ? directParams : calcDirectParams(state, sourceCoordinates, path.listener);
+            listenerInputs.weight = weight;
+        }
+
+        // Every listener has a weight of 0, so there is nothing to hear.
+        if (inputs.numListeners == 0)
+        {
+            resetFrameFIFO(effect);
+            return FMOD_OK;
+        }
 
-                IPLPathEffectParams pathParams = simulationOutputs.pathing;
-                pathParams.order = gSimulationSettings.maxOrder;
-                pathParams.binaural = (effect->pathingBinaural) ? IPL_TRUE : IPL_FALSE;
-                pathParams.hrtf = gHRTF[0];
-                pathParams.listener = listenerCoordinates;
+        inputs.weighted = !(inputs.numListeners == 1 && inputs.listeners[0].weight == 1.0f && effect->listenerPaths[inputs.listeners[0].path].prevWeight == 1.0f);
 
-                iplPathEffectApply(effect->pathEffect, &pathParams, &effect->monoBuffer, &effect->reflectionsSpatializedBuffer);
+        inputs.reflectionsOrder = reflectionsOrder;
+        inputs.reflectionsIRSize = reflectionsIRSize;
+        inputs.reflectionsLODGain = reflectionsLODGain;
+        inputs.samplingRate = samplingRate;
+        inputs.frameSize = effect->frameSize;
+        inputs.numChannelsIn = numChannelsIn;
+        inputs.numChannelsOut = numChannelsOut;
 
-                iplAudioBufferMix(gContext, &effect->reflectionsSpatializedBuffer, &effect->outBuffer);
+        auto renderIndex = (effect->directBinaural ? 4 : 0) | (applyReflections ? 2 : 0) | (applyPathing ? 1 : 0);
+        auto renderFunction = gRenderFunctions[renderIndex];
+
+        // Render as many frames as the block completes. There may be none, one, or several.
+        effect->frameFIFO->process(in, out, numSamples, [&](const float* frameIn, float* frameOut)
+        {
+            inputs.in = frameIn;
+            inputs.out = frameOut;
+            renderFunction(state, inputs);
+
+            // Only the first frame rendered after an HRTF change is crossfaded.
+            for (auto i = 0; i < inputs.numListeners; ++i)
+            {
+                inputs.listeners[i].crossfadeFromHRTF = nullptr;
             }
-        }
-        
-        iplAudioBufferInterleave(gContext, &effect->outBuffer, out);
+        });
+
+        effect->latency = effect->frameFIFO->latency();
     }
 
     return FMOD_OK;
@@ -1461,7 +2745,7 @@ FMOD_DSP_DESCRIPTION gSpatializeEffect =
     nullptr,
     nullptr,
     nullptr,
-    nullptr
+    systemMix
 };
 
 }
@@ -0,0 +1,386 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <mutex>
+
+#include "spatializer_group.h"
+
+namespace SteamAudioFMOD {
+
+// --------------------------------------------------------------------------------------------------------------------
+// SpatializerGroup
+// --------------------------------------------------------------------------------------------------------------------
+
+// Crossover frequencies between the low and mid, and mid and high EQ bands, matching the bands used by Steam Audio.
+static const float kCrossoverFrequencies[2] = { 800.0f, 8000.0f };
+
+const int SpatializerGroup::kMaxVoices;
+const int SpatializerGroup::kMaxOrder;
+const int SpatializerGroup::kMaxChannels;
+
+SpatializerGroup::SpatializerGroup()
+    : mOwner(nullptr)
+    , mFrameSize(0)
+    , mVoiceStride(0)
+    , mAttachMutex("spatializer group attach")
+    , mWriteIndex(0)
+    , mNumRenders(0)
+    , mPrevOrder(-1)
+{
+    for (auto i = 0; i < kMaxVoices; ++i)
+    {
+        mVoiceInUse[i] = false;
+        mSubmitted[0][i] = false;
+        mSubmitted[1][i] = false;
+        mLastRendered[i] = 0;
+    }
+}
+
+bool SpatializerGroup::attach(const void* owner,
+                              int frameSize)
+{
+    std::lock_guard<AuditedMutex> lock(mAttachMutex);
+
+    auto currentOwner = mOwner.load();
+    if (currentOwner && currentOwner != owner)
+        return false;
+
+    // Storage is only ever grown, and only while no voice can be writing to it: a voice that saw the group as active
+    // before the previous owner detached may still be writing, but it holds a voice slot until it is released.
+    if (frameSize > mVoiceStride)
+    {
+        if (currentOwner || hasVoices())
+            return false;
+
+        mSamples[0].assign(static_cast<size_t>(kMaxVoices) * frameSize, 0.0f);
+        mSamples[1].assign(static_cast<size_t>(kMaxVoices) * frameSize, 0.0f);
+        mVoiceStride = frameSize;
+    }
+
+    mFrameSize.store(frameSize, std::memory_order_relaxed);
+    mOwner.store(owner, std::memory_order_release);
+    return true;
+}
+
+void SpatializerGroup::detach(const void* owner)
+{
+    std::lock_guard<AuditedMutex> lock(mAttachMutex);
+
+    if (mOwner.load() == owner)
+    {
+        mOwner.store(nullptr, std::memory_order_release);
+    }
+}
+
+bool SpatializerGroup::isActive() const
+{
+    return (mOwner.load(std::memory_order_acquire) != nullptr);
+}
+
+int SpatializerGroup::frameSize() const
+{
+    return mFrameSize.load(std::memory_order_relaxed);
+}
+
+bool SpatializerGroup::hasVoices() const
+{
+    for (auto i = 0; i < kMaxVoices; ++i)
+    {
+        if (mVoiceInUse[i].load(std::memory_order_acquire))
+            return true;
+    }
+
+    return false;
+}
+
+int SpatializerGroup::addVoice()
+{
+    for (auto i = 0; i < kMaxVoices; ++i)
+    {
+        auto expected = false;
+        if (!mVoiceInUse[i].load(std::memory_order_relaxed) && mVoiceInUse[i].compare_exchange_strong(expected, true))
+        {
+            mSubmitted[0][i].store(false, std::memory_order_relaxed);
+            mSubmitted[1][i].store(false, std::memory_order_relaxed);
+            mLastRendered[i] = 0;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void SpatializerGroup::removeVoice(int voice)
+{
+    if (voice < 0 || kMaxVoices <= voice)
+        return;
+
+    mVoiceInUse[voice].store(false, std::memory_order_release);
+}
+
+float* SpatializerGroup::voiceSamples(int voice)
+{
+    auto writeIndex = mWriteIndex.load(std::memory_order_acquire);
+    return &mSamples[writeIndex][static_cast<size_t>(voice) * mVoiceStride];
+}
+
+void SpatializerGroup::submitVoice(int voice,
+                                   const SpatializerGroupVoiceParams& params)
+{
+    auto writeIndex = mWriteIndex.load(std::memory_order_acquire);
+
+    mEQGains[writeIndex][0][voice] = params.eqGains[0];
+    mEQGains[writeIndex][1][voice] = params.eqGains[1];
+    mEQGains[writeIndex][2][voice] = params.eqGains[2];
+
+    // Convert from Steam Audio's coordinate system (x right, y up, -z ahead) to the Ambisonics coordinate system
+    // (x ahead, y left, z up).
+    mDirections[writeIndex][0][voice] = -params.direction.z;
+    mDirections[writeIndex][1][voice] = -params.direction.x;
+    mDirections[writeIndex][2][voice] = params.direction.y;
+
+    mSubmitted[writeIndex][voice].store(true, std::memory_order_release);
+}
+
+int SpatializerGroup::render(int order,
+                             int samplingRate,
+                             int numSamples,
+                             IPLAudioBuffer& ambisonicsBuffer)
+{
+    auto readIndex = mWriteIndex.load(std::memory_order_relaxed);
+    mWriteIndex.store(1 - readIndex, std::memory_order_release);
+
+    ++mNumRenders;
+
+    order = std::max(0, std::min(order, kMaxOrder));
+    auto numChannels = (order + 1) * (order + 1);
+    numSamples = std::min(numSamples, mFrameSize.load(std::memory_order_relaxed));
+
+    for (auto i = 0; i < numChannels; ++i)
+    {
+        memset(ambisonicsBuffer.data[i], 0, numSamples * sizeof(float));
+    }
+
+    // If the order has changed, the previous encoding coefficients are meaningless, so fade every voice in again.
+    if (order != mPrevOrder)
+    {
+        std::fill(mLastRendered, mLastRendered + kMaxVoices, 0);
+        mPrevOrder = order;
+    }
+
+    auto numVoices = 0;
+    for (auto i = 0; i < kMaxVoices; ++i)
+    {
+        if (!mSubmitted[readIndex][i].load(std::memory_order_acquire))
+            continue;
+
+        mActiveVoices[numVoices] = i;
+        mX[numVoices] = mDirections[readIndex][0][i];
+        mY[numVoices] = mDirections[readIndex][1][i];
+        mZ[numVoices] = mDirections[readIndex][2][i];
+        ++numVoices;
+    }
+
+    if (numVoices == 0 || numSamples <= 0)
+        return 0;
+
+    evaluateSphericalHarmonics(order, numVoices);
+
+    float lowPassCoeffs[2];
+    for (auto i = 0; i < 2; ++i)
+    {
+        lowPassCoeffs[i] = 1.0f - expf(-6.2831853f * kCrossoverFrequencies[i] / samplingRate);
+    }
+
+    auto rampScale = 1.0f / numSamples;
+
+    for (auto i = 0; i < numVoices; ++i)
+    {
+        auto voice = mActiveVoices[i];
+        auto samples = &mSamples[readIndex][static_cast<size_t>(voice) * mVoiceStride];
+
+        float eqGains[3] = { mEQGains[readIndex][0][voice], mEQGains[readIndex][1][voice], mEQGains[readIndex][2][voice] };
+
+        // Voices that were not rendered in the previous block start from silence, so they fade in instead of clicking.
+        if (mLastRendered[voice] + 1 != mNumRenders)
+        {
+            for (auto j = 0; j < 3; ++j)
+            {
+                mPrevEQGains[j][voice] = eqGains[j];
+            }
+
+            mLowPassState[0][voice] = 0.0f;
+            mLowPassState[1][voice] = 0.0f;
+
+            for (auto j = 0; j < numChannels; ++j)
+            {
+                mPrevCoeffs[j][voice] = 0.0f;
+            }
+        }
+
+        applyEQ(voice, eqGains, lowPassCoeffs, numSamples, samples);
+
+        for (auto j = 0; j < numChannels; ++j)
+        {
+            auto startCoeff = mPrevCoeffs[j][voice];
+            auto coeffStep = (mCoeffs[j][i] - startCoeff) * rampScale;
+            auto out = ambisonicsBuffer.data[j];
+
+            for (auto k = 0; k < numSamples; ++k)
+            {
+                out[k] += (startCoeff + coeffStep * k) * samples[k];
+            }
+
+            mPrevCoeffs[j][voice] = mCoeffs[j][i];
+        }
+
+        mLastRendered[voice] = mNumRenders;
+        mSubmitted[readIndex][voice].store(false, std::memory_order_relaxed);
+    }
+
+    return numVoices;
+}
+
+void SpatializerGroup::evaluateSphericalHarmonics(int order,
+                                                  int numVoices)
+{
+    for (auto i = 0; i < numVoices; ++i)
+    {
+        mCoeffs[0][i] = 0.282095f;
+    }
+
+    if (order < 1)
+        return;
+
+    for (auto i = 0; i < numVoices; ++i)
+    {
+        mCoeffs[1][i] = 0.488603f * mY[i];
+        mCoeffs[2][i] = 0.488603f * mZ[i];
+        mCoeffs[3][i] = 0.488603f * mX[i];
+    }
+
+    if (order < 2)
+        return;
+
+    for (auto i = 0; i < numVoices; ++i)
+    {
+        auto x = mX[i];
+        auto y = mY[i];
+        auto z = mZ[i];
+
+        mCoeffs[4][i] = 1.092548f * x * y;
+        mCoeffs[5][i] = 1.092548f * y * z;
+        mCoeffs[6][i] = 0.315392f * (3.0f * z * z - 1.0f);
+        mCoeffs[7][i] = 1.092548f * x * z;
+        mCoeffs[8][i] = 0.546274f * (x * x - y * y);
+    }
+
+    if (order < 3)
+        return;
+
+    for (auto i = 0; i < numVoices; ++i)
+    {
+        auto x = mX[i];
+        auto y = mY[i];
+        auto z = mZ[i];
+
+        mCoeffs[9][i] = 0.590044f * y * (3.0f * x * x - y * y);
+        mCoeffs[10][i] = 2.890611f * x * y * z;
+        mCoeffs[11][i] = 0.457046f * y * (5.0f * z * z - 1.0f);
+        mCoeffs[12][i] = 0.373176f * z * (5.0f * z * z - 3.0f);
+        mCoeffs[13][i] = 0.457046f * x * (5.0f * z * z - 1.0f);
+        mCoeffs[14][i] = 1.445306f * z * (x * x - y * y);
+        mCoeffs[15][i] = 0.590044f * x * (x * x - 3.0f * y * y);
+    }
+}
+
+void SpatializerGroup::applyEQ(int voice,
+                               const float* eqGains,
+                               const float* lowPassCoeffs,
+                               int numSamples,
+                               float* samples)
+{
+    auto rampScale = 1.0f / numSamples;
+
+    // The output is g0 * lp0 + g1 * (lp1 - lp0) + g2 * (x - lp1), where lp0 and lp1 are one-pole low-pass filters at the
+    // two crossover frequencies. This reconstructs the input exactly when all three gains are equal.
+    auto startLow = mPrevEQGains[0][voice] - mPrevEQGains[1][voice];
+    auto startMid = mPrevEQGains[1][voice] - mPrevEQGains[2][voice];
+    auto startHigh = mPrevEQGains[2][voice];
+    auto stepLow = ((eqGains[0] - eqGains[1]) - startLow) * rampScale;
+    auto stepMid = ((eqGains[1] - eqGains[2]) - startMid) * rampScale;
+    auto stepHigh = (eqGains[2] - startHigh) * rampScale;
+
+    auto lp0 = mLowPassState[0][voice];
+    auto lp1 = mLowPassState[1][voice];
+    auto a0 = lowPassCoeffs[0];
+    auto a1 = lowPassCoeffs[1];
+
+    for (auto i = 0; i < numSamples; ++i)
+    {
+        auto x = samples[i];
+        lp0 += a0 * (x - lp0);
+        lp1 += a1 * (x - lp1);
+
+        samples[i] = (startHigh + stepHigh * i) * x + (startLow + stepLow * i) * lp0 + (startMid + stepMid * i) * lp1;
+    }
+
+    mLowPassState[0][voice] = lp0;
+    mLowPassState[1][voice] = lp1;
+
+    for (auto i = 0; i < 3; ++i)
+    {
+        mPrevEQGains[i][voice] = eqGains[i];
+    }
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// Group Registry
+// --------------------------------------------------------------------------------------------------------------------
+
+static std::atomic<SpatializerGroup*> gSpatializerGroups[kMaxSpatializerGroups];
+static AuditedMutex gSpatializerGroupsMutex("spatializer group registry");
+
+SpatializerGroup* getOrCreateSpatializerGroup(int index)
+{
+    if (index < 0 || kMaxSpatializerGroups <= index)
+        return nullptr;
+
+    std::lock_guard<AuditedMutex> lock(gSpatializerGroupsMutex);
+
+    auto group = gSpatializerGroups[index].load();
+    if (!group)
+    {
+        group = new SpatializerGroup();
+        gSpatializerGroups[index].store(group, std::memory_order_release);
+    }
+
+    return group;
+}
+
+SpatializerGroup* getSpatializerGroup(int index)
+{
+    if (index < 0 || kMaxSpatializerGroups <= index)
+        return nullptr;
+
+    return gSpatializerGroups[index].load(std::memory_order_acquire);
+}
+
+void destroySpatializerGroups()
+{
+    std::lock_guard<AuditedMutex> lock(gSpatializerGroupsMutex);
+
+    for (auto i = 0; i < kMaxSpatializerGroups; ++i)
+    {
+        delete gSpatializerGroups[i].exchange(nullptr);
+    }
+}
+
+}
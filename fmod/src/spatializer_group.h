@@ -0,0 +1,166 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <phonon.h>
+
+#include "rt_audit.h"
+
+namespace SteamAudioFMOD {
+
+// --------------------------------------------------------------------------------------------------------------------
+// SpatializerGroup
+// --------------------------------------------------------------------------------------------------------------------
+
+// Per-block parameters submitted by a spatializer voice that is rendered as part of a group.
+struct SpatializerGroupVoiceParams
+{
+    // Broadband gains for the low (< 800 Hz), mid (800 Hz - 8 kHz), and high (> 8 kHz) bands. Includes distance
+    // attenuation, air absorption, directivity, occlusion, transmission, and the direct mix level.
+    float eqGains[3];
+
+    // Unit vector from the listener to the source, in the listener's coordinate space.
+    IPLVector3 direction;
+};
+
+// Renders many spatializer voices in a single DSP callback.
+//
+// Each voice registered with a group submits a mono, pre-downmixed block of samples and a small set of parameters from
+// its own process() callback, instead of running the full per-instance effect chain. The Spatializer Group effect then
+// filters, pans, and mixes every submitted voice in one pass, and runs a single Ambisonics decode (binaural or panned)
+// for the whole group. Per-voice parameters and filter state are stored as structure-of-arrays, so that encoding
+// coefficients and EQ ramps are computed across voices in tight loops.
+//
+// Submissions are double-buffered. The group swaps buffers every time it renders, so voices that are processed before
+// the group in a mix block are heard in the same block, and voices that are processed after the group are heard one
+// block later. Voices are added, submitted, and rendered on the mixer thread. Voices may be removed, and the group
+// attached or detached, from other threads.
+class SpatializerGroup
+{
+public:
+    static const int kMaxVoices = 512;
+    static const int kMaxOrder = 3;
+    static const int kMaxChannels = (kMaxOrder + 1) * (kMaxOrder + 1);
+
+    SpatializerGroup();
+
+    // Makes an effect the renderer for this group, allocating sample storage for the given frame size if needed.
+    // Returns false if another effect is already rendering the group, or if the storage is too small for the frame size
+    // and can't be reallocated because voices are registered with the group.
+    bool attach(const void* owner,
+                int frameSize);
+
+    // Stops an effect from rendering this group. Sample storage is kept, since voices may still be writing to it.
+    void detach(const void* owner);
+
+    // Returns true if an effect is rendering this group, and voices should submit to it.
+    bool isActive() const;
+
+    // The frame size of the effect rendering this group. Voices must submit exactly this many samples.
+    int frameSize() const;
+
+    // Reserves a voice slot. Returns -1 if all slots are in use. Lock-free, must be called on the mixer thread.
+    int addVoice();
+
+    // Frees a voice slot. Lock-free.
+    void removeVoice(int voice);
+
+    // Returns the buffer into which a voice should write its mono input for the current block.
+    float* voiceSamples(int voice);
+
+    // Marks a voice's samples for the current block as ready, along with its parameters.
+    void submitVoice(int voice,
+                     const SpatializerGroupVoiceParams& params);
+
+    // Encodes all voices submitted since the last call into an Ambisonics buffer of the given order, and returns the
+    // number of voices rendered. The buffer must have at least numChannelsForOrder(order) channels, and numSamples
+    // must not exceed frameSize().
+    int render(int order,
+               int samplingRate,
+               int numSamples,
+               IPLAudioBuffer& ambisonicsBuffer);
+
+private:
+    // The effect rendering this group, if any.
+    std::atomic<const void*> mOwner;
+    std::atomic<int> mFrameSize;
+
+    // The number of samples allocated for each voice in mSamples. Only changes while the group has no owner and no
+    // voices, so voices that see the group as active always see the current storage.
+    int mVoiceStride;
+
+    // Serializes attach and detach. Never taken on the mixer thread.
+    AuditedMutex mAttachMutex;
+
+    // Index of the submission buffer that voices write into.
+    std::atomic<int> mWriteIndex;
+
+    // The number of times render has been called.
+    uint64_t mNumRenders;
+
+    // Whether each slot has been reserved by a voice.
+    std::atomic<bool> mVoiceInUse[kMaxVoices];
+
+    // Whether each slot has a submission pending in each buffer.
+    std::atomic<bool> mSubmitted[2][kMaxVoices];
+
+    // Mono input samples, [buffer][voice][sample].
+    std::vector<float> mSamples[2];
+
+    // Submitted parameters, [buffer][band or axis][voice].
+    float mEQGains[2][3][kMaxVoices];
+    float mDirections[2][3][kMaxVoices];
+
+    // Per-voice state carried from one block to the next.
+    float mPrevEQGains[3][kMaxVoices];
+    float mPrevCoeffs[kMaxChannels][kMaxVoices];
+    float mLowPassState[2][kMaxVoices];
+    uint64_t mLastRendered[kMaxVoices];
+    int mPrevOrder;
+
+    // Scratch space used while rendering, indexed by position in mActiveVoices.
+    int mActiveVoices[kMaxVoices];
+    float mCoeffs[kMaxChannels][kMaxVoices];
+    float mX[kMaxVoices];
+    float mY[kMaxVoices];
+    float mZ[kMaxVoices];
+
+    // Returns true if any voice slot is reserved.
+    bool hasVoices() const;
+
+    // Evaluates real, orthonormal spherical harmonics (ACN ordering) for numVoices directions in mX, mY, mZ, given in
+    // the Ambisonics coordinate system (x ahead, y left, z up), and writes them to mCoeffs.
+    void evaluateSphericalHarmonics(int order,
+                                    int numVoices);
+
+    // Applies the 3-band EQ to a voice's samples in place, ramping the band gains over the block.
+    void applyEQ(int voice,
+                 const float* eqGains,
+                 const float* lowPassCoeffs,
+                 int numSamples,
+                 float* samples);
+};
+
+static const int kMaxSpatializerGroups = 16;
+
+// Returns the group with the given index, creating it if needed. Returns nullptr if the index is out of range.
+// Creation is not real-time safe, so this should not be called from the mixer thread unless the group is known to
+// exist.
+SpatializerGroup* getOrCreateSpatializerGroup(int index);
+
+// Returns the group with the given index, or nullptr if it does not exist. Lock-free.
+SpatializerGroup* getSpatializerGroup(int index);
+
+// Destroys all groups. Must only be called when no DSP effects exist.
+void destroySpatializerGroups();
+
+}
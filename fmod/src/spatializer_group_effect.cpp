@@ -0,0 +1,506 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include "steamaudio_fmod.h"
+#include "audio_kernels.h"
+#include "effect_builder.h"
+#include "effect_pool.h"
+#include "rt_audit.h"
+#include "scratch_arena.h"
+#include "spatializer_group.h"
+
+namespace SteamAudioFMOD {
+
+namespace SpatializerGroupEffect {
+
+/**
+ *  DSP parameters for the "Steam Audio Spatializer Group" effect.
+ */
+enum Params
+{
+    /**
+     *  **Type**: `FMOD_DSP_PARAMETER_TYPE_INT`
+     *
+     *  Index of the spatializer group rendered by this effect, or -1 to not render any group. Steam Audio Spatializer
+     *  effects whose **Spatializer Group** parameter is set to the same index are rendered by this effect instead of
+     *  individually. Only one Spatializer Group effect can render a given group at a time; if the group is already
+     *  being rendered by another effect, this effect passes its input through unchanged.
+     */
+    GROUP,
+
+    /**
+     *  **Type**: `FMOD_DSP_PARAMETER_TYPE_INT`
+     *
+     *  Ambisonic order used to pan voices in the group. Higher orders result in more precise spatialization, at the cost
+     *  of increased CPU usage.
+     */
+    AMBISONICS_ORDER,
+
+    /**
+     *  **Type**: `FMOD_DSP_PARAMETER_TYPE_BOOL`
+     *
+     *  If true, applies HRTF-based 3D audio rendering to the group. Otherwise, the group is panned based on the speaker
+     *  configuration.
+     */
+    BINAURAL,
+
+    /** The number of parameters in this effect. */
+    NUM_PARAMS
+};
+
+FMOD_DSP_PARAMETER_DESC gParams[] = {
+    { FMOD_DSP_PARAMETER_TYPE_INT, "Group", "", "Spatializer group index." },
+    { FMOD_DSP_PARAMETER_TYPE_INT, "Order", "", "Ambisonic order." },
+    { FMOD_DSP_PARAMETER_TYPE_BOOL, "Binaural", "", "Spatialize the group using HRTF." }
+};
+
+FMOD_DSP_PARAMETER_DESC* gParamsArray[NUM_PARAMS];
+
+void initParamDescs()
+{
+    for (auto i = 0; i < NUM_PARAMS; ++i)
+    {
+        gParamsArray[i] = &gParams[i];
+    }
+
+    gParams[GROUP].intdesc = {-1, kMaxSpatializerGroups - 1, -1};
+    gParams[AMBISONICS_ORDER].intdesc = {1, SpatializerGroup::kMaxOrder, 2};
+    gParams[BINAURAL].booldesc = {true};
+}
+
+class BuildJob;
+
+struct State
+{
+    int groupIndex;
+    int order;
+    bool binaural;
+
+    std::atomic<SpatializerGroup*> group;
+
+    IPLAmbisonicsDecodeEffect ambisonicsEffect;
+
+    // Used to create the effect object above without blocking the audio thread.
+    BuildJob* buildJob;
+};
+
+enum InitFlags
+{
+    INIT_NONE = 0,
+    INIT_AUDIOBUFFERS = 1 << 0,
+    INIT_AMBISONICSEFFECT = 1 << 1
+};
+
+// Creates the Ambisonics decode effect for a Spatializer Group effect on the effect builder's worker thread.
+class BuildJob : public EffectBuildJob
+{
+public:
+    // Inputs, written on the audio thread before the job is submitted.
+    IPLContext context;
+    IPLAudioSettings audioSettings;
+    int numChannelsOut;
+    IPLHRTF hrtf;
+
+    // Outputs, read on the audio thread once the job is ready.
+    IPLAmbisonicsDecodeEffect ambisonicsEffect;
+
+    BuildJob()
+        : context(nullptr)
+        , audioSettings{}
+        , numChannelsOut(0)
+        , hrtf(nullptr)
+        , ambisonicsEffect(nullptr)
+    {}
+
+    ~BuildJob() override
+    {
+        iplHRTFRelease(&hrtf);
+        gEffectPool.release(&ambisonicsEffect);
+    }
+
+protected:
+    void build() override
+    {
+        IPLAmbisonicsDecodeEffectSettings effectSettings;
+        effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
+        effectSettings.hrtf = hrtf;
+        effectSettings.maxOrder = SpatializerGroup::kMaxOrder;
+
+        gEffectPool.acquire(context, &audioSettings, &effectSettings, &ambisonicsEffect);
+
+        iplHRTFRelease(&hrtf);
+    }
+};
+
+// Returns the effects and buffers that are ready for use. If the Ambisonics decode effect has not been created yet, it
+// is requested from the effect builder, and becomes available in a later block. Never creates effects on the calling
+// thread, so it is safe to call from process().
+InitFlags lazyInit(FMOD_DSP_STATE* state,
+                   const RenderState* renderState,
+                   int numChannelsIn,
+                   int numChannelsOut)
+{
+    auto initFlags = INIT_NONE;
+
+    IPLAudioSettings audioSettings;
+    state->functions->getsamplerate(state, &audioSettings.samplingRate);
+    state->functions->getblocksize(state, reinterpret_cast<unsigned int*>(&audioSettings.frameSize));
+
+    if (!gContext)
+        return initFlags;
+
+    if (!renderState || !renderState->hrtf)
+        return initFlags;
+
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+    auto job = effect->buildJob;
+
+    if (job->isReady())
+    {
+        if (!effect->ambisonicsEffect)
+        {
+            effect->ambisonicsEffect = job->ambisonicsEffect;
+            job->ambisonicsEffect = nullptr;
+        }
+
+        job->complete();
+    }
+
+    if (numChannelsOut > 0)
+    {
+        if (effect->ambisonicsEffect)
+        {
+            initFlags = static_cast<InitFlags>(initFlags | INIT_AMBISONICSEFFECT);
+        }
+        else if (job->isIdle())
+        {
+            job->context = gContext;
+            job->audioSettings = audioSettings;
+            job->numChannelsOut = numChannelsOut;
+            job->hrtf = iplHRTFRetain(renderState->hrtf);
+
+            // If the queue is full, try again in the next block.
+            if (!gEffectBuilder.submit(job))
+                iplHRTFRelease(&job->hrtf);
+        }
+    }
+
+    // Audio buffers are borrowed from the scratch arena in process(), so there is nothing to allocate here.
+    if (numChannelsIn > 0 && numChannelsOut > 0)
+    {
+        initFlags = static_cast<InitFlags>(initFlags | INIT_AUDIOBUFFERS);
+    }
+
+    return initFlags;
+}
+
+// Stops rendering the current group, if any, and starts rendering the group with the given index, if it is not -1.
+void attachToGroup(FMOD_DSP_STATE* state,
+                   int groupIndex)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    if (auto group = effect->group.exchange(nullptr))
+    {
+        group->detach(effect);
+    }
+
+    effect->groupIndex = groupIndex;
+
+    if (groupIndex < 0)
+        return;
+
+    auto frameSize = 0u;
+    state->functions->getblocksize(state, &frameSize);
+
+    auto group = getOrCreateSpatializerGroup(groupIndex);
+    if (group && group->attach(effect, static_cast<int>(frameSize)))
+    {
+        effect->group = group;
+    }
+}
+
+void reset(FMOD_DSP_STATE* state)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+    if (!effect)
+        return;
+
+    effect->order = 2;
+    effect->binaural = true;
+}
+
+// Adds an interleaved bus input to an interleaved output with a possibly different number of channels. Channels that
+// both buffers have are mixed one-to-one. If the output is mono, all input channels are averaged into it instead.
+// Input channels that the output doesn't have are dropped.
+void mixBusInput(const float* in,
+                 int numChannelsIn,
+                 int numSamples,
+                 int numChannelsOut,
+                 float* out)
+{
+    if (numChannelsIn == numChannelsOut)
+    {
+        mixInto(in, numChannelsIn * numSamples, out);
+    }
+    else if (numChannelsOut == 1)
+    {
+        auto scale = 1.0f / numChannelsIn;
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            auto sum = 0.0f;
+            for (auto j = 0; j < numChannelsIn; ++j)
+            {
+                sum += in[i * numChannelsIn + j];
+            }
+
+            out[i] += scale * sum;
+        }
+    }
+    else
+    {
+        auto numChannels = std::min(numChannelsIn, numChannelsOut);
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            for (auto j = 0; j < numChannels; ++j)
+            {
+                out[i * numChannelsOut + j] += in[i * numChannelsIn + j];
+            }
+        }
+    }
+}
+
+FMOD_RESULT F_CALL create(FMOD_DSP_STATE* state)
+{
+    auto effect = new State();
+    effect->buildJob = new BuildJob();
+    state->plugindata = effect;
+    reset(state);
+
+    // Don't render any group until one is explicitly selected, so that adding more than one of these effects to a
+    // project doesn't leave all but one of them silently passing their input through.
+    effect->groupIndex = -1;
+
+    initContextIfRunningInEditor(state);
+    gRenderStateManager.withLatest([&](const RenderState* renderState)
+    {
+        lazyInit(state, renderState, 0, 0);
+    });
+
+    return FMOD_OK;
+}
+
+FMOD_RESULT F_CALL release(FMOD_DSP_STATE* state)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    if (auto group = effect->group.load())
+    {
+        group->detach(effect);
+    }
+
+    gEffectBuilder.abandon(effect->buildJob);
+    gEffectPool.release(&effect->ambisonicsEffect);
+
+    delete effect;
+
+    return FMOD_OK;
+}
+
+FMOD_RESULT F_CALL getBool(FMOD_DSP_STATE* state,
+                           int index,
+                           FMOD_BOOL* value,
+                           char*)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    switch (index)
+    {
+    case BINAURAL:
+        *value = effect->binaural;
+        break;
+    default:
+        return FMOD_ERR_INVALID_PARAM;
+    }
+
+    return FMOD_OK;
+}
+
+FMOD_RESULT F_CALL getInt(FMOD_DSP_STATE* state,
+                          int index,
+                          int* value,
+                          char*)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    switch (index)
+    {
+    case GROUP:
+        *value = effect->groupIndex;
+        break;
+    case AMBISONICS_ORDER:
+        *value = effect->order;
+        break;
+    default:
+        return FMOD_ERR_INVALID_PARAM;
+    }
+
+    return FMOD_OK;
+}
+
+FMOD_RESULT F_CALL setBool(FMOD_DSP_STATE* state,
+                           int index,
+                           FMOD_BOOL value)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    switch (index)
+    {
+    case BINAURAL:
+        effect->binaural = value;
+        break;
+    default:
+        return FMOD_ERR_INVALID_PARAM;
+    }
+
+    return FMOD_OK;
+}
+
+FMOD_RESULT F_CALL setInt(FMOD_DSP_STATE* state,
+                          int index,
+                          int value)
+{
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    switch (index)
+    {
+    case GROUP:
+        if (value != effect->groupIndex)
+        {
+            attachToGroup(state, value);
+        }
+        break;
+    case AMBISONICS_ORDER:
+        effect->order = value;
+        break;
+    default:
+        return FMOD_ERR_INVALID_PARAM;
+    }
+
+    return FMOD_OK;
+}
+
+FMOD_RESULT F_CALL process(FMOD_DSP_STATE* state,
+                           unsigned int,
+                           const FMOD_DSP_BUFFER_ARRAY* inBuffers,
+                           FMOD_DSP_BUFFER_ARRAY* outBuffers,
+                           FMOD_BOOL inputsIdle,
+                           FMOD_DSP_PROCESS_OPERATION operation)
+{
+    RTAuditScope auditScope;
+
+    auto effect = reinterpret_cast<State*>(state->plugindata);
+
+    if (operation == FMOD_DSP_PROCESS_QUERY)
+    {
+        // Voices in the group are not inputs to this effect, so even if the bus is idle, there may be something to
+        // render.
+        if (inputsIdle && !effect->group.load())
+            return FMOD_ERR_DSP_DONTPROCESS;
+    }
+    else if (operation == FMOD_DSP_PROCESS_PERFORM)
+    {
+        auto samplingRate = 0;
+        auto frameSize = 0u;
+        state->functions->getsamplerate(state, &samplingRate);
+        state->functions->getblocksize(state, &frameSize);
+
+        auto numChannelsIn = inBuffers->buffernumchannels[0];
+        auto numChannelsOut = outBuffers->buffernumchannels[0];
+        auto in = inBuffers->buffers[0];
+        auto out = outBuffers->buffers[0];
+
+        // Start by clearing the output buffer.
+        memset(out, 0, numChannelsOut * frameSize * sizeof(float));
+
+        initContextIfRunningInEditor(state);
+
+        // Make sure that audio processing state has been initialized. If initialization fails, stop and emit silence.
+        auto renderState = gRenderStateManager.current();
+        auto initFlags = lazyInit(state, renderState, numChannelsIn, numChannelsOut);
+        if (!(initFlags & INIT_AUDIOBUFFERS) || !(initFlags & INIT_AMBISONICSEFFECT))
+            return FMOD_ERR_DSP_SILENCE;
+
+        auto group = effect->group.load();
+        if (group)
+        {
+            auto order = std::max(1, std::min(effect->order, SpatializerGroup::kMaxOrder));
+
+            ScratchScope scratch;
+            auto ambisonicsBuffer = scratch.audioBuffer(numChannelsForOrder(order), static_cast<int>(frameSize));
+            auto outBuffer = scratch.audioBuffer(numChannelsOut, static_cast<int>(frameSize));
+
+            group->render(order, samplingRate, static_cast<int>(frameSize), ambisonicsBuffer);
+
+            // Voice directions are already relative to the listener, so decode with an identity orientation. The decode
+            // runs even if no voices were submitted, so HRTF filter tails are not cut off.
+            IPLAmbisonicsDecodeEffectParams ambisonicsParams;
+            ambisonicsParams.order = order;
+            ambisonicsParams.hrtf = renderState->hrtf;
+            ambisonicsParams.orientation.right = IPLVector3{1.0f, 0.0f, 0.0f};
+            ambisonicsParams.orientation.up = IPLVector3{0.0f, 1.0f, 0.0f};
+            ambisonicsParams.orientation.ahead = IPLVector3{0.0f, 0.0f, -1.0f};
+            ambisonicsParams.orientation.origin = IPLVector3{0.0f, 0.0f, 0.0f};
+            ambisonicsParams.binaural = (effect->binaural) ? IPL_TRUE : IPL_FALSE;
+
+            iplAmbisonicsDecodeEffectApply(effect->ambisonicsEffect, &ambisonicsParams, &ambisonicsBuffer, &outBuffer);
+
+            // The bus input is mixed in after interleaving, so it doesn't need to be deinterleaved.
+            iplAudioBufferInterleave(gContext, &outBuffer, out);
+        }
+
+        // If no group is being rendered, this passes the input through, since the output was cleared above.
+        mixBusInput(in, numChannelsIn, static_cast<int>(frameSize), numChannelsOut, out);
+
+        return FMOD_OK;
+    }
+
+    return FMOD_OK;
+}
+
+}
+
+/** Descriptor for the Spatializer Group effect. */
+FMOD_DSP_DESCRIPTION gSpatializerGroupEffect
+{
+    FMOD_PLUGIN_SDK_VERSION,
+    "Steam Audio Spatializer Group",
+    STEAMAUDIO_FMOD_VERSION,
+    1,
+    1,
+    SpatializerGroupEffect::create,
+    SpatializerGroupEffect::release,
+    nullptr,
+    nullptr,
+    SpatializerGroupEffect::process,
+    nullptr,
+    SpatializerGroupEffect::NUM_PARAMS,
+    SpatializerGroupEffect::gParamsArray,
+    nullptr,
+    SpatializerGroupEffect::setInt,
+    SpatializerGroupEffect::setBool,
+    nullptr,
+    nullptr,
+    SpatializerGroupEffect::getInt,
+    SpatializerGroupEffect::getBool,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    systemMix
+};
+
+}
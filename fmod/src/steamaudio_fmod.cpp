@@ -4,6 +4,17 @@
 //
 
 #include "steamaudio_fmod.h"
+#include "audio_kernels.h"
+#include "dsp_registry.h"
+#include "effect_builder.h"
+#include "effect_pool.h"
+#include "hrtf_loader.h"
+#include "perf_stats.h"
+#include "pool_allocator.h"
+#include "reflection_budget.h"
+#include "simd_level.h"
+#include "simulation_service.h"
+#include "spatializer_group.h"
 
 #if defined(IPL_OS_MACOSX)
 #include <mach-o/dyld.h>
@@ -22,18 +33,13 @@ namespace SteamAudioFMOD {
 // --------------------------------------------------------------------------------------------------------------------
 
 IPLContext gContext = nullptr;
-IPLHRTF gHRTF[2] = { nullptr, nullptr };
-IPLSimulationSettings gSimulationSettings;
-IPLSource gReverbSource[2] = { nullptr, nullptr };
-IPLReflectionMixer gReflectionMixer[2] = { nullptr, nullptr };
 
-std::atomic<bool> gNewHRTFWritten{ false };
-std::atomic<bool> gIsSimulationSettingsValid{ false };
-std::atomic<bool> gNewReverbSourceWritten{ false };
-std::atomic<bool> gNewReflectionMixerWritten{ false };
+std::atomic<FMOD_DSP_LOG_FUNC> gLogFunction{nullptr};
 
 std::shared_ptr<SourceManager> gSourceManager;
 
+std::atomic<float> gSilenceThreshold{0.0f};
+
 
 // --------------------------------------------------------------------------------------------------------------------
 // Helper Functions
@@ -121,13 +127,7 @@ void applyVolumeRamp(float startVolume,
                      int numSamples,
                      float* buffer)
 {
-    for (auto i = 0; i < numSamples; ++i)
-    {
-        auto fraction = static_cast<float>(i) / static_cast<float>(numSamples);
-        auto volume = fraction * endVolume + (1.0f - fraction) * startVolume;
-        
-        buffer[i] *= volume;
-    }
+    applyRamp(buffer, startVolume, endVolume, numSamples, buffer);
 }
 
 IPLCoordinateSpace3 calcCoordinates(const FMOD_3D_ATTRIBUTES& attributes)
@@ -142,11 +142,29 @@ IPLCoordinateSpace3 calcCoordinates(const FMOD_3D_ATTRIBUTES& attributes)
 
 IPLCoordinateSpace3 calcListenerCoordinates(FMOD_DSP_STATE* state)
 {
+    // FMOD writes the attributes of every listener, so there must be room for all of them.
     auto numListeners = 1;
-    FMOD_3D_ATTRIBUTES listenerAttributes;
-    state->functions->getlistenerattributes(state, &numListeners, &listenerAttributes);
-    
-    return calcCoordinates(listenerAttributes);
+    FMOD_3D_ATTRIBUTES listenerAttributes[FMOD_MAX_LISTENERS] = {};
+    state->functions->getlistenerattributes(state, &numListeners, listenerAttributes);
+
+    return calcCoordinates(listenerAttributes[0]);
+}
+
+int calcAllListenerCoordinates(FMOD_DSP_STATE* state,
+                               IPLCoordinateSpace3* listeners)
+{
+    auto numListeners = 1;
+    FMOD_3D_ATTRIBUTES listenerAttributes[FMOD_MAX_LISTENERS] = {};
+    state->functions->getlistenerattributes(state, &numListeners, listenerAttributes);
+
+    numListeners = std::max(1, std::min(numListeners, FMOD_MAX_LISTENERS));
+
+    for (auto i = 0; i < numListeners; ++i)
+    {
+        listeners[i] = calcCoordinates(listenerAttributes[i]);
+    }
+
+    return numListeners;
 }
 
 bool isRunningInEditor()
@@ -163,14 +181,29 @@ bool isRunningInEditor()
 #endif
 }
 
-void initContextAndDefaultHRTF(IPLAudioSettings audioSettings)
+IPLerror IPLCALL createContext(IPLSIMDLevel simdLevel,
+                               IPLContext* context)
 {
     IPLContextSettings contextSettings{};
     contextSettings.version = STEAMAUDIO_VERSION;
-    contextSettings.simdLevel = IPL_SIMDLEVEL_AVX2;
-    
+    contextSettings.simdLevel = simdLevel;
+#if defined(STEAMAUDIO_ENABLE_RT_AUDIT)
+    contextSettings.allocateCallback = auditedAllocate;
+    contextSettings.freeCallback = auditedFree;
+#else
+    contextSettings.allocateCallback = PoolAllocator::allocateCallback;
+    contextSettings.freeCallback = PoolAllocator::freeCallback;
+#endif
+
+    return IPL_API(iplContextCreate(&contextSettings, context));
+}
+
+void initContextAndDefaultHRTF(IPLAudioSettings audioSettings)
+{
+    // Use the level found by an earlier autotuning run on this machine, if any, but don't autotune here, since that
+    // would stall FMOD Studio's mixer thread.
     IPLContext context = nullptr;
-    IPL_API(iplContextCreate(&contextSettings, &context));
+    createContext(selectSIMDLevel(false, nullptr, nullptr), &context);
     
     IPLHRTFSettings hrtfSettings{};
     hrtfSettings.type = IPL_HRTFTYPE_DEFAULT;
@@ -186,110 +219,267 @@ void initContextAndDefaultHRTF(IPLAudioSettings audioSettings)
     iplContextRelease(&context);
 }
 
+void initContextIfRunningInEditor(FMOD_DSP_STATE* state)
+{
+    if (!gLogFunction.load(std::memory_order_relaxed))
+    {
+        gLogFunction.store(state->functions->log, std::memory_order_relaxed);
+    }
+
+    if (gContext || !isRunningInEditor())
+        return;
+
+    IPLAudioSettings audioSettings;
+    state->functions->getsamplerate(state, &audioSettings.samplingRate);
+    state->functions->getblocksize(state, reinterpret_cast<unsigned int*>(&audioSettings.frameSize));
+
+    initContextAndDefaultHRTF(audioSettings);
+}
+
+FMOD_RESULT F_CALL systemMix(FMOD_DSP_STATE* state,
+                             int stage)
+{
+    RTAuditScope auditScope;
+
+    // If the clock isn't available, blocks are still told apart, since every description's stage 0 call comes before
+    // any stage 1 call.
+    unsigned long long clock = 0;
+    unsigned int offset = 0;
+    unsigned int length = 0;
+    state->functions->getclock(state, &clock, &offset, &length);
+
+    if (stage == 0)
+    {
+        gRenderStateManager.beginMixBlock(clock);
+    }
+    else if (stage == 1)
+    {
+        gRenderStateManager.endMixBlock(clock);
+    }
+
+    return FMOD_OK;
+}
+
+void prewarmEffectPool()
+{
+    gRenderStateManager.withLatest([](const RenderState* renderState)
+    {
+        if (!renderState)
+            return;
+
+        auto simulationSettings = (renderState->isSimulationSettingsValid) ? &renderState->simulationSettings : nullptr;
+        gEffectPool.prewarm(gContext, renderState->hrtf, simulationSettings);
+    });
+}
+
 
 // --------------------------------------------------------------------------------------------------------------------
 // SourceManager
 // --------------------------------------------------------------------------------------------------------------------
 
 SourceManager::SourceManager()
-: mNextHandle(0)
-{}
+    : mNumReaders(0)
+    , mLoggedFull(false)
+    , mWriteMutex("source manager")
+{
+    mFreeSlots.reserve(kMaxSources);
+
+    for (auto i = 0; i < kMaxSources; ++i)
+    {
+        mSlots[i].generation.store(0, std::memory_order_relaxed);
+        mSlots[i].source.store(nullptr, std::memory_order_relaxed);
+        mSlots[i].paramsVersion.store(0, std::memory_order_relaxed);
+        mSlots[i].params[0].handle = -1;
+        mSlots[i].params[1].handle = -1;
+
+        // Slots are handed out from the back, so push them in reverse to use low indices first.
+        mFreeSlots.push_back(kMaxSources - 1 - i);
+    }
+}
 
 SourceManager::~SourceManager()
 {
+    std::lock_guard<AuditedMutex> lock(mWriteMutex);
+
+    for (auto i = 0; i < kMaxSources; ++i)
     {
-        std::lock_guard<std::mutex> lock(mSourceMutex);
-        for (auto& it : mSources)
-        {
-            iplSourceRelease(&mSources[it.first]);
-        }
+        auto source = mSlots[i].source.exchange(nullptr);
+        iplSourceRelease(&source);
+    }
+
+    for (auto& source : mRetiredSources)
+    {
+        iplSourceRelease(&source);
     }
 }
 
 int32_t SourceManager::addSource(IPLSource source)
 {
-    // Retain a reference to this source.
-    auto sourceRetained = iplSourceRetain(source);
-    
-    auto handle = -1;
-    
-    // First, figure out the handle we want to use.
+    std::lock_guard<AuditedMutex> lock(mWriteMutex);
+
+    releaseRetiredSources();
+
+    if (mFreeSlots.empty())
     {
-        std::lock_guard<std::mutex> lock(mHandleMutex);
-        
-        if (mFreeHandles.empty())
-        {
-            // No free handles, use the next-available unused handle.
-            handle = mNextHandle++;
-        }
-        else
+        auto log = gLogFunction.load(std::memory_order_relaxed);
+        if (log && !mLoggedFull)
         {
-            // Use one of the free handles.
-            handle = mFreeHandles.top();
-            mFreeHandles.pop();
+            log(FMOD_DEBUG_LEVEL_WARNING, __FILE__, __LINE__, "iplFMODAddSource",
+                "Steam Audio: Unable to add source, all %d source handles are in use. Remove sources that are no "
+                "longer needed.\n", kMaxSources);
         }
+
+        mLoggedFull = true;
+        return -1;
     }
-    
-    assert(handle >= 0);
-    
-    // Now store the mapping from the handle to this source.
-    {
-        std::lock_guard<std::mutex> lock(mSourceMutex);
-        
-        assert(mSources.find(handle) == mSources.end());
-        
-        mSources[handle] = sourceRetained;
-    }
-    
-    return handle;
+
+    auto index = mFreeSlots.back();
+    mFreeSlots.pop_back();
+
+    auto& slot = mSlots[index];
+    slot.source.store(iplSourceRetain(source), std::memory_order_release);
+
+    auto generation = static_cast<int32_t>(slot.generation.load(std::memory_order_relaxed));
+    return (generation << kIndexBits) | index;
 }
 
 void SourceManager::removeSource(int32_t handle)
 {
-    // Remove the source from the handle-to-source map.
+    if (handle < 0 || kMaxHandle < handle)
+        return;
+
+    auto index = handle & (kMaxSources - 1);
+    auto generation = static_cast<uint32_t>(handle >> kIndexBits);
+
+    std::lock_guard<AuditedMutex> lock(mWriteMutex);
+
+    auto& slot = mSlots[index];
+    if (slot.generation.load(std::memory_order_relaxed) != generation)
+        return;
+
+    auto source = slot.source.exchange(nullptr, std::memory_order_acq_rel);
+    if (!source)
+        return;
+
+    slot.generation.store((generation + 1) & ((1u << kGenerationBits) - 1), std::memory_order_release);
+    mFreeSlots.push_back(index);
+    mLoggedFull = false;
+
+    mRetiredSources.push_back(source);
+    releaseRetiredSources();
+}
+
+IPLSource SourceManager::retainSource(int32_t handle)
+{
+    if (handle < 0 || kMaxHandle < handle)
+        return nullptr;
+
+    auto index = handle & (kMaxSources - 1);
+    auto generation = static_cast<uint32_t>(handle >> kIndexBits);
+    auto& slot = mSlots[index];
+
+    mNumReaders.fetch_add(1);
+
+    IPLSource source = nullptr;
+    if (slot.generation.load() == generation)
     {
-        std::lock_guard<std::mutex> lock(mSourceMutex);
-        
-        if (mSources.find(handle) != mSources.end())
-        {
-            iplSourceRelease(&mSources[handle]);
-            mSources.erase(handle);
-        }
+        source = slot.source.load();
+
+        // If the slot was reused after we checked the generation, the source belongs to a different handle.
+        if (source && slot.generation.load() == generation)
+            source = iplSourceRetain(source);
+        else
+            source = nullptr;
     }
-    
-    // Mark the handle as free.
+
+    mNumReaders.fetch_sub(1);
+
+    return source;
+}
+
+void SourceManager::updateSourceParams(const int32_t* handles,
+                                       const IPLFMODSourceParams* params,
+                                       int numSources)
+{
+    std::lock_guard<AuditedMutex> lock(mWriteMutex);
+
+    for (auto i = 0; i < numSources; ++i)
     {
-        std::lock_guard<std::mutex> lock(mHandleMutex);
-        
-        mFreeHandles.push(handle);
+        auto handle = handles[i];
+        if (handle < 0 || kMaxHandle < handle)
+            continue;
+
+        auto& slot = mSlots[handle & (kMaxSources - 1)];
+        if (slot.generation.load(std::memory_order_relaxed) != static_cast<uint32_t>(handle >> kIndexBits))
+            continue;
+
+        auto version = slot.paramsVersion.load(std::memory_order_relaxed);
+
+        auto& entry = slot.params[(version + 1) & 1];
+        entry.handle = handle;
+        entry.params = params[i];
+
+        slot.paramsVersion.store(version + 1, std::memory_order_release);
     }
 }
 
-IPLSource SourceManager::getSource(int32_t handle)
+bool SourceManager::getSourceParams(int32_t handle,
+                                    IPLFMODSourceParams& params) const
 {
-    std::lock_guard<std::mutex> lock(mSourceMutex);
-    
-    if (mSources.find(handle) != mSources.end())
-        return mSources[handle];
-    else
-        return nullptr;
+    if (handle < 0 || kMaxHandle < handle)
+        return false;
+
+    const auto& slot = mSlots[handle & (kMaxSources - 1)];
+
+    auto version = slot.paramsVersion.load(std::memory_order_acquire);
+    auto entry = slot.params[version & 1];
+
+    // Updates only write to the entry that is not current, so if no update was published while we were copying, the
+    // copy is consistent.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.paramsVersion.load(std::memory_order_relaxed) != version)
+        return false;
+
+    if (entry.handle != handle)
+        return false;
+
+    params = entry.params;
+    return true;
+}
+
+void SourceManager::releaseRetiredSources()
+{
+    // Any reader that could have seen a retired source started before the source was retired, so once there are no
+    // readers, none of them can still be using it.
+    if (mRetiredSources.empty() || mNumReaders.load() != 0)
+        return;
+
+    for (auto& source : mRetiredSources)
+    {
+        iplSourceRelease(&source);
+    }
+
+    mRetiredSources.clear();
 }
 
 extern FMOD_DSP_DESCRIPTION gSpatializeEffect;
 extern FMOD_DSP_DESCRIPTION gMixerReturnEffect;
 extern FMOD_DSP_DESCRIPTION gReverbEffect;
+extern FMOD_DSP_DESCRIPTION gSpatializerGroupEffect;
 
 static FMOD_PLUGINLIST gPluginList[] =
 {
     { FMOD_PLUGINTYPE_DSP, &gSpatializeEffect },
     { FMOD_PLUGINTYPE_DSP, &gMixerReturnEffect },
     { FMOD_PLUGINTYPE_DSP, &gReverbEffect },
+    { FMOD_PLUGINTYPE_DSP, &gSpatializerGroupEffect },
     { FMOD_PLUGINTYPE_MAX, nullptr }
 };
 
 namespace SpatializeEffect { extern void initParamDescs(); }
 namespace MixerReturnEffect { extern void initParamDescs(); }
 namespace ReverbEffect { extern void initParamDescs(); }
+namespace SpatializerGroupEffect { extern void initParamDescs(); }
 
 }
 
@@ -305,6 +495,7 @@ FMOD_PLUGINLIST * F_CALL FMODGetPluginDescriptionList()
     SpatializeEffect::initParamDescs();
     MixerReturnEffect::initParamDescs();
     ReverbEffect::initParamDescs();
+    SpatializerGroupEffect::initParamDescs();
     return gPluginList;
 }
 
@@ -326,6 +517,12 @@ FMOD_DSP_DESCRIPTION* F_CALL FMOD_SteamAudio_Reverb_GetDSPDescription()
     return &SteamAudioFMOD::gReverbEffect;
 }
 
+FMOD_DSP_DESCRIPTION* F_CALL FMOD_SteamAudio_SpatializerGroup_GetDSPDescription()
+{
+    SteamAudioFMOD::SpatializerGroupEffect::initParamDescs();
+    return &SteamAudioFMOD::gSpatializerGroupEffect;
+}
+
 void F_CALL iplFMODGetVersion(unsigned int* major, 
                               unsigned int* minor, 
                               unsigned int* patch)
@@ -345,23 +542,20 @@ void F_CALL iplFMODInitialize(IPLContext context)
     gContext = iplContextRetain(context);
 
     gSourceManager = std::make_shared<SourceManager>();
+
+    gEffectBuilder.start();
+    gHRTFLoader.start();
 }
 
 void F_CALL iplFMODTerminate()
 {
-    gNewReflectionMixerWritten = false;
-    iplReflectionMixerRelease(&gReflectionMixer[0]);
-    iplReflectionMixerRelease(&gReflectionMixer[1]);
-
-    gNewReverbSourceWritten = false;
-    iplSourceRelease(&gReverbSource[0]);
-    iplSourceRelease(&gReverbSource[1]);
+    gSimulationService.stop();
+    gHRTFLoader.stop();
+    gEffectBuilder.stop();
+    gEffectPool.clear();
 
-    gIsSimulationSettingsValid = false;
-
-    gNewHRTFWritten = false;
-    iplHRTFRelease(&gHRTF[0]);
-    iplHRTFRelease(&gHRTF[1]);
+    gRenderStateManager.reset();
+    destroySpatializerGroups();
 
     iplContextRelease(&gContext);
 
@@ -370,37 +564,54 @@ void F_CALL iplFMODTerminate()
 
 void F_CALL iplFMODSetHRTF(IPLHRTF hrtf)
 {
-    if (hrtf == gHRTF[1])
-        return;
+    gRenderStateManager.setHRTF(hrtf);
+    prewarmEffectPool();
+}
 
-    if (!gNewHRTFWritten)
+IPLuint32 F_CALL iplFMODLoadHRTF(IPLAudioSettings audioSettings,
+                                 IPLHRTFSettings hrtfSettings,
+                                 IPLFMODHRTFLoadedCallback callback,
+                                 void* userData)
+{
+    return gHRTFLoader.load(gContext, audioSettings, hrtfSettings, [=](uint32_t id, IPLerror status, IPLHRTF hrtf)
     {
-        iplHRTFRelease(&gHRTF[1]);
-        gHRTF[1] = iplHRTFRetain(hrtf);
+        if (hrtf)
+        {
+            iplFMODSetHRTF(hrtf);
+        }
 
-        gNewHRTFWritten = true;
-    }
+        if (callback)
+        {
+            callback(id, status, userData);
+        }
+    });
 }
 
 void F_CALL iplFMODSetSimulationSettings(IPLSimulationSettings simulationSettings)
 {
-    gSimulationSettings = simulationSettings;
+    gRenderStateManager.setSimulationSettings(simulationSettings);
+    prewarmEffectPool();
+}
 
-    gIsSimulationSettingsValid = true;
+void F_CALL iplFMODSetEffectPoolSettings(IPLFMODEffectPoolSettings settings)
+{
+    gEffectPool.setSettings(settings.maxIdleEffects, settings.audioSettings, settings.numChannelsIn, settings.numChannelsOut);
+    prewarmEffectPool();
 }
 
-void F_CALL iplFMODSetReverbSource(IPLSource reverbSource)
+void F_CALL iplFMODSetSilenceThreshold(IPLfloat32 threshold)
 {
-    if (reverbSource == gReverbSource[1])
-        return;
+    gSilenceThreshold = std::max(threshold, 0.0f);
+}
 
-    if (!gNewReverbSourceWritten)
-    {
-        iplSourceRelease(&gReverbSource[1]);
-        gReverbSource[1] = iplSourceRetain(reverbSource);
- 
-        gNewReverbSourceWritten = true;
-    }
+void F_CALL iplFMODSetReflectionsBudget(IPLfloat32 channelSeconds)
+{
+    gReflectionBudget.setBudget(channelSeconds);
+}
+
+void F_CALL iplFMODSetReverbSource(IPLSource reverbSource)
+{
+    gRenderStateManager.setReverbSource(reverbSource);
 }
 
 IPLint32 F_CALL iplFMODAddSource(IPLSource source)
@@ -418,3 +629,209 @@ void F_CALL iplFMODRemoveSource(IPLint32 handle)
 
     gSourceManager->removeSource(handle);
 }
+
+IPLuint32 F_CALL iplFMODGetSpatializerID(void* dsp)
+{
+    return gDSPRegistry.find(dsp);
+}
+
+void F_CALL iplFMODSetSpatializerReleasedCallback(IPLFMODSpatializerReleasedCallback callback,
+                                                  void* userData)
+{
+    gDSPRegistry.setReleasedCallback(callback, userData);
+}
+
+void F_CALL iplFMODUpdateSources(const IPLint32* handles,
+                                 const IPLFMODSourceParams* params,
+                                 IPLint32 numSources)
+{
+    if (!gSourceManager || !handles || !params || numSources <= 0)
+        return;
+
+    gSourceManager->updateSourceParams(handles, params, numSources);
+}
+
+IPLbool F_CALL iplFMODGetPerfStats(void* dsp,
+                                   IPLFMODPerfStats* stats)
+{
+    if (!stats)
+        return IPL_FALSE;
+
+    PerfStats perfStats{};
+    if (dsp)
+    {
+        if (!gPerfStatsRegistry.read(dsp, perfStats))
+            return IPL_FALSE;
+    }
+    else
+    {
+        gPerfStatsRegistry.readTotal(perfStats);
+    }
+
+    stats->numProcessCalls = perfStats.numProcessCalls;
+    stats->numBypassedBlocks = perfStats.numBypassedBlocks;
+    stats->numInitFailures = perfStats.numInitFailures;
+    stats->numHRTFChanges = perfStats.numHRTFChanges;
+    stats->numHRTFCrossfades = perfStats.numHRTFCrossfades;
+    stats->directTime = perfStats.stageNanoseconds[PERFSTAGE_DIRECT];
+    stats->binauralTime = perfStats.stageNanoseconds[PERFSTAGE_BINAURAL];
+    stats->reflectionsTime = perfStats.stageNanoseconds[PERFSTAGE_REFLECTIONS];
+    stats->pathingTime = perfStats.stageNanoseconds[PERFSTAGE_PATHING];
+    stats->decodeTime = perfStats.stageNanoseconds[PERFSTAGE_DECODE];
+
+    return IPL_TRUE;
+}
+
+IPLbool F_CALL iplFMODGetRealTimeAuditCallbacks(IPLAllocateFunction* allocateCallback,
+                                                IPLFreeFunction* freeCallback)
+{
+    if (allocateCallback)
+        *allocateCallback = auditedAllocate;
+    if (freeCallback)
+        *freeCallback = auditedFree;
+
+#if defined(STEAMAUDIO_ENABLE_RT_AUDIT)
+    return IPL_TRUE;
+#else
+    return IPL_FALSE;
+#endif
+}
+
+IPLint64 F_CALL iplFMODGetRealTimeAuditReport(char* report,
+                                              IPLint32 size)
+{
+    return writeRTAuditReport(report, size);
+}
+
+void F_CALL iplFMODResetRealTimeAudit()
+{
+    resetRTAudit();
+}
+
+void F_CALL iplFMODGetAllocatorCallbacks(IPLAllocateFunction* allocateCallback,
+                                         IPLFreeFunction* freeCallback)
+{
+#if defined(STEAMAUDIO_ENABLE_RT_AUDIT)
+    if (allocateCallback)
+        *allocateCallback = auditedAllocate;
+    if (freeCallback)
+        *freeCallback = auditedFree;
+#else
+    if (allocateCallback)
+        *allocateCallback = PoolAllocator::allocateCallback;
+    if (freeCallback)
+        *freeCallback = PoolAllocator::freeCallback;
+#endif
+}
+
+IPLint32 F_CALL iplFMODGetAllocatorStats(IPLFMODAllocatorStats* stats,
+                                         IPLint32 maxSizeClasses)
+{
+    const auto kNumEntries = PoolAllocator::kLargeSizeClass + 1;
+
+    if (!stats || maxSizeClasses <= 0)
+        return kNumEntries;
+
+    PoolAllocatorStats allocatorStats[kNumEntries];
+    gPoolAllocator.getStats(allocatorStats);
+
+    for (auto i = 0; i < std::min(maxSizeClasses, kNumEntries); ++i)
+    {
+        stats[i].blockSize = allocatorStats[i].blockSize;
+        stats[i].numAllocations = allocatorStats[i].numAllocations;
+        stats[i].numActiveAllocations = allocatorStats[i].numActiveAllocations;
+        stats[i].bytesInUse = allocatorStats[i].bytesInUse;
+        stats[i].peakBytesInUse = allocatorStats[i].peakBytesInUse;
+        stats[i].bytesReserved = allocatorStats[i].bytesReserved;
+    }
+
+    return kNumEntries;
+}
+
+IPLSIMDLevel F_CALL iplFMODGetBestSIMDLevel(IPLbool autotune,
+                                            const char* cacheFileName)
+{
+    try
+    {
+        return selectSIMDLevel(autotune == IPL_TRUE, createContext, cacheFileName);
+    }
+    catch (const std::exception&)
+    {
+        // The Steam Audio library could not be loaded, so kernels can't be timed.
+        return selectSIMDLevel(false, nullptr, cacheFileName);
+    }
+}
+
+IPLerror F_CALL iplFMODStartSimulation(const IPLFMODSimulationSettings* settings)
+{
+    if (!gContext || !settings)
+        return IPL_STATUS_FAILURE;
+
+    SimulationServiceSettings serviceSettings{};
+    serviceSettings.simulationSettings = settings->simulationSettings;
+    serviceSettings.scene = settings->scene;
+    serviceSettings.probeBatches = settings->probeBatches;
+    serviceSettings.numProbeBatches = settings->probeBatches ? settings->numProbeBatches : 0;
+    serviceSettings.sharedInputs = settings->sharedInputs;
+    serviceSettings.updateInterval = settings->updateInterval;
+    serviceSettings.simulateReverb = (settings->simulateReverb == IPL_TRUE);
+
+    auto status = gSimulationService.start(gContext, serviceSettings);
+    if (status != IPL_STATUS_SUCCESS)
+        return status;
+
+    iplFMODSetSimulationSettings(settings->simulationSettings);
+
+    return IPL_STATUS_SUCCESS;
+}
+
+void F_CALL iplFMODStopSimulation()
+{
+    gSimulationService.stop();
+}
+
+IPLint32 F_CALL iplFMODSimulationAddSource(IPLSimulationFlags flags)
+{
+    return gSimulationService.addSource(flags);
+}
+
+void F_CALL iplFMODSimulationRemoveSource(IPLint32 handle)
+{
+    gSimulationService.removeSource(handle);
+}
+
+void F_CALL iplFMODSimulationSetSourceInputs(IPLint32 handle,
+                                             const IPLSimulationInputs* inputs)
+{
+    if (!inputs)
+        return;
+
+    gSimulationService.setSourceInputs(handle, *inputs);
+}
+
+void F_CALL iplFMODSimulationCommitScene()
+{
+    gSimulationService.commitScene();
+}
+
+void F_CALL iplFMODSimulationTick(IPLCoordinateSpace3 listener,
+                                  IPLfloat32 deltaTime)
+{
+    gSimulationService.tick(listener, deltaTime);
+}
+
+void F_CALL iplFMODGetSimulationStats(IPLFMODSimulationStats* stats)
+{
+    if (!stats)
+        return;
+
+    SimulationServiceStats serviceStats{};
+    gSimulationService.getStats(serviceStats);
+
+    stats->numTicks = serviceStats.numTicks;
+    stats->numIndirectUpdates = serviceStats.numIndirectUpdates;
+    stats->numSkippedIndirectUpdates = serviceStats.numSkippedIndirectUpdates;
+    stats->directTime = serviceStats.directTime;
+    stats->reflectionsTime = serviceStats.reflectionsTime;
+    stats->pathingTime = serviceStats.pathingTime;
+}
@@ -12,8 +12,8 @@
 #include <atomic>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <unordered_map>
+#include <vector>
 
 #if defined(IPL_OS_WINDOWS)
 #include <Windows.h>
@@ -26,6 +26,171 @@
 
 #include "steamaudio_fmod_version.h"
 #include "library.h"
+#include "render_state.h"
+#include "rt_audit.h"
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// API Types
+// --------------------------------------------------------------------------------------------------------------------
+
+extern "C" {
+
+/** Flags indicating which fields of \c IPLFMODSourceParams contain valid values. */
+typedef enum {
+    IPL_FMODSOURCEPARAMSFLAGS_OCCLUSION             = 1 << 0,   /**< Use \c occlusion. */
+    IPL_FMODSOURCEPARAMSFLAGS_TRANSMISSION          = 1 << 1,   /**< Use \c transmission. */
+    IPL_FMODSOURCEPARAMSFLAGS_DIRECTMIXLEVEL        = 1 << 2,   /**< Use \c directMixLevel. */
+    IPL_FMODSOURCEPARAMSFLAGS_REFLECTIONSMIXLEVEL   = 1 << 3,   /**< Use \c reflectionsMixLevel. */
+    IPL_FMODSOURCEPARAMSFLAGS_PATHINGMIXLEVEL       = 1 << 4,   /**< Use \c pathingMixLevel. */
+} IPLFMODSourceParamsFlags;
+
+/** Per-source parameters that can be sent to Steam Audio Spatializer instances in bulk, using
+    \c iplFMODUpdateSources. Each field overrides the corresponding DSP parameter. */
+typedef struct {
+    /** Which of the following fields contain valid values. Fields that are not flagged keep their current values. */
+    IPLFMODSourceParamsFlags flags;
+
+    /** Overrides the \c OCCLUSION parameter. */
+    IPLfloat32 occlusion;
+
+    /** Overrides the \c TRANSMISSION_LOW, \c TRANSMISSION_MID, and \c TRANSMISSION_HIGH parameters. */
+    IPLfloat32 transmission[3];
+
+    /** Overrides the \c DIRECT_MIXLEVEL parameter. */
+    IPLfloat32 directMixLevel;
+
+    /** Overrides the \c REFLECTIONS_MIXLEVEL parameter. */
+    IPLfloat32 reflectionsMixLevel;
+
+    /** Overrides the \c PATHING_MIXLEVEL parameter. */
+    IPLfloat32 pathingMixLevel;
+} IPLFMODSourceParams;
+
+/** A snapshot of the performance counters of one or more Steam Audio DSP instances, returned by
+    \c iplFMODGetPerfStats. All counters start at 0 when a DSP is created, and only increase. */
+typedef struct {
+    /** The number of audio frames the DSP has processed. */
+    IPLuint64 numProcessCalls;
+
+    /** The number of audio frames the DSP skipped because its inputs were idle. */
+    IPLuint64 numBypassedBlocks;
+
+    /** The number of audio frames that the DSP could not render normally because its effect objects were not
+        initialized, either because initialization failed or because it has not finished yet. */
+    IPLuint64 numInitFailures;
+
+    /** The number of times the DSP started using a different HRTF. */
+    IPLuint64 numHRTFChanges;
+
+    /** The number of HRTF changes that the DSP crossfaded, instead of switching abruptly. */
+    IPLuint64 numHRTFCrossfades;
+
+    /** Time spent applying the direct effect, in nanoseconds. */
+    IPLuint64 directTime;
+
+    /** Time spent applying binaural or panning effects to direct sound, in nanoseconds. */
+    IPLuint64 binauralTime;
+
+    /** Time spent applying reflection effects or the reflection mixer, in nanoseconds. */
+    IPLuint64 reflectionsTime;
+
+    /** Time spent applying path effects, in nanoseconds. */
+    IPLuint64 pathingTime;
+
+    /** Time spent decoding Ambisonic reflections, in nanoseconds. */
+    IPLuint64 decodeTime;
+} IPLFMODPerfStats;
+
+/** Usage counters for one size class of the plugin's pool allocator, returned by \c iplFMODGetAllocatorStats. */
+typedef struct {
+    /** The largest allocation, in bytes, served by this size class. 0 for the size class that holds allocations too
+        large (or too strictly aligned) to be pooled. */
+    IPLsize blockSize;
+
+    /** The total number of allocations made from this size class, including those that have since been freed. */
+    IPLuint64 numAllocations;
+
+    /** The number of allocations from this size class that have not been freed. */
+    IPLuint64 numActiveAllocations;
+
+    /** The number of bytes in allocations from this size class that have not been freed. */
+    IPLuint64 bytesInUse;
+
+    /** The largest value of \c bytesInUse so far. */
+    IPLuint64 peakBytesInUse;
+
+    /** The number of bytes obtained from the system for this size class, whether currently in use or not. */
+    IPLuint64 bytesReserved;
+} IPLFMODAllocatorStats;
+
+/** Callback that is called when a Steam Audio Spatializer DSP is released.
+
+    \param  dsp         The \c FMOD::DSP object that was released.
+    \param  id          The ID that \c iplFMODGetSpatializerID returned for the DSP.
+    \param  userData    The pointer passed to \c iplFMODSetSpatializerReleasedCallback. */
+typedef void (F_CALL* IPLFMODSpatializerReleasedCallback)(void* dsp, IPLuint32 id, void* userData);
+
+/** Callback that is called when a request made using \c iplFMODLoadHRTF has completed.
+
+    \param  requestId   The ID that \c iplFMODLoadHRTF returned for the request.
+    \param  status      \c IPL_STATUS_SUCCESS if the HRTF was loaded and is now in use. Otherwise, the HRTF could not
+                        be loaded, or the request was cancelled by \c iplFMODTerminate, and the previous HRTF remains
+                        in use.
+    \param  userData    The pointer passed to \c iplFMODLoadHRTF. */
+typedef void (F_CALL* IPLFMODHRTFLoadedCallback)(IPLuint32 requestId, IPLerror status, void* userData);
+
+/** Settings used to start the plugin's simulation service, using \c iplFMODStartSimulation. */
+typedef struct {
+    /** The simulation settings. \c flags determines which types of simulation are run. */
+    IPLSimulationSettings simulationSettings;
+
+    /** The scene to simulate. May be \c NULL if only direct simulation without occlusion is needed. */
+    IPLScene scene;
+
+    /** Array of probe batches to use for baked reflections or pathing. May be \c NULL. */
+    IPLProbeBatch* probeBatches;
+
+    /** The number of elements in \c probeBatches. */
+    IPLint32 numProbeBatches;
+
+    /** Inputs shared by all sources, such as the number of rays and bounces to trace. The listener is ignored; it is
+        specified on each call to \c iplFMODSimulationTick instead. */
+    IPLSimulationSharedInputs sharedInputs;
+
+    /** Minimum time, in seconds, between successive reflections and pathing simulations. Direct simulation runs on
+        every call to \c iplFMODSimulationTick. */
+    IPLfloat32 updateInterval;
+
+    /** If \c IPL_TRUE, and reflections are enabled, listener-centric reverb is also simulated, and rendered by the
+        Steam Audio Reverb DSP. */
+    IPLbool simulateReverb;
+} IPLFMODSimulationSettings;
+
+/** Counters describing the work done by the plugin's simulation service, returned by \c iplFMODGetSimulationStats.
+    All counters start at 0 when the service is started, and only increase. */
+typedef struct {
+    /** The number of calls to \c iplFMODSimulationTick. */
+    IPLuint64 numTicks;
+
+    /** The number of times reflections and pathing were simulated. */
+    IPLuint64 numIndirectUpdates;
+
+    /** The number of times reflections and pathing were due to be simulated, but were skipped because the previous
+        simulation had not finished. */
+    IPLuint64 numSkippedIndirectUpdates;
+
+    /** Time spent simulating direct sound, in nanoseconds. */
+    IPLuint64 directTime;
+
+    /** Time spent simulating reflections, in nanoseconds. */
+    IPLuint64 reflectionsTime;
+
+    /** Time spent simulating pathing, in nanoseconds. */
+    IPLuint64 pathingTime;
+} IPLFMODSimulationStats;
+
+}
 
 
 namespace SteamAudioFMOD {
@@ -47,15 +212,10 @@ enum ParameterApplyType
 // --------------------------------------------------------------------------------------------------------------------
 
 extern IPLContext gContext;
-extern IPLHRTF gHRTF[2];
-extern IPLSimulationSettings gSimulationSettings;
-extern IPLSource gReverbSource[2];
-extern IPLReflectionMixer gReflectionMixer[2];
 
-extern std::atomic<bool> gNewHRTFWritten;
-extern std::atomic<bool> gIsSimulationSettingsValid;
-extern std::atomic<bool> gNewReverbSourceWritten;
-extern std::atomic<bool> gNewReflectionMixerWritten;
+// FMOD's logging function, captured from the state of the first DSP to be created. Used to log from API functions,
+// which are not passed a DSP state. nullptr until a DSP has been created.
+extern std::atomic<FMOD_DSP_LOG_FUNC> gLogFunction;
 
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -104,15 +264,33 @@ void applyVolumeRamp(float startVolume,
 // Converts from FMOD's coordinate system structure to Steam Audio's.
 IPLCoordinateSpace3 calcCoordinates(const FMOD_3D_ATTRIBUTES& attributes);
 
-// Extracts listener coordinate system from the transform provided by FMOD.
+// Extracts listener coordinate system from the transform provided by FMOD. If there are several listeners, returns
+// listener 0.
 IPLCoordinateSpace3 calcListenerCoordinates(FMOD_DSP_STATE* state);
 
+// Extracts the coordinate systems of all of FMOD's listeners, and returns the number of listeners. listeners must have
+// room for FMOD_MAX_LISTENERS elements.
+int calcAllListenerCoordinates(FMOD_DSP_STATE* state,
+                               IPLCoordinateSpace3* listeners);
+
 // Returns true if we're currently running in the FMOD Studio editor.
 bool isRunningInEditor();
 
 // Creates a context and default HRTF. Should only be called if isRunningInEditor returns true.
 void initContextAndDefaultHRTF(IPLAudioSettings audioSettings);
 
+// Creates a context and default HRTF if we're running in the FMOD Studio editor and they haven't been created yet.
+// Also captures FMOD's logging function into gLogFunction. Must not be called while holding a RenderStateManager lock.
+void initContextIfRunningInEditor(FMOD_DSP_STATE* state);
+
+// Called by FMOD before and after each mix. Shared by all Steam Audio DSP effects. Adopts the latest published render
+// state at the start of every mix, so all effects see the same state for the duration of the mix.
+FMOD_RESULT F_CALL systemMix(FMOD_DSP_STATE* state,
+                             int stage);
+
+// Tops up the effect pool for the most recently published HRTF and simulation settings.
+void prewarmEffectPool();
+
 
 // --------------------------------------------------------------------------------------------------------------------
 // SourceManager
@@ -120,39 +298,87 @@ void initContextAndDefaultHRTF(IPLAudioSettings audioSettings);
 
 // Manages assigning a 32-bit integer handle to IPLSource objects, so the C# scripts can reference a specific IPLSource
 // in a single call to AudioSource.SetSpatializerFloat or similar.
+//
+// Sources are stored in a fixed-size slot array. A handle encodes a slot index in its low kIndexBits bits, and the
+// generation of the slot in the next kGenerationBits bits. Every time a source is removed, the generation of its slot is
+// incremented, so stale handles to a slot that has since been reused are detected. Handles are always non-negative and
+// less than 2^23, so they can be passed through a float parameter without loss of precision.
+//
+// Lookups are wait-free. Adding and removing sources is serialized by a mutex, but never blocks lookups. Removed
+// sources are not released until no lookup is in progress, so a lookup that raced with a removal can still safely
+// retain the source it found.
 class SourceManager
 {
 public:
+    static const int kIndexBits = 13;
+    static const int kGenerationBits = 10;
+    static const int kMaxSources = 1 << kIndexBits;
+    static const int32_t kMaxHandle = (1 << (kIndexBits + kGenerationBits)) - 1;
+
     SourceManager();
     ~SourceManager();
 
     // Registers a source that has already been created, and returns the corresponding handle. A reference to the
-    // IPLSource will be retained by this object.
+    // IPLSource will be retained by this object. Returns -1, and logs a warning, if all kMaxSources slots are in use.
     int32_t addSource(IPLSource source);
 
-    // Unregisters a source (by handle), and releases the reference.
+    // Unregisters a source (by handle), and releases the reference. Does nothing if the handle is stale.
     void removeSource(int32_t handle);
 
-    // Returns the IPLSource corresponding to a given handle. If the handle is invalid or the IPLSource has been
-    // released, returns nullptr. Does not retain an additional reference.
-    IPLSource getSource(int32_t handle);
+    // Returns the IPLSource corresponding to a given handle, with an additional reference that the caller must
+    // release. If the handle is invalid or stale, returns nullptr. Wait-free.
+    IPLSource retainSource(int32_t handle);
+
+    // Stores per-source parameters for a batch of sources, replacing any previously stored for them. Entries whose
+    // handles are invalid or stale are skipped.
+    void updateSourceParams(const int32_t* handles,
+                            const IPLFMODSourceParams* params,
+                            int numSources);
+
+    // Retrieves the parameters most recently stored for a source. Returns false if none have been stored since the
+    // source was added, or if they are being overwritten at the time of the call. Wait-free.
+    bool getSourceParams(int32_t handle,
+                         IPLFMODSourceParams& params) const;
 
 private:
-    // The next available integer that hasn't yet been assigned as the handle for any source.
-    int32_t mNextHandle;
+    struct SourceParamsEntry
+    {
+        int32_t handle;
+        IPLFMODSourceParams params;
+    };
+
+    struct Slot
+    {
+        std::atomic<uint32_t> generation;
+        std::atomic<IPLSource> source;
+
+        // Parameters stored by updateSourceParams. Each update is written to the entry that is not current, and then
+        // published by incrementing paramsVersion. The current entry is params[paramsVersion & 1].
+        std::atomic<uint32_t> paramsVersion;
+        SourceParamsEntry params[2];
+    };
+
+    Slot mSlots[kMaxSources];
 
-    // Handles for sources that have been unregistered, and which can now be reused. We will prefer reusing free
-    // handle values over using a new handle value.
-    std::priority_queue<int32_t> mFreeHandles;
+    // The number of retainSource calls in progress.
+    std::atomic<int> mNumReaders;
 
-    // The mapping from handle values to IPLSource objects.
-    std::unordered_map<int32_t, IPLSource> mSources;
+    // Slots that are not in use. Only accessed while holding mWriteMutex.
+    std::vector<int32_t> mFreeSlots;
 
-    // Synchronizes access to the handle priority queue and related values.
-    std::mutex mHandleMutex;
+    // True if a warning has been logged since all slots last became used, so that a game that keeps trying to add
+    // sources doesn't flood the log. Only accessed while holding mWriteMutex.
+    bool mLoggedFull;
 
-    // Synchronizes access to the handle-to-source map.
-    std::mutex mSourceMutex;
+    // Sources that have been removed, but may still be in the process of being retained by a reader. Only accessed
+    // while holding mWriteMutex.
+    std::vector<IPLSource> mRetiredSources;
+
+    // Serializes addSource and removeSource.
+    AuditedMutex mWriteMutex;
+
+    // Releases retired sources, if no reader can still be using them. Must be called while holding mWriteMutex.
+    void releaseRetiredSources();
 };
 
 }
@@ -171,6 +397,7 @@ F_EXPORT FMOD_PLUGINLIST* F_CALL FMODGetPluginDescriptionList();
 F_EXPORT FMOD_DSP_DESCRIPTION* F_CALL FMOD_SteamAudio_Spatialize_GetDSPDescription();
 F_EXPORT FMOD_DSP_DESCRIPTION* F_CALL FMOD_SteamAudio_MixerReturn_GetDSPDescription();
 F_EXPORT FMOD_DSP_DESCRIPTION* F_CALL FMOD_SteamAudio_Reverb_GetDSPDescription();
+F_EXPORT FMOD_DSP_DESCRIPTION* F_CALL FMOD_SteamAudio_SpatializerGroup_GetDSPDescription();
 
 /**
  *  Returns the version of the FMOD Studio integration being used.
@@ -203,6 +430,25 @@ F_EXPORT void F_CALL iplFMODTerminate();
  */
 F_EXPORT void F_CALL iplFMODSetHRTF(IPLHRTF hrtf);
 
+/**
+ *  Creates an HRTF on a background thread, and starts using it for spatialization once it has been created, as if
+ *  \c iplFMODSetHRTF had been called. Use this to switch HRTFs during gameplay (for example, when the user selects a
+ *  different SOFA file in a settings menu) without stalling the calling thread. Spatializers crossfade from the
+ *  previous HRTF to the new one over one audio frame.
+ *
+ *  Requests are handled in the order in which they are made, so if several are made in quick succession, the HRTF
+ *  from the last successful request ends up in use. This function must be called after \c iplFMODInitialize.
+ *
+ *  \param  audioSettings   The audio settings to create the HRTF with.
+ *  \param  hrtfSettings    The HRTF settings. If a SOFA file name or SOFA data is given, it is copied, and need not
+ *                          remain valid after this function returns.
+ *  \param  callback        Called on the background thread once the request has completed. May be NULL.
+ *  \param  userData        Pointer passed to \c callback.
+ *
+ *  \return An ID identifying the request, or 0 if the request could not be made.
+ */
+F_EXPORT IPLuint32 F_CALL iplFMODLoadHRTF(IPLAudioSettings audioSettings, IPLHRTFSettings hrtfSettings, IPLFMODHRTFLoadedCallback callback, void* userData);
+
 /**
  *  Specifies the simulation settings used by the game engine for simulating direct and/or indirect sound propagation.
  *  This function must be called once during initialization, after \c iplFMODInitialize.
@@ -220,8 +466,274 @@ F_EXPORT void F_CALL iplFMODSetSimulationSettings(IPLSimulationSettings simulati
  */
 F_EXPORT void F_CALL iplFMODSetReverbSource(IPLSource reverbSource);
 
+/** Settings for the pool of Steam Audio effect objects that are reused across Steam Audio Spatializer instances. */
+typedef struct {
+    /** The maximum number of unused effect objects of each type and configuration to keep for reuse. This is also the
+        number of effect objects created up front for the configuration described by the remaining fields, so that
+        the first events played don't need to create them. Defaults to 16. */
+    IPLint32 maxIdleEffects;
+
+    /** The sampling rate and frame size of the FMOD mixer. If the sampling rate is 0, no effect objects are created
+        up front. */
+    IPLAudioSettings audioSettings;
+
+    /** The number of channels in the events that will be spatialized. Typically 1. */
+    IPLint32 numChannelsIn;
+
+    /** The number of channels output by the Steam Audio Spatializer. Typically 2. */
+    IPLint32 numChannelsOut;
+} IPLFMODEffectPoolSettings;
+
+/**
+ *  Configures the pool of effect objects that are reused across Steam Audio Spatializer instances. When an event
+ *  instance is released, its effect objects are reset and kept for use by the next event instance with the same
+ *  settings, instead of being destroyed. This function may be called at any time after \c iplFMODInitialize. Effect
+ *  objects are created up front once \c iplFMODSetHRTF has been called.
+ *
+ *  \param  settings    The effect pool settings.
+ */
+F_EXPORT void F_CALL iplFMODSetEffectPoolSettings(IPLFMODEffectPoolSettings settings);
+
+/**
+ *  Specifies the overall gain below which a Steam Audio Spatializer reports its event as silent. FMOD uses the overall
+ *  gain reported by each DSP to decide which events to virtualize, so raising this threshold lets FMOD virtualize
+ *  distant or heavily occluded events sooner. The default is 0, i.e., events are never reported as silent. This
+ *  function may be called at any time after \c iplFMODInitialize.
+ *
+ *  \param  threshold   The linear gain below which events are treated as silent.
+ */
+F_EXPORT void F_CALL iplFMODSetSilenceThreshold(IPLfloat32 threshold);
+
+/**
+ *  Limits the total CPU cost of convolution reverb across all Steam Audio Spatializer instances that apply
+ *  reflections. The budget is the total number of Ambisonic channels times IR duration, in seconds, that may be
+ *  convolved each audio frame. Each frame, sources are ranked by how loud their reflections are likely to be, based on
+ *  distance attenuation and reflections mix level. In that order, each source convolves the highest Ambisonic order
+ *  and longest IR duration, up to those in the simulation settings, that fit in what remains of the budget. Sources
+ *  for which nothing fits don't render reflections. Sources that are already rendering reflections are favored over
+ *  sources with slightly higher priority, so that sources don't repeatedly switch levels of detail, and reflections
+ *  are faded in and out when a source gains or loses its place in the budget. The budget only applies to convolution
+ *  and hybrid reverb, when no reflection mixer is in use. This function may be called at any time after
+ *  \c iplFMODInitialize.
+ *
+ *  \param  channelSeconds  The budget, in channel-seconds. If 0 (the default), there is no limit.
+ */
+F_EXPORT void F_CALL iplFMODSetReflectionsBudget(IPLfloat32 channelSeconds);
+
+/**
+ *  Registers an \c IPLSource object used by the game engine for simulation, so that Steam Audio Spatializer effects
+ *  can use its simulation outputs. A reference to the source is retained until \c iplFMODRemoveSource is called.
+ *
+ *  At most 8192 sources can be registered at the same time. If this limit is reached, this function logs a warning
+ *  using FMOD's logging system, and returns -1 until some sources are removed. Sources that are no longer used should
+ *  therefore always be removed.
+ *
+ *  \param  source  The source to register.
+ *
+ *  \return A handle to the source, to use as the value of the \c SIMULATION_OUTPUTS_HANDLE parameter of the Steam
+ *          Audio Spatializer, or -1 if the source could not be registered.
+ */
 F_EXPORT IPLint32 F_CALL iplFMODAddSource(IPLSource source);
 
+/**
+ *  Unregisters a source registered using \c iplFMODAddSource, and releases the reference to it. The handle may
+ *  eventually be returned again by a later call to \c iplFMODAddSource, so it should not be used after this call.
+ *
+ *  \param  handle  The handle returned by \c iplFMODAddSource.
+ */
 F_EXPORT void F_CALL iplFMODRemoveSource(IPLint32 handle);
 
+/**
+ *  Checks whether a DSP is a Steam Audio Spatializer, without querying FMOD for its name. This is much faster than
+ *  calling \c FMOD::DSP::getInfo, and can be used when searching an event instance's channel group for the
+ *  spatializer.
+ *
+ *  \param  dsp     The \c FMOD::DSP object to check.
+ *
+ *  \return A nonzero ID if \c dsp is a Steam Audio Spatializer that has not been released, 0 otherwise. IDs are
+ *          never reused, so comparing the ID of a previously found DSP to the value returned by a later call detects
+ *          that the DSP was released, even if FMOD has since created another spatializer with the same address.
+ */
+F_EXPORT IPLuint32 F_CALL iplFMODGetSpatializerID(void* dsp);
+
+/**
+ *  Specifies a function to call whenever a Steam Audio Spatializer DSP is released, so the game engine can forget any
+ *  references to it. The callback is called on the thread that releases the DSP.
+ *
+ *  \param  callback    The function to call, or \c NULL to stop receiving callbacks.
+ *  \param  userData    Pointer passed to the callback.
+ */
+F_EXPORT void F_CALL iplFMODSetSpatializerReleasedCallback(IPLFMODSpatializerReleasedCallback callback, void* userData);
+
+/**
+ *  Sends per-source parameters to the Steam Audio Spatializer instances of many sources in a single call. Each
+ *  Steam Audio Spatializer whose \c SIMULATION_OUTPUTS_HANDLE parameter is set to one of the given handles uses the
+ *  corresponding parameters from its next audio frame onwards. This is typically called once per frame, instead of
+ *  setting the corresponding parameters on each DSP.
+ *
+ *  \param  handles     Array of handles obtained by calling \c iplFMODAddSource.
+ *  \param  params      Array of parameters, one for each handle.
+ *  \param  numSources  The number of elements in \c handles and \c params.
+ */
+F_EXPORT void F_CALL iplFMODUpdateSources(const IPLint32* handles, const IPLFMODSourceParams* params, IPLint32 numSources);
+
+/**
+ *  Reads the performance counters of a Steam Audio Spatializer, Reverb, or Mixer Return DSP. Counters are updated
+ *  without locking as each DSP processes audio, so this function may be called on any thread, at any time after
+ *  \c iplFMODInitialize. Call it periodically and subtract successive snapshots to measure cost over an interval.
+ *
+ *  \param  dsp     The \c FMOD::DSP object whose counters to read. If \c NULL, the counters of all Steam Audio DSPs,
+ *                  including those that have since been released, are summed.
+ *  \param  stats   [out] The counters.
+ *
+ *  \return \c IPL_TRUE if the counters were read, \c IPL_FALSE if \c dsp is not a Steam Audio DSP, or has been
+ *          released.
+ */
+F_EXPORT IPLbool F_CALL iplFMODGetPerfStats(void* dsp, IPLFMODPerfStats* stats);
+
+/**
+ *  Returns allocation callbacks that record allocations made by Steam Audio while a Steam Audio DSP is processing
+ *  audio. To use them, set \c IPLContextSettings::allocateCallback and \c IPLContextSettings::freeCallback to the
+ *  returned functions when creating the context passed to \c iplFMODInitialize. Only useful if the plugin was built
+ *  with the real-time audit enabled (\c STEAMAUDIOFMOD_ENABLE_RT_AUDIT); otherwise, the callbacks allocate memory
+ *  without recording anything.
+ *
+ *  \param  allocateCallback    [out] The allocation callback.
+ *  \param  freeCallback        [out] The deallocation callback.
+ *
+ *  \return \c IPL_TRUE if the plugin was built with the real-time audit enabled.
+ */
+F_EXPORT IPLbool F_CALL iplFMODGetRealTimeAuditCallbacks(IPLAllocateFunction* allocateCallback, IPLFreeFunction* freeCallback);
+
+/**
+ *  Summarizes the calls that may block, made while a Steam Audio DSP was processing audio, that the real-time audit has
+ *  recorded so far. This includes heap allocations, mutex locks, and system calls, along with the call stacks they were
+ *  made from. May be called on any thread.
+ *
+ *  \param  report  [out] Buffer to write the summary to, as null-terminated text. Truncated if needed. May be \c NULL.
+ *  \param  size    Size of \c report, in bytes.
+ *
+ *  \return The total number of calls recorded, or -1 if the plugin was built without the real-time audit.
+ */
+F_EXPORT IPLint64 F_CALL iplFMODGetRealTimeAuditReport(char* report, IPLint32 size);
+
+/**
+ *  Discards all calls recorded by the real-time audit so far. Does nothing if the plugin was built without it.
+ */
+F_EXPORT void F_CALL iplFMODResetRealTimeAudit();
+
+/**
+ *  Returns the callbacks of the plugin's pool allocator, for use in \c IPLContextSettings::allocateCallback and
+ *  \c IPLContextSettings::freeCallback. The allocator rounds allocations up to one of a fixed set of size classes, four
+ *  per octave, and reuses freed memory within each size class, which avoids fragmenting the heap over long sessions.
+ *  Chunks of memory that are no longer used are returned to the system. The context that the plugin creates when
+ *  running in FMOD Studio uses this allocator; games can use it for their own context too. If the plugin was built
+ *  with the real-time audit, the callbacks also record allocations made from real-time code.
+ *
+ *  \param  allocateCallback    [out] The allocation callback.
+ *  \param  freeCallback        [out] The deallocation callback.
+ */
+F_EXPORT void F_CALL iplFMODGetAllocatorCallbacks(IPLAllocateFunction* allocateCallback, IPLFreeFunction* freeCallback);
+
+/**
+ *  Reads the usage counters of the plugin's pool allocator, one entry per size class, in increasing order of block
+ *  size, followed by one entry for allocations too large to be pooled. May be called on any thread.
+ *
+ *  \param  stats           [out] Array to fill in. May be \c NULL.
+ *  \param  maxSizeClasses  The number of elements in \c stats.
+ *
+ *  \return The total number of size classes, which may be more than \c maxSizeClasses.
+ */
+F_EXPORT IPLint32 F_CALL iplFMODGetAllocatorStats(IPLFMODAllocatorStats* stats, IPLint32 maxSizeClasses);
+
+/**
+ *  Returns the SIMD level to use for \c IPLContextSettings::simdLevel on the machine this is running on. By default,
+ *  this is the highest level that the CPU and OS support.
+ *
+ *  If \c autotune is \c IPL_TRUE, Steam Audio's binaural and Ambisonics convolution kernels are first timed at each
+ *  supported level, and the fastest level is returned instead. A lower level is only chosen if it is clearly faster,
+ *  which can happen on CPUs that lower their clock speed when running AVX-512 instructions. Autotuning takes a
+ *  fraction of a second, so call this during startup, not on the audio thread.
+ *
+ *  The result of autotuning is saved to a file, and reused by later calls (with or without \c autotune) on the same
+ *  machine, with the same version of Steam Audio. The context that the plugin creates when running in FMOD Studio
+ *  also uses this result.
+ *
+ *  \param  autotune        If \c IPL_TRUE, time each SIMD level unless a saved result is available.
+ *  \param  cacheFileName   Path of the file in which to save the result of autotuning. If \c NULL, a file in the
+ *                          user's cache directory is used.
+ *
+ *  \return The SIMD level to use.
+ */
+F_EXPORT IPLSIMDLevel F_CALL iplFMODGetBestSIMDLevel(IPLbool autotune, const char* cacheFileName);
+
+/**
+ *  Starts the plugin's simulation service, for games that use FMOD without a game engine integration. The service
+ *  creates a simulator, along with sources registered using \c iplFMODSimulationAddSource, and simulates them on each
+ *  call to \c iplFMODSimulationTick. Direct sound is simulated on the calling thread; reflections and pathing are
+ *  simulated on a worker thread, and their results are used by Steam Audio Spatializer instances as soon as they are
+ *  available. The simulation settings are also passed to \c iplFMODSetSimulationSettings. Must be called after
+ *  \c iplFMODInitialize.
+ *
+ *  \param  settings    The settings to use.
+ *
+ *  \return Status code indicating whether or not the service was started. Fails if it is already running.
+ */
+F_EXPORT IPLerror F_CALL iplFMODStartSimulation(const IPLFMODSimulationSettings* settings);
+
+/**
+ *  Stops the plugin's simulation service, waiting for any simulation in progress to finish, and removes all sources
+ *  added to it. Called automatically by \c iplFMODTerminate.
+ */
+F_EXPORT void F_CALL iplFMODStopSimulation();
+
+/**
+ *  Creates a source to be simulated by the simulation service, from the next call to \c iplFMODSimulationTick on.
+ *  Sources created this way count towards the limit of 8192 sources described in \c iplFMODAddSource.
+ *
+ *  \param  flags   The types of simulation to run for this source.
+ *
+ *  \return A handle to the source, to use as the value of the \c SIMULATION_OUTPUTS_HANDLE parameter of the Steam
+ *          Audio Spatializer, or -1 if the source could not be created.
+ */
+F_EXPORT IPLint32 F_CALL iplFMODSimulationAddSource(IPLSimulationFlags flags);
+
+/**
+ *  Removes a source created using \c iplFMODSimulationAddSource. The handle becomes invalid immediately.
+ *
+ *  \param  handle  The handle of the source to remove.
+ */
+F_EXPORT void F_CALL iplFMODSimulationRemoveSource(IPLint32 handle);
+
+/**
+ *  Specifies the inputs used to simulate a source, such as its position and orientation, from the next call to
+ *  \c iplFMODSimulationTick on. May be called on any thread.
+ *
+ *  \param  handle  The handle of the source.
+ *  \param  inputs  The simulation inputs.
+ */
+F_EXPORT void F_CALL iplFMODSimulationSetSourceInputs(IPLint32 handle, const IPLSimulationInputs* inputs);
+
+/**
+ *  Requests that the scene be committed before it is next simulated. Call this after adding, removing, or moving
+ *  geometry in the scene passed to \c iplFMODStartSimulation, instead of calling \c iplSceneCommit directly.
+ */
+F_EXPORT void F_CALL iplFMODSimulationCommitScene();
+
+/**
+ *  Runs one step of simulation. Typically called once per game frame, on the game's main thread. Does not wait for
+ *  reflections or pathing to be simulated.
+ *
+ *  \param  listener    The position and orientation of the listener.
+ *  \param  deltaTime   The time since the previous call, in seconds.
+ */
+F_EXPORT void F_CALL iplFMODSimulationTick(IPLCoordinateSpace3 listener, IPLfloat32 deltaTime);
+
+/**
+ *  Reads the counters of the simulation service. May be called on any thread.
+ *
+ *  \param  stats   [out] The counters.
+ */
+F_EXPORT void F_CALL iplFMODGetSimulationStats(IPLFMODSimulationStats* stats);
+
 }
@@ -4,6 +4,7 @@
 //
 
 #include "steamaudio_unity_native.h"
+#include "audio_kernels.h"
 
 namespace SteamAudioUnity {
 
@@ -182,7 +183,8 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK setParam(UnityAudioEffectState* st
 static void remapAmbisonicsToOutChannels(unsigned int numSamples,
                                          int numAmbisonicsChannelsOut,
                                          int numChannelsOut,
-                                         float* const* ambisonicsOut,
+                                         const IPLAudioBuffer& ambisonicsOut,
+                                         float scalar,
                                          float* out)
 {
     // Remapping is needed to output audio in a way that makes sense to Unity. Following is a note from Unity's
@@ -198,13 +200,11 @@ static void remapAmbisonicsToOutChannels(unsigned int numSamples,
     // the plugin should output its spatialized data to the first 2 channels and zero out the other 2 channels.
 
     auto numChannels = std::min(numAmbisonicsChannelsOut, numChannelsOut);
-    for (auto i = 0u; i < numSamples; ++i)
-    {
-        for (auto j = 0; j < numChannels; ++j)
-        {
-            out[i * numChannelsOut + j] = ambisonicsOut[j][i];
-        }
-    }
+
+    auto buffer = ambisonicsOut;
+    buffer.numSamples = std::min(buffer.numSamples, static_cast<int>(numSamples));
+
+    interleaveScaled(buffer, numChannels, numChannelsOut, scalar, out);
 }
 
 UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* state,
@@ -214,6 +214,8 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* sta
                                                       int numChannelsIn,
                                                       int numChannelsOut)
 {
+    RTAuditScope auditScope;
+
     assert(state);
     assert(in);
     assert(out);
@@ -293,17 +295,13 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* sta
 
     iplAmbisonicsDecodeEffectApply(effect->ambisonicsDecodeEffect, &decodeParams, &effect->n3dInBuffer, &effect->outBuffer);
 
-    remapAmbisonicsToOutChannels(numSamples, state->ambisonicdata->ambisonicOutChannels, numChannelsOut, effect->outBuffer.data, out);
-
     // Normalize the output so that an Ambisonics order 0 clip with peak magnitude 1 is comparable to an
-    // unspatialized mono clip of peak magnitude 1.
+    // unspatialized mono clip of peak magnitude 1. This is applied while remapping, to avoid another pass over the
+    // output.
     const auto kPi = 3.141592f;
     auto scalar = 1.0f / sqrtf(4.0f * kPi);
 
-    for (auto i = 0u; i < numSamples * numChannelsOut; ++i)
-    {
-        out[i] *= scalar;
-    }
+    remapAmbisonicsToOutChannels(numSamples, state->ambisonicdata->ambisonicOutChannels, numChannelsOut, effect->outBuffer, scalar, out);
 
     return UNITY_AUDIODSP_OK;
 }
@@ -4,6 +4,8 @@
 //
 
 #include "steamaudio_unity_native.h"
+#include "audio_kernels.h"
+#include "perf_stats.h"
 
 namespace SteamAudioUnity {
 
@@ -31,6 +33,8 @@ struct State
     IPLAudioBuffer outBuffer;
 
     IPLAmbisonicsDecodeEffect ambisonicsEffect;
+
+    PerfCounters perf;
 };
 
 enum InitFlags
@@ -68,8 +72,11 @@ InitFlags lazyInit(UnityAudioEffectState* state,
 
     if (!state->effectdata)
     {
-        state->effectdata = new State();
+        auto effect = new State();
+        state->effectdata = effect;
         reset(state);
+
+        gPerfStatsRegistry.add(state, &effect->perf);
     }
 
     auto effect = state->GetEffectData<State>();
@@ -162,8 +169,12 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK create(UnityAudioEffectState* stat
 {
     assert(state);
 
-    state->effectdata = new State();
+    auto effect = new State();
+    state->effectdata = effect;
     reset(state);
+
+    gPerfStatsRegistry.add(state, &effect->perf);
+
     lazyInit(state, 0, 0);
     return UNITY_AUDIODSP_OK;
 }
@@ -179,6 +190,8 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK release(UnityAudioEffectState* sta
     if (!effect)
         return UNITY_AUDIODSP_OK;
 
+    gPerfStatsRegistry.remove(state);
+
     iplAudioBufferFree(gContext, &effect->reflectionsBuffer);
     iplAudioBufferFree(gContext, &effect->inBuffer);
     iplAudioBufferFree(gContext, &effect->outBuffer);
@@ -239,6 +252,8 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* sta
                                                       int numChannelsIn,
                                                       int numChannelsOut)
 {
+    RTAuditScope auditScope;
+
     assert(state);
     assert(in);
     assert(out);
@@ -258,14 +273,22 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* sta
 
     // Make sure that audio processing state has been initialized. If initialization fails, stop and emit silence.
     auto initFlags = lazyInit(state, numChannelsIn, numChannelsOut);
+
+    auto effect = state->GetEffectData<State>();
+    if (!effect)
+        return UNITY_AUDIODSP_OK;
+
+    effect->perf.countProcessCall();
+
     if (!(initFlags & INIT_AUDIOBUFFERS) || !(initFlags & INIT_REFLECTIONEFFECT) || !(initFlags & INIT_AMBISONICSEFFECT))
+    {
+        effect->perf.countInitFailure();
         return UNITY_AUDIODSP_OK;
+    }
 
     getLatestHRTF();
 
-    auto effect = state->GetEffectData<State>();
-    if (!effect)
-        return UNITY_AUDIODSP_OK;
+    effect->perf.countHRTFChange(gHRTF[0]);
 
     // TODO: Need to deprecate Unity versions that don't support spatializerdata on mixer effects!
     if (!state->spatializerdata)
@@ -281,20 +304,26 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* sta
     reflectionParams.numChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
     reflectionParams.tanDevice = gSimulationSettings.tanDevice;
 
-    iplReflectionMixerApply(gReflectionMixer[0], &reflectionParams, &effect->reflectionsBuffer);
+    {
+        PerfTimer timer(effect->perf, PERFSTAGE_REFLECTIONS);
+        iplReflectionMixerApply(gReflectionMixer[0], &reflectionParams, &effect->reflectionsBuffer);
+    }
 
-    IPLAmbisonicsDecodeEffectParams ambisonicsParams;
-    ambisonicsParams.order = gSimulationSettings.maxOrder;
-    ambisonicsParams.hrtf = gHRTF[0];
-    ambisonicsParams.orientation = listenerCoordinates;
-    ambisonicsParams.binaural = (effect->binaural) ? IPL_TRUE : IPL_FALSE;
+    {
+        PerfTimer timer(effect->perf, PERFSTAGE_DECODE);
 
-    iplAmbisonicsDecodeEffectApply(effect->ambisonicsEffect, &ambisonicsParams, &effect->reflectionsBuffer, &effect->outBuffer);
+        IPLAmbisonicsDecodeEffectParams ambisonicsParams;
+        ambisonicsParams.order = gSimulationSettings.maxOrder;
+        ambisonicsParams.hrtf = gHRTF[0];
+        ambisonicsParams.orientation = listenerCoordinates;
+        ambisonicsParams.binaural = (effect->binaural) ? IPL_TRUE : IPL_FALSE;
 
-    iplAudioBufferDeinterleave(gContext, in, &effect->inBuffer);
-    iplAudioBufferMix(gContext, &effect->inBuffer, &effect->outBuffer);
+        iplAmbisonicsDecodeEffectApply(effect->ambisonicsEffect, &ambisonicsParams, &effect->reflectionsBuffer, &effect->outBuffer);
+    }
 
+    // The input is mixed in after interleaving, so it doesn't need to be deinterleaved.
     iplAudioBufferInterleave(gContext, &effect->outBuffer, out);
+    mixInto(in, numChannelsIn * effect->outBuffer.numSamples, out);
 
     return UNITY_AUDIODSP_OK;
 }
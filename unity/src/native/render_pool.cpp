@@ -0,0 +1,327 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include "render_pool.h"
+#include "rt_audit.h"
+
+namespace SteamAudioUnity {
+
+// How long a worker keeps looking for jobs after running out, before going to sleep. Jobs are submitted in bursts, one
+// per effect, so this keeps workers awake for the rest of a burst without the mixer thread having to wake them.
+static const int64_t kSpinNanoseconds = 200000;
+
+static int64_t currentTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// RenderJob
+// --------------------------------------------------------------------------------------------------------------------
+
+RenderJob::RenderJob()
+    : mState(STATE_IDLE)
+{}
+
+bool RenderJob::isIdle() const
+{
+    return (mState.load(std::memory_order_acquire) == STATE_IDLE);
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// RenderPool
+// --------------------------------------------------------------------------------------------------------------------
+
+const size_t RenderPool::kQueueSize;
+const int RenderPool::kMaxThreads;
+
+RenderPool gRenderPool;
+
+RenderPool::RenderPool()
+    : mEnqueuePosition(0)
+    , mDequeuePosition(0)
+    , mNumPendingJobs(0)
+    , mTick(std::numeric_limits<uint64_t>::max())
+    , mDeadline(0)
+    , mMaxWait(0.5f)
+    , mRunning(false)
+    , mNumSleepingThreads(0)
+    , mStopRequested(false)
+{
+    for (auto i = 0u; i < kQueueSize; ++i)
+    {
+        mQueue[i].sequence.store(i, std::memory_order_relaxed);
+        mQueue[i].job = nullptr;
+    }
+}
+
+RenderPool::~RenderPool()
+{
+    stop();
+}
+
+bool RenderPool::isRunning() const
+{
+    return mRunning.load(std::memory_order_acquire);
+}
+
+void RenderPool::start(int numThreads,
+                       float maxWait)
+{
+    stop();
+
+    if (numThreads <= 0)
+    {
+        numThreads = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    }
+
+    numThreads = std::max(1, std::min(numThreads, kMaxThreads));
+
+    mMaxWait.store(std::max(maxWait, 0.0f), std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mStopRequested = false;
+
+    for (auto i = 0; i < numThreads; ++i)
+    {
+        mThreads.emplace_back(&RenderPool::threadProc, this);
+    }
+
+    mRunning.store(true, std::memory_order_release);
+}
+
+void RenderPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (!mRunning)
+            return;
+
+        mRunning.store(false, std::memory_order_release);
+        mStopRequested = true;
+    }
+
+    mCondition.notify_all();
+
+    for (auto& thread : mThreads)
+    {
+        thread.join();
+    }
+
+    mThreads.clear();
+
+    // A job may have been submitted after the workers' last check of the queue. Any job submitted from now on is
+    // rendered by the thread that submits it.
+    while (runOne())
+    {}
+}
+
+void RenderPool::beginTick(uint64_t tick,
+                           float blockDuration)
+{
+    if (mTick.exchange(tick, std::memory_order_acq_rel) == tick)
+        return;
+
+    auto maxWait = mMaxWait.load(std::memory_order_relaxed) * blockDuration;
+    mDeadline.store(currentTime() + static_cast<int64_t>(maxWait * 1e9f), std::memory_order_release);
+
+    // No job has been submitted in this tick yet, so every pending job is from an earlier one.
+    help([this]() { return (mNumPendingJobs.load(std::memory_order_acquire) == 0); }, true);
+}
+
+void RenderPool::submit(RenderJob* job)
+{
+    auto expected = static_cast<int>(RenderJob::STATE_IDLE);
+    if (!job->mState.compare_exchange_strong(expected, RenderJob::STATE_QUEUED, std::memory_order_acq_rel))
+        return;
+
+    mNumPendingJobs.fetch_add(1, std::memory_order_acq_rel);
+
+    if (!mRunning.load(std::memory_order_acquire) || !enqueue(job))
+    {
+        run(job);
+        return;
+    }
+
+    // Pairs with the fence in threadProc, so that either the worker sees this job before going to sleep, or we see that
+    // it is sleeping. Notifying without holding the mutex may still occasionally miss a worker, which wakes up
+    // periodically to pick up such jobs.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mNumSleepingThreads.load(std::memory_order_relaxed) > 0)
+    {
+        recordRTAuditEvent(RTAUDITEVENT_SYSCALL, "condition_variable::notify_one");
+        mCondition.notify_one();
+    }
+}
+
+bool RenderPool::wait(RenderJob* job)
+{
+    return help([job]() { return job->isIdle(); }, isRunning());
+}
+
+void RenderPool::finish(RenderJob* job)
+{
+    help([job]() { return job->isIdle(); }, false);
+}
+
+bool RenderPool::enqueue(RenderJob* job)
+{
+    auto position = mEnqueuePosition.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        auto& cell = mQueue[position % kQueueSize];
+        auto sequence = cell.sequence.load(std::memory_order_acquire);
+        auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+        if (difference == 0)
+        {
+            if (mEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                cell.job = job;
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            return false;
+        }
+        else
+        {
+            position = mEnqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+RenderJob* RenderPool::dequeue()
+{
+    auto position = mDequeuePosition.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        auto& cell = mQueue[position % kQueueSize];
+        auto sequence = cell.sequence.load(std::memory_order_acquire);
+        auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+        if (difference == 0)
+        {
+            if (mDequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                auto job = cell.job;
+                cell.sequence.store(position + kQueueSize, std::memory_order_release);
+                return job;
+            }
+        }
+        else if (difference < 0)
+        {
+            return nullptr;
+        }
+        else
+        {
+            position = mDequeuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void RenderPool::run(RenderJob* job)
+{
+    job->mState.store(RenderJob::STATE_RUNNING, std::memory_order_relaxed);
+
+    {
+        RTAuditScope auditScope;
+        job->render();
+    }
+
+    // The effect that owns the job may release it as soon as it is idle, so it must not be touched after this.
+    job->mState.store(RenderJob::STATE_IDLE, std::memory_order_release);
+    mNumPendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool RenderPool::runOne()
+{
+    auto job = dequeue();
+    if (!job)
+        return false;
+
+    run(job);
+    return true;
+}
+
+template <typename Done>
+bool RenderPool::help(Done&& done,
+                      bool useDeadline)
+{
+    if (done())
+        return true;
+
+    auto deadline = mDeadline.load(std::memory_order_acquire);
+    auto yielded = false;
+
+    while (!done())
+    {
+        if (useDeadline && currentTime() >= deadline)
+            return false;
+
+        if (!runOne())
+        {
+            if (!yielded)
+            {
+                recordRTAuditEvent(RTAUDITEVENT_SYSCALL, "this_thread::yield");
+                yielded = true;
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    return true;
+}
+
+void RenderPool::threadProc()
+{
+    auto lastJobTime = currentTime();
+
+    while (true)
+    {
+        if (runOne())
+        {
+            lastJobTime = currentTime();
+            continue;
+        }
+
+        if (currentTime() - lastJobTime < kSpinNanoseconds)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        if (mStopRequested)
+            break;
+
+        mNumSleepingThreads.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (mEnqueuePosition.load(std::memory_order_relaxed) == mDequeuePosition.load(std::memory_order_relaxed))
+        {
+            mCondition.wait_for(lock, std::chrono::milliseconds(1));
+        }
+
+        mNumSleepingThreads.fetch_sub(1, std::memory_order_relaxed);
+        lastJobTime = currentTime();
+    }
+}
+
+}
@@ -0,0 +1,147 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SteamAudioUnity {
+
+// --------------------------------------------------------------------------------------------------------------------
+// RenderJob
+// --------------------------------------------------------------------------------------------------------------------
+
+// One block of audio, handed by an effect from the mixer thread to the render pool's worker threads.
+//
+// An effect owns one job for its lifetime. From process(), it fills in the job's inputs and submits it. In the next
+// mixer tick, it calls RenderPool::wait() before reading the job's outputs or submitting it again. Until the job is
+// idle again, the effect must not touch anything that the job renders with.
+class RenderJob
+{
+public:
+    RenderJob();
+    virtual ~RenderJob() = default;
+
+    // Returns true if the job is neither queued nor running.
+    bool isIdle() const;
+
+protected:
+    // Renders the block. Called on a worker thread, or on the mixer thread if it helps out while waiting.
+    virtual void render() = 0;
+
+private:
+    friend class RenderPool;
+
+    enum State
+    {
+        STATE_IDLE,
+        STATE_QUEUED,
+        STATE_RUNNING,
+    };
+
+    std::atomic<int> mState;
+};
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// RenderPool
+// --------------------------------------------------------------------------------------------------------------------
+
+// Runs RenderJobs on a pool of worker threads, so that effects can be rendered on more than one core even though Unity
+// calls every effect's process() callback on the same mixer thread.
+//
+// Effects that render through the pool are pipelined: each block is submitted in one mixer tick, and its output is
+// played in the next, which adds one block of latency. Each tick has a deadline, some fraction of the block's duration
+// after the tick starts. The first effect to process a tick waits until every job submitted in the previous tick has
+// finished, or until the deadline. After that, an effect whose job has still not finished by the deadline must fall
+// back to something cheaper for that block. While waiting, the mixer thread runs queued jobs itself.
+//
+// Jobs are submitted through a fixed-size, lock-free queue, so submitting never blocks or allocates. If the queue is
+// full, or the pool is not running, the job is rendered on the calling thread instead.
+class RenderPool
+{
+public:
+    static const size_t kQueueSize = 1024;
+    static const int kMaxThreads = 16;
+
+    RenderPool();
+    ~RenderPool();
+
+    bool isRunning() const;
+
+    // Starts numThreads worker threads, or one fewer than the number of CPU cores if numThreads is 0. maxWait is the
+    // fraction of a block's duration after the start of a mixer tick until the tick's deadline. If the pool is already
+    // running, it is stopped first.
+    void start(int numThreads,
+               float maxWait);
+
+    // Renders any jobs still in the queue, and stops the worker threads.
+    void stop();
+
+    // Marks the start of the mixer tick with the given DSP clock, if it has not been marked already, and waits for the
+    // jobs submitted in earlier ticks. blockDuration is in seconds. Mixer thread only.
+    void beginTick(uint64_t tick,
+                   float blockDuration);
+
+    // Queues an idle job. Lock-free, may be called on the audio thread.
+    void submit(RenderJob* job);
+
+    // Waits for a job to finish, until the current tick's deadline. Returns true if the job is idle. If the pool is not
+    // running, there is no deadline. Mixer thread only.
+    bool wait(RenderJob* job);
+
+    // Waits for a job to finish, however long it takes. Must not be called on the audio thread.
+    void finish(RenderJob* job);
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        RenderJob* job;
+    };
+
+    Cell mQueue[kQueueSize];
+    std::atomic<size_t> mEnqueuePosition;
+    std::atomic<size_t> mDequeuePosition;
+
+    // The number of jobs that have been submitted but have not finished.
+    std::atomic<int> mNumPendingJobs;
+
+    std::atomic<uint64_t> mTick;
+    std::atomic<int64_t> mDeadline;
+    std::atomic<float> mMaxWait;
+
+    std::vector<std::thread> mThreads;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::atomic<bool> mRunning;
+    std::atomic<int> mNumSleepingThreads;
+    bool mStopRequested;
+
+    bool enqueue(RenderJob* job);
+    RenderJob* dequeue();
+    void run(RenderJob* job);
+
+    // Runs one queued job, if there is one. Returns false if the queue was empty.
+    bool runOne();
+
+    // Waits until done() returns true, running queued jobs in the meantime. Returns false if the deadline passes first.
+    template <typename Done>
+    bool help(Done&& done,
+              bool useDeadline);
+
+    void threadProc();
+};
+
+extern RenderPool gRenderPool;
+
+}
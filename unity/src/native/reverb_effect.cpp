@@ -4,6 +4,8 @@
 //
 
 #include "steamaudio_unity_native.h"
+#include "audio_kernels.h"
+#include "perf_stats.h"
 
 namespace SteamAudioUnity {
 
@@ -33,6 +35,8 @@ struct State
 
     IPLReflectionEffect reflectionEffect;
     IPLAmbisonicsDecodeEffect ambisonicsEffect;
+
+    PerfCounters perf;
 };
 
 enum InitFlags
@@ -70,8 +74,11 @@ InitFlags lazyInit(UnityAudioEffectState* state,
     
     if (!state->effectdata)
     {
-        state->effectdata = new State();
+        auto effect = new State();
+        state->effectdata = effect;
         reset(state);
+
+        gPerfStatsRegistry.add(state, &effect->perf);
     }
 
     auto effect = state->GetEffectData<State>();
@@ -146,8 +153,12 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK create(UnityAudioEffectState* stat
 {
     assert(state);
 
-    state->effectdata = new State();
+    auto effect = new State();
+    state->effectdata = effect;
     reset(state);
+
+    gPerfStatsRegistry.add(state, &effect->perf);
+
     lazyInit(state, 0, 0);
     return UNITY_AUDIODSP_OK;
 }
@@ -163,6 +174,8 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK release(UnityAudioEffectState* sta
     if (!effect)
         return UNITY_AUDIODSP_OK;
 
+    gPerfStatsRegistry.remove(state);
+
     iplAudioBufferFree(gContext, &effect->inBuffer);
     iplAudioBufferFree(gContext, &effect->monoBuffer);
     iplAudioBufferFree(gContext, &effect->reflectionsBuffer);
@@ -230,6 +243,8 @@ void getLatestSource()
 
 UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* state, float* in, float* out, unsigned int numSamples, int numChannelsIn, int numChannelsOut)
 {
+    RTAuditScope auditScope;
+
     assert(state);
     assert(in);
     assert(out);
@@ -249,17 +264,25 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* sta
 
     // Make sure that audio processing state has been initialized. If initialization fails, stop and emit silence.
     auto initFlags = lazyInit(state, numChannelsIn, numChannelsOut);
+
+    auto effect = state->GetEffectData<State>();
+    if (!effect)
+        return UNITY_AUDIODSP_OK;
+
+    effect->perf.countProcessCall();
+
     if (!(initFlags & INIT_AUDIOBUFFERS) || !(initFlags & INIT_REFLECTIONEFFECT) || !(initFlags & INIT_AMBISONICSEFFECT))
+    {
+        effect->perf.countInitFailure();
         return UNITY_AUDIODSP_OK;
+    }
 
     getLatestHRTF();
     getLatestSource();
 
-    if (!gReverbSource[0])
-        return UNITY_AUDIODSP_OK;
+    effect->perf.countHRTFChange(gHRTF[0]);
 
-    auto effect = state->GetEffectData<State>();
-    if (!effect)
+    if (!gReverbSource[0])
         return UNITY_AUDIODSP_OK;
 
     // TODO: Need to deprecate Unity versions that don't support spatializerdata on mixer effects!
@@ -271,8 +294,7 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* sta
 
     auto listenerCoordinates = calcListenerCoordinates(L);
 
-    iplAudioBufferDeinterleave(gContext, in, &effect->inBuffer);
-    iplAudioBufferDownmix(gContext, &effect->inBuffer, &effect->monoBuffer);
+    deinterleaveDownmix(in, numChannelsIn, effect->monoBuffer.numSamples, nullptr, effect->monoBuffer.data[0]);
 
     IPLSimulationOutputs reverbOutputs{};
     iplSourceGetOutputs(gReverbSource[0], IPL_SIMULATIONFLAGS_REFLECTIONS, &reverbOutputs);
@@ -300,10 +322,15 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* sta
         gNewReflectionMixerWritten = false;
     }
 
-    iplReflectionEffectApply(effect->reflectionEffect, &reflectionParams, &effect->monoBuffer, &effect->reflectionsBuffer, gReflectionMixer[0]);
+    {
+        PerfTimer timer(effect->perf, PERFSTAGE_REFLECTIONS);
+        iplReflectionEffectApply(effect->reflectionEffect, &reflectionParams, &effect->monoBuffer, &effect->reflectionsBuffer, gReflectionMixer[0]);
+    }
 
     if (gSimulationSettings.reflectionType != IPL_REFLECTIONEFFECTTYPE_TAN && !gReflectionMixer[0])
     {
+        PerfTimer timer(effect->perf, PERFSTAGE_DECODE);
+
         IPLAmbisonicsDecodeEffectParams ambisonicsParams;
         ambisonicsParams.order = gSimulationSettings.maxOrder;
         ambisonicsParams.hrtf = gHRTF[0];
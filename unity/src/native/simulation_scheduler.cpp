@@ -0,0 +1,280 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include <algorithm>
+
+#if defined(IPL_OS_WINDOWS)
+#include <Windows.h>
+#elif defined(IPL_OS_LINUX) || defined(IPL_OS_ANDROID)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(IPL_OS_MACOSX) || defined(IPL_OS_IOS)
+#include <pthread.h>
+#endif
+
+#include "simulation_scheduler.h"
+
+namespace SteamAudioUnity {
+
+// Sets the priority of the calling thread. priority ranges from -2 (lowest) to 2 (highest). Raising the priority above
+// the default may require privileges that the game does not have, in which case it is left unchanged.
+static void setCurrentThreadPriority(int priority)
+{
+    priority = std::max(-2, std::min(priority, 2));
+    if (priority == 0)
+        return;
+
+#if defined(IPL_OS_WINDOWS)
+    static const int kPriorities[] = { THREAD_PRIORITY_LOWEST, THREAD_PRIORITY_BELOW_NORMAL, THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_ABOVE_NORMAL, THREAD_PRIORITY_HIGHEST };
+    SetThreadPriority(GetCurrentThread(), kPriorities[priority + 2]);
+#elif defined(IPL_OS_LINUX) || defined(IPL_OS_ANDROID)
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), -5 * priority);
+#elif defined(IPL_OS_MACOSX) || defined(IPL_OS_IOS)
+    static const qos_class_t kClasses[] = { QOS_CLASS_BACKGROUND, QOS_CLASS_UTILITY, QOS_CLASS_DEFAULT, QOS_CLASS_USER_INITIATED, QOS_CLASS_USER_INTERACTIVE };
+    pthread_set_qos_class_self_np(kClasses[priority + 2], 0);
+#endif
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// SimulationScheduler
+// --------------------------------------------------------------------------------------------------------------------
+
+SimulationScheduler gSimulationScheduler;
+
+SimulationScheduler::SimulationScheduler()
+    : mSimulator(nullptr)
+    , mRunOnCallingThread(false)
+    , mRunning(false)
+    , mReadyFlags(static_cast<IPLSimulationFlags>(0))
+{
+    static const IPLSimulationFlags kFlags[] = { IPL_SIMULATIONFLAGS_DIRECT, static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_REFLECTIONS | IPL_SIMULATIONFLAGS_PATHING) };
+
+    for (auto i = 0; i < NUM_SIMULATIONSTAGES; ++i)
+    {
+        auto& stage = mStages[i];
+        stage.flag = kFlags[i];
+        stage.settings = SimulationStageSettings{};
+        stage.timeSinceUpdate = 0.0f;
+        stage.runRequested = false;
+        stage.busy = false;
+        stage.stopRequested = false;
+        stage.completed = false;
+    }
+}
+
+SimulationScheduler::~SimulationScheduler()
+{
+    stop();
+}
+
+bool SimulationScheduler::isRunning() const
+{
+    return mRunning;
+}
+
+void SimulationScheduler::start(const SimulationSchedulerSettings& settings)
+{
+    stop();
+
+    if (!settings.simulator)
+        return;
+
+    mSimulator = iplSimulatorRetain(settings.simulator);
+    mRunOnCallingThread = settings.runOnCallingThread;
+    mReadyFlags = static_cast<IPLSimulationFlags>(0);
+
+    for (auto i = 0; i < NUM_SIMULATIONSTAGES; ++i)
+    {
+        auto& stage = mStages[i];
+        stage.settings = settings.stages[i];
+
+        // Make every stage ready in the first frame.
+        stage.timeSinceUpdate = std::max(stage.settings.updateInterval, 0.0f);
+
+        stage.runRequested = false;
+        stage.busy = false;
+        stage.stopRequested = false;
+        stage.completed = false;
+
+        if (!mRunOnCallingThread)
+        {
+            stage.thread = std::thread(&SimulationScheduler::threadProc, this, std::ref(stage));
+        }
+    }
+
+    mRunning = true;
+}
+
+void SimulationScheduler::stop()
+{
+    if (!mRunning)
+        return;
+
+    for (auto& stage : mStages)
+    {
+        if (!stage.thread.joinable())
+            continue;
+
+        {
+            std::lock_guard<std::mutex> lock(stage.mutex);
+            stage.stopRequested = true;
+        }
+
+        stage.condition.notify_one();
+        stage.thread.join();
+    }
+
+    iplSimulatorRelease(&mSimulator);
+    mRunning = false;
+}
+
+void SimulationScheduler::beginFrame(float deltaTime,
+                                     IPLScene scene,
+                                     bool commitScene,
+                                     SimulationFrame& frame)
+{
+    frame.readyFlags = static_cast<IPLSimulationFlags>(0);
+    frame.completedFlags = static_cast<IPLSimulationFlags>(0);
+    frame.sceneCommitted = false;
+
+    mReadyFlags = static_cast<IPLSimulationFlags>(0);
+
+    if (!mRunning)
+        return;
+
+    auto& direct = mStages[SIMULATIONSTAGE_DIRECT];
+
+    if (!isBusy(mStages[SIMULATIONSTAGE_INDIRECT]))
+    {
+        waitUntilIdle(direct);
+
+        if (scene)
+        {
+            if (commitScene)
+            {
+                iplSceneCommit(scene);
+                frame.sceneCommitted = true;
+            }
+
+            iplSimulatorSetScene(mSimulator, scene);
+        }
+
+        iplSimulatorCommit(mSimulator);
+    }
+
+    for (auto& stage : mStages)
+    {
+        if (stage.completed.exchange(false, std::memory_order_acq_rel))
+        {
+            frame.completedFlags = static_cast<IPLSimulationFlags>(frame.completedFlags | stage.flag);
+        }
+
+        stage.timeSinceUpdate += deltaTime;
+
+        if (stage.timeSinceUpdate >= stage.settings.updateInterval && !isBusy(stage))
+        {
+            mReadyFlags = static_cast<IPLSimulationFlags>(mReadyFlags | stage.flag);
+        }
+    }
+
+    frame.readyFlags = mReadyFlags;
+}
+
+void SimulationScheduler::endFrame(const IPLSimulationSharedInputs& sharedInputs)
+{
+    if (!mRunning || mReadyFlags == 0)
+        return;
+
+    auto inputs = sharedInputs;
+    iplSimulatorSetSharedInputs(mSimulator, mReadyFlags, &inputs);
+
+    for (auto& stage : mStages)
+    {
+        if (!(mReadyFlags & stage.flag))
+            continue;
+
+        stage.timeSinceUpdate = 0.0f;
+
+        if (mRunOnCallingThread)
+        {
+            run(stage);
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stage.mutex);
+            stage.runRequested = true;
+            stage.busy = true;
+        }
+
+        stage.condition.notify_one();
+    }
+
+    mReadyFlags = static_cast<IPLSimulationFlags>(0);
+}
+
+bool SimulationScheduler::isBusy(Stage& stage)
+{
+    std::lock_guard<std::mutex> lock(stage.mutex);
+    return stage.busy;
+}
+
+void SimulationScheduler::waitUntilIdle(Stage& stage)
+{
+    std::unique_lock<std::mutex> lock(stage.mutex);
+    stage.condition.wait(lock, [&stage]() { return !stage.busy; });
+}
+
+void SimulationScheduler::run(Stage& stage)
+{
+    if (stage.flag & IPL_SIMULATIONFLAGS_DIRECT)
+    {
+        iplSimulatorRunDirect(mSimulator);
+    }
+
+    if (stage.flag & IPL_SIMULATIONFLAGS_REFLECTIONS)
+    {
+        iplSimulatorRunReflections(mSimulator);
+    }
+
+    if (stage.flag & IPL_SIMULATIONFLAGS_PATHING)
+    {
+        iplSimulatorRunPathing(mSimulator);
+    }
+
+    stage.completed.store(true, std::memory_order_release);
+}
+
+void SimulationScheduler::threadProc(Stage& stage)
+{
+    setCurrentThreadPriority(stage.settings.priority);
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(stage.mutex);
+            stage.condition.wait(lock, [&stage]() { return stage.runRequested || stage.stopRequested; });
+
+            if (stage.stopRequested)
+                break;
+
+            stage.runRequested = false;
+        }
+
+        run(stage);
+
+        {
+            std::lock_guard<std::mutex> lock(stage.mutex);
+            stage.busy = false;
+        }
+
+        // Wakes up beginFrame() if it is waiting for this stage.
+        stage.condition.notify_all();
+    }
+}
+
+}
@@ -0,0 +1,131 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <phonon.h>
+
+namespace SteamAudioUnity {
+
+// --------------------------------------------------------------------------------------------------------------------
+// SimulationScheduler
+// --------------------------------------------------------------------------------------------------------------------
+
+// The simulation stages run by SimulationScheduler, each on its own thread. The indirect stage runs reflections and
+// then pathing, since the two can't safely run at the same time on the same simulator.
+enum SimulationStage
+{
+    SIMULATIONSTAGE_DIRECT,
+    SIMULATIONSTAGE_INDIRECT,
+    NUM_SIMULATIONSTAGES
+};
+
+// How often, and at what priority, a simulation stage runs.
+struct SimulationStageSettings
+{
+    float updateInterval;   // Minimum time between runs, in seconds. 0 runs the stage every frame it is idle.
+    int priority;           // Thread priority, from -2 (lowest) to 2 (highest). 0 is the OS default.
+};
+
+// Settings for SimulationScheduler::start.
+struct SimulationSchedulerSettings
+{
+    IPLSimulator simulator;
+    SimulationStageSettings stages[NUM_SIMULATIONSTAGES];
+
+    // Runs every stage on the thread that calls endFrame(), for scenes whose ray tracing callbacks can only be called
+    // from the game's main thread.
+    bool runOnCallingThread;
+};
+
+// What the game should do between beginFrame() and endFrame().
+struct SimulationFrame
+{
+    IPLSimulationFlags readyFlags;      // Stages that will run when the frame ends. Set their inputs.
+    IPLSimulationFlags completedFlags;  // Stages that have finished since the previous frame. Read their outputs.
+    bool sceneCommitted;
+};
+
+// Runs the direct and indirect (reflections and pathing) simulations of a game's simulator, each on its own native
+// thread, so that they overlap with each other and with the game's frames, and are unaffected by the game engine's
+// garbage collector.
+//
+// Once per frame, on its main thread, the game calls beginFrame(), sets the inputs of every source for the stages that
+// are ready, reads the outputs for the stages that have completed, and calls endFrame() with the shared inputs, which
+// starts the ready stages. A stage is ready if it is idle, and at least its update interval has passed since it last
+// started. While a stage is running, the next update is delayed, not queued.
+//
+// The simulator is committed, and the scene set, at the start of every frame in which the indirect stage is idle. If
+// direct simulation is still running, beginFrame() waits for it, which takes no longer than running it on the main
+// thread would.
+//
+// Since direct simulation runs after endFrame() returns, its outputs are read in the next frame's beginFrame(), one
+// frame after its inputs were set.
+//
+// All functions must be called from the same thread. None are real-time safe.
+class SimulationScheduler
+{
+public:
+    SimulationScheduler();
+    ~SimulationScheduler();
+
+    bool isRunning() const;
+
+    // Starts the stage threads. If the scheduler is already running, it is stopped first.
+    void start(const SimulationSchedulerSettings& settings);
+
+    // Waits for any stages in progress, and stops the stage threads.
+    void stop();
+
+    // Starts a frame. deltaTime is the time since the previous frame, in seconds. If commitScene is true, scene is
+    // committed along with the simulator, and frame.sceneCommitted is set once it has been.
+    void beginFrame(float deltaTime,
+                    IPLScene scene,
+                    bool commitScene,
+                    SimulationFrame& frame);
+
+    // Sets the shared inputs of the stages that are ready, and starts them.
+    void endFrame(const IPLSimulationSharedInputs& sharedInputs);
+
+private:
+    struct Stage
+    {
+        IPLSimulationFlags flag;
+        SimulationStageSettings settings;
+        float timeSinceUpdate;
+
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool runRequested;
+        bool busy;
+        bool stopRequested;
+
+        // Set when a run finishes, and cleared when beginFrame() reports it.
+        std::atomic<bool> completed;
+    };
+
+    IPLSimulator mSimulator;
+    bool mRunOnCallingThread;
+    bool mRunning;
+    IPLSimulationFlags mReadyFlags;
+    Stage mStages[NUM_SIMULATIONSTAGES];
+
+    bool isBusy(Stage& stage);
+    void waitUntilIdle(Stage& stage);
+    void run(Stage& stage);
+    void threadProc(Stage& stage);
+};
+
+extern SimulationScheduler gSimulationScheduler;
+
+}
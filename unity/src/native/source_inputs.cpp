@@ -0,0 +1,136 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#include "source_inputs.h"
+
+namespace SteamAudioUnity {
+
+#if !defined(IPL_OS_UNSUPPORTED)
+
+// Returns the inputs used for a source that has no input template. These match the defaults used by the C# scripts.
+static IPLSimulationInputs defaultInputs()
+{
+    IPLSimulationInputs inputs{};
+    inputs.distanceAttenuationModel.type = IPL_DISTANCEATTENUATIONTYPE_DEFAULT;
+    inputs.airAbsorptionModel.type = IPL_AIRABSORPTIONTYPE_DEFAULT;
+    inputs.reverbScale[0] = 1.0f;
+    inputs.reverbScale[1] = 1.0f;
+    inputs.reverbScale[2] = 1.0f;
+    return inputs;
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// SourceInputTemplates
+// --------------------------------------------------------------------------------------------------------------------
+
+SourceInputTemplates gSourceInputTemplates;
+
+SourceInputTemplates::~SourceInputTemplates()
+{
+    clear();
+}
+
+void SourceInputTemplates::set(IPLSource source,
+                               const IPLSimulationInputs& inputs)
+{
+    if (!source)
+        return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mTemplates.find(source);
+    if (it == mTemplates.end())
+    {
+        mTemplates[iplSourceRetain(source)] = inputs;
+    }
+    else
+    {
+        it->second = inputs;
+    }
+}
+
+void SourceInputTemplates::remove(IPLSource source)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mTemplates.find(source);
+    if (it == mTemplates.end())
+        return;
+
+    mTemplates.erase(it);
+    iplSourceRelease(&source);
+}
+
+void SourceInputTemplates::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto& entry : mTemplates)
+    {
+        auto source = entry.first;
+        iplSourceRelease(&source);
+    }
+
+    mTemplates.clear();
+}
+
+void SourceInputTemplates::update(IPLSimulationFlags completedFlags,
+                                  IPLSimulationFlags readyFlags,
+                                  int numSources,
+                                  const IPLUnitySourceInputs* inputs,
+                                  IPLDirectEffectParams* outputs)
+{
+    if (!inputs || numSources <= 0)
+        return;
+
+    if (outputs && (completedFlags & IPL_SIMULATIONFLAGS_DIRECT))
+    {
+        IPLSimulationOutputs simulationOutputs{};
+
+        for (auto i = 0; i < numSources; ++i)
+        {
+            if (!inputs[i].source)
+                continue;
+
+            iplSourceGetOutputs(inputs[i].source, IPL_SIMULATIONFLAGS_DIRECT, &simulationOutputs);
+
+            outputs[i] = simulationOutputs.direct;
+        }
+    }
+
+    if (readyFlags == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const auto defaults = defaultInputs();
+
+    for (auto i = 0; i < numSources; ++i)
+    {
+        const auto& record = inputs[i];
+        if (!record.source)
+            continue;
+
+        auto it = mTemplates.find(record.source);
+        auto simulationInputs = (it != mTemplates.end()) ? it->second : defaults;
+
+        simulationInputs.flags = record.flags;
+        simulationInputs.directFlags = record.directFlags;
+        simulationInputs.source = record.transform;
+        simulationInputs.directivity.dipoleWeight = record.dipoleWeight;
+        simulationInputs.directivity.dipolePower = record.dipolePower;
+        simulationInputs.occlusionType = record.occlusionType;
+        simulationInputs.occlusionRadius = record.occlusionRadius;
+        simulationInputs.numOcclusionSamples = record.numOcclusionSamples;
+        simulationInputs.numTransmissionRays = record.numTransmissionRays;
+
+        iplSourceSetInputs(record.source, readyFlags, &simulationInputs);
+    }
+}
+
+#endif
+
+}
@@ -0,0 +1,63 @@
+//
+// Copyright 2017 Valve Corporation. All rights reserved. Subject to the following license:
+// https://valvesoftware.github.io/steam-audio/license.html
+//
+
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+
+#include "steamaudio_unity_native.h"
+
+namespace SteamAudioUnity {
+
+#if !defined(IPL_OS_UNSUPPORTED)
+
+// --------------------------------------------------------------------------------------------------------------------
+// SourceInputTemplates
+// --------------------------------------------------------------------------------------------------------------------
+
+// Lets the C# scripts set the simulation inputs of many sources in one call, without marshalling a full
+// IPLSimulationInputs for each of them every frame.
+//
+// Most simulation inputs of a source (its distance attenuation model, baked data, pathing settings, and so on) only
+// change when the source's settings do. These are stored here, as the source's input template, retaining the source.
+// Every frame, update() combines the template with the few inputs that do change, given as a compact, blittable
+// IPLUnitySourceInputs record, and sets the result as the source's inputs. A source without a template uses default
+// values for everything not in its record.
+//
+// All functions are thread-safe, but none are real-time safe.
+class SourceInputTemplates
+{
+public:
+    ~SourceInputTemplates();
+
+    // Sets the input template of a source, retaining the source if it did not have one.
+    void set(IPLSource source,
+             const IPLSimulationInputs& inputs);
+
+    // Removes the input template of a source, and releases the source.
+    void remove(IPLSource source);
+
+    // Removes all input templates.
+    void clear();
+
+    // Reads the direct outputs of each source into outputs if completedFlags includes direct simulation, and then sets
+    // the inputs of each source for the simulations in readyFlags.
+    void update(IPLSimulationFlags completedFlags,
+                IPLSimulationFlags readyFlags,
+                int numSources,
+                const IPLUnitySourceInputs* inputs,
+                IPLDirectEffectParams* outputs);
+
+private:
+    std::unordered_map<IPLSource, IPLSimulationInputs> mTemplates;
+    std::mutex mMutex;
+};
+
+extern SourceInputTemplates gSourceInputTemplates;
+
+#endif
+
+}
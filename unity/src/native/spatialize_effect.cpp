@@ -4,6 +4,13 @@
 //
 
 #include "steamaudio_unity_native.h"
+#include "audio_kernels.h"
+#include "effect_builder.h"
+#include "effect_pool.h"
+#include "perf_stats.h"
+#include "reflection_budget.h"
+#include "render_pool.h"
+#include "scratch_arena.h"
 
 namespace SteamAudioUnity {
 
@@ -90,6 +97,94 @@ UnityAudioParameterDefinition gParamDefinitions[] =
 
 #if !defined(IPL_OS_UNSUPPORTED)
 
+class BuildJob;
+class PipelineJob;
+
+enum InitFlags
+{
+    INIT_NONE = 0,
+    INIT_DIRECTAUDIOBUFFERS = 1 << 0,
+    INIT_REFLECTIONAUDIOBUFFERS = 1 << 1,
+    INIT_DIRECTEFFECT = 1 << 2,
+    INIT_BINAURALEFFECT = 1 << 3,
+    INIT_REFLECTIONEFFECT = 1 << 4,
+    INIT_PATHEFFECT = 1 << 5,
+    INIT_AMBISONICSEFFECT = 1 << 6,
+    INIT_PIPELINEBUFFERS = 1 << 7
+};
+
+// Inputs to renderFallback.
+struct FallbackParams
+{
+    IPLVector3 direction;
+    float distanceAttenuation;
+    float spatialBlend;
+};
+
+// Everything needed to render a block, apart from the effect objects. Calculated on the mixer thread, so that in
+// pipelined mode, a worker thread can render the block while the mixer moves on.
+struct BlockParams
+{
+    InitFlags initFlags;
+    int numChannelsIn;
+    int numChannelsOut;
+    int numSamples;
+    FallbackParams fallback;
+
+    // The rest is only set if the effect objects needed to render normally are ready.
+    bool render;
+    IPLCoordinateSpace3 listenerCoordinates;
+    IPLDirectEffectParams directParams;
+    bool directBinaural;
+    IPLHRTFInterpolation hrtfInterpolation;
+    float directMixLevel;
+    bool applyReflections;
+    bool applyPathing;
+    int reflectionsOrder;
+    int reflectionsIRSize;
+
+    // 1 if the reflection budget allows reflections to be rendered, 0 if they should fade out.
+    float reflectionsLODGain;
+
+    bool reflectionsBinaural;
+    float reflectionsMixLevel;
+    bool pathingBinaural;
+    float pathingMixLevel;
+    IPLHRTF hrtf;
+    IPLSource simulationSource;
+    IPLReflectionMixer reflectionMixer;
+};
+
+// The most channels a held block can have. Unity's largest speaker mode is 7.1.
+const int kMaxHeldChannels = 8;
+
+// Interleaved audio buffers that a pipelined effect hands to and from the render pool.
+struct PipelineBuffers
+{
+    int numChannelsIn;
+    int numChannelsOut;
+    int numSamples;
+    std::vector<float> input;       // The block being rendered by the render job.
+    std::vector<float> output;      // The render job's output.
+
+    PipelineBuffers(int numChannelsIn,
+                    int numChannelsOut,
+                    int numSamples)
+        : numChannelsIn(numChannelsIn)
+        , numChannelsOut(numChannelsOut)
+        , numSamples(numSamples)
+        , input(static_cast<size_t>(numChannelsIn) * numSamples)
+        , output(static_cast<size_t>(numChannelsOut) * numSamples)
+    {}
+
+    bool matches(int numChannelsIn,
+                 int numChannelsOut,
+                 int numSamples) const
+    {
+        return (this->numChannelsIn == numChannelsIn && this->numChannelsOut == numChannelsOut && this->numSamples == numSamples);
+    }
+};
+
 struct State
 {
     bool directBinaural;
@@ -129,6 +224,7 @@ struct State
     float prevReflectionsMixLevel;
     float prevPathingMixLevel;
 
+    // Temporary buffers, borrowed from the rendering thread's scratch arena. Only valid while a block is being rendered.
     IPLAudioBuffer inBuffer;
     IPLAudioBuffer outBuffer;
     IPLAudioBuffer directBuffer;
@@ -142,23 +238,237 @@ struct State
     IPLReflectionEffect reflectionEffect;
     IPLPathEffect pathEffect;
     IPLAmbisonicsDecodeEffect ambisonicsEffect;
+
+    // When the HRTF changes, binauralEffect finishes the block with the old HRTF while this effect starts rendering with
+    // the new one, and the two are crossfaded. The effects then swap roles.
+    IPLBinauralEffect crossfadeBinauralEffect;
+
+    // The HRTF that binauralEffect rendered the previous block with. Retained, so it stays valid for the crossfade
+    // even after a new HRTF has been adopted.
+    IPLHRTF binauralHRTF;
+
+    // Used to create the effect objects above without blocking the audio thread.
+    BuildJob* buildJob;
+
+    // This effect's slot in the reflection budget, and the level of detail and gain most recently requested for
+    // reflections. The gain is 0 while the budget has left this effect without reflections. Only used by prepareBlock.
+    int reflectionBudgetSource;
+    ReflectionLOD reflectionsLOD;
+    float reflectionsLODGain;
+
+    // The gain at which reflections were last rendered. Only used by renderBlock.
+    float prevReflectionsLODGain;
+
+    // Used to render blocks on the render pool in pipelined mode. While the job is in flight, only the job may touch
+    // the effect objects, audio buffers, and binauralHRTF above, or pipelineBuffers.
+    PipelineJob* renderJob;
+    std::unique_ptr<PipelineBuffers> pipelineBuffers;
+
+    // True from when renderJob is submitted until it has finished and its output has been consumed.
+    bool renderJobInFlight;
+
+    // True if renderJob missed the deadline of the tick after it was submitted, so its output will be discarded.
+    bool renderJobLate;
+
+    // A block that could not be submitted to the render pool, to be played in the next tick. Allocated in create() for
+    // up to kMaxHeldChannels channels, so that blocks can be held before pipelineBuffers has been built.
+    std::vector<float> heldInput;
+    bool hasHeldBlock;
+    int heldNumChannels;
+    int heldNumSamples;
+    FallbackParams heldParams;
+
+    PerfCounters perf;
 };
 
-enum InitFlags
+// Creates effect objects for a spatializer instance on the effect builder's worker thread.
+class BuildJob : public EffectBuildJob
 {
-    INIT_NONE = 0,
-    INIT_DIRECTAUDIOBUFFERS = 1 << 0,
-    INIT_REFLECTIONAUDIOBUFFERS = 1 << 1,
-    INIT_DIRECTEFFECT = 1 << 2,
-    INIT_BINAURALEFFECT = 1 << 3,
-    INIT_REFLECTIONEFFECT = 1 << 4,
-    INIT_PATHEFFECT = 1 << 5,
-    INIT_AMBISONICSEFFECT = 1 << 6
+public:
+    // Inputs, written on the audio thread before the job is submitted.
+    IPLContext context;
+    IPLAudioSettings audioSettings;
+    int numChannelsIn;
+    int numChannelsOut;
+    IPLHRTF hrtf;
+    IPLSimulationSettings simulationSettings;
+    InitFlags requested;
+
+    // Outputs, read on the audio thread once the job is ready.
+    IPLPanningEffect panningEffect;
+    IPLBinauralEffect binauralEffect;
+    IPLBinauralEffect crossfadeBinauralEffect;
+    IPLDirectEffect directEffect;
+    IPLReflectionEffect reflectionEffect;
+    IPLPathEffect pathEffect;
+    IPLAmbisonicsDecodeEffect ambisonicsEffect;
+    std::unique_ptr<PipelineBuffers> pipelineBuffers;
+
+    BuildJob()
+        : context(nullptr)
+        , audioSettings{}
+        , numChannelsIn(0)
+        , numChannelsOut(0)
+        , hrtf(nullptr)
+        , simulationSettings{}
+        , requested(INIT_NONE)
+        , panningEffect(nullptr)
+        , binauralEffect(nullptr)
+        , crossfadeBinauralEffect(nullptr)
+        , directEffect(nullptr)
+        , reflectionEffect(nullptr)
+        , pathEffect(nullptr)
+        , ambisonicsEffect(nullptr)
+    {}
+
+    ~BuildJob() override
+    {
+        iplHRTFRelease(&hrtf);
+
+        gEffectPool.release(&panningEffect);
+        gEffectPool.release(&binauralEffect);
+        gEffectPool.release(&crossfadeBinauralEffect);
+        gEffectPool.release(&directEffect);
+        gEffectPool.release(&reflectionEffect);
+        gEffectPool.release(&pathEffect);
+        gEffectPool.release(&ambisonicsEffect);
+    }
+
+protected:
+    void build() override
+    {
+        if (requested & INIT_BINAURALEFFECT)
+        {
+            IPLPanningEffectSettings panningSettings{};
+            panningSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
+
+            auto status = gEffectPool.acquire(context, &audioSettings, &panningSettings, &panningEffect);
+
+            if (status == IPL_STATUS_SUCCESS)
+            {
+                IPLBinauralEffectSettings binauralSettings;
+                binauralSettings.hrtf = hrtf;
+
+                gEffectPool.acquire(context, &audioSettings, &binauralSettings, &binauralEffect);
+                gEffectPool.acquire(context, &audioSettings, &binauralSettings, &crossfadeBinauralEffect);
+            }
+        }
+
+        if (requested & INIT_DIRECTEFFECT)
+        {
+            IPLDirectEffectSettings effectSettings;
+            effectSettings.numChannels = numChannelsIn;
+
+            gEffectPool.acquire(context, &audioSettings, &effectSettings, &directEffect);
+        }
+
+        if (requested & INIT_REFLECTIONEFFECT)
+        {
+            IPLReflectionEffectSettings effectSettings;
+            effectSettings.type = simulationSettings.reflectionType;
+            effectSettings.numChannels = numChannelsForOrder(simulationSettings.maxOrder);
+            effectSettings.irSize = numSamplesForDuration(simulationSettings.maxDuration, audioSettings.samplingRate);
+
+            gEffectPool.acquire(context, &audioSettings, &effectSettings, &reflectionEffect);
+        }
+
+        if (requested & INIT_PATHEFFECT)
+        {
+            IPLPathEffectSettings effectSettings{};
+            effectSettings.maxOrder = simulationSettings.maxOrder;
+            effectSettings.spatialize = IPL_TRUE;
+            effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
+            effectSettings.hrtf = hrtf;
+
+            gEffectPool.acquire(context, &audioSettings, &effectSettings, &pathEffect);
+        }
+
+        if (requested & INIT_AMBISONICSEFFECT)
+        {
+            IPLAmbisonicsDecodeEffectSettings effectSettings;
+            effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
+            effectSettings.hrtf = hrtf;
+            effectSettings.maxOrder = simulationSettings.maxOrder;
+
+            gEffectPool.acquire(context, &audioSettings, &effectSettings, &ambisonicsEffect);
+        }
+
+        // Also frees any buffers left over from an earlier job.
+        if (requested & INIT_PIPELINEBUFFERS)
+        {
+            pipelineBuffers.reset(new PipelineBuffers(numChannelsIn, numChannelsOut, audioSettings.frameSize));
+        }
+
+        iplHRTFRelease(&hrtf);
+    }
 };
 
+void renderBlock(State* effect,
+                 const BlockParams& params,
+                 const float* in,
+                 float* out);
+
+// Renders one block of a pipelined effect on the render pool.
+class PipelineJob : public RenderJob
+{
+public:
+    // Qualified, since RenderJob has a State of its own.
+    SpatializeEffect::State* effect;
+
+    // The HRTF, simulation source, and reflection mixer are retained while the job is in flight.
+    BlockParams params;
+
+    explicit PipelineJob(SpatializeEffect::State* effect)
+        : effect(effect)
+        , params{}
+    {}
+
+    ~PipelineJob() override
+    {
+        releaseParams();
+    }
+
+    void retainParams()
+    {
+        params.hrtf = iplHRTFRetain(params.hrtf);
+        params.simulationSource = iplSourceRetain(params.simulationSource);
+        params.reflectionMixer = iplReflectionMixerRetain(params.reflectionMixer);
+    }
+
+    void releaseParams()
+    {
+        iplHRTFRelease(&params.hrtf);
+        iplSourceRelease(&params.simulationSource);
+        iplReflectionMixerRelease(&params.reflectionMixer);
+    }
+
+protected:
+    void render() override
+    {
+        renderBlock(effect, params, effect->pipelineBuffers->input.data(), effect->pipelineBuffers->output.data());
+    }
+};
+
+// Moves an effect object out of a finished build job, unless the instance already has one.
+template <typename T>
+void adoptEffect(T& effect,
+                 T& builtEffect)
+{
+    if (!effect)
+    {
+        effect = builtEffect;
+        builtEffect = nullptr;
+    }
+}
+
+// Returns the effects and buffers that are ready for use. Any effects that are needed but have not been created yet are
+// requested from the effect builder, and become available in a later frame. Never creates effects on the calling
+// thread, so it is safe to call from process(). If pipelined is true, the buffers used to hand blocks to the render
+// pool are also requested. Must not be called while the effect's render job is in flight.
 InitFlags lazyInit(UnityAudioEffectState* state,
                    int numChannelsIn,
-                   int numChannelsOut)
+                   int numChannelsOut,
+                   bool pipelined)
 {
     assert(state);
 
@@ -178,131 +488,97 @@ InitFlags lazyInit(UnityAudioEffectState* state,
     audioSettings.samplingRate = state->samplerate;
     audioSettings.frameSize = state->dspbuffersize;
 
-    auto status = IPL_STATUS_SUCCESS;
+    auto job = effect->buildJob;
 
-    if (numChannelsOut > 0)
+    if (job->isReady())
     {
-        if (!effect->panningEffect)
-        {
-            IPLPanningEffectSettings effectSettings{};
-            effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
-
-            status = iplPanningEffectCreate(gContext, &audioSettings, &effectSettings, &effect->panningEffect);
-        }
-
-        if (status == IPL_STATUS_SUCCESS)
-        {
-            if (!effect->binauralEffect)
-            {
-                IPLBinauralEffectSettings effectSettings;
-                effectSettings.hrtf = gHRTF[1];
+        adoptEffect(effect->panningEffect, job->panningEffect);
+        adoptEffect(effect->binauralEffect, job->binauralEffect);
+        adoptEffect(effect->crossfadeBinauralEffect, job->crossfadeBinauralEffect);
+        adoptEffect(effect->directEffect, job->directEffect);
+        adoptEffect(effect->reflectionEffect, job->reflectionEffect);
+        adoptEffect(effect->pathEffect, job->pathEffect);
+        adoptEffect(effect->ambisonicsEffect, job->ambisonicsEffect);
+
+        // Any buffers being replaced are freed by the next job, or when the job is deleted.
+        if (job->pipelineBuffers)
+            std::swap(effect->pipelineBuffers, job->pipelineBuffers);
+
+        job->complete();
+    }
 
-                status = iplBinauralEffectCreate(gContext, &audioSettings, &effectSettings, &effect->binauralEffect);
-            }
-        }
+    auto requested = INIT_NONE;
 
-        if (status == IPL_STATUS_SUCCESS)
+    if (numChannelsOut > 0)
+    {
+        if (effect->panningEffect && effect->binauralEffect && effect->crossfadeBinauralEffect)
             initFlags = static_cast<InitFlags>(initFlags | INIT_BINAURALEFFECT);
+        else
+            requested = static_cast<InitFlags>(requested | INIT_BINAURALEFFECT);
     }
 
     if (numChannelsIn > 0)
     {
-        status = IPL_STATUS_SUCCESS;
-        if (!effect->directEffect)
-        {
-            IPLDirectEffectSettings effectSettings;
-            effectSettings.numChannels = numChannelsIn;
-
-            status = iplDirectEffectCreate(gContext, &audioSettings, &effectSettings, &effect->directEffect);
-        }
-
-        if (status == IPL_STATUS_SUCCESS)
+        if (effect->directEffect)
             initFlags = static_cast<InitFlags>(initFlags | INIT_DIRECTEFFECT);
+        else
+            requested = static_cast<InitFlags>(requested | INIT_DIRECTEFFECT);
     }
 
     if (effect->applyReflections && gIsSimulationSettingsValid)
     {
-        status = IPL_STATUS_SUCCESS;
-
-        if (!effect->reflectionEffect)
-        {
-            IPLReflectionEffectSettings effectSettings;
-            effectSettings.type = gSimulationSettings.reflectionType;
-            effectSettings.numChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
-            effectSettings.irSize = numSamplesForDuration(gSimulationSettings.maxDuration, audioSettings.samplingRate);
-
-            status = iplReflectionEffectCreate(gContext, &audioSettings, &effectSettings, &effect->reflectionEffect);
-        }
-
-        if (status == IPL_STATUS_SUCCESS)
+        if (effect->reflectionEffect)
             initFlags = static_cast<InitFlags>(initFlags | INIT_REFLECTIONEFFECT);
+        else
+            requested = static_cast<InitFlags>(requested | INIT_REFLECTIONEFFECT);
     }
 
     if (effect->applyPathing && gIsSimulationSettingsValid)
     {
-        status = IPL_STATUS_SUCCESS;
-
-        if (!effect->pathEffect)
-        {
-            IPLPathEffectSettings effectSettings{};
-            effectSettings.maxOrder = gSimulationSettings.maxOrder;
-            effectSettings.spatialize = IPL_TRUE;
-            effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
-            effectSettings.hrtf = gHRTF[1];
-
-            status = iplPathEffectCreate(gContext, &audioSettings, &effectSettings, &effect->pathEffect);
-        }
-
-        if (status == IPL_STATUS_SUCCESS)
+        if (effect->pathEffect)
             initFlags = static_cast<InitFlags>(initFlags | INIT_PATHEFFECT);
+        else
+            requested = static_cast<InitFlags>(requested | INIT_PATHEFFECT);
     }
 
     if (numChannelsOut > 0 && gIsSimulationSettingsValid)
     {
-        status = IPL_STATUS_SUCCESS;
-
-        if (!effect->ambisonicsEffect)
-        {
-            IPLAmbisonicsDecodeEffectSettings effectSettings;
-            effectSettings.speakerLayout = speakerLayoutForNumChannels(numChannelsOut);
-            effectSettings.hrtf = gHRTF[1];
-            effectSettings.maxOrder = gSimulationSettings.maxOrder;
-
-            status = iplAmbisonicsDecodeEffectCreate(gContext, &audioSettings, &effectSettings, &effect->ambisonicsEffect);
-        }
-
-        if (status == IPL_STATUS_SUCCESS)
+        if (effect->ambisonicsEffect)
             initFlags = static_cast<InitFlags>(initFlags | INIT_AMBISONICSEFFECT);
+        else
+            requested = static_cast<InitFlags>(requested | INIT_AMBISONICSEFFECT);
     }
 
-    if (numChannelsIn > 0 && numChannelsOut > 0)
+    if (pipelined && numChannelsIn > 0 && numChannelsOut > 0)
     {
-        if (!effect->inBuffer.data)
-            iplAudioBufferAllocate(gContext, numChannelsIn, audioSettings.frameSize, &effect->inBuffer);
-        
-        if (!effect->outBuffer.data)
-            iplAudioBufferAllocate(gContext, numChannelsOut, audioSettings.frameSize, &effect->outBuffer);
-        
-        if (!effect->directBuffer.data)
-            iplAudioBufferAllocate(gContext, numChannelsIn, audioSettings.frameSize, &effect->directBuffer);
+        if (effect->pipelineBuffers && effect->pipelineBuffers->matches(numChannelsIn, numChannelsOut, audioSettings.frameSize))
+            initFlags = static_cast<InitFlags>(initFlags | INIT_PIPELINEBUFFERS);
+        else
+            requested = static_cast<InitFlags>(requested | INIT_PIPELINEBUFFERS);
+    }
 
-        if (!effect->monoBuffer.data)
-            iplAudioBufferAllocate(gContext, 1, audioSettings.frameSize, &effect->monoBuffer);
+    if (requested != INIT_NONE && job->isIdle())
+    {
+        job->context = gContext;
+        job->audioSettings = audioSettings;
+        job->numChannelsIn = numChannelsIn;
+        job->numChannelsOut = numChannelsOut;
+        job->hrtf = iplHRTFRetain(gHRTF[1]);
+        job->simulationSettings = gSimulationSettings;
+        job->requested = requested;
+
+        // If the queue is full, try again in the next frame.
+        if (!gEffectBuilder.submit(job))
+            iplHRTFRelease(&job->hrtf);
+    }
 
+    // Audio buffers are borrowed from the scratch arena in process(), so there is nothing to allocate here.
+    if (numChannelsIn > 0 && numChannelsOut > 0)
+    {
         initFlags = static_cast<InitFlags>(initFlags | INIT_DIRECTAUDIOBUFFERS);
 
         if ((effect->applyReflections || effect->applyPathing) && gIsSimulationSettingsValid)
-        {
-            auto numAmbisonicChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
-
-            if (!effect->reflectionsBuffer.data)
-                iplAudioBufferAllocate(gContext, numAmbisonicChannels, audioSettings.frameSize, &effect->reflectionsBuffer);
-            
-            if (!effect->reflectionsSpatializedBuffer.data)
-                iplAudioBufferAllocate(gContext, numChannelsOut, audioSettings.frameSize, &effect->reflectionsSpatializedBuffer);
-
             initFlags = static_cast<InitFlags>(initFlags | INIT_REFLECTIONAUDIOBUFFERS);
-        }
     }
 
     return initFlags;
@@ -378,13 +654,25 @@ void reset(UnityAudioEffectState* state)
     effect->prevDirectMixLevel = 0.0f;
     effect->prevReflectionsMixLevel = 0.0f;
     effect->prevPathingMixLevel = 0.0f;
+
+    effect->reflectionsLOD = ReflectionLOD{-1, 0.0f};
+    effect->reflectionsLODGain = 0.0f;
+    effect->prevReflectionsLODGain = 0.0f;
 }
 
 UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK create(UnityAudioEffectState* state)
 {
     assert(state);
 
-    state->effectdata = new State();
+    auto effect = new State();
+    effect->buildJob = new BuildJob();
+    effect->renderJob = new PipelineJob(effect);
+    effect->reflectionBudgetSource = gReflectionBudget.addSource();
+    effect->heldInput.resize(static_cast<size_t>(kMaxHeldChannels) * state->dspbuffersize);
+
+    state->effectdata = effect;
+
+    gPerfStatsRegistry.add(state, &effect->perf);
 
     if (state->spatializerdata)
     {
@@ -392,7 +680,7 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK create(UnityAudioEffectState* stat
     }
 
     reset(state);
-    lazyInit(state, 0, 0);
+    lazyInit(state, 0, 0, false);
     return UNITY_AUDIODSP_OK;
 }
 
@@ -404,25 +692,32 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK release(UnityAudioEffectState* sta
     if (!effect)
         return UNITY_AUDIODSP_OK;
 
-    iplAudioBufferFree(gContext, &effect->inBuffer);
-    iplAudioBufferFree(gContext, &effect->outBuffer);
-    iplAudioBufferFree(gContext, &effect->directBuffer);
-    iplAudioBufferFree(gContext, &effect->monoBuffer);
-    iplAudioBufferFree(gContext, &effect->reflectionsBuffer);
-    iplAudioBufferFree(gContext, &effect->reflectionsSpatializedBuffer);
+    gPerfStatsRegistry.remove(state);
+
+    // The render job may still be using the effect objects.
+    if (effect->renderJobInFlight)
+        gRenderPool.finish(effect->renderJob);
 
-    iplPanningEffectRelease(&effect->panningEffect);
-    iplBinauralEffectRelease(&effect->binauralEffect);
-    iplDirectEffectRelease(&effect->directEffect);
-    iplReflectionEffectRelease(&effect->reflectionEffect);
-    iplPathEffectRelease(&effect->pathEffect);
-    iplAmbisonicsDecodeEffectRelease(&effect->ambisonicsEffect);
+    delete effect->renderJob;
+
+    gEffectBuilder.abandon(effect->buildJob);
+    gReflectionBudget.removeSource(effect->reflectionBudgetSource);
+
+    gEffectPool.release(&effect->panningEffect);
+    gEffectPool.release(&effect->binauralEffect);
+    gEffectPool.release(&effect->crossfadeBinauralEffect);
+    gEffectPool.release(&effect->directEffect);
+    gEffectPool.release(&effect->reflectionEffect);
+    gEffectPool.release(&effect->pathEffect);
+    gEffectPool.release(&effect->ambisonicsEffect);
 
     effect->newSimulationSourceWritten = false;
     iplSourceRelease(&effect->simulationSource[0]);
     iplSourceRelease(&effect->simulationSource[1]);
 
-    delete state->effectdata;
+    iplHRTFRelease(&effect->binauralHRTF);
+
+    delete effect;
 
     return UNITY_AUDIODSP_OK;
 }
@@ -679,76 +974,134 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK setParam(UnityAudioEffectState* st
     case SIMULATION_OUTPUTS_HANDLE:
         if (gSourceManager)
         {
-            setSource(state, gSourceManager->getSource(static_cast<int>(value)));
+            auto source = gSourceManager->retainSource(static_cast<int32_t>(value));
+            setSource(state, source);
+            iplSourceRelease(&source);
         }
+        effect->perf.setSourceHandle(static_cast<int32_t>(value));
         break;
     }
 
     return UNITY_AUDIODSP_OK;
 }
 
-UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* state,
-                                                      float* in,
-                                                      float* out,
-                                                      unsigned int numSamples,
-                                                      int numChannelsIn,
-                                                      int numChannelsOut)
+// Calculates the direction from the listener to the source, in the listener's coordinate space, applying perspective
+// correction if enabled.
+IPLVector3 calcSourceDirection(const State* effect,
+                               const float* S,
+                               const float* L)
 {
-    assert(state);
-    assert(in);
-    assert(out);
-
-    // Assume that the number of input and output channels are the same.
-    assert(numChannelsIn == numChannelsOut);
+    IPLVector3 direction{ 0.0f, 1.0f, 0.0f };
+    if (gPerspectiveCorrection[0].enabled && effect->perspectiveCorrection)
+    {
+        auto M = gPerspectiveCorrection[0].transform.elements[0];
+        auto directionX = M[0] * S[12] + M[1] * S[13] + M[2] * S[14] + M[3];
+        auto directionY = M[4] * S[12] + M[5] * S[13] + M[6] * S[14] + M[7];
+        auto directionZ = M[8] * S[12] + M[9] * S[13] + M[10] * S[14] + M[11];
+        auto directionW = M[12] * S[12] + M[13] * S[13] + M[14] * S[14] + M[15];
 
-    // Start by clearing the output buffer.
-    memset(out, 0, numChannelsOut * numSamples * sizeof(float));
+        float xfactor = gPerspectiveCorrection[0].xfactor;
+        float yfactor = gPerspectiveCorrection[0].yfactor;
 
-    // Unity can call the process callback even when not in play mode. In this case, emit silence.
-    if (!(state->flags & UnityAudioEffectStateFlags_IsPlaying))
+        if (fabs(directionW) > 1e-6f)
+        {
+            // Should always hit this. Zero check just to be safe.
+            direction = convertVector(.5f * directionX * xfactor / fabsf(directionW), .5f * directionY * yfactor / fabsf(directionW), directionZ / fabsf(directionW));
+        }
+    }
+    else
     {
-        return UNITY_AUDIODSP_OK;
+        auto directionX = L[0] * S[12] + L[4] * S[13] + L[8] * S[14] + L[12];
+        auto directionY = L[1] * S[12] + L[5] * S[13] + L[9] * S[14] + L[13];
+        auto directionZ = L[2] * S[12] + L[6] * S[13] + L[10] * S[14] + L[14];
+        direction = convertVector(directionX, directionY, directionZ);
     }
 
-    auto effect = state->GetEffectData<State>();
-    if (!effect)
-        return UNITY_AUDIODSP_OK;
+    if (dot(direction, direction) < 1e-6f)
+        direction = IPLVector3{ 0.0f, 1.0f, 0.0f };
 
-    // If Unity is passing us a mono output buffer, do nothing.
-    if (numChannelsOut < 2)
-        return UNITY_AUDIODSP_OK;
+    return direction;
+}
 
-    // Unity can call the process callback even when the audio source is not actually playing. When it does so, it
-    // sends incorrect values for spatial blend, distance attenuation, and all the other parameters. Because the
-    // direct effect performs a smooth ramp between gain values across multiple frames, it can try to smoothly ramp from
-    // incorrect to correct values once playback actually starts. This will result in an audible artifact: the first
-    // few frames of audio may be unexpectedly loud. To work around this, we don't perform any audio processing until
-    // we see the first non-zero input audio sample, at which point parameters should be correct as well.
-    if (!effect->inputStarted)
+// Renders a cheap approximation of the direct path, for use while effect objects are still being built, or when a
+// pipelined effect's render job is late. The input is downmixed to mono, attenuated, and panned between the front left
+// and right speakers using an equal-power law.
+void renderFallback(const State* effect,
+                    const FallbackParams& params,
+                    int numChannelsIn,
+                    int numChannelsOut,
+                    int numSamples,
+                    const float* in,
+                    float* out)
+{
+    auto level = effect->directMixLevel / numChannelsIn;
+    if (effect->applyDistanceAttenuation)
+        level *= params.distanceAttenuation;
+    if (effect->applyOcclusion)
+        level *= effect->occlusion;
+
+    auto pan = params.spatialBlend * unitVector(params.direction).x;
+    auto angle = (pan + 1.0f) * 0.25f * 3.14159265f;
+
+    float gains[2] = { level * cosf(angle), level * sinf(angle) };
+
+    for (auto i = 0; i < numSamples; ++i)
     {
-        for (auto i = 0u; i < numChannelsIn * numSamples; ++i)
+        auto sum = 0.0f;
+        for (auto j = 0; j < numChannelsIn; ++j)
         {
-            if (fabsf(in[i]) != 0.0f)
-            {
-                effect->inputStarted = true;
-                break;
-            }
+            sum += in[i * numChannelsIn + j];
         }
 
-        if (!effect->inputStarted)
-            return UNITY_AUDIODSP_OK;
+        out[i * numChannelsOut] = gains[0] * sum;
+        out[i * numChannelsOut + 1] = gains[1] * sum;
     }
+}
 
-    // Make sure that audio processing state has been initialized. If initialization fails, stop and emit silence.
-    // TODO: if nothing is initialized, do some fallback processing (passthrough, panning, or something like that).
-    auto initFlags = lazyInit(state, numChannelsIn, numChannelsOut);
-    if (!(initFlags & INIT_DIRECTAUDIOBUFFERS) || !(initFlags & INIT_BINAURALEFFECT) || !(initFlags & INIT_DIRECTEFFECT))
-        return UNITY_AUDIODSP_OK;
+// Renders the direct path with both the previous HRTF and the HRTF in params, and crossfades between them over the
+// block. The binaural effect that has been rendering with the previous HRTF continues with it, so its output has no
+// discontinuity. The other binaural effect starts from silence with the new HRTF, and becomes the main effect for
+// subsequent blocks.
+void crossfadeBinaural(State* effect,
+                       const IPLBinauralEffectParams& params,
+                       IPLHRTF previousHRTF,
+                       IPLAudioBuffer newBuffer)
+{
+    auto previousParams = params;
+    previousParams.hrtf = previousHRTF;
+    iplBinauralEffectApply(effect->binauralEffect, &previousParams, &effect->directBuffer, &effect->outBuffer);
+
+    auto newParams = params;
+    iplBinauralEffectReset(effect->crossfadeBinauralEffect);
+    iplBinauralEffectApply(effect->crossfadeBinauralEffect, &newParams, &effect->directBuffer, &newBuffer);
+
+    for (auto i = 0; i < newBuffer.numChannels; ++i)
+    {
+        applyRamp(effect->outBuffer.data[i], 1.0f, 0.0f, newBuffer.numSamples, effect->outBuffer.data[i]);
+        applyRamp(newBuffer.data[i], 0.0f, 1.0f, newBuffer.numSamples, newBuffer.data[i]);
+        mixInto(newBuffer.data[i], newBuffer.numSamples, effect->outBuffer.data[i]);
+    }
+
+    std::swap(effect->binauralEffect, effect->crossfadeBinauralEffect);
+}
+
+// Calculates the parameters for rendering a block, from the effect's parameters and Unity's spatializer data, and picks
+// up any new global state. Must be called on the mixer thread. If initFlags does not include the effect objects needed
+// to render normally, only the inputs to the fallback are calculated.
+void prepareBlock(UnityAudioEffectState* state,
+                  InitFlags initFlags,
+                  int numChannelsIn,
+                  int numChannelsOut,
+                  BlockParams& params)
+{
+    auto effect = state->GetEffectData<State>();
 
     getLatestPerspectiveCorrection();
     getLatestHRTF();
     getLatestSource(state);
 
+    effect->perf.countHRTFChange(gHRTF[0]);
+
     // Local-to-world transform matrix for the source.
     auto S = state->spatializerdata->sourcematrix;
 
@@ -795,9 +1148,86 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* sta
     auto _distanceAttenuation = (1.0f - spatialBlend) + spatialBlend * distanceAttenuation;
     auto _spatialBlend = (spatialBlend == 1.0f && distanceAttenuation == 0.0f) ? 1.0f : spatialBlend * distanceAttenuation / _distanceAttenuation;
 
-    iplAudioBufferDeinterleave(gContext, in, &effect->inBuffer);
+    params = BlockParams{};
+    params.initFlags = initFlags;
+    params.numChannelsIn = numChannelsIn;
+    params.numChannelsOut = numChannelsOut;
+    params.numSamples = static_cast<int>(state->dspbuffersize);
+    params.fallback.direction = calcSourceDirection(effect, S, L);
+    params.fallback.distanceAttenuation = _distanceAttenuation;
+    params.fallback.spatialBlend = _spatialBlend;
+
+    params.render = (initFlags & INIT_BINAURALEFFECT) && (initFlags & INIT_DIRECTEFFECT);
+    if (!params.render)
+        return;
 
-    IPLDirectEffectParams directParams;
+    params.listenerCoordinates = listenerCoordinates;
+    params.directBinaural = effect->directBinaural;
+    params.hrtfInterpolation = effect->hrtfInterpolation;
+    params.directMixLevel = effect->directMixLevel;
+    params.reflectionsBinaural = effect->reflectionsBinaural;
+    params.reflectionsMixLevel = effect->reflectionsMixLevel;
+    params.pathingBinaural = effect->pathingBinaural;
+    params.pathingMixLevel = effect->pathingMixLevel;
+    params.hrtf = gHRTF[0];
+    params.simulationSource = effect->simulationSource[0];
+
+    params.applyReflections = effect->simulationSource[0] && effect->applyReflections &&
+        (initFlags & INIT_REFLECTIONAUDIOBUFFERS) && (initFlags & INIT_REFLECTIONEFFECT) && (initFlags & INIT_AMBISONICSEFFECT);
+    params.applyPathing = effect->simulationSource[0] && effect->applyPathing &&
+        (initFlags & INIT_REFLECTIONAUDIOBUFFERS) && (initFlags & INIT_PATHEFFECT) && (initFlags & INIT_AMBISONICSEFFECT);
+
+    params.reflectionsOrder = gSimulationSettings.maxOrder;
+    params.reflectionsIRSize = numSamplesForDuration(gSimulationSettings.maxDuration, static_cast<int>(state->samplerate));
+    params.reflectionsLODGain = 1.0f;
+
+    // If a reflection budget is set, convolve with however much of the IR the budget allows, prioritizing sources
+    // by how loud their reflections are likely to be. TAN and the reflection mixer are not budgeted.
+    auto budgetReflections = params.applyReflections && gReflectionBudget.isEnabled() && !gReflectionMixer[0] &&
+        (gSimulationSettings.reflectionType == IPL_REFLECTIONEFFECTTYPE_CONVOLUTION || gSimulationSettings.reflectionType == IPL_REFLECTIONEFFECTTYPE_HYBRID);
+
+    if (budgetReflections)
+    {
+        auto priority = effect->reflectionsMixLevel * _distanceAttenuation;
+        gReflectionBudget.update(effect->reflectionBudgetSource, state->currdsptick, priority, gSimulationSettings.maxOrder, gSimulationSettings.maxDuration);
+
+        // If the budget no longer has room for this source, fade its reflections out at the level of detail they were
+        // last rendered at, before stopping.
+        auto lod = gReflectionBudget.lod(effect->reflectionBudgetSource);
+        if (lod.order < 0 && effect->reflectionsLODGain > 0.0f && effect->reflectionsLOD.order >= 0)
+        {
+            lod = effect->reflectionsLOD;
+            params.reflectionsLODGain = 0.0f;
+        }
+
+        if (lod.order < 0)
+        {
+            params.applyReflections = false;
+        }
+        else
+        {
+            params.reflectionsOrder = lod.order;
+            params.reflectionsIRSize = numSamplesForDuration(lod.duration, static_cast<int>(state->samplerate));
+            effect->reflectionsLOD = lod;
+        }
+    }
+
+    effect->reflectionsLODGain = (params.applyReflections) ? params.reflectionsLODGain : 0.0f;
+
+    if (params.applyReflections)
+    {
+        if (gNewReflectionMixerWritten)
+        {
+            iplReflectionMixerRelease(&gReflectionMixer[0]);
+            gReflectionMixer[0] = iplReflectionMixerRetain(gReflectionMixer[1]);
+
+            gNewReflectionMixerWritten = false;
+        }
+
+        params.reflectionMixer = gReflectionMixer[0];
+    }
+
+    auto& directParams = params.directParams;
     directParams.flags = static_cast<IPLDirectEffectFlags>(0);
     directParams.distanceAttenuation = _distanceAttenuation;
     directParams.airAbsorption[0] = effect->airAbsorption[0];
@@ -820,128 +1250,459 @@ UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* sta
         directParams.flags = static_cast<IPLDirectEffectFlags>(directParams.flags | IPL_DIRECTEFFECTFLAGS_APPLYOCCLUSION);
     if (effect->applyTransmission)
         directParams.flags = static_cast<IPLDirectEffectFlags>(directParams.flags | IPL_DIRECTEFFECTFLAGS_APPLYTRANSMISSION);
+}
 
-    iplDirectEffectApply(effect->directEffect, &directParams, &effect->inBuffer, &effect->directBuffer);
-
-    IPLVector3 direction{ 0.0f, 1.0f, 0.0f };
-    if (gPerspectiveCorrection[0].enabled && effect->perspectiveCorrection)
+// Renders a block whose parameters were calculated by prepareBlock. Only touches the effect's render state, so it can
+// run on any thread, as long as no other thread is rendering the same effect.
+void renderBlock(State* effect,
+                 const BlockParams& params,
+                 const float* in,
+                 float* out)
+{
+    auto numChannelsIn = params.numChannelsIn;
+    auto numChannelsOut = params.numChannelsOut;
+    auto numSamples = params.numSamples;
+    auto frameSize = params.numSamples;
+
+    ScratchScope scratch;
+    effect->inBuffer = scratch.audioBuffer(numChannelsIn, frameSize);
+    effect->outBuffer = scratch.audioBuffer(numChannelsOut, frameSize);
+    effect->directBuffer = scratch.audioBuffer(numChannelsIn, frameSize);
+    effect->monoBuffer = scratch.audioBuffer(1, frameSize);
+
+    if (params.initFlags & INIT_REFLECTIONAUDIOBUFFERS)
     {
-        auto M = gPerspectiveCorrection[0].transform.elements[0];
-        auto directionX = M[0] * S[12] + M[1] * S[13] + M[2] * S[14] + M[3];
-        auto directionY = M[4] * S[12] + M[5] * S[13] + M[6] * S[14] + M[7];
-        auto directionZ = M[8] * S[12] + M[9] * S[13] + M[10] * S[14] + M[11];
-        auto directionW = M[12] * S[12] + M[13] * S[13] + M[14] * S[14] + M[15];
+        effect->reflectionsBuffer = scratch.audioBuffer(numChannelsForOrder(params.reflectionsOrder), frameSize);
+        effect->reflectionsSpatializedBuffer = scratch.audioBuffer(numChannelsOut, frameSize);
+    }
 
-        float xfactor = gPerspectiveCorrection[0].xfactor;
-        float yfactor = gPerspectiveCorrection[0].yfactor;
+    auto applyReflections = params.applyReflections;
+    auto applyPathing = params.applyPathing;
 
-        if (fabs(directionW) > 1e-6f)
-        {
-            // Should always hit this. Zero check just to be safe.
-            direction = convertVector(.5f * directionX * xfactor / fabsf(directionW), .5f * directionY * yfactor / fabsf(directionW), directionZ / fabsf(directionW));
-        }
-    }
-    else
+    // Reflections and pathing are applied to a mono downmix of the input, which we calculate in the same pass as
+    // deinterleaving the input.
+    auto inMono = effect->inBuffer.data[0];
+    if ((applyReflections || applyPathing) && numChannelsIn > 1)
     {
-        auto directionX = L[0] * S[12] + L[4] * S[13] + L[8] * S[14] + L[12];
-        auto directionY = L[1] * S[12] + L[5] * S[13] + L[9] * S[14] + L[13];
-        auto directionZ = L[2] * S[12] + L[6] * S[13] + L[10] * S[14] + L[14];
-        direction = convertVector(directionX, directionY, directionZ);
+        inMono = scratch.audioBuffer(1, frameSize).data[0];
     }
 
-    if (dot(direction, direction) < 1e-6f)
-        direction = IPLVector3{ 0.0f, 1.0f, 0.0f };
+    {
+        PerfTimer timer(effect->perf, PERFSTAGE_DIRECT);
+
+        auto directParams = params.directParams;
+
+        deinterleaveDownmix(in, numChannelsIn, frameSize, effect->inBuffer.data, (inMono != effect->inBuffer.data[0]) ? inMono : nullptr);
+        iplDirectEffectApply(effect->directEffect, &directParams, &effect->inBuffer, &effect->directBuffer);
+    }
 
-    if (effect->directBinaural)
+    if (params.directBinaural)
     {
+        PerfTimer timer(effect->perf, PERFSTAGE_BINAURAL);
+
         IPLBinauralEffectParams binauralParams{};
-        binauralParams.direction = direction;
-        binauralParams.interpolation = effect->hrtfInterpolation;
-        binauralParams.spatialBlend = _spatialBlend;
-        binauralParams.hrtf = gHRTF[0];
+        binauralParams.direction = params.fallback.direction;
+        binauralParams.interpolation = params.hrtfInterpolation;
+        binauralParams.spatialBlend = params.fallback.spatialBlend;
+        binauralParams.hrtf = params.hrtf;
+
+        if (effect->binauralHRTF && effect->binauralHRTF != params.hrtf)
+        {
+            crossfadeBinaural(effect, binauralParams, effect->binauralHRTF, scratch.audioBuffer(numChannelsOut, frameSize));
+        }
+        else
+        {
+            iplBinauralEffectApply(effect->binauralEffect, &binauralParams, &effect->directBuffer, &effect->outBuffer);
+        }
 
-        iplBinauralEffectApply(effect->binauralEffect, &binauralParams, &effect->directBuffer, &effect->outBuffer);
+        if (effect->binauralHRTF != params.hrtf)
+        {
+            iplHRTFRelease(&effect->binauralHRTF);
+            effect->binauralHRTF = iplHRTFRetain(params.hrtf);
+        }
     }
     else
     {
+        PerfTimer timer(effect->perf, PERFSTAGE_BINAURAL);
+
         iplAudioBufferDownmix(gContext, &effect->directBuffer, &effect->monoBuffer);
 
         IPLPanningEffectParams panningParams{};
-        panningParams.direction = direction;
+        panningParams.direction = params.fallback.direction;
 
         iplPanningEffectApply(effect->panningEffect, &panningParams, &effect->monoBuffer, &effect->outBuffer);
     }
 
-    for (auto i = 0; i < numChannelsOut; ++i)
-    {
-        applyVolumeRamp(effect->prevDirectMixLevel, effect->directMixLevel, numSamples, effect->outBuffer.data[i]);
-    }
-    effect->prevDirectMixLevel = effect->directMixLevel;
+    // Spatialized reflections and pathing are summed here, and mixed with the direct path when writing the output.
+    const IPLAudioBuffer* indirectBuffer = nullptr;
 
-    if (effect->simulationSource[0])
+    if (applyReflections || applyPathing)
     {
         IPLSimulationOutputs simulationOutputs{};
-        iplSourceGetOutputs(effect->simulationSource[0], static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_REFLECTIONS | IPL_SIMULATIONFLAGS_PATHING), &simulationOutputs);
+        iplSourceGetOutputs(params.simulationSource, static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_REFLECTIONS | IPL_SIMULATIONFLAGS_PATHING), &simulationOutputs);
 
-        if (effect->applyReflections &&
-            (initFlags & INIT_REFLECTIONAUDIOBUFFERS) && (initFlags & INIT_REFLECTIONEFFECT) && (initFlags && INIT_AMBISONICSEFFECT))
+        if (applyReflections)
         {
-            iplAudioBufferDownmix(gContext, &effect->inBuffer, &effect->monoBuffer);
+            applyRamp(inMono, effect->prevReflectionsMixLevel, params.reflectionsMixLevel, numSamples, effect->monoBuffer.data[0]);
+            effect->prevReflectionsMixLevel = params.reflectionsMixLevel;
 
-            applyVolumeRamp(effect->prevReflectionsMixLevel, effect->reflectionsMixLevel, numSamples, effect->monoBuffer.data[0]);
-            effect->prevReflectionsMixLevel = effect->reflectionsMixLevel;
+            // If reflections are fading back in after the reflection budget left them out, drop the tail of whatever
+            // was convolved before they faded out.
+            if (effect->prevReflectionsLODGain <= 0.0f && params.reflectionsLODGain > 0.0f)
+            {
+                iplReflectionEffectReset(effect->reflectionEffect);
+            }
 
             IPLReflectionEffectParams reflectionParams = simulationOutputs.reflections;
             reflectionParams.type = gSimulationSettings.reflectionType;
-            reflectionParams.numChannels = numChannelsForOrder(gSimulationSettings.maxOrder);
-            reflectionParams.irSize = numSamplesForDuration(gSimulationSettings.maxDuration, static_cast<int>(state->samplerate));
+            reflectionParams.numChannels = numChannelsForOrder(params.reflectionsOrder);
+            reflectionParams.irSize = params.reflectionsIRSize;
             reflectionParams.tanDevice = gSimulationSettings.tanDevice;
 
-            if (gNewReflectionMixerWritten)
             {
-                iplReflectionMixerRelease(&gReflectionMixer[0]);
-                gReflectionMixer[0] = iplReflectionMixerRetain(gReflectionMixer[1]);
-
-                gNewReflectionMixerWritten = false;
+                PerfTimer timer(effect->perf, PERFSTAGE_REFLECTIONS);
+                iplReflectionEffectApply(effect->reflectionEffect, &reflectionParams, &effect->monoBuffer, &effect->reflectionsBuffer, params.reflectionMixer);
             }
 
-            iplReflectionEffectApply(effect->reflectionEffect, &reflectionParams, &effect->monoBuffer, &effect->reflectionsBuffer, gReflectionMixer[0]);
+            if (effect->prevReflectionsLODGain != params.reflectionsLODGain)
+            {
+                for (auto i = 0; i < effect->reflectionsBuffer.numChannels; ++i)
+                {
+                    applyRamp(effect->reflectionsBuffer.data[i], effect->prevReflectionsLODGain, params.reflectionsLODGain, numSamples, effect->reflectionsBuffer.data[i]);
+                }
+
+                effect->prevReflectionsLODGain = params.reflectionsLODGain;
+            }
 
-            if (gSimulationSettings.reflectionType != IPL_REFLECTIONEFFECTTYPE_TAN && !gReflectionMixer[0])
+            if (gSimulationSettings.reflectionType != IPL_REFLECTIONEFFECTTYPE_TAN && !params.reflectionMixer)
             {
+                PerfTimer timer(effect->perf, PERFSTAGE_DECODE);
+
                 IPLAmbisonicsDecodeEffectParams ambisonicsParams;
-                ambisonicsParams.order = gSimulationSettings.maxOrder;
-                ambisonicsParams.hrtf = gHRTF[0];
-                ambisonicsParams.orientation = listenerCoordinates;
-                ambisonicsParams.binaural = (effect->reflectionsBinaural) ? IPL_TRUE : IPL_FALSE;
+                ambisonicsParams.order = params.reflectionsOrder;
+                ambisonicsParams.hrtf = params.hrtf;
+                ambisonicsParams.orientation = params.listenerCoordinates;
+                ambisonicsParams.binaural = (params.reflectionsBinaural) ? IPL_TRUE : IPL_FALSE;
 
                 iplAmbisonicsDecodeEffectApply(effect->ambisonicsEffect, &ambisonicsParams, &effect->reflectionsBuffer, &effect->reflectionsSpatializedBuffer);
 
-                iplAudioBufferMix(gContext, &effect->reflectionsSpatializedBuffer, &effect->outBuffer);
+                indirectBuffer = &effect->reflectionsSpatializedBuffer;
             }
         }
 
-        if (effect->applyPathing &&
-            (initFlags & INIT_REFLECTIONAUDIOBUFFERS) && (initFlags & INIT_PATHEFFECT) && (initFlags && INIT_AMBISONICSEFFECT))
+        if (applyPathing)
         {
-            iplAudioBufferDownmix(gContext, &effect->inBuffer, &effect->monoBuffer);
-
-            applyVolumeRamp(effect->prevPathingMixLevel, effect->pathingMixLevel, numSamples, effect->monoBuffer.data[0]);
-            effect->prevPathingMixLevel = effect->pathingMixLevel;
+            applyRamp(inMono, effect->prevPathingMixLevel, params.pathingMixLevel, numSamples, effect->monoBuffer.data[0]);
+            effect->prevPathingMixLevel = params.pathingMixLevel;
 
             IPLPathEffectParams pathParams = simulationOutputs.pathing;
             pathParams.order = gSimulationSettings.maxOrder;
-            pathParams.binaural = (effect->pathingBinaural) ? IPL_TRUE : IPL_FALSE;
-            pathParams.hrtf = gHRTF[0];
-            pathParams.listener = listenerCoordinates;
+            pathParams.binaural = (params.pathingBinaural) ? IPL_TRUE : IPL_FALSE;
+            pathParams.hrtf = params.hrtf;
+            pathParams.listener = params.listenerCoordinates;
+
+            PerfTimer timer(effect->perf, PERFSTAGE_PATHING);
+
+            if (indirectBuffer)
+            {
+                auto pathingBuffer = scratch.audioBuffer(numChannelsOut, frameSize);
+
+                iplPathEffectApply(effect->pathEffect, &pathParams, &effect->monoBuffer, &pathingBuffer);
+
+                for (auto i = 0; i < numChannelsOut; ++i)
+                {
+                    mixInto(pathingBuffer.data[i], frameSize, effect->reflectionsSpatializedBuffer.data[i]);
+                }
+            }
+            else
+            {
+                iplPathEffectApply(effect->pathEffect, &pathParams, &effect->monoBuffer, &effect->reflectionsSpatializedBuffer);
+
+                indirectBuffer = &effect->reflectionsSpatializedBuffer;
+            }
+        }
+    }
+
+    rampMixInterleave(effect->outBuffer, effect->prevDirectMixLevel, params.directMixLevel, indirectBuffer, out);
+    effect->prevDirectMixLevel = params.directMixLevel;
+}
+
+// Keeps a block that could not be submitted to the render pool, so that it can be played in the next tick.
+void holdBlock(State* effect,
+               const BlockParams& params,
+               int numChannels,
+               int numSamples,
+               const float* in)
+{
+    auto numValues = static_cast<size_t>(numChannels) * numSamples;
+    if (numValues > effect->heldInput.size())
+        return;
+
+    memcpy(effect->heldInput.data(), in, numValues * sizeof(float));
+
+    effect->heldNumChannels = numChannels;
+    effect->heldNumSamples = numSamples;
+    effect->heldParams = params.fallback;
+    effect->hasHeldBlock = true;
+}
+
+// Plays the held block, if any, using the fallback.
+void playHeldBlock(State* effect,
+                   int numChannels,
+                   int numSamples,
+                   float* out)
+{
+    if (!effect->hasHeldBlock)
+        return;
+
+    if (effect->heldNumChannels == numChannels && effect->heldNumSamples == numSamples)
+    {
+        renderFallback(effect, effect->heldParams, numChannels, numChannels, numSamples, effect->heldInput.data(), out);
+    }
+
+    effect->hasHeldBlock = false;
+}
+
+bool isSilent(const float* in,
+              int numValues)
+{
+    for (auto i = 0; i < numValues; ++i)
+    {
+        if (fabsf(in[i]) != 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+// Processes a block in pipelined mode after pipelined rendering has been turned off. The held block is rendered
+// normally on this thread, and this block is held in turn, so the latency stays at one block and nothing is dropped.
+// Once a silent block arrives, it is dropped instead, and the effect goes back to rendering inline.
+void drainPipeline(UnityAudioEffectState* state,
+                   float* in,
+                   float* out,
+                   unsigned int numSamples,
+                   int numChannelsIn,
+                   int numChannelsOut)
+{
+    auto effect = state->GetEffectData<State>();
+
+    // The effect objects can't be touched until the render job has finished.
+    auto initFlags = INIT_NONE;
+    if (!effect->renderJobInFlight)
+    {
+        initFlags = lazyInit(state, numChannelsIn, numChannelsOut, false);
+        if (!(initFlags & INIT_DIRECTAUDIOBUFFERS))
+        {
+            effect->perf.countInitFailure();
+            playHeldBlock(effect, numChannelsIn, static_cast<int>(numSamples), out);
+            return;
+        }
+    }
+
+    BlockParams params;
+    prepareBlock(state, initFlags, numChannelsIn, numChannelsOut, params);
+
+    auto heldBlockMatches = effect->heldNumChannels == numChannelsIn && effect->heldNumSamples == static_cast<int>(numSamples) &&
+        params.numSamples == static_cast<int>(numSamples);
+    if (effect->hasHeldBlock && params.render && heldBlockMatches)
+    {
+        renderBlock(effect, params, effect->heldInput.data(), out);
+        effect->hasHeldBlock = false;
+    }
+    else
+    {
+        playHeldBlock(effect, numChannelsIn, static_cast<int>(numSamples), out);
+    }
+
+    if (effect->renderJobInFlight || !isSilent(in, numChannelsIn * static_cast<int>(numSamples)))
+    {
+        holdBlock(effect, params, numChannelsIn, static_cast<int>(numSamples), in);
+    }
+}
 
-            iplPathEffectApply(effect->pathEffect, &pathParams, &effect->monoBuffer, &effect->reflectionsSpatializedBuffer);
+// Processes a block in pipelined mode. The output is that of the block passed in the previous tick, which a worker
+// thread has rendered in the meantime, and this block is submitted to the render pool, to be played in the next tick.
+// If the worker misses the tick's deadline, or the block can't be rendered normally, the fallback is played instead, so
+// the latency is always one block.
+void processPipelined(UnityAudioEffectState* state,
+                      float* in,
+                      float* out,
+                      unsigned int numSamples,
+                      int numChannelsIn,
+                      int numChannelsOut)
+{
+    auto effect = state->GetEffectData<State>();
+    auto job = effect->renderJob;
+    auto buffers = effect->pipelineBuffers.get();
+    auto buffersMatch = buffers && buffers->matches(numChannelsIn, numChannelsOut, static_cast<int>(numSamples));
+
+    gRenderPool.beginTick(state->currdsptick, static_cast<float>(state->dspbuffersize) / static_cast<float>(state->samplerate));
+
+    if (effect->renderJobInFlight)
+    {
+        if (gRenderPool.wait(job))
+        {
+            // If the job was late, the fallback has already played its block.
+            if (!effect->renderJobLate && buffersMatch)
+            {
+                memcpy(out, buffers->output.data(), buffers->output.size() * sizeof(float));
+            }
 
-            iplAudioBufferMix(gContext, &effect->reflectionsSpatializedBuffer, &effect->outBuffer);
+            job->releaseParams();
+            effect->renderJobInFlight = false;
+            effect->renderJobLate = false;
         }
+        else if (!effect->renderJobLate)
+        {
+            effect->perf.countLateBlock();
+
+            if (buffersMatch)
+            {
+                renderFallback(effect, job->params.fallback, numChannelsIn, numChannelsOut, numSamples, buffers->input.data(), out);
+            }
+
+            effect->renderJobLate = true;
+        }
+    }
+
+    if (!gRenderPool.isRunning())
+    {
+        drainPipeline(state, in, out, numSamples, numChannelsIn, numChannelsOut);
+        return;
+    }
+
+    playHeldBlock(effect, numChannelsIn, static_cast<int>(numSamples), out);
+
+    BlockParams params;
+
+    // The render job is still rendering an earlier block, so this block can only be played using the fallback.
+    if (effect->renderJobInFlight)
+    {
+        effect->perf.countLateBlock();
+
+        prepareBlock(state, INIT_NONE, numChannelsIn, numChannelsOut, params);
+        holdBlock(effect, params, numChannelsIn, static_cast<int>(numSamples), in);
+        return;
+    }
+
+    auto initFlags = lazyInit(state, numChannelsIn, numChannelsOut, true);
+    if (!(initFlags & INIT_DIRECTAUDIOBUFFERS))
+    {
+        effect->perf.countInitFailure();
+        return;
+    }
+
+    prepareBlock(state, initFlags, numChannelsIn, numChannelsOut, params);
+
+    if (!params.render)
+        effect->perf.countInitFailure();
+
+    // Until the buffers for pipelining have been built, blocks are held and played in the next tick using the fallback,
+    // so the latency is one block from the first block on.
+    if (!params.render || !(initFlags & INIT_PIPELINEBUFFERS) || params.numSamples != static_cast<int>(numSamples))
+    {
+        holdBlock(effect, params, numChannelsIn, static_cast<int>(numSamples), in);
+        return;
+    }
+
+    buffers = effect->pipelineBuffers.get();
+    memcpy(buffers->input.data(), in, buffers->input.size() * sizeof(float));
+
+    job->params = params;
+    job->retainParams();
+
+    effect->renderJobInFlight = true;
+    gRenderPool.submit(job);
+}
+
+UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK process(UnityAudioEffectState* state,
+                                                      float* in,
+                                                      float* out,
+                                                      unsigned int numSamples,
+                                                      int numChannelsIn,
+                                                      int numChannelsOut)
+{
+    RTAuditScope auditScope;
+
+    assert(state);
+    assert(in);
+    assert(out);
+
+    // Assume that the number of input and output channels are the same.
+    assert(numChannelsIn == numChannelsOut);
+
+    // Start by clearing the output buffer.
+    memset(out, 0, numChannelsOut * numSamples * sizeof(float));
+
+    auto effect = state->GetEffectData<State>();
+    if (!effect)
+        return UNITY_AUDIODSP_OK;
+
+    // Unity can call the process callback even when not in play mode. In this case, emit silence.
+    if (!(state->flags & UnityAudioEffectStateFlags_IsPlaying))
+    {
+        effect->perf.countBypassedBlock();
+        return UNITY_AUDIODSP_OK;
+    }
+
+    // If Unity is passing us a mono output buffer, do nothing.
+    if (numChannelsOut < 2)
+        return UNITY_AUDIODSP_OK;
+
+    // Unity can call the process callback even when the audio source is not actually playing. When it does so, it
+    // sends incorrect values for spatial blend, distance attenuation, and all the other parameters. Because the
+    // direct effect performs a smooth ramp between gain values across multiple frames, it can try to smoothly ramp from
+    // incorrect to correct values once playback actually starts. This will result in an audible artifact: the first
+    // few frames of audio may be unexpectedly loud. To work around this, we don't perform any audio processing until
+    // we see the first non-zero input audio sample, at which point parameters should be correct as well.
+    if (!effect->inputStarted)
+    {
+        for (auto i = 0u; i < numChannelsIn * numSamples; ++i)
+        {
+            if (fabsf(in[i]) != 0.0f)
+            {
+                effect->inputStarted = true;
+                break;
+            }
+        }
+
+        if (!effect->inputStarted)
+        {
+            effect->perf.countBypassedBlock();
+            return UNITY_AUDIODSP_OK;
+        }
+    }
+
+    effect->perf.countProcessCall();
+
+    // Blocks still in the pipeline are drained even if pipelined rendering has just been turned off.
+    if (gRenderPool.isRunning() || effect->renderJobInFlight || effect->hasHeldBlock)
+    {
+        processPipelined(state, in, out, numSamples, numChannelsIn, numChannelsOut);
+        return UNITY_AUDIODSP_OK;
+    }
+
+    // Make sure that audio processing state has been initialized. If initialization fails, stop and emit silence.
+    // While the effect objects are being built, render a panned approximation instead.
+    auto initFlags = lazyInit(state, numChannelsIn, numChannelsOut, false);
+    if (!(initFlags & INIT_DIRECTAUDIOBUFFERS))
+    {
+        effect->perf.countInitFailure();
+        return UNITY_AUDIODSP_OK;
+    }
+
+    BlockParams params;
+    prepareBlock(state, initFlags, numChannelsIn, numChannelsOut, params);
+
+    if (!params.render)
+    {
+        effect->perf.countInitFailure();
+        renderFallback(effect, params.fallback, numChannelsIn, numChannelsOut, numSamples, in, out);
+        return UNITY_AUDIODSP_OK;
     }
 
-    iplAudioBufferInterleave(gContext, &effect->outBuffer, out);
+    renderBlock(effect, params, in, out);
 
     return UNITY_AUDIODSP_OK;
 }
@@ -4,6 +4,16 @@
 //
 
 #include "steamaudio_unity_native.h"
+#include "audio_kernels.h"
+#include "effect_builder.h"
+#include "effect_pool.h"
+#include "perf_stats.h"
+#include "pool_allocator.h"
+#include "reflection_budget.h"
+#include "render_pool.h"
+#include "simd_level.h"
+#include "simulation_scheduler.h"
+#include "source_inputs.h"
 
 #if defined(IPL_OS_UNSUPPORTED)
 #pragma message("WARNING: Compiling for an unsupported platform!")
@@ -30,6 +40,7 @@ IPLSource gReverbSource[2] = { nullptr, nullptr };
 IPLReflectionMixer gReflectionMixer[2] = { nullptr, nullptr };
 
 std::atomic<bool> gNewHRTFWritten{ false };
+AuditedMutex gHRTFMutex("HRTF");
 std::atomic<bool> gNewPerspectiveCorrectionWritten{ false };
 std::atomic<bool> gIsSimulationSettingsValid{ false };
 std::atomic<bool> gNewReverbSourceWritten{ false };
@@ -82,15 +93,23 @@ void UNITY_AUDIODSP_CALLBACK iplUnityGetVersion(unsigned int* major, unsigned in
 
 void UNITY_AUDIODSP_CALLBACK iplUnityInitialize(IPLContext context)
 {
-    assert(gContext == nullptr);
+    assert(SteamAudioUnity::gContext == nullptr);
 
     SteamAudioUnity::gContext = iplContextRetain(context);
 
     SteamAudioUnity::gSourceManager = std::make_shared<SteamAudioUnity::SourceManager>();
+
+    SteamAudioUnity::gEffectBuilder.start();
 }
 
 void UNITY_AUDIODSP_CALLBACK iplUnityTerminate()
 {
+    SteamAudioUnity::gSimulationScheduler.stop();
+    SteamAudioUnity::gSourceInputTemplates.clear();
+    SteamAudioUnity::gRenderPool.stop();
+    SteamAudioUnity::gEffectBuilder.stop();
+    SteamAudioUnity::gEffectPool.clear();
+
     SteamAudioUnity::gNewReflectionMixerWritten = false;
     iplReflectionMixerRelease(&SteamAudioUnity::gReflectionMixer[0]);
     iplReflectionMixerRelease(&SteamAudioUnity::gReflectionMixer[1]);
@@ -133,6 +152,7 @@ void UNITY_AUDIODSP_CALLBACK iplUnitySetHRTF(IPLHRTF hrtf)
         return;
 
     SteamAudioUnity::setHRTF(hrtf);
+    SteamAudioUnity::prewarmEffectPool(hrtf);
 }
 
 void UNITY_AUDIODSP_CALLBACK iplUnitySetSimulationSettings(IPLSimulationSettings simulationSettings)
@@ -140,6 +160,83 @@ void UNITY_AUDIODSP_CALLBACK iplUnitySetSimulationSettings(IPLSimulationSettings
     SteamAudioUnity::gSimulationSettings = simulationSettings;
 
     SteamAudioUnity::gIsSimulationSettingsValid = true;
+
+    SteamAudioUnity::prewarmEffectPool(SteamAudioUnity::gHRTF[1]);
+}
+
+void UNITY_AUDIODSP_CALLBACK iplUnitySetEffectPoolSettings(IPLUnityEffectPoolSettings settings)
+{
+    SteamAudioUnity::gEffectPool.setSettings(settings.maxIdleEffects, settings.audioSettings, settings.numChannelsIn, settings.numChannelsOut);
+    SteamAudioUnity::prewarmEffectPool(SteamAudioUnity::gHRTF[1]);
+}
+
+void UNITY_AUDIODSP_CALLBACK iplUnitySetReflectionsBudget(IPLfloat32 channelSeconds)
+{
+    SteamAudioUnity::gReflectionBudget.setBudget(channelSeconds);
+}
+
+void UNITY_AUDIODSP_CALLBACK iplUnitySetPipelineSettings(IPLUnityPipelineSettings settings)
+{
+    if (settings.enabled)
+    {
+        SteamAudioUnity::gRenderPool.start(settings.numThreads, settings.maxWait);
+    }
+    else
+    {
+        SteamAudioUnity::gRenderPool.stop();
+    }
+}
+
+void UNITY_AUDIODSP_CALLBACK iplUnityStartSimulationScheduler(IPLUnitySimulationSchedulerSettings settings)
+{
+    SteamAudioUnity::SimulationSchedulerSettings schedulerSettings{};
+    schedulerSettings.simulator = settings.simulator;
+    schedulerSettings.stages[SteamAudioUnity::SIMULATIONSTAGE_DIRECT] = { settings.direct.updateInterval, settings.direct.priority };
+    schedulerSettings.stages[SteamAudioUnity::SIMULATIONSTAGE_INDIRECT] = { settings.indirect.updateInterval, settings.indirect.priority };
+    schedulerSettings.runOnCallingThread = (settings.runOnCallingThread == IPL_TRUE);
+
+    SteamAudioUnity::gSimulationScheduler.start(schedulerSettings);
+}
+
+void UNITY_AUDIODSP_CALLBACK iplUnityStopSimulationScheduler()
+{
+    SteamAudioUnity::gSimulationScheduler.stop();
+}
+
+void UNITY_AUDIODSP_CALLBACK iplUnityBeginSimulationFrame(IPLfloat32 deltaTime, IPLScene scene, IPLbool commitScene, IPLUnitySimulationFrame* frame)
+{
+    if (!frame)
+        return;
+
+    SteamAudioUnity::SimulationFrame simulationFrame{};
+    SteamAudioUnity::gSimulationScheduler.beginFrame(deltaTime, scene, (commitScene == IPL_TRUE), simulationFrame);
+
+    frame->readyFlags = simulationFrame.readyFlags;
+    frame->completedFlags = simulationFrame.completedFlags;
+    frame->sceneCommitted = (simulationFrame.sceneCommitted) ? IPL_TRUE : IPL_FALSE;
+}
+
+void UNITY_AUDIODSP_CALLBACK iplUnityEndSimulationFrame(IPLSimulationSharedInputs sharedInputs)
+{
+    SteamAudioUnity::gSimulationScheduler.endFrame(sharedInputs);
+}
+
+void UNITY_AUDIODSP_CALLBACK iplUnitySetSourceInputTemplate(IPLSource source, IPLSimulationInputs* inputs)
+{
+    if (!inputs)
+        return;
+
+    SteamAudioUnity::gSourceInputTemplates.set(source, *inputs);
+}
+
+void UNITY_AUDIODSP_CALLBACK iplUnityRemoveSourceInputTemplate(IPLSource source)
+{
+    SteamAudioUnity::gSourceInputTemplates.remove(source);
+}
+
+void UNITY_AUDIODSP_CALLBACK iplUnityUpdateSources(IPLSimulationFlags completedFlags, IPLSimulationFlags readyFlags, IPLint32 numSources, const IPLUnitySourceInputs* inputs, IPLDirectEffectParams* outputs)
+{
+    SteamAudioUnity::gSourceInputTemplates.update(completedFlags, readyFlags, numSources, inputs, outputs);
 }
 
 void UNITY_AUDIODSP_CALLBACK iplUnitySetReverbSource(IPLSource reverbSource)
@@ -172,6 +269,109 @@ void UNITY_AUDIODSP_CALLBACK iplUnityRemoveSource(IPLint32 handle)
     SteamAudioUnity::gSourceManager->removeSource(handle);
 }
 
+IPLbool UNITY_AUDIODSP_CALLBACK iplUnityGetPerfStats(IPLint32 handle,
+                                                     IPLUnityPerfStats* stats)
+{
+    if (!stats)
+        return IPL_FALSE;
+
+    SteamAudioUnity::PerfStats perfStats{};
+    if (handle >= 0)
+    {
+        if (!SteamAudioUnity::gPerfStatsRegistry.readForSource(handle, perfStats))
+            return IPL_FALSE;
+    }
+    else
+    {
+        SteamAudioUnity::gPerfStatsRegistry.readTotal(perfStats);
+    }
+
+    stats->numProcessCalls = perfStats.numProcessCalls;
+    stats->numBypassedBlocks = perfStats.numBypassedBlocks;
+    stats->numInitFailures = perfStats.numInitFailures;
+    stats->numHRTFChanges = perfStats.numHRTFChanges;
+    stats->directTime = perfStats.stageNanoseconds[SteamAudioUnity::PERFSTAGE_DIRECT];
+    stats->binauralTime = perfStats.stageNanoseconds[SteamAudioUnity::PERFSTAGE_BINAURAL];
+    stats->reflectionsTime = perfStats.stageNanoseconds[SteamAudioUnity::PERFSTAGE_REFLECTIONS];
+    stats->pathingTime = perfStats.stageNanoseconds[SteamAudioUnity::PERFSTAGE_PATHING];
+    stats->decodeTime = perfStats.stageNanoseconds[SteamAudioUnity::PERFSTAGE_DECODE];
+    stats->numLateBlocks = perfStats.numLateBlocks;
+
+    return IPL_TRUE;
+}
+
+IPLbool UNITY_AUDIODSP_CALLBACK iplUnityGetRealTimeAuditCallbacks(IPLAllocateFunction* allocateCallback,
+                                                                  IPLFreeFunction* freeCallback)
+{
+    if (allocateCallback)
+        *allocateCallback = SteamAudioUnity::auditedAllocate;
+    if (freeCallback)
+        *freeCallback = SteamAudioUnity::auditedFree;
+
+#if defined(STEAMAUDIO_ENABLE_RT_AUDIT)
+    return IPL_TRUE;
+#else
+    return IPL_FALSE;
+#endif
+}
+
+IPLint64 UNITY_AUDIODSP_CALLBACK iplUnityGetRealTimeAuditReport(char* report,
+                                                                IPLint32 size)
+{
+    return SteamAudioUnity::writeRTAuditReport(report, size);
+}
+
+void UNITY_AUDIODSP_CALLBACK iplUnityResetRealTimeAudit()
+{
+    SteamAudioUnity::resetRTAudit();
+}
+
+void UNITY_AUDIODSP_CALLBACK iplUnityGetAllocatorCallbacks(IPLAllocateFunction* allocateCallback,
+                                                           IPLFreeFunction* freeCallback)
+{
+#if defined(STEAMAUDIO_ENABLE_RT_AUDIT)
+    if (allocateCallback)
+        *allocateCallback = SteamAudioUnity::auditedAllocate;
+    if (freeCallback)
+        *freeCallback = SteamAudioUnity::auditedFree;
+#else
+    if (allocateCallback)
+        *allocateCallback = SteamAudioUnity::PoolAllocator::allocateCallback;
+    if (freeCallback)
+        *freeCallback = SteamAudioUnity::PoolAllocator::freeCallback;
+#endif
+}
+
+IPLint32 UNITY_AUDIODSP_CALLBACK iplUnityGetAllocatorStats(IPLUnityAllocatorStats* stats,
+                                                           IPLint32 maxSizeClasses)
+{
+    const auto kNumEntries = SteamAudioUnity::PoolAllocator::kLargeSizeClass + 1;
+
+    if (!stats || maxSizeClasses <= 0)
+        return kNumEntries;
+
+    SteamAudioUnity::PoolAllocatorStats allocatorStats[kNumEntries];
+    SteamAudioUnity::gPoolAllocator.getStats(allocatorStats);
+
+    for (auto i = 0; i < std::min(maxSizeClasses, kNumEntries); ++i)
+    {
+        stats[i].blockSize = allocatorStats[i].blockSize;
+        stats[i].numAllocations = allocatorStats[i].numAllocations;
+        stats[i].numActiveAllocations = allocatorStats[i].numActiveAllocations;
+        stats[i].bytesInUse = allocatorStats[i].bytesInUse;
+        stats[i].peakBytesInUse = allocatorStats[i].peakBytesInUse;
+        stats[i].bytesReserved = allocatorStats[i].bytesReserved;
+    }
+
+    return kNumEntries;
+}
+
+IPLSIMDLevel UNITY_AUDIODSP_CALLBACK iplUnityGetBestSIMDLevel(IPLbool autotune,
+                                                              IPLUnitySIMDLevelContextCreateCallback createContext)
+{
+    return SteamAudioUnity::selectSIMDLevel(autotune == IPL_TRUE, createContext, nullptr);
+}
+
 
 namespace SteamAudioUnity {
 
@@ -254,13 +454,7 @@ void applyVolumeRamp(float startVolume,
                      int numSamples, 
                      float* buffer)
 {
-    for (auto i = 0; i < numSamples; ++i)
-    {
-        auto fraction = static_cast<float>(i) / static_cast<float>(numSamples);
-        auto volume = fraction * endVolume + (1.0f - fraction) * startVolume;
-
-        buffer[i] *= volume;
-    }
+    applyRamp(buffer, startVolume, endVolume, numSamples, buffer);
 }
 
 //void crossfadeInputAndOutput(const float* inBuffer, const int numChannels, const int numSamples, float* outBuffer)
@@ -307,6 +501,11 @@ void getLatestHRTF()
 {
     if (gNewHRTFWritten)
     {
+        // Never wait for the game thread. If it is publishing an HRTF right now, pick it up in the next frame.
+        std::unique_lock<AuditedMutex> lock(gHRTFMutex, std::try_to_lock);
+        if (!lock.owns_lock())
+            return;
+
         iplHRTFRelease(&gHRTF[0]);
         gHRTF[0] = iplHRTFRetain(gHRTF[1]);
 
@@ -316,13 +515,20 @@ void getLatestHRTF()
 
 void setHRTF(IPLHRTF hrtf)
 {
-    if (!gNewHRTFWritten)
-    {
-        iplHRTFRelease(&gHRTF[1]);
-        gHRTF[1] = iplHRTFRetain(hrtf);
+    // If the audio thread has not picked up the previous HRTF yet, replace it, so the most recent HRTF is always the one
+    // that ends up in use.
+    std::lock_guard<AuditedMutex> lock(gHRTFMutex);
 
-        gNewHRTFWritten = true;
-    }
+    iplHRTFRelease(&gHRTF[1]);
+    gHRTF[1] = iplHRTFRetain(hrtf);
+
+    gNewHRTFWritten = true;
+}
+
+void prewarmEffectPool(IPLHRTF hrtf)
+{
+    auto simulationSettings = (gIsSimulationSettingsValid) ? &gSimulationSettings : nullptr;
+    gEffectPool.prewarm(gContext, hrtf, simulationSettings);
 }
 
 void getLatestPerspectiveCorrection()
@@ -354,87 +560,122 @@ void setPerspectiveCorrection(IPLUnityPerspectiveCorrection& correction)
 // --------------------------------------------------------------------------------------------------------------------
 
 SourceManager::SourceManager()
-    : mNextHandle(0)
-{}
+    : mNumReaders(0)
+    , mWriteMutex("source manager")
+{
+    mFreeSlots.reserve(kMaxSources);
+
+    for (auto i = 0; i < kMaxSources; ++i)
+    {
+        mSlots[i].generation.store(0, std::memory_order_relaxed);
+        mSlots[i].source.store(nullptr, std::memory_order_relaxed);
+
+        // Slots are handed out from the back, so push them in reverse to use low indices first.
+        mFreeSlots.push_back(kMaxSources - 1 - i);
+    }
+}
 
 SourceManager::~SourceManager()
 {
+    std::lock_guard<AuditedMutex> lock(mWriteMutex);
+
+    for (auto i = 0; i < kMaxSources; ++i)
     {
-        std::lock_guard<std::mutex> lock(mSourceMutex);
-        for (auto& it : mSources)
-        {
-            iplSourceRelease(&mSources[it.first]);
-        }
+        auto source = mSlots[i].source.exchange(nullptr);
+        iplSourceRelease(&source);
+    }
+
+    for (auto& source : mRetiredSources)
+    {
+        iplSourceRelease(&source);
     }
 }
 
 int32_t SourceManager::addSource(IPLSource source)
 {
-    // Retain a reference to this source.
-    auto sourceRetained = iplSourceRetain(source);
+    std::lock_guard<AuditedMutex> lock(mWriteMutex);
 
-    auto handle = -1;
+    releaseRetiredSources();
 
-    // First, figure out the handle we want to use.
-    {
-        std::lock_guard<std::mutex> lock(mHandleMutex);
+    if (mFreeSlots.empty())
+        return -1;
 
-        if (mFreeHandles.empty())
-        {
-            // No free handles, use the next-available unused handle.
-            handle = mNextHandle++;
-        }
-        else
-        {
-            // Use one of the free handles.
-            handle = mFreeHandles.top();
-            mFreeHandles.pop();
-        }
-    }
+    auto index = mFreeSlots.back();
+    mFreeSlots.pop_back();
 
-    assert(handle >= 0);
+    auto& slot = mSlots[index];
+    slot.source.store(iplSourceRetain(source), std::memory_order_release);
 
-    // Now store the mapping from the handle to this source.
-    {
-        std::lock_guard<std::mutex> lock(mSourceMutex);
+    auto generation = static_cast<int32_t>(slot.generation.load(std::memory_order_relaxed));
+    return (generation << kIndexBits) | index;
+}
 
-        assert(mSources.find(handle) == mSources.end());
+void SourceManager::removeSource(int32_t handle)
+{
+    if (handle < 0 || kMaxHandle < handle)
+        return;
 
-        mSources[handle] = sourceRetained;
-    }
+    auto index = handle & (kMaxSources - 1);
+    auto generation = static_cast<uint32_t>(handle >> kIndexBits);
+
+    std::lock_guard<AuditedMutex> lock(mWriteMutex);
+
+    auto& slot = mSlots[index];
+    if (slot.generation.load(std::memory_order_relaxed) != generation)
+        return;
+
+    auto source = slot.source.exchange(nullptr, std::memory_order_acq_rel);
+    if (!source)
+        return;
+
+    slot.generation.store((generation + 1) & ((1u << kGenerationBits) - 1), std::memory_order_release);
+    mFreeSlots.push_back(index);
 
-    return handle;
+    mRetiredSources.push_back(source);
+    releaseRetiredSources();
 }
 
-void SourceManager::removeSource(int32_t handle)
+IPLSource SourceManager::retainSource(int32_t handle)
 {
-    // Remove the source from the handle-to-source map.
-    {
-        std::lock_guard<std::mutex> lock(mSourceMutex);
+    if (handle < 0 || kMaxHandle < handle)
+        return nullptr;
 
-        if (mSources.find(handle) != mSources.end())
-        {
-            iplSourceRelease(&mSources[handle]);
-            mSources.erase(handle);
-        }
-    }
+    auto index = handle & (kMaxSources - 1);
+    auto generation = static_cast<uint32_t>(handle >> kIndexBits);
+    auto& slot = mSlots[index];
 
-    // Mark the handle as free.
+    mNumReaders.fetch_add(1);
+
+    IPLSource source = nullptr;
+    if (slot.generation.load() == generation)
     {
-        std::lock_guard<std::mutex> lock(mHandleMutex);
+        source = slot.source.load();
 
-        mFreeHandles.push(handle);
+        // If the slot was reused after we checked the generation, the source belongs to a different handle.
+        if (source && slot.generation.load() == generation)
+            source = iplSourceRetain(source);
+        else
+            source = nullptr;
     }
+
+    mNumReaders.fetch_sub(1);
+
+    return source;
 }
 
-IPLSource SourceManager::getSource(int32_t handle)
+void SourceManager::releaseRetiredSources()
 {
-    std::lock_guard<std::mutex> lock(mSourceMutex);
+    // Any reader that could have seen a retired source started before the source was retired, so once there are no
+    // readers, none of them can still be using it.
+    if (mRetiredSources.empty() || mNumReaders.load() != 0)
+        return;
 
-    if (mSources.find(handle) != mSources.end())
-        return mSources[handle];
-    else
-        return nullptr;
+    for (auto& source : mRetiredSources)
+    {
+        iplSourceRelease(&source);
+    }
+
+    mRetiredSources.clear();
 }
 
 }
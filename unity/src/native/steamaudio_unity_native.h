@@ -15,14 +15,15 @@
 #include <limits>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <unordered_map>
+#include <vector>
 
 #include <unity5/AudioPluginInterface.h>
 
 #include <phonon.h>
 
 #include "steamaudio_unity_version.h"
+#include "rt_audit.h"
 
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -41,6 +42,85 @@ typedef struct {
     IPLMatrix4x4 transform;
 } IPLUnityPerspectiveCorrection;
 
+/** Settings for the pool of effect objects reused across Steam Audio Spatializer instances. */
+typedef struct {
+    IPLint32 maxIdleEffects;
+    IPLAudioSettings audioSettings;
+    IPLint32 numChannelsIn;
+    IPLint32 numChannelsOut;
+} IPLUnityEffectPoolSettings;
+
+/** Performance counters of one or more Steam Audio effect instances. Times are in nanoseconds. */
+typedef struct {
+    IPLuint64 numProcessCalls;
+    IPLuint64 numBypassedBlocks;
+    IPLuint64 numInitFailures;
+    IPLuint64 numHRTFChanges;
+    IPLuint64 directTime;
+    IPLuint64 binauralTime;
+    IPLuint64 reflectionsTime;
+    IPLuint64 pathingTime;
+    IPLuint64 decodeTime;
+    IPLuint64 numLateBlocks;
+} IPLUnityPerfStats;
+
+/** Settings for pipelined rendering of Steam Audio Spatializer instances on a pool of worker threads. */
+typedef struct {
+    IPLbool enabled;
+    IPLint32 numThreads;
+    IPLfloat32 maxWait;
+} IPLUnityPipelineSettings;
+
+/** How often, and at what thread priority (-2 to 2), one simulation stage runs. */
+typedef struct {
+    IPLfloat32 updateInterval;
+    IPLint32 priority;
+} IPLUnitySimulationStageSettings;
+
+/** Settings for the native simulation scheduler. */
+typedef struct {
+    IPLSimulator simulator;
+    IPLUnitySimulationStageSettings direct;
+    IPLUnitySimulationStageSettings indirect;
+    IPLbool runOnCallingThread;
+} IPLUnitySimulationSchedulerSettings;
+
+/** What the game should do between iplUnityBeginSimulationFrame and iplUnityEndSimulationFrame. */
+typedef struct {
+    IPLSimulationFlags readyFlags;
+    IPLSimulationFlags completedFlags;
+    IPLbool sceneCommitted;
+} IPLUnitySimulationFrame;
+
+/** The simulation inputs of one source that may change every frame. Everything else is taken from the source's input
+    template, set using iplUnitySetSourceInputTemplate. */
+typedef struct {
+    IPLSource source;
+    IPLSimulationFlags flags;
+    IPLDirectSimulationFlags directFlags;
+    IPLCoordinateSpace3 transform;
+    IPLfloat32 dipoleWeight;
+    IPLfloat32 dipolePower;
+    IPLOcclusionType occlusionType;
+    IPLfloat32 occlusionRadius;
+    IPLint32 numOcclusionSamples;
+    IPLint32 numTransmissionRays;
+} IPLUnitySourceInputs;
+
+/** Usage counters for one size class of the pool allocator. blockSize is 0 for allocations too large (or too strictly
+    aligned) to be pooled. */
+typedef struct {
+    IPLsize blockSize;
+    IPLuint64 numAllocations;
+    IPLuint64 numActiveAllocations;
+    IPLuint64 bytesInUse;
+    IPLuint64 peakBytesInUse;
+    IPLuint64 bytesReserved;
+} IPLUnityAllocatorStats;
+
+/** Creates a context whose SIMD level is at most simdLevel. Used by iplUnityGetBestSIMDLevel to time each level. */
+typedef IPLerror (IPLCALL* IPLUnitySIMDLevelContextCreateCallback)(IPLSIMDLevel simdLevel, IPLContext* context);
+
 #endif
 
 // This function is called by Unity when it loads native audio plugins. It returns metadata that describes all of the
@@ -63,10 +143,95 @@ UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnitySetSimulationSett
 
 UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnitySetReverbSource(IPLSource reverbSource);
 
+UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnitySetEffectPoolSettings(IPLUnityEffectPoolSettings settings);
+
+UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnitySetReflectionsBudget(IPLfloat32 channelSeconds);
+
+// Enables or disables pipelined rendering. When enabled, each Steam Audio Spatializer hands its block to a pool of
+// numThreads worker threads (or one fewer than the number of CPU cores, if numThreads is 0), and plays the block it
+// handed over in the previous mixer tick, which adds one block of latency. maxWait is the fraction of a block's duration
+// that the mixer thread waits, per tick, for workers to finish. A spatializer whose worker misses this deadline plays a
+// cheaper, panned approximation of its block instead. Must not be called on the audio thread.
+UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnitySetPipelineSettings(IPLUnityPipelineSettings settings);
+
+// Starts running the direct simulation of the given simulator on one native thread, and its reflections and pathing
+// simulations, one after the other, on another. If runOnCallingThread is true, every stage runs on the thread that calls iplUnityEndSimulationFrame instead,
+// for scenes whose ray tracing callbacks must be called from the game's main thread. If the scheduler is already
+// running, it is stopped first.
+UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnityStartSimulationScheduler(IPLUnitySimulationSchedulerSettings settings);
+
+// Waits for any simulations in progress, and stops the simulation threads. Must be called before the simulator is
+// released.
+UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnityStopSimulationScheduler();
+
+// Starts a simulation frame. Between this and iplUnityEndSimulationFrame, the game sets the inputs of every source for
+// the stages in frame->readyFlags, and reads the outputs of every source for the stages in frame->completedFlags. If
+// commitScene is true, scene is committed along with the simulator, as soon as no simulation is using it, and
+// frame->sceneCommitted is set once it has been. Main thread only.
+UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnityBeginSimulationFrame(IPLfloat32 deltaTime, IPLScene scene, IPLbool commitScene, IPLUnitySimulationFrame* frame);
+
+// Ends a simulation frame, setting the shared inputs of the stages that are ready, and starting them. Main thread only.
+UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnityEndSimulationFrame(IPLSimulationSharedInputs sharedInputs);
+
+// Sets the simulation inputs of a source that are not part of IPLUnitySourceInputs. Only needs to be called again when
+// they change. The fields that are part of IPLUnitySourceInputs are ignored.
+UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnitySetSourceInputTemplate(IPLSource source, IPLSimulationInputs* inputs);
+
+// Removes the input template of a source, and releases the reference to the source that it held.
+UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnityRemoveSourceInputTemplate(IPLSource source);
+
+// Updates numSources sources in one call, instead of one call per source to iplSourceGetOutputs and
+// iplSourceSetInputs. If completedFlags includes IPL_SIMULATIONFLAGS_DIRECT, first reads the direct simulation outputs
+// of inputs[i].source into outputs[i]. Then, if readyFlags is non-zero, sets the inputs of each source for the
+// simulations in readyFlags, combining inputs[i] with the source's input template. outputs may be NULL.
+//
+// Both arrays must stay pinned for the duration of the call. Their contents are blittable, so the pointer to a
+// NativeArray can be passed directly, including from Burst-compiled code. Must be called between
+// iplUnityBeginSimulationFrame and iplUnityEndSimulationFrame, with the flags returned by the former, but may be called
+// on any thread, for example from a job that the main thread completes before ending the frame.
+UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnityUpdateSources(IPLSimulationFlags completedFlags, IPLSimulationFlags readyFlags, IPLint32 numSources, const IPLUnitySourceInputs* inputs, IPLDirectEffectParams* outputs);
+
 UNITY_AUDIODSP_EXPORT_API IPLint32 UNITY_AUDIODSP_CALLBACK iplUnityAddSource(IPLSource source);
 
 UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnityRemoveSource(IPLint32 handle);
 
+// Reads the performance counters of the spatializer rendering the source with the given handle, as returned by
+// iplUnityAddSource. If handle is -1, reads the sum of the counters of all Steam Audio effects, past and present.
+// May be called on any thread. Returns IPL_FALSE if no spatializer is rendering the source.
+UNITY_AUDIODSP_EXPORT_API IPLbool UNITY_AUDIODSP_CALLBACK iplUnityGetPerfStats(IPLint32 handle, IPLUnityPerfStats* stats);
+
+// Returns allocation callbacks that can be used in IPLContextSettings so that the real-time audit also records heap
+// allocations made by Steam Audio while a Steam Audio effect is processing audio. Returns IPL_TRUE if the plugin was
+// built with the real-time audit enabled (STEAMAUDIOUNITY_ENABLE_RT_AUDIT); otherwise, the callbacks allocate memory
+// without recording anything.
+UNITY_AUDIODSP_EXPORT_API IPLbool UNITY_AUDIODSP_CALLBACK iplUnityGetRealTimeAuditCallbacks(IPLAllocateFunction* allocateCallback, IPLFreeFunction* freeCallback);
+
+// Writes a summary of the heap allocations, mutex locks, and system calls recorded by the real-time audit so far, along
+// with the call stacks they were made from, to report as null-terminated text, truncated to fit in size bytes. May be
+// called on any thread. Returns the total number of calls recorded, or -1 if the plugin was built without the
+// real-time audit.
+UNITY_AUDIODSP_EXPORT_API IPLint64 UNITY_AUDIODSP_CALLBACK iplUnityGetRealTimeAuditReport(char* report, IPLint32 size);
+
+// Discards all calls recorded by the real-time audit so far. Does nothing if the plugin was built without it.
+UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnityResetRealTimeAudit();
+
+// Returns the callbacks of the pool allocator, for use in IPLContextSettings. The allocator rounds allocations up to one
+// of a fixed set of size classes, four per octave, and reuses freed memory within each size class, which avoids
+// fragmenting the heap over long sessions. Chunks of memory that are no longer used are returned to the system. If the
+// plugin was built with the real-time audit, the callbacks also record allocations made from real-time code.
+UNITY_AUDIODSP_EXPORT_API void UNITY_AUDIODSP_CALLBACK iplUnityGetAllocatorCallbacks(IPLAllocateFunction* allocateCallback, IPLFreeFunction* freeCallback);
+
+// Reads the usage counters of the pool allocator, one entry per size class, in increasing order of block size, followed
+// by one entry for allocations too large to be pooled. May be called on any thread. Returns the total number of size
+// classes, which may be more than maxSizeClasses.
+UNITY_AUDIODSP_EXPORT_API IPLint32 UNITY_AUDIODSP_CALLBACK iplUnityGetAllocatorStats(IPLUnityAllocatorStats* stats, IPLint32 maxSizeClasses);
+
+// Returns the SIMD level to create contexts with on this machine: the highest level that the CPU and OS support or, if
+// autotune is IPL_TRUE, the level at which Steam Audio's kernels run fastest, timed using contexts created by
+// createContext. The result of autotuning is saved in the user's cache directory, and reused by later calls on the same
+// machine.
+UNITY_AUDIODSP_EXPORT_API IPLSIMDLevel UNITY_AUDIODSP_CALLBACK iplUnityGetBestSIMDLevel(IPLbool autotune, IPLUnitySIMDLevelContextCreateCallback createContext);
+
 #endif
 
 }
@@ -92,6 +257,9 @@ extern std::atomic<bool> gIsSimulationSettingsValid;
 extern std::atomic<bool> gNewReverbSourceWritten;
 extern std::atomic<bool> gNewReflectionMixerWritten;
 
+// Guards publishing a new HRTF. Only ever try-locked on the audio thread.
+extern AuditedMutex gHRTFMutex;
+
 
 // --------------------------------------------------------------------------------------------------------------------
 // Helper Functions
@@ -144,6 +312,9 @@ IPLCoordinateSpace3 calcListenerCoordinates(const float* listenerMatrix);
 void getLatestHRTF();
 void setHRTF(IPLHRTF hrtf);
 
+// Tops up the effect pool for the given HRTF and the current simulation settings.
+void prewarmEffectPool(IPLHRTF hrtf);
+
 void getLatestPerspectiveCorrection();
 void setPerspectiveCorrection(IPLUnityPerspectiveCorrection& correction);
 
@@ -153,39 +324,61 @@ void setPerspectiveCorrection(IPLUnityPerspectiveCorrection& correction);
 
 // Manages assigning a 32-bit integer handle to IPLSource objects, so the C# scripts can reference a specific IPLSource
 // in a single call to AudioSource.SetSpatializerFloat or similar.
+//
+// Sources are stored in a fixed-size slot array. A handle encodes a slot index in its low kIndexBits bits, and the
+// generation of the slot in the next kGenerationBits bits. Every time a source is removed, the generation of its slot is
+// incremented, so stale handles to a slot that has since been reused are detected. Handles are always non-negative and
+// less than 2^23, so they can be passed through a float parameter without loss of precision.
+//
+// Lookups are wait-free. Adding and removing sources is serialized by a mutex, but never blocks lookups. Removed
+// sources are not released until no lookup is in progress, so a lookup that raced with a removal can still safely
+// retain the source it found.
 class SourceManager
 {
 public:
+    static const int kIndexBits = 13;
+    static const int kGenerationBits = 10;
+    static const int kMaxSources = 1 << kIndexBits;
+    static const int32_t kMaxHandle = (1 << (kIndexBits + kGenerationBits)) - 1;
+
     SourceManager();
     ~SourceManager();
 
     // Registers a source that has already been created, and returns the corresponding handle. A reference to the
-    // IPLSource will be retained by this object.
+    // IPLSource will be retained by this object. Returns -1 if all slots are in use.
     int32_t addSource(IPLSource source);
 
-    // Unregisters a source (by handle), and releases the reference.
+    // Unregisters a source (by handle), and releases the reference. Does nothing if the handle is stale.
     void removeSource(int32_t handle);
 
-    // Returns the IPLSource corresponding to a given handle. If the handle is invalid or the IPLSource has been
-    // released, returns nullptr. Does not retain an additional reference.
-    IPLSource getSource(int32_t handle);
+    // Returns the IPLSource corresponding to a given handle, with an additional reference that the caller must
+    // release. If the handle is invalid or stale, returns nullptr. Wait-free.
+    IPLSource retainSource(int32_t handle);
 
 private:
-    // The next available integer that hasn't yet been assigned as the handle for any source.
-    int32_t mNextHandle;
+    struct Slot
+    {
+        std::atomic<uint32_t> generation;
+        std::atomic<IPLSource> source;
+    };
+
+    Slot mSlots[kMaxSources];
+
+    // The number of retainSource calls in progress.
+    std::atomic<int> mNumReaders;
 
-    // Handles for sources that have been unregistered, and which can now be reused. We will prefer reusing free
-    // handle values over using a new handle value.
-    std::priority_queue<int32_t> mFreeHandles;
+    // Slots that are not in use. Only accessed while holding mWriteMutex.
+    std::vector<int32_t> mFreeSlots;
 
-    // The mapping from handle values to IPLSource objects.
-    std::unordered_map<int32_t, IPLSource> mSources;
+    // Sources that have been removed, but may still be in the process of being retained by a reader. Only accessed
+    // while holding mWriteMutex.
+    std::vector<IPLSource> mRetiredSources;
 
-    // Synchronizes access to the handle priority queue and related values.
-    std::mutex mHandleMutex;
+    // Serializes addSource and removeSource.
+    AuditedMutex mWriteMutex;
 
-    // Synchronizes access to the handle-to-source map.
-    std::mutex mSourceMutex;
+    // Releases retired sources, if no reader can still be using them. Must be called while holding mWriteMutex.
+    void releaseRetiredSources();
 };
 
 #endif
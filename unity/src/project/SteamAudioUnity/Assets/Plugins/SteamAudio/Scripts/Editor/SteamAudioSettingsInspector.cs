@@ -43,6 +43,9 @@ namespace SteamAudio
         SerializedProperty mBakingPathRange;
         SerializedProperty mBakedPathingCPUCoresPercentage;
         SerializedProperty mSimulationUpdateInterval;
+        SerializedProperty mDirectSimulationUpdateInterval;
+        SerializedProperty mDirectSimulationPriority;
+        SerializedProperty mIndirectSimulationPriority;
         SerializedProperty mReflectionEffectType;
         SerializedProperty mHybridReverbTransitionTime;
         SerializedProperty mHybridReverbOverlapPercent;
@@ -54,6 +57,10 @@ namespace SteamAudio
         SerializedProperty mTANAmbisonicOrder;
         SerializedProperty mTANMaxSources;
         SerializedProperty mEnableValidation;
+        SerializedProperty mAutotuneSIMDLevel;
+        SerializedProperty mPipelinedSpatialization;
+        SerializedProperty mPipelineThreads;
+        SerializedProperty mPipelineMaxWait;
 
 #if !UNITY_2019_2_OR_NEWER
         static string[] sSceneTypes = new string[] { "Phonon", "Embree", "Radeon Rays", "Unity" };
@@ -97,6 +104,9 @@ namespace SteamAudio
             mBakingPathRange = serializedObject.FindProperty("bakingPathRange");
             mBakedPathingCPUCoresPercentage = serializedObject.FindProperty("bakedPathingCPUCoresPercentage");
             mSimulationUpdateInterval = serializedObject.FindProperty("simulationUpdateInterval");
+            mDirectSimulationUpdateInterval = serializedObject.FindProperty("directSimulationUpdateInterval");
+            mDirectSimulationPriority = serializedObject.FindProperty("directSimulationPriority");
+            mIndirectSimulationPriority = serializedObject.FindProperty("indirectSimulationPriority");
             mReflectionEffectType = serializedObject.FindProperty("reflectionEffectType");
             mHybridReverbTransitionTime = serializedObject.FindProperty("hybridReverbTransitionTime");
             mHybridReverbOverlapPercent = serializedObject.FindProperty("hybridReverbOverlapPercent");
@@ -108,6 +118,10 @@ namespace SteamAudio
             mTANAmbisonicOrder = serializedObject.FindProperty("TANAmbisonicOrder");
             mTANMaxSources = serializedObject.FindProperty("TANMaxSources");
             mEnableValidation = serializedObject.FindProperty("EnableValidation");
+            mAutotuneSIMDLevel = serializedObject.FindProperty("AutotuneSIMDLevel");
+            mPipelinedSpatialization = serializedObject.FindProperty("PipelinedSpatialization");
+            mPipelineThreads = serializedObject.FindProperty("PipelineThreads");
+            mPipelineMaxWait = serializedObject.FindProperty("PipelineMaxWait");
         }
 
         public override void OnInspectorGUI()
@@ -163,6 +177,9 @@ namespace SteamAudio
             EditorGUILayout.PropertyField(mBakedPathingCPUCoresPercentage);
 
             EditorGUILayout.PropertyField(mSimulationUpdateInterval);
+            EditorGUILayout.PropertyField(mDirectSimulationUpdateInterval);
+            EditorGUILayout.PropertyField(mDirectSimulationPriority);
+            EditorGUILayout.PropertyField(mIndirectSimulationPriority);
 
 #if UNITY_2019_2_OR_NEWER
             EditorGUILayout.PropertyField(mReflectionEffectType);
@@ -197,6 +214,13 @@ namespace SteamAudio
             }
 
             EditorGUILayout.PropertyField(mEnableValidation);
+            EditorGUILayout.PropertyField(mAutotuneSIMDLevel);
+            EditorGUILayout.PropertyField(mPipelinedSpatialization);
+            if (mPipelinedSpatialization.boolValue)
+            {
+                EditorGUILayout.PropertyField(mPipelineThreads);
+                EditorGUILayout.PropertyField(mPipelineMaxWait);
+            }
 
             serializedObject.ApplyModifiedProperties();
         }
@@ -5,6 +5,7 @@
 
 using AOT;
 using System;
+using System.Runtime.InteropServices;
 using UnityEngine;
 
 namespace SteamAudio
@@ -18,7 +19,9 @@ namespace SteamAudio
             var contextSettings = new ContextSettings { };
             contextSettings.version = Constants.kVersion;
             contextSettings.logCallback = LogMessage;
-            contextSettings.simdLevel = SIMDLevel.AVX2;
+            contextSettings.simdLevel = SelectSIMDLevel();
+
+            SetAllocatorCallbacks(ref contextSettings);
 
             if (SteamAudioSettings.Singleton.EnableValidation)
             {
@@ -50,6 +53,55 @@ namespace SteamAudio
             return mContext;
         }
 
+        // Uses the native plugin's pool allocator, which keeps Steam Audio's allocations from fragmenting the heap over
+        // long sessions. If the native plugin is not available, Steam Audio's default allocator is used instead.
+        static void SetAllocatorCallbacks(ref ContextSettings contextSettings)
+        {
+            try
+            {
+                IntPtr allocateCallback;
+                IntPtr freeCallback;
+                API.iplUnityGetAllocatorCallbacks(out allocateCallback, out freeCallback);
+
+                contextSettings.allocateCallback = (AllocateCallback) Marshal.GetDelegateForFunctionPointer(allocateCallback, typeof(AllocateCallback));
+                contextSettings.freeCallback = (FreeCallback) Marshal.GetDelegateForFunctionPointer(freeCallback, typeof(FreeCallback));
+            }
+            catch (DllNotFoundException)
+            {}
+            catch (EntryPointNotFoundException)
+            {}
+        }
+
+        // Asks the native plugin for the best SIMD level for this machine, autotuning if enabled in the settings. If the
+        // native plugin is not available, AVX2 is used as the maximum level.
+        static SIMDLevel SelectSIMDLevel()
+        {
+            try
+            {
+                var autotune = SteamAudioSettings.Singleton.AutotuneSIMDLevel ? Bool.True : Bool.False;
+                return API.iplUnityGetBestSIMDLevel(autotune, CreateContextForSIMDLevel);
+            }
+            catch (DllNotFoundException)
+            {}
+            catch (EntryPointNotFoundException)
+            {}
+
+            return SIMDLevel.AVX2;
+        }
+
+        // Creates a context with the given SIMD level, for timing Steam Audio's kernels at that level.
+        [MonoPInvokeCallback(typeof(SIMDLevelContextCreateCallback))]
+        static Error CreateContextForSIMDLevel(SIMDLevel simdLevel, out IntPtr context)
+        {
+            var contextSettings = new ContextSettings { };
+            contextSettings.version = Constants.kVersion;
+            contextSettings.simdLevel = simdLevel;
+
+            SetAllocatorCallbacks(ref contextSettings);
+
+            return API.iplContextCreate(ref contextSettings, out context);
+        }
+
         [MonoPInvokeCallback(typeof(LogCallback))]
         public static void LogMessage(LogLevel level, string message)
         {
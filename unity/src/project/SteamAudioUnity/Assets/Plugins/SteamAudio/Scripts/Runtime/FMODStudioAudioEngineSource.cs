@@ -16,6 +16,8 @@ namespace SteamAudio
         object mEventEmitter = null;
         object mEventInstance = null;
         object mDSP = null;
+        uint mDSPID = 0;
+        bool mHandleSent = false;
         SteamAudioSource mSteamAudioSource = null;
         int mHandle = -1;
 
@@ -28,7 +30,7 @@ namespace SteamAudio
         static MethodInfo FMOD_Studio_EventInstance_isValid;
         static MethodInfo FMOD_ChannelGroup_getNumDSPs;
         static MethodInfo FMOD_ChannelGroup_getDSP;
-        static MethodInfo FMOD_DSP_getInfo;
+        static FieldInfo FMOD_DSP_handle;
         static MethodInfo FMOD_DSP_setParameterInt;
         static bool mBoundToPlugin = false;
 
@@ -58,13 +60,31 @@ namespace SteamAudio
         public override void UpdateParameters(SteamAudioSource source)
         {
             CheckForChangedEventInstance();
+            CheckForReleasedDSP();
 
             FindDSP(source.gameObject);
             if (!mFoundDSP)
                 return;
 
-            var index = kSimulationOutputsParamIndex;
-            FMOD_DSP_setParameterInt.Invoke(mDSP, new object[] { index++, mHandle });
+            // The handle only needs to be sent once to each DSP instance.
+            if (!mHandleSent)
+            {
+                FMOD_DSP_setParameterInt.Invoke(mDSP, new object[] { kSimulationOutputsParamIndex, mHandle });
+                mHandleSent = true;
+            }
+        }
+
+        void CheckForReleasedDSP()
+        {
+            if (!mFoundDSP)
+                return;
+
+            // The plugin assigns a new ID to every spatializer DSP it creates, so if the ID has changed (or is 0), the
+            // DSP we found earlier has been released.
+            if (FMODStudioAPI.iplFMODGetSpatializerID(GetDSPHandle(mDSP)) != mDSPID)
+            {
+                mFoundDSP = false;
+            }
         }
 
         void CheckForChangedEventInstance()
@@ -95,6 +115,8 @@ namespace SteamAudio
 
             BindToFMODStudioPlugin();
 
+            mHandleSent = false;
+
             mEventEmitter = gameObject.GetComponent(FMODUnity_StudioEventEmitter) as object;
             if (mEventEmitter == null)
                 return;
@@ -119,17 +141,8 @@ namespace SteamAudio
                 FMOD_ChannelGroup_getDSP.Invoke(channelGroup, getDSPArgs);
                 mDSP = getDSPArgs[1];
 
-                var dspName = "";
-                var dspVersion = 0u;
-                var dspNumChannels = 0;
-                var dspConfigWidth = 0;
-                var dspConfigHeight = 0;
-
-                var getInfoArgs = new object[] { dspName, dspVersion, dspNumChannels, dspConfigWidth, dspConfigHeight };
-                FMOD_DSP_getInfo.Invoke(mDSP, getInfoArgs);
-                dspName = (string)getInfoArgs[0];
-
-                if (dspName == "Steam Audio Spatializer")
+                mDSPID = FMODStudioAPI.iplFMODGetSpatializerID(GetDSPHandle(mDSP));
+                if (mDSPID != 0)
                 {
                     mFoundDSP = true;
                     return;
@@ -137,6 +150,11 @@ namespace SteamAudio
             }
         }
 
+        static IntPtr GetDSPHandle(object dsp)
+        {
+            return (IntPtr)FMOD_DSP_handle.GetValue(dsp);
+        }
+
         static void BindToFMODStudioPlugin()
         {
             if (mBoundToPlugin)
@@ -156,16 +174,7 @@ namespace SteamAudio
             FMOD_ChannelGroup_getNumDSPs = FMOD_ChannelGroup.GetMethod("getNumDSPs");
             FMOD_ChannelGroup_getDSP = FMOD_ChannelGroup.GetMethod("getDSP");
             FMOD_DSP_setParameterInt = FMOD_DSP.GetMethod("setParameterInt");
-
-            var candidates = FMOD_DSP.GetMethods();
-            foreach (var candidate in candidates)
-            {
-                if (candidate.Name == "getInfo" && candidate.GetParameters().Length == 5)
-                {
-                    FMOD_DSP_getInfo = candidate;
-                    break;
-                }
-            }
+            FMOD_DSP_handle = FMOD_DSP.GetField("handle");
 
             mBoundToPlugin = true;
         }
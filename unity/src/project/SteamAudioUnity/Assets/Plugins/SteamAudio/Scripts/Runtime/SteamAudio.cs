@@ -226,6 +226,9 @@ namespace SteamAudio
     [UnmanagedFunctionPointer(CallingConvention.Winapi)]
     public delegate void PathingVisualizationCallback(Vector3 from, Vector3 to, Bool occluded, IntPtr userData);
 
+    [UnmanagedFunctionPointer(CallingConvention.Winapi)]
+    public delegate Error SIMDLevelContextCreateCallback(SIMDLevel simdLevel, out IntPtr context);
+
     // STRUCTURES
 
     [StructLayout(LayoutKind.Sequential)]
@@ -649,6 +652,53 @@ namespace SteamAudio
         public Matrix4x4 transform;
     }
 
+    [StructLayout(LayoutKind.Sequential)]
+    public struct PipelineSettings
+    {
+        public Bool enabled;
+        public int numThreads;
+        public float maxWait;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SimulationStageSettings
+    {
+        public float updateInterval;
+        public int priority;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SimulationSchedulerSettings
+    {
+        public IntPtr simulator;
+        public SimulationStageSettings direct;
+        public SimulationStageSettings indirect;
+        public Bool runOnCallingThread;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SimulationFrame
+    {
+        public SimulationFlags readyFlags;
+        public SimulationFlags completedFlags;
+        public Bool sceneCommitted;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SourceInputs
+    {
+        public IntPtr source;
+        public SimulationFlags flags;
+        public DirectSimulationFlags directFlags;
+        public CoordinateSpace3 transform;
+        public float dipoleWeight;
+        public float dipolePower;
+        public OcclusionType occlusionType;
+        public float occlusionRadius;
+        public int numOcclusionSamples;
+        public int numTransmissionRays;
+    }
+
     // FUNCTIONS
 
     public static class API
@@ -1316,6 +1366,70 @@ namespace SteamAudio
 #endif
         public static extern void iplUnitySetPerspectiveCorrection(PerspectiveCorrection correction);
 
+#if UNITY_IOS && !UNITY_EDITOR
+        [DllImport("__Internal")]
+#else
+        [DllImport("audioplugin_phonon")]
+#endif
+        public static extern void iplUnitySetPipelineSettings(PipelineSettings settings);
+
+#if UNITY_IOS && !UNITY_EDITOR
+        [DllImport("__Internal")]
+#else
+        [DllImport("audioplugin_phonon")]
+#endif
+        public static extern void iplUnityStartSimulationScheduler(SimulationSchedulerSettings settings);
+
+#if UNITY_IOS && !UNITY_EDITOR
+        [DllImport("__Internal")]
+#else
+        [DllImport("audioplugin_phonon")]
+#endif
+        public static extern void iplUnityStopSimulationScheduler();
+
+#if UNITY_IOS && !UNITY_EDITOR
+        [DllImport("__Internal")]
+#else
+        [DllImport("audioplugin_phonon")]
+#endif
+        public static extern void iplUnityBeginSimulationFrame(float deltaTime, IntPtr scene, Bool commitScene, out SimulationFrame frame);
+
+#if UNITY_IOS && !UNITY_EDITOR
+        [DllImport("__Internal")]
+#else
+        [DllImport("audioplugin_phonon")]
+#endif
+        public static extern void iplUnityEndSimulationFrame(SimulationSharedInputs sharedInputs);
+
+#if UNITY_IOS && !UNITY_EDITOR
+        [DllImport("__Internal")]
+#else
+        [DllImport("audioplugin_phonon")]
+#endif
+        public static extern void iplUnitySetSourceInputTemplate(IntPtr source, ref SimulationInputs inputs);
+
+#if UNITY_IOS && !UNITY_EDITOR
+        [DllImport("__Internal")]
+#else
+        [DllImport("audioplugin_phonon")]
+#endif
+        public static extern void iplUnityRemoveSourceInputTemplate(IntPtr source);
+
+#if UNITY_IOS && !UNITY_EDITOR
+        [DllImport("__Internal")]
+#else
+        [DllImport("audioplugin_phonon")]
+#endif
+        public static extern void iplUnityUpdateSources(SimulationFlags completedFlags, SimulationFlags readyFlags, int numSources, [In] SourceInputs[] inputs, [Out] DirectEffectParams[] outputs);
+
+        // For use with NativeArray<SourceInputs> and NativeArray<DirectEffectParams>, e.g. from Burst-compiled jobs.
+#if UNITY_IOS && !UNITY_EDITOR
+        [DllImport("__Internal")]
+#else
+        [DllImport("audioplugin_phonon")]
+#endif
+        public static extern void iplUnityUpdateSources(SimulationFlags completedFlags, SimulationFlags readyFlags, int numSources, IntPtr inputs, IntPtr outputs);
+
 #if UNITY_IOS && !UNITY_EDITOR
         [DllImport("__Internal")]
 #else
@@ -1357,5 +1471,19 @@ namespace SteamAudio
         [DllImport("audioplugin_phonon")]
 #endif
         public static extern void iplUnityTerminate();
+
+#if UNITY_IOS && !UNITY_EDITOR
+        [DllImport("__Internal")]
+#else
+        [DllImport("audioplugin_phonon")]
+#endif
+        public static extern void iplUnityGetAllocatorCallbacks(out IntPtr allocateCallback, out IntPtr freeCallback);
+
+#if UNITY_IOS && !UNITY_EDITOR
+        [DllImport("__Internal")]
+#else
+        [DllImport("audioplugin_phonon")]
+#endif
+        public static extern SIMDLevel iplUnityGetBestSIMDLevel(Bool autotune, SIMDLevelContextCreateCallback createContext);
     }
 }
@@ -6,7 +6,6 @@
 using System;
 using System.Collections.Generic;
 using System.Runtime.InteropServices;
-using System.Threading;
 using AOT;
 using UnityEngine;
 using UnityEngine.SceneManagement;
@@ -58,14 +57,12 @@ namespace SteamAudio
         Transform mListener = null;
         SteamAudioListener mListenerComponent = null;
         HashSet<SteamAudioSource> mSources = new HashSet<SteamAudioSource>();
+        SteamAudioSource[] mSourceList = new SteamAudioSource[0];
+        SourceInputs[] mSourceInputs = new SourceInputs[0];
+        DirectEffectParams[] mSourceOutputs = new DirectEffectParams[0];
         HashSet<SteamAudioListener> mListeners = new HashSet<SteamAudioListener>();
         RaycastHit[] mRayHits = new RaycastHit[1];
         IntPtr mMaterialBuffer = IntPtr.Zero;
-        Thread mSimulationThread = null;
-        EventWaitHandle mSimulationThreadWaitHandle = null;
-        bool mStopSimulationThread = false;
-        bool mSimulationCompleted = false;
-        float mSimulationUpdateTimeElapsed = 0.0f;
         bool mSceneCommitRequired = false;
 
         static SteamAudioManager sSingleton = null;
@@ -412,10 +409,7 @@ namespace SteamAudio
 
                 mSimulator = new Simulator(mContext, simulationSettings);
 
-                mSimulationThreadWaitHandle = new EventWaitHandle(false, EventResetMode.AutoReset);
-
-                mSimulationThread = new Thread(RunSimulation);
-                mSimulationThread.Start();
+                StartSimulationScheduler();
 
                 mAudioEngineState = AudioEngineState.Create(SteamAudioSettings.Singleton.audioEngine);
                 if (mAudioEngineState != null)
@@ -484,18 +478,30 @@ namespace SteamAudio
             if (mCurrentScene == null || mSimulator == null)
                 return;
 
-            if (mSimulationThread.ThreadState == ThreadState.WaitSleepJoin)
+            var frame = new SimulationFrame { };
+            API.iplUnityBeginSimulationFrame(Time.deltaTime, mCurrentScene.Get(), mSceneCommitRequired ? Bool.True : Bool.False, out frame);
+
+            if (frame.sceneCommitted == Bool.True)
+            {
+                mSceneCommitRequired = false;
+            }
+
+            if (frame.completedFlags != 0 || frame.readyFlags != 0)
+            {
+                UpdateSources(frame.completedFlags, frame.readyFlags);
+            }
+
+            if (frame.completedFlags != 0)
             {
-                if (mSceneCommitRequired)
+                foreach (var listener in mListeners)
                 {
-                    mCurrentScene.Commit();
-                    mSceneCommitRequired = false;
+                    listener.UpdateOutputs(frame.completedFlags);
                 }
-
-                mSimulator.SetScene(mCurrentScene);
-                mSimulator.Commit();
             }
 
+            if (frame.readyFlags == 0)
+                return;
+
             var sharedInputs = new SimulationSharedInputs { };
 
             if (mListener != null)
@@ -514,102 +520,65 @@ namespace SteamAudio
             sharedInputs.pathingVisualizationCallback = null;
             sharedInputs.pathingUserData = IntPtr.Zero;
 
-            mSimulator.SetSharedInputs(SimulationFlags.Direct, sharedInputs);
-
-            foreach (var source in mSources)
-            {
-                source.SetInputs(SimulationFlags.Direct);
-            }
-
             foreach (var listener in mListeners)
             {
-                listener.SetInputs(SimulationFlags.Direct);
+                listener.SetInputs(frame.readyFlags);
             }
 
-            mSimulator.RunDirect();
+            API.iplUnityEndSimulationFrame(sharedInputs);
+        }
 
-            foreach (var source in mSources)
+        // Reads the direct simulation outputs of every source, and sets their inputs, with a single call into the
+        // native plugin instead of two per source.
+        void UpdateSources(SimulationFlags completedFlags, SimulationFlags readyFlags)
+        {
+            var numSources = mSources.Count;
+
+            if (mSourceList.Length < numSources)
             {
-                source.UpdateOutputs(SimulationFlags.Direct);
+                var capacity = Math.Max(numSources, 2 * mSourceList.Length);
+                mSourceList = new SteamAudioSource[capacity];
+                mSourceInputs = new SourceInputs[capacity];
+                mSourceOutputs = new DirectEffectParams[capacity];
             }
 
-            foreach (var listener in mListeners)
+            var index = 0;
+            foreach (var source in mSources)
             {
-                listener.UpdateOutputs(SimulationFlags.Direct);
+                mSourceList[index] = source;
+                source.GetInputs(ref mSourceInputs[index]);
+                ++index;
             }
 
-            mSimulationUpdateTimeElapsed += Time.deltaTime;
-            if (mSimulationUpdateTimeElapsed < SteamAudioSettings.Singleton.simulationUpdateInterval)
-                return;
-
-            mSimulationUpdateTimeElapsed = 0.0f;
+            API.iplUnityUpdateSources(completedFlags, readyFlags, numSources, mSourceInputs, mSourceOutputs);
 
-            if (mSimulationThread.ThreadState == ThreadState.WaitSleepJoin)
+            if ((completedFlags & SimulationFlags.Direct) != 0)
             {
-                if (mSimulationCompleted)
-                {
-                    mSimulationCompleted = false;
-
-                    foreach (var source in mSources)
-                    {
-                        source.UpdateOutputs(SimulationFlags.Reflections | SimulationFlags.Pathing);
-                    }
-
-                    foreach (var listener in mListeners)
-                    {
-                        listener.UpdateOutputs(SimulationFlags.Reflections | SimulationFlags.Pathing);
-                    }
-                }
-
-                mSimulator.SetSharedInputs(SimulationFlags.Reflections | SimulationFlags.Pathing, sharedInputs);
-
-                foreach (var source in mSources)
-                {
-                    source.SetInputs(SimulationFlags.Reflections | SimulationFlags.Pathing);
-                }
-
-                foreach (var listener in mListeners)
-                {
-                    listener.SetInputs(SimulationFlags.Reflections | SimulationFlags.Pathing);
-                }
-
-                if (SteamAudioSettings.Singleton.sceneType == SceneType.Custom)
-                {
-                    // The Unity ray tracer must be called from the main thread only, so run the simulation here.
-                    // It's not suitable for heavy workloads anyway, so we assume that the performance hit is
-                    // acceptable. If not, we recommend switching to one of the other ray tracers.
-                    RunSimulationInternal();
-                }
-                else
+                for (var i = 0; i < numSources; ++i)
                 {
-                    mSimulationThreadWaitHandle.Set();
+                    mSourceList[i].UpdateOutputs(ref mSourceOutputs[i]);
                 }
             }
-        }
-#endif
-
-        void RunSimulationInternal()
-        {
-            if (mSimulator == null)
-                return;
-
-            mSimulator.RunReflections();
-            mSimulator.RunPathing();
 
-            mSimulationCompleted = true;
+            Array.Clear(mSourceList, 0, numSources);
         }
+#endif
 
-        void RunSimulation()
+        // Runs direct and indirect (reflections and pathing) simulation on native threads owned by audioplugin_phonon. The Unity ray
+        // tracer must be called from the main thread only, so with it, all simulation runs in LateUpdate instead. It's
+        // not suitable for heavy workloads anyway, so we assume that the performance hit is acceptable. If not, we
+        // recommend switching to one of the other ray tracers.
+        void StartSimulationScheduler()
         {
-            while (!mStopSimulationThread)
-            {
-                mSimulationThreadWaitHandle.WaitOne();
-
-                if (mStopSimulationThread)
-                    break;
+            var schedulerSettings = new SimulationSchedulerSettings { };
+            schedulerSettings.simulator = mSimulator.Get();
+            schedulerSettings.direct.updateInterval = SteamAudioSettings.Singleton.directSimulationUpdateInterval;
+            schedulerSettings.direct.priority = SteamAudioSettings.Singleton.directSimulationPriority;
+            schedulerSettings.indirect.updateInterval = SteamAudioSettings.Singleton.simulationUpdateInterval;
+            schedulerSettings.indirect.priority = SteamAudioSettings.Singleton.indirectSimulationPriority;
+            schedulerSettings.runOnCallingThread = (SteamAudioSettings.Singleton.sceneType == SceneType.Custom) ? Bool.True : Bool.False;
 
-                RunSimulationInternal();
-            }
+            API.iplUnityStartSimulationScheduler(schedulerSettings);
         }
 
         public static void Initialize(ManagerInitReason reason)
@@ -629,11 +598,9 @@ namespace SteamAudio
 
         public static void ShutDown()
         {
-            if (sSingleton.mSimulationThread != null)
+            if (sSingleton.mSimulator != null)
             {
-                sSingleton.mStopSimulationThread = true;
-                sSingleton.mSimulationThreadWaitHandle.Set();
-                sSingleton.mSimulationThread.Join();
+                API.iplUnityStopSimulationScheduler();
             }
 
             RemoveAllDynamicObjects(force: true);
@@ -692,11 +659,9 @@ namespace SteamAudio
 
         public static void Reinitialize()
         {
-            if (sSingleton.mSimulationThread != null)
+            if (sSingleton.mSimulator != null)
             {
-                sSingleton.mStopSimulationThread = true;
-                sSingleton.mSimulationThreadWaitHandle.Set();
-                sSingleton.mSimulationThread.Join();
+                API.iplUnityStopSimulationScheduler();
             }
 
             RemoveAllDynamicObjects(force: true);
@@ -809,9 +774,7 @@ namespace SteamAudio
 
             sSingleton.mSimulator = new Simulator(sSingleton.mContext, simulationSettings);
 
-            sSingleton.mStopSimulationThread = false;
-            sSingleton.mSimulationThread = new Thread(sSingleton.RunSimulation);
-            sSingleton.mSimulationThread.Start();
+            sSingleton.StartSimulationScheduler();
 
             sSingleton.mAudioEngineState = AudioEngineState.Create(SteamAudioSettings.Singleton.audioEngine);
             if (sSingleton.mAudioEngineState != null)
@@ -91,6 +91,12 @@ namespace SteamAudio
         [Header("Simulation Update Settings")]
         [Range(0.1f, 1.0f)]
         public float simulationUpdateInterval = 0.1f;
+        [Range(0.0f, 1.0f)]
+        public float directSimulationUpdateInterval = 0.0f;
+        [Range(-2, 2)]
+        public int directSimulationPriority = 0;
+        [Range(-2, 2)]
+        public int indirectSimulationPriority = 0;
 
         [Header("Reflection Effect Settings")]
         public ReflectionEffectType reflectionEffectType = ReflectionEffectType.Convolution;
@@ -122,6 +128,12 @@ namespace SteamAudio
 
         [Header("Advanced Settings")]
         public bool EnableValidation = false;
+        public bool AutotuneSIMDLevel = false;
+        public bool PipelinedSpatialization = false;
+        [Range(0, 16)]
+        public int PipelineThreads = 0;
+        [Range(0.1f, 1.0f)]
+        public float PipelineMaxWait = 0.5f;
 
         static SteamAudioSettings sSingleton = null;
 
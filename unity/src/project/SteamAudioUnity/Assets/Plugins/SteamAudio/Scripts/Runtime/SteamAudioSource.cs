@@ -153,6 +153,8 @@ namespace SteamAudio
         DistanceAttenuationModel mCurveAttenuationModel = new DistanceAttenuationModel { };
         GCHandle mThis;
         SteamAudioSettings mSettings = null;
+        SimulationInputs mInputTemplate = new SimulationInputs { };
+        bool mInputTemplateSet = false;
 
         private void Awake()
         {
@@ -209,6 +211,12 @@ namespace SteamAudio
 
             if (mSource != null)
             {
+                if (mInputTemplateSet)
+                {
+                    API.iplUnityRemoveSourceInputTemplate(mSource.Get());
+                    mInputTemplateSet = false;
+                }
+
                 mSource.Release();
                 mSource = null;
             }
@@ -264,11 +272,58 @@ namespace SteamAudio
             var listener = SteamAudioManager.GetSteamAudioListener();
 
             var inputs = new SimulationInputs { };
+            GetInputTemplate(listener, ref inputs);
+
             inputs.source.origin = Common.ConvertVector(transform.position);
             inputs.source.ahead = Common.ConvertVector(transform.forward);
             inputs.source.up = Common.ConvertVector(transform.up);
             inputs.source.right = Common.ConvertVector(transform.right);
+            inputs.directivity.dipoleWeight = dipoleWeight;
+            inputs.directivity.dipolePower = dipolePower;
+            inputs.occlusionType = occlusionType;
+            inputs.occlusionRadius = occlusionRadius;
+            inputs.numOcclusionSamples = occlusionSamples;
+            inputs.numTransmissionRays = maxTransmissionSurfaces;
+            inputs.flags = GetSimulationFlags(listener);
+            inputs.directFlags = GetDirectSimulationFlags();
 
+            mSource.SetInputs(flags, inputs);
+        }
+
+        // Fills in this source's record for API.iplUnityUpdateSources. If any of the inputs that are not part of the
+        // record have changed since the last call, they are sent to the native plugin first.
+        public void GetInputs(ref SourceInputs record)
+        {
+            var listener = SteamAudioManager.GetSteamAudioListener();
+
+            var inputTemplate = new SimulationInputs { };
+            GetInputTemplate(listener, ref inputTemplate);
+
+            if (!mInputTemplateSet || !InputTemplatesEqual(ref inputTemplate, ref mInputTemplate))
+            {
+                API.iplUnitySetSourceInputTemplate(mSource.Get(), ref inputTemplate);
+                mInputTemplate = inputTemplate;
+                mInputTemplateSet = true;
+            }
+
+            record.source = mSource.Get();
+            record.flags = GetSimulationFlags(listener);
+            record.directFlags = GetDirectSimulationFlags();
+            record.transform.origin = Common.ConvertVector(transform.position);
+            record.transform.ahead = Common.ConvertVector(transform.forward);
+            record.transform.up = Common.ConvertVector(transform.up);
+            record.transform.right = Common.ConvertVector(transform.right);
+            record.dipoleWeight = dipoleWeight;
+            record.dipolePower = dipolePower;
+            record.occlusionType = occlusionType;
+            record.occlusionRadius = occlusionRadius;
+            record.numOcclusionSamples = occlusionSamples;
+            record.numTransmissionRays = maxTransmissionSurfaces;
+        }
+
+        // Fills in the inputs that usually only change when this source's settings do.
+        void GetInputTemplate(SteamAudioListener listener, ref SimulationInputs inputs)
+        {
             if (mSettings.audioEngine == AudioEngineType.Unity &&
                 distanceAttenuation &&
                 distanceAttenuationInput == DistanceAttenuationInput.CurveDriven &&
@@ -283,12 +338,6 @@ namespace SteamAudio
             }
 
             inputs.airAbsorptionModel.type = AirAbsorptionModelType.Default;
-            inputs.directivity.dipoleWeight = dipoleWeight;
-            inputs.directivity.dipolePower = dipolePower;
-            inputs.occlusionType = occlusionType;
-            inputs.occlusionRadius = occlusionRadius;
-            inputs.numOcclusionSamples = occlusionSamples;
-            inputs.numTransmissionRays = maxTransmissionSurfaces;
             inputs.reverbScaleLow = 1.0f;
             inputs.reverbScaleMid = 1.0f;
             inputs.reverbScaleHigh = 1.0f;
@@ -317,15 +366,18 @@ namespace SteamAudio
                     inputs.bakedDataIdentifier = listener.currentBakedListener.GetBakedDataIdentifier();
                 }
             }
+        }
 
-            inputs.flags = SimulationFlags.Direct;
+        SimulationFlags GetSimulationFlags(SteamAudioListener listener)
+        {
+            var flags = SimulationFlags.Direct;
             if (reflections)
             {
                 if ((reflectionsType == ReflectionsType.Realtime) ||
                     (reflectionsType == ReflectionsType.BakedStaticSource && currentBakedSource != null) ||
                     (reflectionsType == ReflectionsType.BakedStaticListener && listener != null && listener.currentBakedListener != null))
                 {
-                    inputs.flags = inputs.flags | SimulationFlags.Reflections;
+                    flags = flags | SimulationFlags.Reflections;
                 }
             }
             if (pathing)
@@ -337,23 +389,54 @@ namespace SteamAudio
                 }
                 else
                 {
-                    inputs.flags = inputs.flags | SimulationFlags.Pathing;
+                    flags = flags | SimulationFlags.Pathing;
                 }
             }
 
-            inputs.directFlags = 0;
+            return flags;
+        }
+
+        DirectSimulationFlags GetDirectSimulationFlags()
+        {
+            DirectSimulationFlags flags = 0;
             if (distanceAttenuation)
-                inputs.directFlags = inputs.directFlags | DirectSimulationFlags.DistanceAttenuation;
+                flags = flags | DirectSimulationFlags.DistanceAttenuation;
             if (airAbsorption)
-                inputs.directFlags = inputs.directFlags | DirectSimulationFlags.AirAbsorption;
+                flags = flags | DirectSimulationFlags.AirAbsorption;
             if (directivity)
-                inputs.directFlags = inputs.directFlags | DirectSimulationFlags.Directivity;
+                flags = flags | DirectSimulationFlags.Directivity;
             if (occlusion)
-                inputs.directFlags = inputs.directFlags | DirectSimulationFlags.Occlusion;
+                flags = flags | DirectSimulationFlags.Occlusion;
             if (transmission)
-                inputs.directFlags = inputs.directFlags | DirectSimulationFlags.Transmission;
+                flags = flags | DirectSimulationFlags.Transmission;
 
-            mSource.SetInputs(flags, inputs);
+            return flags;
+        }
+
+        // Compares only the fields filled in by GetInputTemplate.
+        static bool InputTemplatesEqual(ref SimulationInputs a, ref SimulationInputs b)
+        {
+            return a.distanceAttenuationModel.type == b.distanceAttenuationModel.type &&
+                   a.distanceAttenuationModel.minDistance == b.distanceAttenuationModel.minDistance &&
+                   a.distanceAttenuationModel.callback == b.distanceAttenuationModel.callback &&
+                   a.distanceAttenuationModel.userData == b.distanceAttenuationModel.userData &&
+                   a.distanceAttenuationModel.dirty == b.distanceAttenuationModel.dirty &&
+                   a.hybridReverbTransitionTime == b.hybridReverbTransitionTime &&
+                   a.hybridReverbOverlapPercent == b.hybridReverbOverlapPercent &&
+                   a.baked == b.baked &&
+                   a.bakedDataIdentifier.type == b.bakedDataIdentifier.type &&
+                   a.bakedDataIdentifier.variation == b.bakedDataIdentifier.variation &&
+                   a.bakedDataIdentifier.endpointInfluence.center.x == b.bakedDataIdentifier.endpointInfluence.center.x &&
+                   a.bakedDataIdentifier.endpointInfluence.center.y == b.bakedDataIdentifier.endpointInfluence.center.y &&
+                   a.bakedDataIdentifier.endpointInfluence.center.z == b.bakedDataIdentifier.endpointInfluence.center.z &&
+                   a.bakedDataIdentifier.endpointInfluence.radius == b.bakedDataIdentifier.endpointInfluence.radius &&
+                   a.pathingProbes == b.pathingProbes &&
+                   a.visRadius == b.visRadius &&
+                   a.visThreshold == b.visThreshold &&
+                   a.visRange == b.visRange &&
+                   a.pathingOrder == b.pathingOrder &&
+                   a.enableValidation == b.enableValidation &&
+                   a.findAlternatePaths == b.findAlternatePaths;
         }
 
         public SimulationOutputs GetOutputs(SimulationFlags flags)
@@ -370,37 +453,9 @@ namespace SteamAudio
         {
             var outputs = mSource.GetOutputs(flags);
 
-            if (SteamAudioSettings.Singleton.audioEngine == AudioEngineType.Unity &&
-                ((flags & SimulationFlags.Direct) != 0))
+            if ((flags & SimulationFlags.Direct) != 0)
             {
-                if (distanceAttenuation && distanceAttenuationInput == DistanceAttenuationInput.PhysicsBased)
-                {
-                    distanceAttenuationValue = outputs.direct.distanceAttenuation;
-                }
-
-                if (airAbsorption && airAbsorptionInput == AirAbsorptionInput.SimulationDefined)
-                {
-                    airAbsorptionLow = outputs.direct.airAbsorptionLow;
-                    airAbsorptionMid = outputs.direct.airAbsorptionMid;
-                    airAbsorptionHigh = outputs.direct.airAbsorptionHigh;
-                }
-
-                if (directivity && directivityInput == DirectivityInput.SimulationDefined)
-                {
-                    directivityValue = outputs.direct.directivity;
-                }
-
-                if (occlusion && occlusionInput == OcclusionInput.SimulationDefined)
-                {
-                    occlusionValue = outputs.direct.occlusion;
-                }
-
-                if (transmission && transmissionInput == TransmissionInput.SimulationDefined)
-                {
-                    transmissionLow = outputs.direct.transmissionLow;
-                    transmissionMid = outputs.direct.transmissionMid;
-                    transmissionHigh = outputs.direct.transmissionHigh;
-                }
+                UpdateOutputs(ref outputs.direct);
             }
 
             if (pathing && ((flags & SimulationFlags.Pathing) != 0))
@@ -411,6 +466,42 @@ namespace SteamAudio
             }
         }
 
+        // Applies the direct simulation outputs read by API.iplUnityUpdateSources, or by UpdateOutputs above.
+        public void UpdateOutputs(ref DirectEffectParams direct)
+        {
+            if (SteamAudioSettings.Singleton.audioEngine != AudioEngineType.Unity)
+                return;
+
+            if (distanceAttenuation && distanceAttenuationInput == DistanceAttenuationInput.PhysicsBased)
+            {
+                distanceAttenuationValue = direct.distanceAttenuation;
+            }
+
+            if (airAbsorption && airAbsorptionInput == AirAbsorptionInput.SimulationDefined)
+            {
+                airAbsorptionLow = direct.airAbsorptionLow;
+                airAbsorptionMid = direct.airAbsorptionMid;
+                airAbsorptionHigh = direct.airAbsorptionHigh;
+            }
+
+            if (directivity && directivityInput == DirectivityInput.SimulationDefined)
+            {
+                directivityValue = direct.directivity;
+            }
+
+            if (occlusion && occlusionInput == OcclusionInput.SimulationDefined)
+            {
+                occlusionValue = direct.occlusion;
+            }
+
+            if (transmission && transmissionInput == TransmissionInput.SimulationDefined)
+            {
+                transmissionLow = direct.transmissionLow;
+                transmissionMid = direct.transmissionMid;
+                transmissionHigh = direct.transmissionHigh;
+            }
+        }
+
         void InitializeDeformedSphereMesh(int nPhi, int nTheta)
         {
             var dPhi = (2.0f * Mathf.PI) / nPhi;
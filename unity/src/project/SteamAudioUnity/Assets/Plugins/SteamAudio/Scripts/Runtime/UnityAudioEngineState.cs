@@ -17,6 +17,12 @@ namespace SteamAudio
             API.iplUnitySetHRTF(defaultHRTF);
             API.iplUnitySetSimulationSettings(simulationSettings);
             API.iplUnitySetPerspectiveCorrection(correction);
+
+            var pipelineSettings = new PipelineSettings { };
+            pipelineSettings.enabled = SteamAudioSettings.Singleton.PipelinedSpatialization ? Bool.True : Bool.False;
+            pipelineSettings.numThreads = SteamAudioSettings.Singleton.PipelineThreads;
+            pipelineSettings.maxWait = SteamAudioSettings.Singleton.PipelineMaxWait;
+            API.iplUnitySetPipelineSettings(pipelineSettings);
         }
 
         public override void Destroy()
@@ -22,10 +22,12 @@ USteamAudioSourceComponent::USteamAudioSourceComponent()
     , OcclusionRadius(1.0f)
     , OcclusionSamples(16)
     , OcclusionValue(1.0f)
+    , bDriveOcclusionFromComponent(false)
     , bSimulateTransmission(false)
     , TransmissionLowValue(1.0f)
     , TransmissionMidValue(1.0f)
     , TransmissionHighValue(1.0f)
+    , bDriveTransmissionFromComponent(false)
     , MaxTransmissionSurfaces(1)
     , bSimulateReflections(false)
     , ReflectionsType(EReflectionSimulationType::REALTIME)
@@ -196,6 +198,8 @@ bool USteamAudioSourceComponent::CanEditChange(const FProperty* InProperty) cons
         return bParentVal && bSimulateOcclusion && (OcclusionType == EOcclusionType::VOLUMETRIC);
     if ((InProperty->GetFName() == GET_MEMBER_NAME_CHECKED(USteamAudioSourceComponent, OcclusionValue)))
         return bParentVal && !bSimulateOcclusion;
+    if ((InProperty->GetFName() == GET_MEMBER_NAME_CHECKED(USteamAudioSourceComponent, bDriveOcclusionFromComponent)))
+        return bParentVal && !bSimulateOcclusion;
     if ((InProperty->GetFName() == GET_MEMBER_NAME_CHECKED(USteamAudioSourceComponent, bSimulateTransmission)))
         return bParentVal && bSimulateOcclusion;
     if ((InProperty->GetFName() == GET_MEMBER_NAME_CHECKED(USteamAudioSourceComponent, TransmissionLowValue)))
@@ -204,6 +208,8 @@ bool USteamAudioSourceComponent::CanEditChange(const FProperty* InProperty) cons
         return bParentVal && !bSimulateTransmission;
     if ((InProperty->GetFName() == GET_MEMBER_NAME_CHECKED(USteamAudioSourceComponent, TransmissionHighValue)))
         return bParentVal && !bSimulateTransmission;
+    if ((InProperty->GetFName() == GET_MEMBER_NAME_CHECKED(USteamAudioSourceComponent, bDriveTransmissionFromComponent)))
+        return bParentVal && !bSimulateTransmission;
 	if ((InProperty->GetFName() == GET_MEMBER_NAME_CHECKED(USteamAudioSourceComponent, ReflectionsType)))
 		return bParentVal && bSimulateReflections;
 	if ((InProperty->GetFName() == GET_MEMBER_NAME_CHECKED(USteamAudioSourceComponent, CurrentBakedSource)))
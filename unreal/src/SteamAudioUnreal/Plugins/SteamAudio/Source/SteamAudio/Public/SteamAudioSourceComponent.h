@@ -77,6 +77,11 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = OcclusionSettings, meta = (UIMin = "0.0", UIMax = "1.0"))
     float OcclusionValue;
 
+    /** If true, and using FMOD Studio, OcclusionValue is applied to the Steam Audio Spatializer effect, overriding the
+        value set in FMOD Studio. Only if not simulating occlusion. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = OcclusionSettings)
+    bool bDriveOcclusionFromComponent;
+
     /** If true, transmission will be simulated via ray tracing. Only if simulating occlusion. */
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = OcclusionSettings)
     bool bSimulateTransmission;
@@ -92,6 +97,11 @@ public:
     /** The high frequency (8 kHz and above) EQ value for transmission. Only if not simulating transmission. */
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = OcclusionSettings, meta = (UIMin = "0.0", UIMax = "1.0"))
     float TransmissionHighValue;
+
+    /** If true, and using FMOD Studio, the transmission EQ values are applied to the Steam Audio Spatializer effect,
+        overriding the values set in FMOD Studio. Only if not simulating transmission. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = OcclusionSettings)
+    bool bDriveTransmissionFromComponent;
     
     /** The maximum number of rays to trace when finding surfaces between the source and the listener for the
         purposes of simulating transmission. */
@@ -6,6 +6,7 @@
 #include "Interfaces/IPluginManager.h"
 #include "Kismet/GameplayStatics.h"
 #include "FMODStudioModule.h"
+#include "Misc/CoreDelegates.h"
 #include "FMODStudio/Classes/FMODAudioComponent.h"
 #include "SteamAudioSourceComponent.h"
 
@@ -21,6 +22,8 @@ void F_CALL iplFMODSetSimulationSettings(IPLSimulationSettings SimulationSetting
 void F_CALL iplFMODSetReverbSource(IPLSource ReverbSource);
 IPLint32 F_CALL iplFMODAddSource(IPLSource Source);
 void F_CALL iplFMODRemoveSource(IPLint32 Handle);
+IPLuint32 F_CALL iplFMODGetSpatializerID(void* DSP);
+void F_CALL iplFMODUpdateSources(const IPLint32* Handles, const SteamAudio::IPLFMODSourceParams* Params, IPLint32 NumSources);
 }
 #endif
 
@@ -64,6 +67,8 @@ void FSteamAudioFMODStudioModule::StartupModule()
 	this->iplFMODSetReverbSource = (iplFMODSetReverbSource_t) ::iplFMODSetReverbSource;
 	this->iplFMODAddSource = (iplFMODAddSource_t) ::iplFMODAddSource;
 	this->iplFMODRemoveSource = (iplFMODRemoveSource_t) ::iplFMODRemoveSource;
+	this->iplFMODUpdateSources = (iplFMODUpdateSources_t) ::iplFMODUpdateSources;
+	this->iplFMODGetSpatializerID = (iplFMODGetSpatializerID_t) ::iplFMODGetSpatializerID;
 #else
 	Library = FPlatformProcess::GetDllHandle(*LibraryPath);
 	check(Library);
@@ -76,6 +81,8 @@ void FSteamAudioFMODStudioModule::StartupModule()
 	iplFMODSetReverbSource = (iplFMODSetReverbSource_t) FPlatformProcess::GetDllExport(Library, TEXT("iplFMODSetReverbSource"));
 	iplFMODAddSource = (iplFMODAddSource_t) FPlatformProcess::GetDllExport(Library, TEXT("iplFMODAddSource"));
 	iplFMODRemoveSource = (iplFMODRemoveSource_t) FPlatformProcess::GetDllExport(Library, TEXT("iplFMODRemoveSource"));
+	iplFMODUpdateSources = (iplFMODUpdateSources_t) FPlatformProcess::GetDllExport(Library, TEXT("iplFMODUpdateSources"));
+	iplFMODGetSpatializerID = (iplFMODGetSpatializerID_t) FPlatformProcess::GetDllExport(Library, TEXT("iplFMODGetSpatializerID"));
 #endif
 }
 
@@ -102,10 +109,16 @@ void FFMODStudioAudioEngineState::Initialize(IPLContext Context, IPLHRTF HRTF, c
 	FSteamAudioFMODStudioModule::Get().iplFMODInitialize(Context);
 	FSteamAudioFMODStudioModule::Get().iplFMODSetHRTF(HRTF);
 	FSteamAudioFMODStudioModule::Get().iplFMODSetSimulationSettings(SimulationSettings);
+
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FFMODStudioAudioEngineState::FlushSourceParams);
 }
 
 void FFMODStudioAudioEngineState::Destroy()
 {
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	QueuedHandles.Empty();
+	QueuedParams.Empty();
+
 	if (FSteamAudioFMODStudioModule::Get().Library)
 	{
 		FSteamAudioFMODStudioModule::Get().iplFMODTerminate();
@@ -180,7 +193,28 @@ IPLAudioSettings FFMODStudioAudioEngineState::GetAudioSettings()
 
 TSharedPtr<IAudioEngineSource> FFMODStudioAudioEngineState::CreateAudioEngineSource()
 {
-	return MakeShared<FFMODStudioAudioEngineSource>();
+	return MakeShared<FFMODStudioAudioEngineSource>(this);
+}
+
+void FFMODStudioAudioEngineState::QueueSourceParams(IPLint32 Handle, const IPLFMODSourceParams& Params)
+{
+	QueuedHandles.Add(Handle);
+	QueuedParams.Add(Params);
+}
+
+void FFMODStudioAudioEngineState::FlushSourceParams()
+{
+	if (QueuedHandles.Num() == 0)
+		return;
+
+	// Older versions of the FMOD Studio plugin don't export this function.
+	if (FSteamAudioFMODStudioModule::Get().iplFMODUpdateSources)
+	{
+		FSteamAudioFMODStudioModule::Get().iplFMODUpdateSources(QueuedHandles.GetData(), QueuedParams.GetData(), QueuedHandles.Num());
+	}
+
+	QueuedHandles.Reset();
+	QueuedParams.Reset();
 }
 
 FMOD::System* FFMODStudioAudioEngineState::GetSystem()
@@ -205,9 +239,13 @@ FMOD::System* FFMODStudioAudioEngineState::GetSystem()
 // FFMODStudioAudioEngineSource
 // ---------------------------------------------------------------------------------------------------------------------
 
-FFMODStudioAudioEngineSource::FFMODStudioAudioEngineSource()
-	: FMODAudioComponent(nullptr)
+FFMODStudioAudioEngineSource::FFMODStudioAudioEngineSource(FFMODStudioAudioEngineState* State)
+	: State(State)
+	, FMODAudioComponent(nullptr)
 	, DSP(nullptr)
+	, DSPID(0)
+	, HandleDSP(nullptr)
+	, SentHandle(-1)
 	, SourceComponent(nullptr)
 	, Handle(-1)
 {}
@@ -239,14 +277,52 @@ void FFMODStudioAudioEngineSource::UpdateParameters(USteamAudioSourceComponent*
 
 	FMOD::DSP* MyDSP = GetDSP();
 
-	if (MyDSP)
+	// The handle only needs to be sent when it or the DSP changes. Everything else is sent in bulk at the end of the
+	// frame.
+	if (MyDSP && (MyDSP != HandleDSP || Handle != SentHandle))
 	{
 		MyDSP->setParameterInt(kSimulationOutputsParamIndex, Handle);
+		HandleDSP = MyDSP;
+		SentHandle = Handle;
+	}
+
+	if (State && Handle >= 0)
+	{
+		IPLFMODSourceParams Params{};
+
+		// User-defined values are only sent if the component opts in, so that by default, values set in FMOD Studio
+		// are not overwritten.
+		if (!SteamAudioSourceComponent->bSimulateOcclusion && SteamAudioSourceComponent->bDriveOcclusionFromComponent)
+		{
+			Params.flags = (IPLFMODSourceParamsFlags) (Params.flags | IPL_FMODSOURCEPARAMSFLAGS_OCCLUSION);
+			Params.occlusion = SteamAudioSourceComponent->OcclusionValue;
+		}
+
+		if (!SteamAudioSourceComponent->bSimulateTransmission && SteamAudioSourceComponent->bDriveTransmissionFromComponent)
+		{
+			Params.flags = (IPLFMODSourceParamsFlags) (Params.flags | IPL_FMODSOURCEPARAMSFLAGS_TRANSMISSION);
+			Params.transmission[0] = SteamAudioSourceComponent->TransmissionLowValue;
+			Params.transmission[1] = SteamAudioSourceComponent->TransmissionMidValue;
+			Params.transmission[2] = SteamAudioSourceComponent->TransmissionHighValue;
+		}
+
+		if (Params.flags)
+		{
+			State->QueueSourceParams(Handle, Params);
+		}
 	}
 }
 
 FMOD::DSP* FFMODStudioAudioEngineSource::GetDSP()
 {
+	// If the event was stopped or restarted, the spatializer we found earlier has been released.
+	if (DSP && DSPID != 0 && FSteamAudioFMODStudioModule::Get().iplFMODGetSpatializerID(DSP) != DSPID)
+	{
+		DSP = nullptr;
+		DSPID = 0;
+		HandleDSP = nullptr;
+	}
+
 	if (FMODAudioComponent && !DSP)
 	{
 		FMOD::Studio::EventInstance* EventInstance = FMODAudioComponent->StudioInstance;
@@ -264,22 +340,10 @@ FMOD::DSP* FFMODStudioAudioEngineSource::GetDSP()
 					{
 						FMOD::DSP* CurDSP = nullptr;
 						Result = ChannelGroup->getDSP(i, &CurDSP);
-						if (Result == FMOD_OK && CurDSP)
+						if (Result == FMOD_OK && CurDSP && IsSpatializerDSP(CurDSP, DSPID))
 						{
-							char Name[64] = {0};
-							unsigned int Version = 0;
-							int Channels = 0;
-							int Width = 0;
-							int Height = 0;
-							Result = CurDSP->getInfo(Name, &Version, &Channels, &Width, &Height);
-							if (Result == FMOD_OK)
-							{
-								if (strncmp(Name, "Steam Audio Spatializer", 64) == 0)
-								{
-									DSP = CurDSP;
-									break;
-								}
-							}
+							DSP = CurDSP;
+							break;
 						}
 					}
 				}
@@ -290,6 +354,27 @@ FMOD::DSP* FFMODStudioAudioEngineSource::GetDSP()
 	return DSP;
 }
 
+bool FFMODStudioAudioEngineSource::IsSpatializerDSP(FMOD::DSP* CandidateDSP, IPLuint32& ID)
+{
+	// The plugin keeps a registry of live spatializers, which is much cheaper to query than the DSP's name.
+	if (FSteamAudioFMODStudioModule::Get().iplFMODGetSpatializerID)
+	{
+		ID = FSteamAudioFMODStudioModule::Get().iplFMODGetSpatializerID(CandidateDSP);
+		return (ID != 0);
+	}
+
+	// Older versions of the plugin don't have a registry, so fall back to checking the name.
+	ID = 0;
+
+	char Name[64] = {0};
+	unsigned int Version = 0;
+	int Channels = 0;
+	int Width = 0;
+	int Height = 0;
+	FMOD_RESULT Result = CandidateDSP->getInfo(Name, &Version, &Channels, &Width, &Height);
+	return (Result == FMOD_OK && strncmp(Name, "Steam Audio Spatializer", 64) == 0);
+}
+
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -19,6 +19,27 @@ namespace SteamAudio {
 // FSteamAudioFMODStudioModule
 // ---------------------------------------------------------------------------------------------------------------------
 
+/** Equivalent to IPLFMODSourceParamsFlags in the Steam Audio FMOD Studio plugin. */
+enum IPLFMODSourceParamsFlags
+{
+    IPL_FMODSOURCEPARAMSFLAGS_OCCLUSION = 1 << 0,
+    IPL_FMODSOURCEPARAMSFLAGS_TRANSMISSION = 1 << 1,
+    IPL_FMODSOURCEPARAMSFLAGS_DIRECTMIXLEVEL = 1 << 2,
+    IPL_FMODSOURCEPARAMSFLAGS_REFLECTIONSMIXLEVEL = 1 << 3,
+    IPL_FMODSOURCEPARAMSFLAGS_PATHINGMIXLEVEL = 1 << 4,
+};
+
+/** Equivalent to IPLFMODSourceParams in the Steam Audio FMOD Studio plugin. */
+struct IPLFMODSourceParams
+{
+    IPLFMODSourceParamsFlags flags;
+    IPLfloat32 occlusion;
+    IPLfloat32 transmission[3];
+    IPLfloat32 directMixLevel;
+    IPLfloat32 reflectionsMixLevel;
+    IPLfloat32 pathingMixLevel;
+};
+
 typedef void (F_CALL* iplFMODGetVersion_t)(unsigned int* Major, unsigned int* Minor, unsigned int* Patch);
 typedef void (F_CALL* iplFMODInitialize_t)(IPLContext Context);
 typedef void (F_CALL* iplFMODTerminate_t)();
@@ -27,6 +48,8 @@ typedef void (F_CALL* iplFMODSetSimulationSettings_t)(IPLSimulationSettings Simu
 typedef void (F_CALL* iplFMODSetReverbSource_t)(IPLSource ReverbSource);
 typedef IPLint32 (F_CALL* iplFMODAddSource_t)(IPLSource Source);
 typedef void (F_CALL* iplFMODRemoveSource_t)(IPLint32 Handle);
+typedef IPLuint32 (F_CALL* iplFMODGetSpatializerID_t)(void* DSP);
+typedef void (F_CALL* iplFMODUpdateSources_t)(const IPLint32* Handles, const IPLFMODSourceParams* Params, IPLint32 NumSources);
 
 class FSteamAudioFMODStudioModule : public IAudioEngineStateFactory
 {
@@ -43,6 +66,8 @@ public:
     iplFMODSetReverbSource_t iplFMODSetReverbSource;
     iplFMODAddSource_t iplFMODAddSource;
     iplFMODRemoveSource_t iplFMODRemoveSource;
+    iplFMODUpdateSources_t iplFMODUpdateSources;
+    iplFMODGetSpatializerID_t iplFMODGetSpatializerID;
 
     /**
      * Inherited from IModuleInterface
@@ -102,6 +127,9 @@ public:
     /** Returns the FMOD core system instance. */
     FMOD::System* GetSystem();
 
+    /** Queues parameters for a source, to be sent along with those of all other sources at the end of the frame. */
+    void QueueSourceParams(IPLint32 Handle, const IPLFMODSourceParams& Params);
+
 private:
     /** The FMOD Studio system. */
     FMOD::Studio::System* StudioSystem;
@@ -109,8 +137,20 @@ private:
     /** The FMOD core system. */
     FMOD::System* CoreSystem;
 
+    /** Handles of the sources whose parameters have been queued this frame. */
+    TArray<IPLint32> QueuedHandles;
+
+    /** Parameters queued this frame, one for each element of QueuedHandles. */
+    TArray<IPLFMODSourceParams> QueuedParams;
+
+    /** Registration of FlushSourceParams with the end-of-frame delegate. */
+    FDelegateHandle EndFrameHandle;
+
     /** Converts a vector from FMOD Studio's coordinate system to Unreal's coordinate system. */
     FVector ConvertVectorFromFMODStudio(const FMOD_VECTOR& FMODStudioVector);
+
+    /** Sends all parameters queued this frame to the Steam Audio FMOD Studio plugin in a single call. */
+    void FlushSourceParams();
 };
 
 
@@ -124,7 +164,7 @@ private:
 class FFMODStudioAudioEngineSource : public IAudioEngineSource
 {
 public:
-    FFMODStudioAudioEngineSource();
+    FFMODStudioAudioEngineSource(FFMODStudioAudioEngineState* State);
 
     /**
      * Inherited from IAudioEngineState
@@ -143,17 +183,32 @@ public:
     FMOD::DSP* GetDSP();
 
 private:
+    /** The audio engine state that created this source. */
+    FFMODStudioAudioEngineState* State;
+
     /** The FMOD Audio component corresponding to this source. */
     UFMODAudioComponent* FMODAudioComponent;
 
     /** The DSP effect we want to communicate with. */
     FMOD::DSP* DSP;
 
+    /** The ID of DSP, as returned by iplFMODGetSpatializerID. Used to detect when DSP has been released. */
+    IPLuint32 DSPID;
+
+    /** The DSP effect to which a handle was last sent. */
+    FMOD::DSP* HandleDSP;
+
+    /** The handle that was last sent to HandleDSP. */
+    int SentHandle;
+
     /** The Steam Audio Source component corresponding to this source. */
     USteamAudioSourceComponent* SourceComponent;
 
     /** The handle of the Steam Audio Source, obtained via iplFMODAddSource. */
     int Handle;
+
+    /** Returns true if the given DSP is a Steam Audio Spatializer, and sets ID to its ID (or 0 if unknown). */
+    bool IsSpatializerDSP(FMOD::DSP* CandidateDSP, IPLuint32& ID);
 };
 
 }